@@ -74,7 +74,10 @@ int ext2_lite_init(drive_desc_t* drive_desc, fs_desc_t* fs_desc)
     if (superblock.magic != 0xEF53) {
         return -1;
     }
-    if (superblock.rev_level != 0) {
+    if (superblock.rev_level > 1) {
+        return -1;
+    }
+    if (superblock.rev_level == 1 && superblock.inode_size != INODE_LEN) {
         return -1;
     }
 
@@ -103,11 +106,11 @@ int ext2_lite_has_in_dir(uint32_t block_index, char* path, uint32_t* found_inode
     _ext2_lite_read(tmp_dir_buf, _ext2_lite_get_offset_of_block(block_index), _ext2_lite_get_block_len());
     dir_entry_t* start_of_entry = (dir_entry_t*)tmp_dir_buf;
     for (;;) {
-        if (start_of_entry->inode == 0) {
+        if (start_of_entry->rec_len == 0) {
             return -1;
         }
-        // checking name of this entry
-        bool is_name_correct = true;
+        // checking name of this entry, deleted entries have inode 0
+        bool is_name_correct = (start_of_entry->inode != 0);
         for (int i = 0; i < start_of_entry->name_len; i++) {
             is_name_correct &= (path[i] == *((char*)start_of_entry + 8 + i));
         }
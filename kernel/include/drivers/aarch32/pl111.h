@@ -25,6 +25,9 @@ enum PL111RegisterMasks {
     MASKDEFINE(LCD_BW, 4, 1),
     MASKDEFINE(LCD_BPP, 1, 3),
     MASKDEFINE(LCD_EN, 0, 1),
+
+    MASKDEFINE(LCD_VCOMP, 12, 2),
+    MASKDEFINE(LCD_INT_VCOMP, 3, 1),
 };
 
 enum PL111Consts {
@@ -124,6 +124,13 @@ enum DRIVER_FILE_SYSTEM_OPERTAION {
     DRIVER_FILE_SYSTEM_FSTAT,
     DRIVER_FILE_SYSTEM_IOCTL,
     DRIVER_FILE_SYSTEM_MMAP,
+
+    DRIVER_FILE_SYSTEM_WRITE_INODES,
+    DRIVER_FILE_SYSTEM_SYNC,
+
+    DRIVER_FILE_SYSTEM_READV,
+    DRIVER_FILE_SYSTEM_WRITEV,
+    DRIVER_FILE_SYSTEM_WAIT_QUEUE,
 };
 
 typedef struct {
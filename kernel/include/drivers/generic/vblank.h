@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2020-2021 Nikita Melekhin. All rights reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef _KERNEL_DRIVERS_GENERIC_VBLANK_H
+#define _KERNEL_DRIVERS_GENERIC_VBLANK_H
+
+#include <libkern/types.h>
+
+/* The rate of vblanks, which are emulated for displays without an interrupt. */
+#define VBLANK_EMULATED_RATE 60
+
+/**
+ * Vblank timing of a display. A display with a vblank interrupt counts the
+ * vblanks itself, others get them emulated from the system timer. A reader
+ * asks for the next vblank with BGA_REQUEST_VBLANK and the display becomes
+ * readable, when it comes. Reading gives the vblank counter and disarms it,
+ * so an idle reader is never woken up.
+ */
+struct vblank {
+    uint32_t count;
+    uint32_t armed_at;
+    bool armed;
+    bool has_irq;
+};
+typedef struct vblank vblank_t;
+
+uint32_t vblank_count(vblank_t* vblank);
+void vblank_irq(vblank_t* vblank);
+void vblank_arm(vblank_t* vblank);
+bool vblank_can_read(vblank_t* vblank);
+int vblank_read(vblank_t* vblank, uint8_t* buf, uint32_t len);
+
+#endif //_KERNEL_DRIVERS_GENERIC_VBLANK_H
@@ -53,12 +53,38 @@ struct PACKED superblock {
 
     uint8_t prealloc_blocks;
     uint8_t prealloc_dir_blocks;
+    uint16_t reserved_gdt_blocks;
 
     // current jurnalling is unsupported
-    uint8_t unused[1024 - 206];
+    uint8_t journal_uuid[16];
+    uint32_t journal_inum;
+    uint32_t journal_dev;
+    uint32_t last_orphan;
+
+    /* Directory indexing support */
+    uint32_t hash_seed[4];
+    uint8_t def_hash_version;
+    uint8_t reserved_char_pad[3];
+
+    uint32_t default_mount_opts;
+    uint32_t first_meta_bg;
+    uint8_t unused_ext4[0x160 - 0x108];
+    uint32_t flags;
+    uint8_t unused[1024 - 0x164];
 };
 typedef struct superblock superblock_t;
 
+#define EXT2_FEATURE_COMPAT_DIR_INDEX 0x0020
+#define EXT2_FEATURE_INCOMPAT_FILETYPE 0x0002
+#define EXT2_FEATURE_RO_COMPAT_SPARSE_SUPER 0x0001
+#define EXT2_FEATURE_RO_COMPAT_LARGE_FILE 0x0002
+
+#define EXT2_FEATURE_INCOMPAT_SUPP (EXT2_FEATURE_INCOMPAT_FILETYPE)
+#define EXT2_FEATURE_RO_COMPAT_SUPP (EXT2_FEATURE_RO_COMPAT_SPARSE_SUPER | EXT2_FEATURE_RO_COMPAT_LARGE_FILE)
+
+#define EXT2_FLAGS_SIGNED_HASH 0x0001
+#define EXT2_FLAGS_UNSIGNED_HASH 0x0002
+
 #define GROUP_LEN (sizeof(group_desc_t))
 struct PACKED group_desc {
     uint32_t block_bitmap;
@@ -118,6 +144,8 @@ struct PACKED inode {
 };
 typedef struct inode inode_t;
 
+#define EXT2_INDEX_FL 0x00001000 /* Directory is hash-indexed */
+
 #define DIR_ENTRY_LEN (sizeof(dir_entry_t))
 struct PACKED dir_entry {
     uint32_t inode;
@@ -128,6 +156,51 @@ struct PACKED dir_entry {
 };
 typedef struct dir_entry dir_entry_t;
 
+#define EXT2_FT_UNKNOWN 0
+#define EXT2_FT_REG_FILE 1
+#define EXT2_FT_DIR 2
+#define EXT2_FT_CHRDEV 3
+#define EXT2_FT_BLKDEV 4
+#define EXT2_FT_FIFO 5
+#define EXT2_FT_SOCK 6
+#define EXT2_FT_SYMLINK 7
+
+/**
+ * Hash tree (dir_index) structures. The first block of an indexed dir keeps
+ * "." and ".." entries, where ".." covers the rest of the block, which holds
+ * dx_root_info and dx entries. Internal nodes are blocks with one empty dir
+ * entry covering the whole block, followed by dx entries.
+ * The first dx entry of a node stores dx_countlimit instead of a hash.
+ */
+#define EXT2_HTREE_LEGACY 0
+#define EXT2_HTREE_HALF_MD4 1
+#define EXT2_HTREE_TEA 2
+#define EXT2_HTREE_LEGACY_UNSIGNED 3
+#define EXT2_HTREE_HALF_MD4_UNSIGNED 4
+#define EXT2_HTREE_TEA_UNSIGNED 5
+#define EXT2_HTREE_EOF 0x7fffffffU
+
+struct PACKED dx_root_info {
+    uint32_t reserved_zero;
+    uint8_t hash_version;
+    uint8_t info_length;
+    uint8_t indirect_levels;
+    uint8_t unused_flags;
+};
+typedef struct dx_root_info dx_root_info_t;
+
+struct PACKED dx_countlimit {
+    uint16_t limit;
+    uint16_t count;
+};
+typedef struct dx_countlimit dx_countlimit_t;
+
+struct PACKED dx_entry {
+    uint32_t hash;
+    uint32_t block;
+};
+typedef struct dx_entry dx_entry_t;
+
 void ext2_install();
 
 /* All others apis are avail for VFS throw struct fs_ops_t */
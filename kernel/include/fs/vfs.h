@@ -13,6 +13,7 @@
 #include <fs/ext2/ext2.h>
 #include <libkern/lock.h>
 #include <libkern/syscall_structs.h>
+#include <tasking/wait_queue.h>
 
 #define DENTRY_WAS_IN_CACHE 0
 #define DENTRY_NEWLY_ALLOCATED 1
@@ -70,6 +71,19 @@ struct dentry {
     struct dentry* mounted_dentry;
 
     struct socket* sock;
+
+    /* Cache management, protected by the dentry cache lock. */
+    struct dentry* hash_next;
+    struct dentry* lru_prev;
+    struct dentry* lru_next;
+    bool in_lru;
+    bool loading; /* The inode is being read, the reader holds the dentry's lock. */
+    bool load_failed;
+
+    /* Writeback, protected by the dentry dirty lock. */
+    struct dentry* dirty_prev;
+    struct dentry* dirty_next;
+    bool in_dirty_list;
 };
 typedef struct dentry dentry_t;
 
@@ -78,7 +92,6 @@ struct dentry_cache_list {
     struct dentry_cache_list* next;
     dentry_t* data;
     uint32_t len;
-    lock_t lock;
 };
 typedef struct dentry_cache_list dentry_cache_list_t;
 
@@ -99,12 +112,16 @@ struct file_ops {
     int (*ioctl)(dentry_t* dentry, uint32_t cmd, uint32_t arg);
     int (*fstat)(dentry_t* dentry, fstat_t* stat);
     struct proc_zone* (*mmap)(dentry_t* dentry, mmap_params_t* params);
+    int (*readv)(dentry_t*, const iovec_t*, int, uint32_t); /* Optional, vfs falls back to read for every iovec. */
+    int (*writev)(dentry_t*, const iovec_t*, int, uint32_t); /* Optional, vfs falls back to write for every iovec. */
+    wait_queue_t* (*wait_queue)(dentry_t*); /* Optional, epoll polls files without a wait queue. */
 };
 typedef struct file_ops file_ops_t;
 
 struct dentry_ops {
     int (*read_inode)(dentry_t* dentry);
     int (*write_inode)(dentry_t* dentry);
+    int (*write_inodes)(dentry_t** dentries, uint32_t count); /* Optional, dentries are sorted by inode index. */
     int (*free_inode)(dentry_t* dentry);
     fsdata_t (*get_fsdata)(dentry_t* dentry);
 };
@@ -114,6 +131,7 @@ struct fs_ops {
     int (*recognize)(vfs_device_t* dev);
     int (*prepare_fs)(vfs_device_t* dev);
     int (*eject_device)(vfs_device_t* dev);
+    int (*sync)(vfs_device_t* dev);
 
     file_ops_t file;
     dentry_ops_t dentry;
@@ -129,6 +147,8 @@ typedef struct fs_desc fs_desc_t;
 enum FD_TYPE {
     FD_TYPE_FILE,
     FD_TYPE_SOCKET,
+    FD_TYPE_EPOLL,
+    FD_TYPE_PIPE,
 };
 
 struct file_descriptor {
@@ -136,6 +156,8 @@ struct file_descriptor {
     union {
         dentry_t* dentry; // type == FD_TYPE_FILE
         struct socket* sock_entry; // type == FD_TYPE_SOCKET
+        struct epoll* epoll_entry; // type == FD_TYPE_EPOLL
+        struct pipe* pipe_entry; // type == FD_TYPE_PIPE
     };
     uint32_t offset;
     uint32_t flags;
@@ -143,12 +165,34 @@ struct file_descriptor {
 };
 typedef struct file_descriptor file_descriptor_t;
 
+enum SOCKET_STATE {
+    SOCKET_UNCONNECTED,
+    SOCKET_LISTENING,
+    SOCKET_CONNECTED,
+    SOCKET_DISCONNECTED, /* The peer has closed the connection. */
+};
+
 struct socket {
     uint32_t d_count;
     int domain;
     int type;
     int protocol;
+    int state;
+
+    /* Connected socket: incoming data, the peer writes into it. */
     ringbuffer_t buffer;
+    struct socket* peer;
+
+    /* Woken with EPOLLIN/EPOLLOUT, when the socket becomes readable or writable. */
+    wait_queue_t wait_queue;
+
+    /* Listening socket: connections waiting to be accepted. */
+    struct socket* backlog_head;
+    struct socket* backlog_tail;
+    struct socket* backlog_next;
+    uint32_t backlog_count;
+    uint32_t backlog_limit;
+
     file_descriptor_t bind_file;
 };
 typedef struct socket socket_t;
@@ -158,6 +202,8 @@ typedef struct socket socket_t;
  */
 
 void dentry_flusher();
+void dentry_writeback();
+void dentry_fsync(dentry_t* dentry);
 
 void dentry_set_parent(dentry_t* to, dentry_t* parent);
 dentry_t* dentry_get(uint32_t dev_indx, uint32_t inode_indx);
@@ -177,6 +223,21 @@ void dentry_inode_rem_flag(dentry_t* dentry, mode_t mode);
 
 uint32_t dentry_stat_cached_count();
 
+/**
+ * NAME CACHE
+ */
+
+int name_cache_lookup(dentry_t* dir, const char* name, uint32_t len, uint32_t* inode_indx);
+void name_cache_add(dentry_t* dir, const char* name, uint32_t len, uint32_t inode_indx);
+void name_cache_invalidate_name(dentry_t* dir, const char* name, uint32_t len);
+void name_cache_invalidate_inode(dentry_t* dentry);
+void name_cache_invalidate_dev(uint32_t dev_indx);
+
+uint32_t name_cache_stat_hits();
+uint32_t name_cache_stat_negative_hits();
+uint32_t name_cache_stat_misses();
+uint32_t name_cache_stat_entries();
+
 /**
  * VFS HELPERS
  */
@@ -204,14 +265,21 @@ int vfs_unlink(dentry_t* file);
 int vfs_lookup(dentry_t* dir, const char* name, uint32_t len, dentry_t** result);
 int vfs_open(dentry_t* file, file_descriptor_t* fd, uint32_t flags);
 int vfs_close(file_descriptor_t* fd);
+int vfs_dup(file_descriptor_t* from, file_descriptor_t* to);
 bool vfs_can_read(file_descriptor_t* fd);
 bool vfs_can_write(file_descriptor_t* fd);
 int vfs_read(file_descriptor_t* fd, void* buf, uint32_t len);
 int vfs_write(file_descriptor_t* fd, void* buf, uint32_t len);
+int vfs_readv(file_descriptor_t* fd, const iovec_t* iov, int iovcnt);
+int vfs_writev(file_descriptor_t* fd, const iovec_t* iov, int iovcnt);
+int vfs_preadv(file_descriptor_t* fd, const iovec_t* iov, int iovcnt, uint32_t offset);
+int vfs_pwritev(file_descriptor_t* fd, const iovec_t* iov, int iovcnt, uint32_t offset);
 int vfs_mkdir(dentry_t* dir, const char* name, size_t len, mode_t mode);
 int vfs_rmdir(dentry_t* dir);
 int vfs_getdents(file_descriptor_t* dir_fd, uint8_t* buf, uint32_t len);
 int vfs_fstat(file_descriptor_t* fd, fstat_t* stat);
+int vfs_fsync(file_descriptor_t* fd, bool data_only);
+int vfs_sync();
 
 int vfs_mount(dentry_t* mountpoint, device_t* dev, uint32_t fs_indx);
 int vfs_umount(dentry_t* mountpoint);
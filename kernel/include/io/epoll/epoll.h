@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2020-2021 Nikita Melekhin. All rights reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef _KERNEL_IO_EPOLL_EPOLL_H
+#define _KERNEL_IO_EPOLL_EPOLL_H
+
+#include <fs/vfs.h>
+#include <libkern/syscall_structs.h>
+#include <libkern/types.h>
+#include <tasking/wait_queue.h>
+
+struct epoll;
+
+struct epoll_item {
+    wait_queue_entry_t wait; /* Must be the first, wait queue callbacks cast it to the item. */
+    struct epoll* ep;
+    struct epoll_item* next;
+    struct epoll_item* polled_next;
+    struct epoll_item* ready_next;
+    bool on_ready_list;
+
+    int fd;
+    file_descriptor_t file; /* A copy of the fd made by EPOLL_CTL_ADD. */
+    wait_queue_t* wait_queue; /* NULL, if the file has none and is polled. */
+    uint32_t events;
+    epoll_data_t data;
+};
+typedef struct epoll_item epoll_item_t;
+
+/**
+ * An epoll instance keeps the items it watches and a ready list of those,
+ * which have got an event since they were last reported. Files with a wait
+ * queue put their items onto the ready list themselves, so a wait costs
+ * O(ready items) instead of O(watched fds).
+ */
+struct epoll {
+    uint32_t d_count;
+    epoll_item_t* items;
+    epoll_item_t* polled;
+    epoll_item_t* ready_head;
+    epoll_item_t* ready_tail;
+    uint32_t ready_count;
+};
+typedef struct epoll epoll_t;
+
+int epoll_create(file_descriptor_t* fd);
+epoll_t* epoll_duplicate(epoll_t* ep);
+int epoll_put(epoll_t* ep);
+
+int epoll_ctl(epoll_t* ep, int op, int fd_num, file_descriptor_t* fd, epoll_event_t* event);
+void epoll_forget_fd(epoll_t* ep, int fd_num);
+bool epoll_has_ready(epoll_t* ep);
+int epoll_collect(epoll_t* ep, epoll_event_t* events, int maxevents);
+
+#endif /* _KERNEL_IO_EPOLL_EPOLL_H */
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2020-2021 Nikita Melekhin. All rights reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef _KERNEL_IO_PIPE_PIPE_H
+#define _KERNEL_IO_PIPE_PIPE_H
+
+#include <fs/vfs.h>
+#include <libkern/syscall_structs.h>
+#include <libkern/types.h>
+#include <mem/vmm/zoner.h>
+#include <tasking/wait_queue.h>
+
+#define PIPE_PAGES 16
+
+struct pipe_buffer {
+    uint32_t frame; /* 0, till the page is used for the first time. */
+    uint32_t offset;
+    uint32_t len;
+};
+typedef struct pipe_buffer pipe_buffer_t;
+
+/**
+ * A pipe is a ring of pages. Data is appended to the last used page and
+ * taken from the first one, so every piece of data lies in one page, and
+ * splice moves it between a page and a file with a single call of the
+ * file's read or write. Pages get frames, when they are used for the first
+ * time, and keep them till the pipe is freed.
+ */
+struct pipe {
+    zone_t zone;
+    pipe_buffer_t bufs[PIPE_PAGES];
+    uint32_t head; /* The page, which is read from. */
+    uint32_t used; /* The number of pages holding data. */
+    uint32_t size; /* The number of bytes in the pipe. */
+
+    uint32_t readers;
+    uint32_t writers;
+    wait_queue_t wait_queue;
+};
+typedef struct pipe pipe_t;
+
+int pipe_create(file_descriptor_t* read_fd, file_descriptor_t* write_fd);
+void pipe_duplicate(file_descriptor_t* fd);
+int pipe_put(file_descriptor_t* fd);
+
+int pipe_splice_from_file(pipe_t* pipe, file_descriptor_t* in, uint32_t* offset, uint32_t len);
+int pipe_splice_to_file(pipe_t* pipe, file_descriptor_t* out, uint32_t* offset, uint32_t len);
+int pipe_splice_to_pipe(pipe_t* pipe, pipe_t* out, uint32_t len);
+
+#endif /* _KERNEL_IO_PIPE_PIPE_H */
@@ -8,11 +8,49 @@
 #ifndef _KERNEL_IO_SHARED_BUFFER_SHARED_BUFFER_H
 #define _KERNEL_IO_SHARED_BUFFER_SHARED_BUFFER_H
 
+#include <algo/dynamic_array.h>
 #include <libkern/types.h>
 
+struct proc;
+struct proc_zone;
+
+struct shared_buffer_mapping {
+    struct shared_buffer_mapping* next;
+    struct proc* proc;
+    uint32_t start;
+};
+typedef struct shared_buffer_mapping shared_buffer_mapping_t;
+
+/**
+ * A shared buffer is a set of physical pages, which is mapped only into
+ * processes which have created or opened it. Every mapping reserves the
+ * address range for the largest size, the buffer could be resized to,
+ * so resizing never moves the buffer.
+ */
+struct shared_buffer {
+    struct shared_buffer* hash_next;
+    int id;
+    pid_t owner;
+    uint32_t refs; /* The number of mappings. */
+    size_t size;
+    uint32_t pages; /* The number of allocated frames. */
+    uint32_t reserved_pages;
+    uint32_t* frames;
+    shared_buffer_mapping_t* mappings;
+    dynamic_array_t granted; /* pids, which are allowed to open the buffer. */
+};
+typedef struct shared_buffer shared_buffer_t;
+
 int shared_buffer_init();
 int shared_buffer_create(uint8_t** buffer, size_t size);
 int shared_buffer_get(int id, uint8_t** buffer);
 int shared_buffer_free(int id);
+int shared_buffer_grant(int id, pid_t pid);
+int shared_buffer_revoke(int id, pid_t pid);
+int shared_buffer_resize(int id, size_t size);
+
+int shared_buffer_frame(struct proc_zone* zone, uint32_t vaddr, uint32_t* paddr);
+int shared_buffer_fork_zone(struct proc* new_proc, struct proc_zone* zone);
+void shared_buffer_release_zones(struct proc* p, dynamic_array_t* zones);
 
-#endif /* _KERNEL_IO_SHARED_BUFFER_SHARED_BUFFER_H */
\ No newline at end of file
+#endif /* _KERNEL_IO_SHARED_BUFFER_SHARED_BUFFER_H */
@@ -15,9 +15,14 @@ bool local_socket_can_read(dentry_t* dentry, uint32_t start);
 int local_socket_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len);
 bool local_socket_can_write(dentry_t* dentry, uint32_t start);
 int local_socket_write(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len);
+int local_socket_readv(dentry_t* dentry, const iovec_t* iov, int iovcnt, uint32_t start);
+int local_socket_writev(dentry_t* dentry, const iovec_t* iov, int iovcnt, uint32_t start);
+wait_queue_t* local_socket_wait_queue(dentry_t* dentry);
 
 int local_socket_bind(file_descriptor_t* sock, char* name, uint32_t len);
+int local_socket_listen(file_descriptor_t* sock, int backlog);
 int local_socket_connect(file_descriptor_t* sock, char* name, uint32_t len);
+int local_socket_accept(file_descriptor_t* sock, file_descriptor_t* new_fd);
 
 
 #endif /* _KERNEL_IO_SOCKETS_LOCAL_SOCKET_H */
\ No newline at end of file
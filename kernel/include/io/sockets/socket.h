@@ -12,10 +12,13 @@
 #include <libkern/syscall_structs.h>
 #include <libkern/types.h>
 
-#define MAX_SOCKET_COUNT 16
+#define SOCKET_BUFFER_SIZE (16 * KB)
+#define SOCKET_MAX_BACKLOG SOMAXCONN
 
+socket_t* socket_alloc(int domain, int type, int protocol);
 int socket_create(int domain, int type, int protocol, file_descriptor_t* fd, file_ops_t* ops);
+int socket_connect_pair(socket_t* sock, socket_t* peer);
 socket_t* socket_duplicate(socket_t* sock);
 int socket_put(socket_t* sock);
 
-#endif /* _KERNEL_IO_SOCKETS_SOCKET_H */
\ No newline at end of file
+#endif /* _KERNEL_IO_SOCKETS_SOCKET_H */
@@ -9,21 +9,37 @@
 #define _KERNEL_IO_TTY_PTY_MASTER_H
 
 #include <fs/vfs.h>
+#include <mem/vmm/vmm.h>
 
 #ifndef PTYS_COUNT
 #define PTYS_COUNT 16
 #endif
 
+#define PTY_BUFFER_STD_SIZE (16 * KB)
+#define PTY_BUFFER_MIN_SIZE (4 * KB)
+#define PTY_BUFFER_MAX_SIZE (256 * KB)
+
 struct pty_slave_entry;
 struct pty_master_entry {
     ringbuffer_t buffer;
     struct pty_slave_entry* pts;
     dentry_t dentry;
+
+    /**
+     * Read coalescing: a blocking read of the master wakes up, when
+     * read_min bytes are in the buffer, or when read_time ticks passed
+     * since the oldest of them came.
+     */
+    uint32_t read_min;
+    time_t read_time;
+    time_t pending_since;
 };
 typedef struct pty_master_entry pty_master_entry_t;
 
 extern pty_master_entry_t pty_masters[PTYS_COUNT];
 
 int pty_master_alloc(file_descriptor_t* fd);
+int pty_master_push(pty_master_entry_t* ptm, const uint8_t* buf, uint32_t len);
+int pty_resize_rings(pty_master_entry_t* ptm, uint32_t size);
 
 #endif
\ No newline at end of file
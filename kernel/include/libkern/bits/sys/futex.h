@@ -0,0 +1,7 @@
+#ifndef _KERNEL_LIBKERN_BITS_SYS_FUTEX_H
+#define _KERNEL_LIBKERN_BITS_SYS_FUTEX_H
+
+#define FUTEX_WAIT 0x0
+#define FUTEX_WAKE 0x1
+
+#endif // _KERNEL_LIBKERN_BITS_SYS_FUTEX_H
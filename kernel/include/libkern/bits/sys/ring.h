@@ -0,0 +1,61 @@
+#ifndef _KERNEL_LIBKERN_BITS_SYS_RING_H
+#define _KERNEL_LIBKERN_BITS_SYS_RING_H
+
+#include <libkern/types.h>
+
+#define RING_MAX_ENTRIES 256
+
+#define RING_OP_NOP 0
+#define RING_OP_READ 1
+#define RING_OP_WRITE 2
+#define RING_OP_FSTAT 3
+#define RING_OP_OPEN 4
+#define RING_OP_CLOSE 5
+
+/* Reads and writes at the file's own offset, moving it as read() and write() do. */
+#define RING_OFFSET_CURRENT ((off_t)-1)
+
+/**
+ * A submission entry describes one call:
+ *  read, write: fd, addr and len are the buffer, offset is for pread/pwrite;
+ *  fstat: fd, addr is fstat_t;
+ *  open: addr is the path, flags are open flags, len is the mode;
+ *  close: fd.
+ * The result of the call, as the syscall would return it, comes in the
+ * completion entry with the same user_data.
+ */
+struct ring_sqe {
+    uint32_t op;
+    int fd;
+    void* addr;
+    uint32_t len;
+    off_t offset;
+    uint32_t flags;
+    uint32_t user_data;
+};
+typedef struct ring_sqe ring_sqe_t;
+
+struct ring_cqe {
+    uint32_t user_data;
+    int res;
+};
+typedef struct ring_cqe ring_cqe_t;
+
+/**
+ * The queues live in the memory of the process. The app puts entries at
+ * sq_tail and takes completions at cq_head, the kernel takes entries at
+ * sq_head and puts completions at cq_tail. Indexes grow freely and are
+ * taken modulo entries, which is a power of 2.
+ */
+struct ring {
+    uint32_t sq_head;
+    uint32_t sq_tail;
+    uint32_t cq_head;
+    uint32_t cq_tail;
+    uint32_t entries;
+    ring_sqe_t* sqes;
+    ring_cqe_t* cqes;
+};
+typedef struct ring ring_t;
+
+#endif // _KERNEL_LIBKERN_BITS_SYS_RING_H
@@ -0,0 +1,14 @@
+#ifndef _KERNEL_LIBKERN_BITS_SYS_UIO_H
+#define _KERNEL_LIBKERN_BITS_SYS_UIO_H
+
+#include <libkern/types.h>
+
+#define IOV_MAX 1024
+
+struct iovec {
+    void* iov_base;
+    size_t iov_len;
+};
+typedef struct iovec iovec_t;
+
+#endif // _KERNEL_LIBKERN_BITS_SYS_UIO_H
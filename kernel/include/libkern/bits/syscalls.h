@@ -48,6 +48,29 @@ enum __sysid {
     SYS_SHBUF_CREATE,
     SYS_SHBUF_GET,
     SYS_SHBUF_FREE,
+    SYS_FSYNC,
+    SYS_FDATASYNC,
+    SYS_SYNC,
+    SYS_LISTEN,
+    SYS_ACCEPT,
+    SYS_FUTEX,
+    SYS_SHBUF_GRANT,
+    SYS_SHBUF_REVOKE,
+    SYS_SHBUF_RESIZE,
+    SYS_READV,
+    SYS_WRITEV,
+    SYS_PREADV,
+    SYS_PWRITEV,
+    SYS_PREAD,
+    SYS_PWRITE,
+    SYS_EPOLL_CREATE,
+    SYS_EPOLL_CTL,
+    SYS_EPOLL_WAIT,
+    SYS_PIPE,
+    SYS_DUP2,
+    SYS_SPLICE,
+    SYS_SENDFILE,
+    SYS_RING_ENTER,
 };
 typedef enum __sysid sysid_t;
 
@@ -14,5 +14,6 @@ int log(const char* format, ...);
 int log_warn(const char* format, ...);
 int log_error(const char* format, ...);
 int log_not_formatted(const char* format, ...);
+int log_write(const char* buf, size_t len);
 
 #endif // _KERNEL_LIBKERN_LOG_H
\ No newline at end of file
@@ -2,11 +2,16 @@
 #define _KERNEL_LIBKERN_SYSCALL_STRUCTS_H
 
 #include <libkern/bits/fcntl.h>
+#include <libkern/bits/sys/epoll.h>
+#include <libkern/bits/sys/futex.h>
 #include <libkern/bits/sys/ioctls.h>
 #include <libkern/bits/sys/mman.h>
+#include <libkern/bits/sys/ring.h>
 #include <libkern/bits/sys/select.h>
 #include <libkern/bits/sys/socket.h>
+#include <libkern/bits/sys/splice.h>
 #include <libkern/bits/sys/stat.h>
+#include <libkern/bits/sys/uio.h>
 #include <libkern/bits/sys/utsname.h>
 #include <libkern/bits/syscalls.h>
 #include <libkern/bits/thread.h>
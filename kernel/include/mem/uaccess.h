@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2020-2021 Nikita Melekhin. All rights reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef _KERNEL_MEM_UACCESS_H
+#define _KERNEL_MEM_UACCESS_H
+
+#include <libkern/types.h>
+#include <platform/generic/tasking/trapframe.h>
+
+#define UACCESS_READ 0x0
+#define UACCESS_WRITE 0x1
+
+/**
+ * Every instruction of uaccess_copy, which could fault on a user address,
+ * has an entry in the exception table. The page fault handler moves such
+ * a fault to the fixup code, which returns the number of not copied bytes.
+ */
+struct uaccess_ex_entry {
+    uint32_t insn;
+    uint32_t fixup;
+};
+typedef struct uaccess_ex_entry uaccess_ex_entry_t;
+
+/* Implemented per platform. Returns the number of bytes which were not copied. */
+uint32_t uaccess_copy(void* dest, const void* src, uint32_t len);
+
+int copy_from_user(void* dest, const void* src, uint32_t len);
+int copy_to_user(void* dest, const void* src, uint32_t len);
+int uaccess_check(const void* ptr, uint32_t len, int access);
+bool uaccess_fixup(trapframe_t* tf);
+
+#endif /* _KERNEL_MEM_UACCESS_H */
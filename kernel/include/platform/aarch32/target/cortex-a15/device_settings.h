@@ -47,4 +47,6 @@
 #define PL050_KEYBOARD_IRQ_LINE (32 + 12)
 #define PL050_MOUSE_IRQ_LINE (32 + 13)
 
+#define PL111_IRQ_LINE (32 + 14)
+
 #endif /* _KERNEL_PLATFORM_AARCH32_TARGET_CORTEX_A15_DEVICE_SETTINGS_H */
\ No newline at end of file
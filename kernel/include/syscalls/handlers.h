@@ -25,6 +25,12 @@ void sys_exit(trapframe_t* tf);
 void sys_fork(trapframe_t* tf);
 void sys_read(trapframe_t* tf);
 void sys_write(trapframe_t* tf);
+void sys_readv(trapframe_t* tf);
+void sys_writev(trapframe_t* tf);
+void sys_preadv(trapframe_t* tf);
+void sys_pwritev(trapframe_t* tf);
+void sys_pread(trapframe_t* tf);
+void sys_pwrite(trapframe_t* tf);
 void sys_open(trapframe_t* tf);
 void sys_close(trapframe_t* tf);
 void sys_waitpid(trapframe_t* tf);
@@ -54,6 +60,14 @@ void sys_getpgid(trapframe_t* tf);
 void sys_create_thread(trapframe_t* tf);
 void sys_sleep(trapframe_t* tf);
 void sys_select(trapframe_t* tf);
+void sys_epoll_create(trapframe_t* tf);
+void sys_epoll_ctl(trapframe_t* tf);
+void sys_epoll_wait(trapframe_t* tf);
+void sys_pipe(trapframe_t* tf);
+void sys_dup2(trapframe_t* tf);
+void sys_splice(trapframe_t* tf);
+void sys_sendfile(trapframe_t* tf);
+void sys_ring_enter(trapframe_t* tf);
 void sys_fstat(trapframe_t* tf);
 void sys_sched_yield(trapframe_t* tf);
 void sys_uname(trapframe_t* tf);
@@ -64,6 +78,15 @@ void sys_nice(trapframe_t* tf);
 void sys_shbuf_create(trapframe_t* tf);
 void sys_shbuf_get(trapframe_t* tf);
 void sys_shbuf_free(trapframe_t* tf);
+void sys_shbuf_grant(trapframe_t* tf);
+void sys_shbuf_revoke(trapframe_t* tf);
+void sys_shbuf_resize(trapframe_t* tf);
+void sys_fsync(trapframe_t* tf);
+void sys_fdatasync(trapframe_t* tf);
+void sys_sync(trapframe_t* tf);
+void sys_listen(trapframe_t* tf);
+void sys_accept(trapframe_t* tf);
+void sys_futex(trapframe_t* tf);
 
 void sys_none(trapframe_t* tf);
 
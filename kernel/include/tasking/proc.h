@@ -18,7 +18,7 @@
 #include <mem/vmm/zoner.h>
 
 #define MAX_PROCESS_COUNT 1024
-#define MAX_OPENED_FILES 16
+#define MAX_OPENED_FILES 32
 
 struct blocker;
 
@@ -42,8 +42,10 @@ enum ZONE_TYPES {
     ZONE_TYPE_MAPPED = 0x20,
     ZONE_TYPE_MAPPED_FILE_PRIVATLY = 0x40,
     ZONE_TYPE_MAPPED_FILE_SHAREDLY = 0x80,
+    ZONE_TYPE_SHARED_BUFFER = 0x100,
 };
 
+struct shared_buffer;
 struct proc_zone {
     uint32_t start;
     uint32_t len;
@@ -51,6 +53,7 @@ struct proc_zone {
     uint32_t flags;
     dentry_t* file;
     uint32_t offset;
+    struct shared_buffer* shbuf;
 };
 typedef struct proc_zone proc_zone_t;
 
@@ -132,6 +135,7 @@ int proc_chdir(proc_t* p, const char* path);
 file_descriptor_t* proc_get_free_fd(proc_t* p);
 file_descriptor_t* proc_get_fd(proc_t* p, uint32_t index);
 int proc_get_fd_id(proc_t* proc, file_descriptor_t* fd);
+int proc_close_fd(proc_t* p, file_descriptor_t* fd);
 
 /**
  * PROC ZONER FUNCTIONS
@@ -21,7 +21,7 @@
 
 #define MAX_PROCESS_COUNT 1024
 #define MAX_DYING_PROCESS_COUNT 8
-#define MAX_OPENED_FILES 16
+#define MAX_OPENED_FILES 32
 #define SIGNALS_CNT 32
 
 extern proc_t proc[MAX_PROCESS_COUNT];
@@ -42,9 +42,35 @@ enum BLOCKER_REASON {
     BLOCKER_SLEEP,
     BLOCKER_SELECT,
     BLOCKER_DUMPING,
+    BLOCKER_FUTEX,
+    BLOCKER_EPOLL,
+};
+
+enum FUTEX_KEY_TYPE {
+    FUTEX_KEY_PRIVATE,
+    FUTEX_KEY_SHARED,
 };
 
 struct proc;
+
+/**
+ * A private futex is keyed by its process and the user address, a futex in
+ * a shared buffer by the physical address, as the buffer is mapped at
+ * different addresses in processes.
+ */
+struct futex_key {
+    uint32_t type;
+    struct proc* owner;
+    uint32_t addr;
+};
+typedef struct futex_key futex_key_t;
+
+static ALWAYS_INLINE bool futex_key_equal(const futex_key_t* a, const futex_key_t* b)
+{
+    return a->type == b->type && a->owner == b->owner && a->addr == b->addr;
+}
+
+struct epoll;
 struct thread {
     struct proc* process;
     uint32_t tid;
@@ -72,6 +98,9 @@ struct thread {
     fd_set_t readfds;
     fd_set_t writefds;
     fd_set_t exceptfds;
+    futex_key_t futex_key;
+    bool futex_woken;
+    struct epoll* blocker_epoll;
 
     /* Stat data */
     time_t stat_total_running_ticks;
@@ -125,6 +154,9 @@ int init_read_blocker(thread_t* p, file_descriptor_t* bfd);
 int init_write_blocker(thread_t* thread, file_descriptor_t* bfd);
 int init_sleep_blocker(thread_t* thread, uint32_t time);
 int init_select_blocker(thread_t* thread, int nfds, fd_set_t* readfds, fd_set_t* writefds, fd_set_t* exceptfds, timeval_t* timeout);
+int init_futex_blocker(thread_t* thread, const futex_key_t* key);
+int init_epoll_blocker(thread_t* thread, struct epoll* ep, int timeout_ms);
+int futex_wake_blocked(const futex_key_t* key, int count);
 
 /**
  * DEBUG FUNCTIONS
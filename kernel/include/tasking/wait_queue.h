@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2020-2021 Nikita Melekhin. All rights reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef _KERNEL_TASKING_WAIT_QUEUE_H
+#define _KERNEL_TASKING_WAIT_QUEUE_H
+
+#include <libkern/types.h>
+
+struct wait_queue_entry;
+typedef void (*wait_queue_func_t)(struct wait_queue_entry* entry, uint32_t events);
+
+/**
+ * A wait queue lists the waiters of an object, which are interested in its
+ * state changes. The object calls wait_queue_wake with the events that have
+ * happened, so waiters don't have to poll it. When the object goes away, it
+ * calls wait_queue_release, and every waiter has to forget about it.
+ */
+struct wait_queue_entry {
+    struct wait_queue_entry* prev;
+    struct wait_queue_entry* next;
+    wait_queue_func_t wake;
+    wait_queue_func_t release;
+};
+typedef struct wait_queue_entry wait_queue_entry_t;
+
+struct wait_queue {
+    wait_queue_entry_t* head;
+};
+typedef struct wait_queue wait_queue_t;
+
+static inline void wait_queue_init(wait_queue_t* wq) { wq->head = NULL; }
+
+void wait_queue_add(wait_queue_t* wq, wait_queue_entry_t* entry);
+void wait_queue_remove(wait_queue_t* wq, wait_queue_entry_t* entry);
+void wait_queue_wake(wait_queue_t* wq, uint32_t events);
+void wait_queue_release(wait_queue_t* wq);
+
+#endif /* _KERNEL_TASKING_WAIT_QUEUE_H */
@@ -6,6 +6,9 @@
  */
 
 #include <algo/ringbuffer.h>
+#include <libkern/bits/errno.h>
+#include <libkern/libkern.h>
+#include <mem/uaccess.h>
 #include <mem/vmm/vmm.h>
 
 #define BUFFER_STD_SIZE (16 * KB)
@@ -58,29 +61,26 @@ uint32_t ringbuffer_space_to_read_with_custom_start(ringbuffer_t* buf, uint32_t
     return buf->zone.len - start + buf->end;
 }
 
+/* One byte is always kept free, otherwise a full buffer looks like an empty one. */
 uint32_t ringbuffer_space_to_write(ringbuffer_t* buf)
 {
     if (buf->start > buf->end) {
-        return buf->start - buf->end;
+        return buf->start - buf->end - 1;
     }
-    return buf->zone.len - buf->end + buf->start;
+    return buf->zone.len - buf->end + buf->start - 1;
 }
 
 uint32_t ringbuffer_read(ringbuffer_t* buf, uint8_t* holder, uint32_t siz)
 {
-    uint32_t i = 0;
-    if (buf->start > buf->end) {
-        for (; i < siz && buf->start < buf->zone.len; i++, buf->start++) {
-            holder[i] = buf->zone.ptr[buf->start];
-        }
-        if (buf->start == buf->zone.len) {
-            buf->start = 0;
-        }
+    siz = min(siz, ringbuffer_space_to_read(buf));
+    uint32_t first = min(siz, buf->zone.len - buf->start);
+    memcpy(holder, &buf->zone.ptr[buf->start], first);
+    memcpy(holder + first, buf->zone.ptr, siz - first);
+    buf->start += siz;
+    if (buf->start >= buf->zone.len) {
+        buf->start -= buf->zone.len;
     }
-    for (; i < siz && buf->start < buf->end; i++, buf->start++) {
-        holder[i] = buf->zone.ptr[buf->start];
-    }
-    return i;
+    return siz;
 }
 
 uint32_t ringbuffer_read_with_start(ringbuffer_t* buf, uint32_t start, uint8_t* holder, uint32_t siz)
@@ -116,19 +116,47 @@ uint32_t ringbuffer_read_one(ringbuffer_t* buf, uint8_t* data)
 
 uint32_t ringbuffer_write(ringbuffer_t* buf, const uint8_t* holder, uint32_t siz)
 {
-    uint32_t i = 0;
-    if (buf->end >= buf->start) {
-        for (; i < siz && buf->end < buf->zone.len; i++, buf->end++) {
-            buf->zone.ptr[buf->end] = holder[i];
-        }
-        if (buf->end == buf->zone.len) {
-            buf->end = 0;
-        }
+    siz = min(siz, ringbuffer_space_to_write(buf));
+    uint32_t first = min(siz, buf->zone.len - buf->end);
+    memcpy(&buf->zone.ptr[buf->end], holder, first);
+    memcpy(buf->zone.ptr, holder + first, siz - first);
+    buf->end += siz;
+    if (buf->end >= buf->zone.len) {
+        buf->end -= buf->zone.len;
     }
-    for (; i < siz && buf->end < buf->start; i++, buf->end++) {
-        buf->zone.ptr[buf->end] = holder[i];
+    return siz;
+}
+
+/**
+ * User variants copy straight to or from the user memory. If the user
+ * memory faults, the buffer is left as it was and -EFAULT is returned.
+ */
+int ringbuffer_read_user(ringbuffer_t* buf, uint8_t* holder, uint32_t siz)
+{
+    siz = min(siz, ringbuffer_space_to_read(buf));
+    uint32_t first = min(siz, buf->zone.len - buf->start);
+    if (copy_to_user(holder, &buf->zone.ptr[buf->start], first) || copy_to_user(holder + first, buf->zone.ptr, siz - first)) {
+        return -EFAULT;
     }
-    return i;
+    buf->start += siz;
+    if (buf->start >= buf->zone.len) {
+        buf->start -= buf->zone.len;
+    }
+    return siz;
+}
+
+int ringbuffer_write_user(ringbuffer_t* buf, const uint8_t* holder, uint32_t siz)
+{
+    siz = min(siz, ringbuffer_space_to_write(buf));
+    uint32_t first = min(siz, buf->zone.len - buf->end);
+    if (copy_from_user(&buf->zone.ptr[buf->end], holder, first) || copy_from_user(buf->zone.ptr, holder + first, siz - first)) {
+        return -EFAULT;
+    }
+    buf->end += siz;
+    if (buf->end >= buf->zone.len) {
+        buf->end -= buf->zone.len;
+    }
+    return siz;
 }
 
 uint32_t ringbuffer_write_ignore_bounds(ringbuffer_t* buf, const uint8_t* holder, uint32_t siz)
@@ -145,7 +173,7 @@ uint32_t ringbuffer_write_ignore_bounds(ringbuffer_t* buf, const uint8_t* holder
 
 uint32_t ringbuffer_write_one(ringbuffer_t* buf, uint8_t data)
 {
-    if (buf->end + 1 != buf->start) {
+    if (ringbuffer_space_to_write(buf)) {
         buf->zone.ptr[buf->end] = data;
         buf->end++;
         if (buf->end == buf->zone.len) {
@@ -6,6 +6,7 @@
  */
 
 #include <drivers/aarch32/pl111.h>
+#include <drivers/generic/vblank.h>
 #include <fs/devfs/devfs.h>
 #include <fs/vfs.h>
 #include <libkern/bits/errno.h>
@@ -13,6 +14,7 @@
 #include <libkern/log.h>
 #include <mem/vmm/vmm.h>
 #include <mem/vmm/zoner.h>
+#include <platform/aarch32/interrupts.h>
 #include <tasking/tasking.h>
 
 #define DEBUG_PL111
@@ -23,6 +25,7 @@ static char* pl111_bufs_paddr[2];
 static uint32_t pl111_screen_width;
 static uint32_t pl111_screen_height;
 static uint32_t pl111_screen_buffer_size;
+static vblank_t pl111_vblank;
 
 static inline int _pl111_map_itself()
 {
@@ -61,11 +64,24 @@ static int _pl111_ioctl(dentry_t* dentry, uint32_t cmd, uint32_t arg)
     case BGA_SWAP_BUFFERS:
         registers->lcd_upbase = (uint32_t)pl111_bufs_paddr[(arg & 1)];
         return 0;
+    case BGA_REQUEST_VBLANK:
+        vblank_arm(&pl111_vblank);
+        return 0;
     default:
         return -EINVAL;
     }
 }
 
+static bool _pl111_can_read(dentry_t* dentry, uint32_t start)
+{
+    return vblank_can_read(&pl111_vblank);
+}
+
+static int _pl111_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
+{
+    return vblank_read(&pl111_vblank, buf, len);
+}
+
 static proc_zone_t* _pl111_mmap(dentry_t* dentry, mmap_params_t* params)
 {
     bool map_shared = ((params->flags & MAP_SHARED) > 0);
@@ -102,6 +118,8 @@ static void pl111_recieve_notification(uint32_t msg, uint32_t param)
         }
 
         file_ops_t fops = { 0 };
+        fops.can_read = _pl111_can_read;
+        fops.read = _pl111_read;
         fops.ioctl = _pl111_ioctl;
         fops.mmap = _pl111_mmap;
         devfs_inode_t* res = devfs_register(mp, MKDEV(10, 156), "bga", 3, 0, &fops);
@@ -113,6 +131,17 @@ static void pl111_recieve_notification(uint32_t msg, uint32_t param)
 #endif
 }
 
+/**
+ * The vertical compare interrupt comes at the start of every vertical sync.
+ * Until the first of them, e.g. if the board does not raise it, vblanks are
+ * emulated.
+ */
+static void _pl111_int_handler()
+{
+    registers->lcd_icr = LCD_INT_VCOMP_MASK;
+    vblank_irq(&pl111_vblank);
+}
+
 void pl111_set_resolution(uint32_t width, uint32_t height)
 {
     pl111_screen_width = width;
@@ -155,7 +184,12 @@ void pl111_init(device_t* dev)
         | (LCD_24_BPP << LCD_BPP_POS)
         | LCD_EN_MASK;
 
+    // Vertical compare interrupts come at the start of the vertical sync.
+    ctl &= ~LCD_VCOMP_MASK;
     registers->lcd_control = ctl;
+
+    registers->lcd_imsc = LCD_INT_VCOMP_MASK;
+    irq_register_handler(PL111_IRQ_LINE, 0, 0, _pl111_int_handler);
 }
 
 static driver_desc_t _pl111_driver_info()
@@ -12,6 +12,7 @@
 #include <libkern/libkern.h>
 
 static ringbuffer_t gkeyboard_buffer;
+static wait_queue_t gkeyboard_wait_queue;
 static bool _gkeyboard_has_prefix_e0 = false;
 static bool _gkeyboard_shift_enabled = false;
 static bool _gkeyboard_ctrl_enabled = false;
@@ -36,6 +37,11 @@ static int _generic_keyboard_read(dentry_t* dentry, uint8_t* buf, uint32_t start
     return leno;
 }
 
+static wait_queue_t* _generic_keyboard_wait_queue(dentry_t* dentry)
+{
+    return &gkeyboard_wait_queue;
+}
+
 int generic_keyboard_create_devfs()
 {
     dentry_t* mp;
@@ -46,6 +52,7 @@ int generic_keyboard_create_devfs()
     file_ops_t fops = {0};
     fops.can_read = _generic_keyboard_can_read;
     fops.read = _generic_keyboard_read;
+    fops.wait_queue = _generic_keyboard_wait_queue;
     devfs_inode_t* res = devfs_register(mp, MKDEV(11, 0), "kbd", 3, 0, &fops);
 
     dentry_put(mp);
@@ -123,6 +130,7 @@ void generic_emit_key_set1(uint32_t scancode)
     }
 
     ringbuffer_write(&gkeyboard_buffer, (uint8_t*)&packet, sizeof(kbd_packet_t));
+    wait_queue_wake(&gkeyboard_wait_queue, EPOLLIN);
 }
 
 // TODO: Implement with table
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2020-2021 Nikita Melekhin. All rights reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <drivers/generic/vblank.h>
+#include <libkern/bits/errno.h>
+#include <libkern/libkern.h>
+#include <time/time_manager.h>
+
+/**
+ * The timer ticks slower than a display refreshes, so the emulated vblanks
+ * come one or two ticks apart, but there are VBLANK_EMULATED_RATE of them
+ * every second.
+ */
+static uint32_t _vblank_emulated_count()
+{
+    uint32_t in_second = timeman_get_ticks_from_last_second() * VBLANK_EMULATED_RATE / timeman_ticks_per_second();
+    return timeman_seconds_since_boot() * VBLANK_EMULATED_RATE + in_second;
+}
+
+uint32_t vblank_count(vblank_t* vblank)
+{
+    if (vblank->has_irq) {
+        return vblank->count;
+    }
+    return _vblank_emulated_count();
+}
+
+/**
+ * Called by a display from its vblank interrupt. The first one switches the
+ * display from emulated vblanks to its own ones.
+ */
+void vblank_irq(vblank_t* vblank)
+{
+    vblank->has_irq = true;
+    vblank->count++;
+}
+
+void vblank_arm(vblank_t* vblank)
+{
+    vblank->armed_at = vblank_count(vblank);
+    vblank->armed = true;
+}
+
+bool vblank_can_read(vblank_t* vblank)
+{
+    return vblank->armed && vblank_count(vblank) != vblank->armed_at;
+}
+
+int vblank_read(vblank_t* vblank, uint8_t* buf, uint32_t len)
+{
+    if (len < sizeof(uint32_t)) {
+        return -EINVAL;
+    }
+    uint32_t count = vblank_count(vblank);
+    memcpy(buf, (uint8_t*)&count, sizeof(uint32_t));
+    vblank->armed = false;
+    return sizeof(uint32_t);
+}
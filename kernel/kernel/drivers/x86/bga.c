@@ -6,6 +6,7 @@
  */
 
 #include <drivers/driver_manager.h>
+#include <drivers/generic/vblank.h>
 #include <drivers/x86/bga.h>
 #include <drivers/x86/pci.h>
 #include <fs/devfs/devfs.h>
@@ -37,6 +38,8 @@
 static uint16_t bga_screen_width, bga_screen_height;
 static uint32_t bga_screen_line_size, bga_screen_buffer_size;
 static uint32_t bga_buf_paddr;
+/* BGA has no vblank interrupt, so its vblanks are always emulated. */
+static vblank_t bga_vblank;
 
 static inline void _bga_write_reg(uint16_t cmd, uint16_t data)
 {
@@ -78,11 +81,24 @@ static int _bga_ioctl(dentry_t* dentry, uint32_t cmd, uint32_t arg)
         y_offset = bga_screen_height * (arg & 1);
         _bga_write_reg(VBE_DISPI_INDEX_Y_OFFSET, (uint16_t)y_offset);
         return 0;
+    case BGA_REQUEST_VBLANK:
+        vblank_arm(&bga_vblank);
+        return 0;
     default:
         return -EINVAL;
     }
 }
 
+static bool _bga_can_read(dentry_t* dentry, uint32_t start)
+{
+    return vblank_can_read(&bga_vblank);
+}
+
+static int _bga_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
+{
+    return vblank_read(&bga_vblank, buf, len);
+}
+
 static proc_zone_t* _bga_mmap(dentry_t* dentry, mmap_params_t* params)
 {
     bool map_shared = ((params->flags & MAP_SHARED) > 0);
@@ -116,6 +132,8 @@ static void bga_recieve_notification(uint32_t msg, uint32_t param)
         }
 
         file_ops_t fops = { 0 };
+        fops.can_read = _bga_can_read;
+        fops.read = _bga_read;
         fops.ioctl = _bga_ioctl;
         fops.mmap = _bga_mmap;
         devfs_inode_t* res = devfs_register(mp, MKDEV(10, 156), "bga", 3, 0, &fops);
@@ -19,6 +19,7 @@
 // #define MOUSE_DRIVER_DEBUG
 
 static ringbuffer_t mouse_buffer;
+static wait_queue_t mouse_wait_queue;
 
 void mouse_run();
 
@@ -37,6 +38,11 @@ static int _mouse_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t
     return leno;
 }
 
+static wait_queue_t* _mouse_wait_queue(dentry_t* dentry)
+{
+    return &mouse_wait_queue;
+}
+
 static void _mouse_recieve_notification(uint32_t msg, uint32_t param)
 {
     if (msg == DM_NOTIFICATION_DEVFS_READY) {
@@ -48,6 +54,7 @@ static void _mouse_recieve_notification(uint32_t msg, uint32_t param)
         file_ops_t fops = { 0 };
         fops.can_read = _mouse_can_read;
         fops.read = _mouse_read;
+        fops.wait_queue = _mouse_wait_queue;
         devfs_inode_t* res = devfs_register(mp, MKDEV(10, 1), "mouse", 5, 0, &fops);
 
         dentry_put(mp);
@@ -144,6 +151,7 @@ void mouse_handler()
     }
 
     ringbuffer_write(&mouse_buffer, (uint8_t*)&packet, sizeof(mouse_packet_t));
+    wait_queue_wake(&mouse_wait_queue, EPOLLIN);
 
 #ifdef MOUSE_DRIVER_DEBUG
     log("%x", packet.button_states);
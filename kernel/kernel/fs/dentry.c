@@ -22,59 +22,150 @@
 #define READ_INODE 1
 #define DENTRY_ALLOC_SIZE (4 * KB) /* Shows the size of list's parts. */
 #define DENTRY_SWAP_THRESHOLD_FOR_INODE_CACHE (16 * KB)
+#define DENTRY_HASH_SIZE 256 /* Must be a power of 2. */
+#define DENTRY_WRITEBACK_BATCH 16
 
 extern vfs_device_t _vfs_devices[MAX_DEVICES_COUNT];
 extern dynamic_array_t _vfs_fses;
 extern uint32_t root_fs_dev_id;
 
-static bool can_cache_inodes = 1;
-static uint32_t stat_cached_dentries = 0; /* Count of dentries which are held. */
+static uint32_t stat_cached_dentries = 0; /* Count of hashed dentries out of the lru, changed under the cache lock. */
 static uint32_t stat_cached_inodes_area_size = 0; /* Sum of all areas which is used for holding inodes. */
 static dentry_cache_list_t* dentry_cache;
-static uint16_t* dentry_cahced;
+
+/**
+ * The cache lock protects the hashtable, the lru and the free lists.
+ * Lock order: dentry_cache_lock could be taken before a dentry's lock,
+ * but never while a dentry's lock is held. The only exception is a loading
+ * dentry: its reader holds its lock while taking the cache lock, so nobody
+ * takes the lock of a loading dentry under the cache lock.
+ */
+static lock_t dentry_cache_lock;
+static dentry_t* dentry_hashtable[DENTRY_HASH_SIZE];
+static dentry_t* dentry_free_list; /* Entries which don't hold a dentry, linked with hash_next. */
+static dentry_t* dentry_lru_head; /* The most recently released dentry, which isn't held by someone. */
+static dentry_t* dentry_lru_tail; /* The first candidate to be replaced. */
+
+/**
+ * Dentries with DENTRY_DIRTY set are linked into the dirty list, so writeback
+ * doesn't walk the whole cache. The dirty lock could be taken while any other
+ * dentry lock is held, so nothing is taken under it.
+ */
+static lock_t dentry_dirty_lock;
+static dentry_t* dentry_dirty_head;
 
 static inline void dentry_set_flag_lockless(dentry_t* dentry, uint32_t flag);
 static inline bool dentry_test_flag_lockless(dentry_t* dentry, uint32_t flag);
 static inline void dentry_rem_flag_lockless(dentry_t* dentry, uint32_t flag);
 static inline bool dentry_inode_test_flag_lockless(dentry_t* dentry, mode_t mode);
+static void dentry_dirty_list_add(dentry_t* dentry);
+static void dentry_dirty_list_remove(dentry_t* dentry);
 
 static inline bool need_to_free_inode_cache()
 {
     return (stat_cached_inodes_area_size > DENTRY_SWAP_THRESHOLD_FOR_INODE_CACHE);
 }
 
-static inline bool free_inode_cache()
+/**
+ * HASHTABLE & LRU
+ */
+
+static inline uint32_t dentry_hash(uint32_t dev_indx, uint32_t inode_indx)
 {
-    dentry_cache_list_t* dentry_cache_block = dentry_cache;
-    dentry_t* valid_dentry_candidate = NULL;
-    while (dentry_cache_block) {
-        lock_acquire(&dentry_cache_block->lock);
-        int dentries_in_block = dentry_cache_block->len / sizeof(dentry_t);
-        for (int i = 0; i < dentries_in_block; i++) {
-            if (dentry_cache_block->data[i].d_count == 0) {
-                dentry_cache_block->data[i].inode_indx = 0;
-                stat_cached_inodes_area_size -= INODE_LEN;
-                kfree(dentry_cache_block->data[i].inode);
-            }
+    uint32_t key = inode_indx ^ (dev_indx << 24);
+    key ^= key >> 16;
+    key *= 0x45d9f3b;
+    key ^= key >> 16;
+    return key & (DENTRY_HASH_SIZE - 1);
+}
+
+static inline void dentry_hash_insert_locked(dentry_t* dentry)
+{
+    uint32_t bucket = dentry_hash(dentry->dev_indx, dentry->inode_indx);
+    dentry->hash_next = dentry_hashtable[bucket];
+    dentry_hashtable[bucket] = dentry;
+}
+
+static inline void dentry_hash_remove_locked(dentry_t* dentry)
+{
+    dentry_t** link = &dentry_hashtable[dentry_hash(dentry->dev_indx, dentry->inode_indx)];
+    while (*link) {
+        if (*link == dentry) {
+            *link = dentry->hash_next;
+            dentry->hash_next = NULL;
+            return;
         }
-        lock_release(&dentry_cache_block->lock);
-        dentry_cache_block = dentry_cache_block->next;
+        link = &(*link)->hash_next;
     }
+}
 
-    if (need_to_free_inode_cache()) {
-        can_cache_inodes = 0;
+static inline dentry_t* dentry_hash_find_locked(uint32_t dev_indx, uint32_t inode_indx)
+{
+    dentry_t* dentry = dentry_hashtable[dentry_hash(dev_indx, inode_indx)];
+    while (dentry) {
+        if (dentry->dev_indx == dev_indx && dentry->inode_indx == inode_indx) {
+            return dentry;
+        }
+        dentry = dentry->hash_next;
     }
-    return true;
+    return NULL;
 }
 
-static void dentry_cache_alloc()
+static inline void dentry_lru_push_locked(dentry_t* dentry)
+{
+    dentry->lru_prev = NULL;
+    dentry->lru_next = dentry_lru_head;
+    if (dentry_lru_head) {
+        dentry_lru_head->lru_prev = dentry;
+    } else {
+        dentry_lru_tail = dentry;
+    }
+    dentry_lru_head = dentry;
+    dentry->in_lru = true;
+}
+
+static inline void dentry_lru_remove_locked(dentry_t* dentry)
+{
+    if (!dentry->in_lru) {
+        return;
+    }
+
+    if (dentry->lru_prev) {
+        dentry->lru_prev->lru_next = dentry->lru_next;
+    } else {
+        dentry_lru_head = dentry->lru_next;
+    }
+
+    if (dentry->lru_next) {
+        dentry->lru_next->lru_prev = dentry->lru_prev;
+    } else {
+        dentry_lru_tail = dentry->lru_prev;
+    }
+
+    dentry->lru_prev = NULL;
+    dentry->lru_next = NULL;
+    dentry->in_lru = false;
+}
+
+static inline void dentry_free_list_push_locked(dentry_t* dentry)
+{
+    dentry->inode_indx = 0;
+    dentry->hash_next = dentry_free_list;
+    dentry_free_list = dentry;
+}
+
+static void dentry_cache_alloc_locked()
 {
     dentry_cache_list_t* list_block = (dentry_cache_list_t*)kmalloc(DENTRY_ALLOC_SIZE);
     memset((uint8_t*)list_block, 0, DENTRY_ALLOC_SIZE);
-    lock_init(&list_block->lock);
     list_block->data = (dentry_t*)&list_block[1];
     list_block->len = DENTRY_ALLOC_SIZE - ((uint32_t)&list_block[1] - (uint32_t)&list_block[0]);
 
+    int dentries_in_block = list_block->len / sizeof(dentry_t);
+    for (int i = dentries_in_block - 1; i >= 0; i--) {
+        dentry_free_list_push_locked(&list_block->data[i]);
+    }
+
     if (dentry_cache == 0) {
         dentry_cache = list_block;
     } else {
@@ -87,50 +178,65 @@ static void dentry_cache_alloc()
     }
 }
 
+/**
+ * dentry_cache_free_entry_locked compeletly removes the dentry from the
+ * cache and frees its inode area. The entry is put to the free list.
+ */
+static void dentry_cache_free_entry_locked(dentry_t* dentry)
+{
+    dentry_lru_remove_locked(dentry);
+    dentry_hash_remove_locked(dentry);
+    dentry_dirty_list_remove(dentry);
+    if (dentry->inode) {
+        kfree(dentry->inode);
+        dentry->inode = NULL;
+        stat_cached_inodes_area_size -= INODE_LEN;
+    }
+    dentry_free_list_push_locked(dentry);
+}
+
+/**
+ * Evicts the least recently released dentries while inodes take
+ * too much memory.
+ */
+static void dentry_cache_trim_locked()
+{
+    while (need_to_free_inode_cache() && dentry_lru_tail) {
+        dentry_cache_free_entry_locked(dentry_lru_tail);
+    }
+}
+
 /**
  * In this function, we try to find an entry to fill it with a new dentry.
  * Since we have a valid dentries in the cache, which isn't held by someone, they are
  * also condidates to be replaced. But because we want to have more valid entries in the
- * cache, we will start to look for a complitely free entry.
+ * cache, we will start to look for a complitely free entry. The cache grows while
+ * inodes fit into DENTRY_SWAP_THRESHOLD_FOR_INODE_CACHE, after that the least
+ * recently released dentry is replaced.
  */
-static dentry_t* dentry_cache_find_empty_entry()
+static dentry_t* dentry_cache_find_empty_entry_locked()
 {
-    dentry_cache_list_t* dentry_cache_block = dentry_cache;
-    dentry_t* valid_dentry_candidate = NULL;
-    while (dentry_cache_block) {
-        lock_acquire(&dentry_cache_block->lock);
-        int dentries_in_block = dentry_cache_block->len / sizeof(dentry_t);
-        for (int i = 0; i < dentries_in_block; i++) {
-            if (dentry_cache_block->data[i].inode_indx == 0) {
-                lock_release(&dentry_cache_block->lock);
-                return &dentry_cache_block->data[i];
-            }
-            if (dentry_cache_block->data[i].d_count == 0) {
-                valid_dentry_candidate = &dentry_cache_block->data[i];
-            }
+    if (!dentry_free_list) {
+        if (dentry_lru_tail && need_to_free_inode_cache()) {
+            /* The replaced dentry keeps its area for storing inode. */
+            dentry_t* victim = dentry_lru_tail;
+            dentry_lru_remove_locked(victim);
+            dentry_hash_remove_locked(victim);
+            dentry_dirty_list_remove(victim);
+            return victim;
         }
-        lock_release(&dentry_cache_block->lock);
-        dentry_cache_block = dentry_cache_block->next;
-    }
-
-    /* If we hasn't found a complitely free entry, let's erase a 
-       valid dentries in the cache, which isn't held by someone. */
-    if (valid_dentry_candidate) {
-        return valid_dentry_candidate;
+        dentry_cache_alloc_locked();
     }
 
-    /* If there is no space, let's allocate a bigger area. */
-    dentry_cache_alloc();
-    dentry_cache_list_t* last = dentry_cache;
-    while (last->next != NULL) {
-        last = last->next;
-    }
-    return &last->data[0];
+    dentry_t* dentry = dentry_free_list;
+    dentry_free_list = dentry->hash_next;
+    dentry->hash_next = NULL;
+    return dentry;
 }
 
 static inline void dentry_delete_inode(dentry_t* dentry)
 {
-    ASSERT(dentry->d_count == 0 && dentry_test_flag(dentry, DENTRY_INODE_TO_BE_DELETED));
+    ASSERT(dentry->d_count == 0 && dentry_test_flag_lockless(dentry, DENTRY_INODE_TO_BE_DELETED));
     dentry->ops->dentry.free_inode(dentry);
 }
 
@@ -143,54 +249,18 @@ static inline void dentry_flush_inode(dentry_t* dentry)
 }
 
 /**
- * dentry_delete_from_cache compeletly deletes dentry from cache.
- * In case when file was deleted and after that a new was created
- * with the same inode_id, dentry can't recognize and could use old
- * inode data. We need delete dentry from cache and free inode.
+ * With READ_INODE the new dentry is returned loading and locked: its inode
+ * has to be read with dentry_load_inode() after the cache lock is released.
  */
-static void dentry_delete_from_cache(dentry_t* dentry)
-{
-    /* This marks the dentry as deleted. */
-    dentry->inode_indx = 0;
-    if (dentry->inode) {
-        kfree(dentry->inode);
-    }
-    stat_cached_inodes_area_size -= INODE_LEN;
-    if (!need_to_free_inode_cache()) {
-        can_cache_inodes = 1;
-    }
-}
-
-/**
- * dentry_prefree puts the dentry in a state when it can be
- * safely replaced with a new one.
- * Note: the dentry stays valid and can be reused without needless to
- *       read all data again.
- */
-static void dentry_prefree(dentry_t* dentry)
-{
-    if (!can_cache_inodes) {
-        dentry_delete_from_cache(dentry);
-    } else {
-        if (need_to_free_inode_cache()) {
-            free_inode_cache();
-        }
-    }
-    stat_cached_dentries--;
-}
-
-static dentry_t* dentry_alloc_new(uint32_t dev_indx, uint32_t inode_indx, int need_to_read_inode)
+static dentry_t* dentry_alloc_new_locked(uint32_t dev_indx, uint32_t inode_indx, int need_to_read_inode)
 {
     if (inode_indx == 0) {
         return NULL;
     }
 
-    dentry_t* dentry = dentry_cache_find_empty_entry();
+    dentry_t* dentry = dentry_cache_find_empty_entry_locked();
     fs_desc_t* fs_desc;
 
-    /* If inode_indx isn't 0, so we can say that we replace a valid dentry, which
-       has area for storing inode allocated. */
-    bool already_allocated_inode = (dentry->inode_indx != 0);
     lock_init(&dentry->lock);
     dentry->d_count = 1;
     dentry->flags = 0;
@@ -201,21 +271,112 @@ static dentry_t* dentry_alloc_new(uint32_t dev_indx, uint32_t inode_indx, int ne
     dentry->inode_indx = inode_indx;
     dentry->fsdata = dentry->ops->dentry.get_fsdata(dentry);
     dentry->parent = NULL;
-
-    if (!already_allocated_inode) {
+    dentry->mountpoint = NULL;
+    dentry->mounted_dentry = NULL;
+    dentry->sock = NULL;
+    dentry->loading = false;
+    dentry->load_failed = false;
+
+    /* If a valid dentry was replaced, it has area for storing inode allocated. */
+    if (!dentry->inode) {
         dentry->inode = (inode_t*)kmalloc(INODE_LEN);
         stat_cached_inodes_area_size += INODE_LEN;
     }
 
-    if (need_to_read_inode && dentry->ops->dentry.read_inode(dentry) < 0) {
-        log_error("[Dentry] Can't read inode %d %d (dev, ino)", dev_indx, inode_indx);
-        return NULL;
+    if (need_to_read_inode) {
+        lock_acquire(&dentry->lock);
+        dentry->loading = true;
     }
 
+    dentry_hash_insert_locked(dentry);
     stat_cached_dentries++;
     return dentry;
 }
 
+/**
+ * Reads the inode of a dentry returned loading by dentry_alloc_new_locked().
+ * Lookups, which found the dentry meanwhile, hold a reference and wait on its
+ * lock. While the dentry is loading its d_count is changed only under the
+ * cache lock. On failure the dentry is unhashed and the last of its holders
+ * frees it.
+ * Note: must be called with the dentry's lock held and without the cache lock.
+ */
+static dentry_t* dentry_load_inode(dentry_t* dentry)
+{
+    int err = dentry->ops->dentry.read_inode(dentry);
+
+    lock_acquire(&dentry_cache_lock);
+    dentry->loading = false;
+    if (err >= 0) {
+        lock_release(&dentry_cache_lock);
+        lock_release(&dentry->lock);
+        return dentry;
+    }
+
+    log_error("[Dentry] Can't read inode %d %d (dev, ino)", dentry->dev_indx, dentry->inode_indx);
+    dentry->load_failed = true;
+    dentry_hash_remove_locked(dentry);
+    dentry->d_count--;
+    lock_release(&dentry->lock);
+    if (dentry->d_count == 0) {
+        stat_cached_dentries--;
+        dentry_cache_free_entry_locked(dentry);
+    }
+    lock_release(&dentry_cache_lock);
+    return NULL;
+}
+
+/**
+ * Waits for the reader of a loading dentry, which the caller holds.
+ * Returns NULL and drops the reference, if the inode couldn't be read.
+ */
+static dentry_t* dentry_wait_loaded(dentry_t* dentry)
+{
+    lock_acquire(&dentry->lock);
+    bool failed = dentry->load_failed;
+    lock_release(&dentry->lock);
+    if (!failed) {
+        return dentry;
+    }
+
+    /* The dentry is unhashed, only the holders of the failed load change d_count. */
+    lock_acquire(&dentry_cache_lock);
+    dentry->d_count--;
+    if (dentry->d_count == 0) {
+        stat_cached_dentries--;
+        dentry_cache_free_entry_locked(dentry);
+    }
+    lock_release(&dentry_cache_lock);
+    return NULL;
+}
+
+/**
+ * dentry_cache_release is called when the last reference to the dentry is
+ * dropped. The dentry stays valid and can be reused without needless to read
+ * all data again, or it is compeletly deleted from the cache in case when the
+ * file was deleted. Otherwise, a new file created with the same inode_id could
+ * use old inode data.
+ * Note: must be called without the dentry's lock held.
+ */
+static void dentry_cache_release(dentry_t* dentry, bool inode_deleted)
+{
+    lock_acquire(&dentry_cache_lock);
+    /* Somebody could have got the dentry from the hashtable, while we flushed it. */
+    if (dentry->d_count != 0 || dentry->in_lru || dentry->inode_indx == 0) {
+        lock_release(&dentry_cache_lock);
+        return;
+    }
+
+    stat_cached_dentries--;
+    if (inode_deleted) {
+        dentry_cache_free_entry_locked(dentry);
+    } else {
+        dentry_lru_push_locked(dentry);
+        dentry_cache_trim_locked();
+    }
+    lock_release(&dentry_cache_lock);
+}
+
 void dentry_set_inode(dentry_t* dentry, inode_t* inode)
 {
     lock_acquire(&dentry->lock);
@@ -229,8 +390,17 @@ void dentry_set_inode(dentry_t* dentry, inode_t* inode)
 void dentry_set_parent(dentry_t* to, dentry_t* parent)
 {
     lock_acquire(&to->lock);
+    dentry_t* old_parent = to->parent;
+    if (old_parent == parent) {
+        lock_release(&to->lock);
+        return;
+    }
     to->parent = dentry_duplicate(parent);
     lock_release(&to->lock);
+
+    if (old_parent) {
+        dentry_put(old_parent);
+    }
 }
 
 dentry_t* dentry_get_parent(dentry_t* dentry)
@@ -242,7 +412,207 @@ dentry_t* dentry_get_parent(dentry_t* dentry)
 }
 
 /**
- * Is a thread enrty point. The function flushes all inodes to drive.
+ * DIRTY LIST & WRITEBACK
+ */
+
+static void dentry_dirty_list_add(dentry_t* dentry)
+{
+    lock_acquire(&dentry_dirty_lock);
+    if (!dentry->in_dirty_list) {
+        dentry->dirty_prev = NULL;
+        dentry->dirty_next = dentry_dirty_head;
+        if (dentry_dirty_head) {
+            dentry_dirty_head->dirty_prev = dentry;
+        }
+        dentry_dirty_head = dentry;
+        dentry->in_dirty_list = true;
+    }
+    lock_release(&dentry_dirty_lock);
+}
+
+static inline void dentry_dirty_list_remove_locked(dentry_t* dentry)
+{
+    if (!dentry->in_dirty_list) {
+        return;
+    }
+
+    if (dentry->dirty_prev) {
+        dentry->dirty_prev->dirty_next = dentry->dirty_next;
+    } else {
+        dentry_dirty_head = dentry->dirty_next;
+    }
+
+    if (dentry->dirty_next) {
+        dentry->dirty_next->dirty_prev = dentry->dirty_prev;
+    }
+
+    dentry->dirty_prev = NULL;
+    dentry->dirty_next = NULL;
+    dentry->in_dirty_list = false;
+}
+
+static void dentry_dirty_list_remove(dentry_t* dentry)
+{
+    lock_acquire(&dentry_dirty_lock);
+    dentry_dirty_list_remove_locked(dentry);
+    lock_release(&dentry_dirty_lock);
+}
+
+static inline void dentry_cache_hold_locked(dentry_t* dentry)
+{
+    /* A dentry, whose last reference is being dropped, is not in the lru yet
+       and is still counted: dentry_cache_release() will see it held again. */
+    if (dentry->in_lru) {
+        dentry_lru_remove_locked(dentry);
+        stat_cached_dentries++;
+    }
+    lock_acquire(&dentry->lock);
+    dentry->d_count++;
+    lock_release(&dentry->lock);
+}
+
+/**
+ * Takes up to DENTRY_WRITEBACK_BATCH dentries from the dirty list. The
+ * dentries are held, so they can't be evicted while they are written.
+ * Note: the writeback runs with interrupts enabled, so locks are taken only
+ * with interrupts disabled, a syscall could spin on a lock of a preempted thread.
+ */
+static uint32_t dentry_writeback_collect(dentry_t** batch)
+{
+    uint32_t count = 0;
+    system_disable_interrupts();
+    lock_acquire(&dentry_cache_lock);
+    lock_acquire(&dentry_dirty_lock);
+    while (count < DENTRY_WRITEBACK_BATCH && dentry_dirty_head) {
+        dentry_t* dentry = dentry_dirty_head;
+        dentry_dirty_list_remove_locked(dentry);
+        batch[count++] = dentry;
+    }
+    lock_release(&dentry_dirty_lock);
+
+    for (uint32_t i = 0; i < count; i++) {
+        dentry_cache_hold_locked(batch[i]);
+    }
+    lock_release(&dentry_cache_lock);
+    system_enable_interrupts();
+    return count;
+}
+
+static inline bool dentry_writeback_less(dentry_t* a, dentry_t* b)
+{
+    if (a->dev_indx != b->dev_indx) {
+        return a->dev_indx < b->dev_indx;
+    }
+    return a->inode_indx < b->inode_indx;
+}
+
+/**
+ * Drops the reference taken by dentry_writeback_collect(). If it is the last
+ * one, a dirty inode is written here with interrupts enabled, and the parent
+ * is held while the dentry is put, so its last put is done the same way.
+ * Note: deleting an inode still runs with interrupts disabled, freeing updates
+ * bitmaps of the filesystem which are not guarded by any lock.
+ */
+static void dentry_writeback_unpin(dentry_t* dentry)
+{
+    while (dentry) {
+        system_disable_interrupts();
+        lock_acquire(&dentry->lock);
+        bool last_ref = dentry->d_count == 1;
+        bool write = last_ref && dentry->inode && dentry_test_flag_lockless(dentry, DENTRY_DIRTY)
+            && !dentry_test_flag_lockless(dentry, DENTRY_INODE_TO_BE_DELETED | DENTRY_CUSTOM);
+        if (write) {
+            dentry_rem_flag_lockless(dentry, DENTRY_DIRTY);
+            lock_release(&dentry->lock);
+            system_enable_interrupts();
+            dentry->ops->dentry.write_inode(dentry);
+            continue;
+        }
+
+        dentry_t* parent = last_ref ? dentry->parent : NULL;
+        lock_release(&dentry->lock);
+        if (parent) {
+            dentry_duplicate(parent);
+        }
+        dentry_put(dentry);
+        system_enable_interrupts();
+        dentry = parent;
+    }
+}
+
+/**
+ * Writes inodes of the batch. The batch is sorted, so inodes which share a
+ * block of the inode table are next to each other and filesystems supporting
+ * write_inodes could write them at once.
+ * The dentries are pinned by the batch, so the inodes are written with
+ * interrupts enabled and without the dentry locks. DENTRY_DIRTY is cleared
+ * before the write, so a change made meanwhile marks the inode dirty again.
+ */
+static void dentry_writeback_batch(dentry_t** batch, uint32_t count)
+{
+    for (uint32_t i = 1; i < count; i++) {
+        dentry_t* dentry = batch[i];
+        uint32_t j = i;
+        for (; j > 0 && dentry_writeback_less(dentry, batch[j - 1]); j--) {
+            batch[j] = batch[j - 1];
+        }
+        batch[j] = dentry;
+    }
+
+    dentry_t* dirty[DENTRY_WRITEBACK_BATCH];
+    for (uint32_t i = 0; i < count;) {
+        uint32_t dirty_cnt = 0;
+        uint32_t dev_indx = batch[i]->dev_indx;
+
+        for (; i < count && batch[i]->dev_indx == dev_indx; i++) {
+            system_disable_interrupts();
+            lock_acquire(&batch[i]->lock);
+            if (dentry_test_flag_lockless(batch[i], DENTRY_DIRTY) && batch[i]->inode) {
+                dentry_rem_flag_lockless(batch[i], DENTRY_DIRTY);
+                dirty[dirty_cnt++] = batch[i];
+            }
+            lock_release(&batch[i]->lock);
+            system_enable_interrupts();
+        }
+
+        if (dirty_cnt && dirty[0]->ops->dentry.write_inodes) {
+            dirty[0]->ops->dentry.write_inodes(dirty, dirty_cnt);
+        } else {
+            for (uint32_t j = 0; j < dirty_cnt; j++) {
+                dirty[j]->ops->dentry.write_inode(dirty[j]);
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        dentry_writeback_unpin(batch[i]);
+    }
+}
+
+/**
+ * dentry_writeback writes all dirty inodes to drives.
+ */
+void dentry_writeback()
+{
+    dentry_t* batch[DENTRY_WRITEBACK_BATCH];
+    uint32_t count;
+    while ((count = dentry_writeback_collect(batch))) {
+        dentry_writeback_batch(batch, count);
+    }
+}
+
+/**
+ * dentry_fsync writes the inode of the dentry, if it is dirty.
+ */
+void dentry_fsync(dentry_t* dentry)
+{
+    lock_acquire(&dentry->lock);
+    dentry_flush_inode(dentry);
+    lock_release(&dentry->lock);
+}
+
+/**
+ * Is a thread enrty point. The function writes dirty inodes to drives.
  */
 void dentry_flusher()
 {
@@ -250,79 +620,76 @@ void dentry_flusher()
 #ifdef DENTRY_DEBUG
         log("WORK dentry_flusher");
 #endif
-        dentry_cache_list_t* dentry_cache_block = dentry_cache;
-        while (dentry_cache_block) {
-            lock_acquire(&dentry_cache_block->lock);
-            int dentries_in_block = dentry_cache_block->len / sizeof(dentry_t);
-            for (int i = 0; i < dentries_in_block; i++) {
-                if (dentry_cache_block->data[i].inode_indx != 0) {
-                    // Keep only locks here might not be as effective as with disabled interrupts.
-                    lock_acquire(&dentry_cache_block->data[i].lock);
-                    system_disable_interrupts();
-                    dentry_flush_inode(&dentry_cache_block->data[i]);
-                    system_enable_interrupts();
-                    lock_release(&dentry_cache_block->data[i].lock);
-                }
-            }
-            lock_release(&dentry_cache_block->lock);
-            dentry_cache_block = dentry_cache_block->next;
-        }
+        dentry_writeback();
         ksys1(SYS_SLEEP, 2);
     }
 }
 
+/**
+ * dentry_cache_lookup_locked finds the dentry in the hashtable and marks
+ * it as held. Returns NULL if there is no such dentry in the cache.
+ */
+static dentry_t* dentry_cache_lookup_locked(uint32_t dev_indx, uint32_t inode_indx)
+{
+    dentry_t* dentry = dentry_hash_find_locked(dev_indx, inode_indx);
+    if (!dentry) {
+        return NULL;
+    }
+
+    /* The reader holds the lock of a loading dentry, see dentry_load_inode(). */
+    if (dentry->loading) {
+        dentry->d_count++;
+        return dentry;
+    }
+
+    dentry_cache_hold_locked(dentry);
+    return dentry;
+}
+
 /**
  * There are 3 cases for each entry in a cache array:
  * 1) We have a valid dentry which is held by someone.
- * 2) We have a valid dentry which isn'y held by someone and ready to swapped out.
- * 3) We have an unsed entry in the cache array.
+ * 2) We have a valid dentry which isn'y held by someone and ready to swapped out (it's in lru).
+ * 3) We have an unsed entry in the cache array (it's in the free list).
  */
 dentry_t* dentry_get(uint32_t dev_indx, uint32_t inode_indx)
 {
-    /* We try to find the dentry in the cache */
-    dentry_cache_list_t* dentry_cache_block = dentry_cache;
-    while (dentry_cache_block) {
-        lock_acquire(&dentry_cache_block->lock);
-        int dentries_in_block = dentry_cache_block->len / sizeof(dentry_t);
-        for (int i = 0; i < dentries_in_block; i++) {
-            if (dentry_cache_block->data[i].dev_indx == dev_indx && dentry_cache_block->data[i].inode_indx == inode_indx) {
-                if (!dentry_cache_block->data[i].d_count)
-                    stat_cached_dentries++;
-                lock_release(&dentry_cache_block->lock);
-                return dentry_duplicate(&dentry_cache_block->data[i]);
-            }
-        }
-        lock_release(&dentry_cache_block->lock);
-        dentry_cache_block = dentry_cache_block->next;
+    lock_acquire(&dentry_cache_lock);
+    dentry_t* dentry = dentry_cache_lookup_locked(dev_indx, inode_indx);
+    if (dentry) {
+        bool loading = dentry->loading;
+        lock_release(&dentry_cache_lock);
+        return loading ? dentry_wait_loaded(dentry) : dentry;
     }
 
-    /* It means no dentry in the cache. Let's add it. */
-    return dentry_alloc_new(dev_indx, inode_indx, READ_INODE);
+    /* It means no dentry in the cache. Let's add it, the inode is read without the cache lock. */
+    dentry = dentry_alloc_new_locked(dev_indx, inode_indx, READ_INODE);
+    lock_release(&dentry_cache_lock);
+    if (!dentry) {
+        return NULL;
+    }
+    return dentry_load_inode(dentry);
 }
 
 dentry_t* dentry_get_no_inode(uint32_t dev_indx, uint32_t inode_indx, int* newly_allocated)
 {
-    /* We try to find the dentry in the cache */
-    dentry_cache_list_t* dentry_cache_block = dentry_cache;
-    while (dentry_cache_block) {
-        lock_acquire(&dentry_cache_block->lock);
-        int dentries_in_block = dentry_cache_block->len / sizeof(dentry_t);
-        for (int i = 0; i < dentries_in_block; i++) {
-            if (dentry_cache_block->data[i].dev_indx == dev_indx && dentry_cache_block->data[i].inode_indx == inode_indx) {
-                if (!dentry_cache_block->data[i].d_count)
-                    stat_cached_dentries++;
-                *newly_allocated = DENTRY_WAS_IN_CACHE;
-                lock_release(&dentry_cache_block->lock);
-                return dentry_duplicate(&dentry_cache_block->data[i]);
-            }
-        }
-        lock_release(&dentry_cache_block->lock);
-        dentry_cache_block = dentry_cache_block->next;
+    lock_acquire(&dentry_cache_lock);
+    dentry_t* dentry = dentry_cache_lookup_locked(dev_indx, inode_indx);
+    if (dentry && dentry->loading) {
+        lock_release(&dentry_cache_lock);
+        *newly_allocated = DENTRY_WAS_IN_CACHE;
+        return dentry_wait_loaded(dentry);
     }
 
-    /* It means no dentry in the cache. Let's add it. */
-    *newly_allocated = DENTRY_NEWLY_ALLOCATED;
-    return dentry_alloc_new(dev_indx, inode_indx, NOT_READ_INODE);
+    if (dentry) {
+        *newly_allocated = DENTRY_WAS_IN_CACHE;
+    } else {
+        /* It means no dentry in the cache. Let's add it. */
+        *newly_allocated = DENTRY_NEWLY_ALLOCATED;
+        dentry = dentry_alloc_new_locked(dev_indx, inode_indx, NOT_READ_INODE);
+    }
+    lock_release(&dentry_cache_lock);
+    return dentry;
 }
 
 dentry_t* dentry_duplicate(dentry_t* dentry)
@@ -333,18 +700,18 @@ dentry_t* dentry_duplicate(dentry_t* dentry)
     return dentry;
 }
 
-static inline void dentry_put_impl(dentry_t* dentry)
+/**
+ * dentry_put_impl is called with dentry's lock held, when the dentry
+ * isn't held by anyone. Returns true if the inode was deleted.
+ */
+static inline bool dentry_put_impl(dentry_t* dentry)
 {
-    if (dentry->parent) {
-        dentry_put(dentry->parent);
-    }
-
     if (dentry_test_flag_lockless(dentry, DENTRY_CUSTOM)) {
         dentry->inode_indx = 0;
         if (dentry->ops->dentry.free_inode) {
             dentry->ops->dentry.free_inode(dentry);
         }
-        return;
+        return false;
     }
 
     if (dentry_test_flag_lockless(dentry, DENTRY_INODE_TO_BE_DELETED)) {
@@ -352,26 +719,48 @@ static inline void dentry_put_impl(dentry_t* dentry)
         log("Inode delete %d", dentry->inode_indx);
 #endif
         dentry_delete_inode(dentry);
-        dentry_delete_from_cache(dentry);
-        return;
+        return true;
     }
 #ifdef DENTRY_DEBUG
     log("Inode flushed %d", dentry->inode_indx);
 #endif
     dentry_flush_inode(dentry);
-    dentry_prefree(dentry);
+    return false;
+}
+
+/**
+ * dentry_put_last_ref finishes the work of the last put. Called with
+ * dentry's lock held, releases it.
+ */
+static void dentry_put_last_ref(dentry_t* dentry)
+{
+    bool is_custom = dentry_test_flag_lockless(dentry, DENTRY_CUSTOM);
+    dentry_t* parent = dentry->parent;
+    dentry->parent = NULL;
+
+    bool inode_deleted = dentry_put_impl(dentry);
+    lock_release(&dentry->lock);
+
+    /* Custom dentries are not a cache of a file, so they are not kept in the cache. */
+    if (!is_custom) {
+        dentry_cache_release(dentry, inode_deleted);
+    }
+
+    if (parent) {
+        dentry_put(parent);
+    }
 }
 
 void dentry_force_put(dentry_t* dentry)
 {
     lock_acquire(&dentry->lock);
     if (dentry_test_flag_lockless(dentry, DENTRY_MOUNTPOINT)) {
+        lock_release(&dentry->lock);
         return;
     }
 
     dentry->d_count = 0;
-    dentry_put_impl(dentry);
-    lock_release(&dentry->lock);
+    dentry_put_last_ref(dentry);
 }
 
 void dentry_put(dentry_t* dentry)
@@ -381,7 +770,8 @@ void dentry_put(dentry_t* dentry)
     dentry->d_count--;
 
     if (dentry->d_count == 0) {
-        dentry_put_impl(dentry);
+        dentry_put_last_ref(dentry);
+        return;
     }
     lock_release(&dentry->lock);
 }
@@ -390,14 +780,22 @@ void dentry_put_all_dentries_of_dev(uint32_t dev_indx)
 {
     dentry_cache_list_t* dentry_cache_block = dentry_cache;
     while (dentry_cache_block) {
-        lock_acquire(&dentry_cache_block->lock);
         int dentries_in_block = dentry_cache_block->len / sizeof(dentry_t);
         for (int i = 0; i < dentries_in_block; i++) {
-            if (dentry_cache_block->data[i].dev_indx == dev_indx && dentry_cache_block->data[i].inode != 0) {
-                dentry_force_put(&dentry_cache_block->data[i]);
+            dentry_t* dentry = &dentry_cache_block->data[i];
+            if (dentry->dev_indx == dev_indx && dentry->inode_indx != 0) {
+                if (dentry->d_count) {
+                    dentry_force_put(dentry);
+                }
+
+                /* The device is gone, so the cached data of it is no longer valid. */
+                lock_acquire(&dentry_cache_lock);
+                if (dentry->d_count == 0 && dentry->inode_indx != 0) {
+                    dentry_cache_free_entry_locked(dentry);
+                }
+                lock_release(&dentry_cache_lock);
             }
         }
-        lock_release(&dentry_cache_block->lock);
         dentry_cache_block = dentry_cache_block->next;
     }
 }
@@ -405,6 +803,11 @@ void dentry_put_all_dentries_of_dev(uint32_t dev_indx)
 static inline void dentry_set_flag_lockless(dentry_t* dentry, uint32_t flag)
 {
     dentry->flags |= flag;
+
+    /* Custom dentries are not owned by the cache, they are never written back. */
+    if ((flag & DENTRY_DIRTY) && !(dentry->flags & DENTRY_CUSTOM)) {
+        dentry_dirty_list_add(dentry);
+    }
 }
 
 static inline bool dentry_test_flag_lockless(dentry_t* dentry, uint32_t flag)
@@ -425,7 +828,7 @@ static inline bool dentry_inode_test_flag_lockless(dentry_t* dentry, mode_t mode
 inline void dentry_set_flag(dentry_t* dentry, uint32_t flag)
 {
     lock_acquire(&dentry->lock);
-    dentry->flags |= flag;
+    dentry_set_flag_lockless(dentry, flag);
     lock_release(&dentry->lock);
 }
 
@@ -432,6 +432,15 @@ int devfs_can_write(dentry_t* dentry, uint32_t start)
     return true;
 }
 
+wait_queue_t* devfs_wait_queue(dentry_t* dentry)
+{
+    devfs_inode_t* devfs_inode = (devfs_inode_t*)dentry->inode;
+    if (devfs_inode->handlers->wait_queue) {
+        return devfs_inode->handlers->wait_queue(dentry);
+    }
+    return NULL;
+}
+
 int devfs_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
 {
     devfs_inode_t* devfs_inode = (devfs_inode_t*)dentry->inode;
@@ -518,6 +527,7 @@ driver_desc_t _devfs_driver_info()
     fs_desc.functions[DRIVER_FILE_SYSTEM_FSTAT] = devfs_fstat;
     fs_desc.functions[DRIVER_FILE_SYSTEM_IOCTL] = devfs_ioctl;
     fs_desc.functions[DRIVER_FILE_SYSTEM_MMAP] = devfs_mmap;
+    fs_desc.functions[DRIVER_FILE_SYSTEM_WAIT_QUEUE] = devfs_wait_queue;
 
     return fs_desc;
 }
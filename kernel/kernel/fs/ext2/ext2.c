@@ -10,9 +10,11 @@
 #include <libkern/libkern.h>
 #include <libkern/log.h>
 #include <mem/kmalloc.h>
+#include <platform/generic/system.h>
 #include <time/time_manager.h>
 
 #define MAX_BLOCK_LEN 1024
+#define EXT2_DX_MAX_LEVELS 2
 
 #define SUPERBLOCK _ext2_superblocks[dev->dev->id]
 #define GROUPS_COUNT _ext2_group_table_info[dev->dev->id].count
@@ -23,11 +25,34 @@
 
 static superblock_t* _ext2_superblocks[MAX_DEVICES_COUNT];
 static groups_info_t _ext2_group_table_info[MAX_DEVICES_COUNT];
+static uint32_t* _ext2_group_free_hints[MAX_DEVICES_COUNT]; /* The first bit of a group which might be free. */
+
+/* A step on the path from the dx root to a leaf. */
+struct dx_frame {
+    uint32_t block_index; /* Index of the block inside the dir. */
+    uint8_t* buf;
+    dx_entry_t* entries;
+    dx_entry_t* at;
+};
+typedef struct dx_frame dx_frame_t;
+
+struct dx_path {
+    dx_frame_t frames[EXT2_DX_MAX_LEVELS];
+    uint32_t levels;
+    uint32_t hash;
+    uint32_t hash_version;
+};
+typedef struct dx_path dx_path_t;
 
 driver_desc_t _ext2_driver_info();
 
 /* DRIVE RELATED FUNCTIONS */
 static void _ext2_read_from_dev(vfs_device_t* dev, uint8_t* buf, uint32_t start, uint32_t len);
+/**
+ * Note: the dentry flusher writes inodes with interrupts enabled, so a drive
+ * command and the read-modify-write of a sector run with interrupts disabled,
+ * a syscall must not interleave with them.
+ */
 static void _ext2_write_to_dev(vfs_device_t* dev, uint8_t* buf, uint32_t start, uint32_t len);
 static uint32_t _ext2_get_disk_size(vfs_device_t* dev);
 
@@ -35,6 +60,8 @@ static uint32_t _ext2_get_disk_size(vfs_device_t* dev);
 static inline bool _ext2_bitmap_get(uint8_t* bitmap, uint32_t index);
 static inline void _ext2_bitmap_set_bit(uint8_t* bitmap, uint32_t index);
 static inline void _ext2_bitmap_unset_bit(uint8_t* bitmap, uint32_t index);
+static uint32_t _ext2_bitmap_find_zero(uint32_t* bitmap, uint32_t start, uint32_t len);
+static uint32_t _ext2_bitmap_find_one(uint32_t* bitmap, uint32_t start, uint32_t len);
 
 /* GROUPS FUNCTIONS */
 static inline uint32_t _ext2_get_group_len(superblock_t* sb);
@@ -53,15 +80,23 @@ static int _ext2_set_block_of_inode_lev1(dentry_t* dentry, uint32_t cur_block, u
 static int _ext2_set_block_of_inode_lev2(dentry_t* dentry, uint32_t cur_block, uint32_t inode_block_index, uint32_t val);
 static int _ext2_set_block_of_inode(dentry_t* dentry, uint32_t inode_block_index, uint32_t val);
 
-static int _ext2_find_free_block_index(vfs_device_t* dev, fsdata_t fsdata, uint32_t* block_index, uint32_t group_index);
-static int _ext2_allocate_block_index(vfs_device_t* dev, fsdata_t fsdata, uint32_t* block_index, uint32_t pref_group);
-static int _ext2_free_block_index(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index);
+static int _ext2_find_free_blocks(vfs_device_t* dev, fsdata_t fsdata, uint32_t group_index, uint32_t goal_off, uint32_t want, uint32_t* block_index, uint32_t* count);
+static int _ext2_allocate_blocks(vfs_device_t* dev, fsdata_t fsdata, uint32_t goal, uint32_t want, uint32_t* block_index, uint32_t* count);
+static int _ext2_free_blocks(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index, uint32_t count);
 
-static int _ext2_allocate_block_for_inode(dentry_t* dentry, uint32_t pref_group, uint32_t* block_index);
+static uint32_t _ext2_get_data_blocks_cnt(dentry_t* dentry);
+static uint32_t _ext2_get_goal_block(dentry_t* dentry);
+static int _ext2_allocate_meta_block(dentry_t* dentry, uint32_t* block_index);
+static int _ext2_prepare_indirect_blocks(dentry_t* dentry, uint32_t inode_block_index);
+static int _ext2_allocate_blocks_for_inode(dentry_t* dentry, uint32_t count);
+static int _ext2_allocate_block_for_inode(dentry_t* dentry, uint32_t* block_index);
+static void _ext2_release_blocks_of_inode(dentry_t* dentry, uint32_t from);
 
 /* INODE FUNCTIONS */
+static uint32_t _ext2_get_inode_offset(dentry_t* dentry);
 int ext2_read_inode(dentry_t* dentry);
 int ext2_write_inode(dentry_t* dentry);
+int ext2_write_inodes(dentry_t** dentries, uint32_t count);
 int ext2_free_inode(dentry_t* dentry);
 
 static int _ext2_find_free_inode_index(vfs_device_t* dev, fsdata_t fsdata, uint32_t* inode_index, uint32_t group_index);
@@ -78,10 +113,28 @@ static int _ext2_add_first_entry_to_dir_block(vfs_device_t* dev, fsdata_t fsdata
 static int _ext2_add_to_dir_block(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index, dentry_t* child_dentry, const char* filename, uint32_t len);
 static int _ext2_rm_from_dir_block(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index, dentry_t* child_dentry);
 
+static uint32_t _ext2_get_dir_block(dentry_t* dir, uint32_t block_index);
+static int _ext2_dir_read_block(dentry_t* dir, uint32_t block_index, uint8_t* buf);
+static int _ext2_dir_write_block(dentry_t* dir, uint32_t block_index, uint8_t* buf);
+static int _ext2_dir_append_block(dentry_t* dir, uint32_t* block_index, uint32_t* data_block_index);
+static uint8_t _ext2_dir_entry_file_type(fsdata_t fsdata, dentry_t* child_dentry);
+
 static int _ext2_add_child(dentry_t* dir, dentry_t* child_dentry, const char* name, int len);
 static int _ext2_rm_child(dentry_t* dir, dentry_t* child_dentry);
 static int _ext2_setup_dir(dentry_t* dir, dentry_t* parent_dir, mode_t mode);
 
+/* HTREE FUNCTIONS */
+static inline bool _ext2_has_dir_index(superblock_t* sb);
+static inline bool _ext2_is_dir_indexed(dentry_t* dir);
+static uint32_t _ext2_dx_hash(superblock_t* sb, uint32_t hash_version, const char* name, uint32_t len);
+static int _ext2_dx_probe(dentry_t* dir, const char* name, uint32_t len, dx_path_t* path);
+static bool _ext2_dx_next_leaf(dentry_t* dir, dx_path_t* path);
+static int _ext2_dx_lookup(dentry_t* dir, const char* name, uint32_t len, uint32_t* found_inode_index);
+static int _ext2_dx_split_leaf(dentry_t* dir, dx_path_t* path, uint32_t data_block_index, uint8_t* buf, uint8_t* new_buf, uint32_t* target_block_index);
+static int _ext2_dx_grow_index(dentry_t* dir, dx_path_t* path, uint8_t* buf);
+static int _ext2_dx_add_child(dentry_t* dir, dentry_t* child_dentry, const char* name, uint32_t len);
+static int _ext2_dx_make_indexed(dentry_t* dir);
+
 /* FILE FUNCTIONS */
 static int _ext2_setup_file(dentry_t* file, mode_t mode);
 
@@ -89,6 +142,7 @@ static int _ext2_setup_file(dentry_t* file, mode_t mode);
 int ext2_recognize_drive(vfs_device_t* dev);
 int ext2_prepare_fs(vfs_device_t* dev);
 int ext2_save_state(vfs_device_t* dev);
+int ext2_sync(vfs_device_t* dev);
 fsdata_t get_fsdata(dentry_t* dentry);
 
 int ext2_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len);
@@ -113,7 +167,9 @@ static void _ext2_read_from_dev(vfs_device_t* dev, uint8_t* buf, uint32_t start,
     uint8_t tmp_buf[512];
 
     while (len) {
+        system_disable_interrupts();
         read(dev->dev, sector, tmp_buf);
+        system_enable_interrupts();
         for (int i = 0; i < min(512 - start_offset, len); i++) {
             buf[already_read++] = tmp_buf[start_offset + i];
         }
@@ -132,6 +188,7 @@ static void _ext2_write_to_dev(vfs_device_t* dev, uint8_t* buf, uint32_t start,
     uint32_t start_offset = start % 512;
     uint8_t tmp_buf[512];
     while (len != 0) {
+        system_disable_interrupts();
         if (start_offset != 0 || len < 512) {
             read(dev->dev, sector, tmp_buf);
         }
@@ -139,6 +196,7 @@ static void _ext2_write_to_dev(vfs_device_t* dev, uint8_t* buf, uint32_t start,
             tmp_buf[start_offset + i] = buf[already_written++];
         }
         write(dev->dev, sector, tmp_buf, 512);
+        system_enable_interrupts();
         len -= min(512 - start_offset, len);
         sector++;
         start_offset = 0;
@@ -170,6 +228,32 @@ static inline void _ext2_bitmap_unset_bit(uint8_t* bitmap, uint32_t index)
     bitmap[index / 8] &= ~(1 << (index % 8));
 }
 
+/**
+ * Bitmaps are scanned a word at a time, so they have to be word aligned.
+ * Both functions return @len if nothing is found.
+ */
+static uint32_t _ext2_bitmap_find_zero(uint32_t* bitmap, uint32_t start, uint32_t len)
+{
+    for (uint32_t i = start; i < len; i = (i | 31) + 1) {
+        uint32_t word = bitmap[i / 32] | ((1u << (i % 32)) - 1);
+        if (word != 0xffffffff) {
+            return min((i & ~31u) + __builtin_ctz(~word), len);
+        }
+    }
+    return len;
+}
+
+static uint32_t _ext2_bitmap_find_one(uint32_t* bitmap, uint32_t start, uint32_t len)
+{
+    for (uint32_t i = start; i < len; i = (i | 31) + 1) {
+        uint32_t word = bitmap[i / 32] & ~((1u << (i % 32)) - 1);
+        if (word != 0) {
+            return min((i & ~31u) + __builtin_ctz(word), len);
+        }
+    }
+    return len;
+}
+
 /**
  * GROUPS FUNCTIONS
  */
@@ -290,88 +374,382 @@ int _ext2_set_block_of_inode(dentry_t* dentry, uint32_t inode_block_index, uint3
     return _ext2_set_block_of_inode_lev2(dentry, dentry->inode->block[14], inode_block_index - (12 + block_len + block_len * block_len), val);
 }
 
-static int _ext2_find_free_block_index(vfs_device_t* dev, fsdata_t fsdata, uint32_t* block_index, uint32_t group_index)
+/**
+ * _ext2_find_free_blocks looks for a run of free blocks in the group. The
+ * search starts from @goal_off, the run is at most @want blocks long.
+ */
+static int _ext2_find_free_blocks(vfs_device_t* dev, fsdata_t fsdata, uint32_t group_index, uint32_t goal_off, uint32_t want, uint32_t* block_index, uint32_t* count)
 {
-    uint8_t block_bitmap[MAX_BLOCK_LEN];
-    _ext2_read_from_dev(dev, block_bitmap, _ext2_get_block_offset(fsdata.sb, fsdata.gt->table[group_index].block_bitmap), BLOCK_LEN(fsdata.sb));
+    const uint32_t bits = fsdata.sb->blocks_per_group;
+    uint32_t* hints = _ext2_group_free_hints[dev->dev->id];
+    uint32_t block_bitmap[MAX_BLOCK_LEN / 4];
+    uint32_t bitmap_start = _ext2_get_block_offset(fsdata.sb, fsdata.gt->table[group_index].block_bitmap);
+    _ext2_read_from_dev(dev, (uint8_t*)block_bitmap, bitmap_start, BLOCK_LEN(fsdata.sb));
+
+    uint32_t off = _ext2_bitmap_find_zero(block_bitmap, goal_off, bits);
+    if (off == bits && goal_off > hints[group_index]) {
+        off = _ext2_bitmap_find_zero(block_bitmap, hints[group_index], goal_off);
+        off = (off == goal_off) ? bits : off;
+    }
+    if (off == bits) {
+        hints[group_index] = bits;
+        return -ENOSPC;
+    }
 
-    for (uint32_t off = 0; off < 8 * BLOCK_LEN(fsdata.sb); off++) {
-        if (!_ext2_bitmap_get(block_bitmap, off)) {
-            *block_index = fsdata.sb->blocks_per_group * group_index + off + 1;
-            _ext2_bitmap_set_bit(block_bitmap, off);
-            _ext2_write_to_dev(dev, block_bitmap, _ext2_get_block_offset(fsdata.sb, fsdata.gt->table[group_index].block_bitmap), BLOCK_LEN(fsdata.sb));
+    uint32_t end = _ext2_bitmap_find_one(block_bitmap, off, min(bits, off + want));
+    for (uint32_t i = off; i < end; i++) {
+        _ext2_bitmap_set_bit((uint8_t*)block_bitmap, i);
+    }
+    _ext2_write_to_dev(dev, (uint8_t*)block_bitmap, bitmap_start, BLOCK_LEN(fsdata.sb));
+
+    if (hints[group_index] == off) {
+        hints[group_index] = end;
+    }
+    fsdata.gt->table[group_index].free_blocks_count -= (end - off);
+    fsdata.sb->free_blocks_count -= (end - off);
+
+    *block_index = fsdata.sb->blocks_per_group * group_index + off + 1;
+    *count = end - off;
+    return 0;
+}
+
+/**
+ * _ext2_allocate_blocks allocates up to @want contiguous blocks. It starts
+ * with @goal, if it's busy the next free blocks in its group are taken.
+ * Pass 0 as @goal to take the first free blocks.
+ */
+static int _ext2_allocate_blocks(vfs_device_t* dev, fsdata_t fsdata, uint32_t goal, uint32_t want, uint32_t* block_index, uint32_t* count)
+{
+    uint32_t groups_cnt = fsdata.gt->count;
+    uint32_t* hints = _ext2_group_free_hints[dev->dev->id];
+    uint32_t goal_group = goal ? (goal - 1) / fsdata.sb->blocks_per_group : 0;
+    uint32_t goal_off = goal ? (goal - 1) % fsdata.sb->blocks_per_group : 0;
+    if (goal_group >= groups_cnt) {
+        goal_group = 0;
+        goal_off = 0;
+    }
+
+    for (int i = 0; i < groups_cnt; i++) {
+        uint32_t group_id = (goal_group + i) % groups_cnt;
+        if (!fsdata.gt->table[group_id].free_blocks_count || hints[group_id] >= fsdata.sb->blocks_per_group) {
+            continue;
+        }
+
+        uint32_t start_off = (i == 0) ? max(goal_off, hints[group_id]) : hints[group_id];
+        if (_ext2_find_free_blocks(dev, fsdata, group_id, start_off, want, block_index, count) == 0) {
             return 0;
         }
     }
     return -ENOSPC;
 }
 
-static int _ext2_allocate_block_index(vfs_device_t* dev, fsdata_t fsdata, uint32_t* block_index, uint32_t pref_group)
+static int _ext2_free_blocks(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index, uint32_t count)
 {
-    uint32_t groups_cnt = GROUPS_COUNT;
-    for (int i = 0; i < groups_cnt; i++) {
-        uint32_t group_id = (pref_group + i) % groups_cnt;
-        if (GROUP_TABLES[group_id].free_blocks_count) {
-            if (_ext2_find_free_block_index(dev, fsdata, block_index, group_id) == 0) {
-                return 0;
+    block_index--;
+    uint32_t group_index = block_index / fsdata.sb->blocks_per_group;
+    uint32_t off = block_index % fsdata.sb->blocks_per_group;
+    if (group_index >= fsdata.gt->count || off + count > fsdata.sb->blocks_per_group) {
+        return -EINVAL;
+    }
+
+    uint32_t block_bitmap[MAX_BLOCK_LEN / 4];
+    uint32_t bitmap_start = _ext2_get_block_offset(fsdata.sb, fsdata.gt->table[group_index].block_bitmap);
+    _ext2_read_from_dev(dev, (uint8_t*)block_bitmap, bitmap_start, BLOCK_LEN(fsdata.sb));
+    for (uint32_t i = off; i < off + count; i++) {
+        _ext2_bitmap_unset_bit((uint8_t*)block_bitmap, i);
+    }
+    _ext2_write_to_dev(dev, (uint8_t*)block_bitmap, bitmap_start, BLOCK_LEN(fsdata.sb));
+
+    uint32_t* hints = _ext2_group_free_hints[dev->dev->id];
+    hints[group_index] = min(hints[group_index], off);
+    fsdata.gt->table[group_index].free_blocks_count += count;
+    fsdata.sb->free_blocks_count += count;
+    return 0;
+}
+
+/**
+ * inode->blocks counts indirect blocks too, while most callers are interested
+ * only in the count of data blocks.
+ * NOTE: triple indirect blocks are not supported for writing, so they are not counted.
+ */
+static uint32_t _ext2_get_data_blocks_cnt(dentry_t* dentry)
+{
+    const uint32_t per_block = BLOCK_LEN(dentry->fsdata.sb) / 4;
+    uint32_t total = TO_EXT_BLOCKS_CNT(dentry->fsdata.sb, dentry->inode->blocks);
+    if (total <= 12) {
+        return total;
+    }
+
+    total--; // single indirect
+    if (total <= 12 + per_block) {
+        return total;
+    }
+
+    total--; // double indirect
+    uint32_t rest = total - 12 - per_block;
+    uint32_t lev1_blocks = (rest + per_block) / (per_block + 1);
+    return total - lev1_blocks;
+}
+
+/**
+ * New blocks of a file are put right after its last block. The first block
+ * of a file goes into the group of its inode.
+ */
+static uint32_t _ext2_get_goal_block(dentry_t* dentry)
+{
+    uint32_t blocks_cnt = _ext2_get_data_blocks_cnt(dentry);
+    if (blocks_cnt) {
+        uint32_t last_block_index = _ext2_get_block_of_inode(dentry, blocks_cnt - 1);
+        if (last_block_index) {
+            return last_block_index + 1;
+        }
+    }
+
+    uint32_t group_index = (dentry->inode_indx - 1) / dentry->fsdata.sb->inodes_per_group;
+    return group_index * dentry->fsdata.sb->blocks_per_group + 1;
+}
+
+static int _ext2_allocate_meta_block(dentry_t* dentry, uint32_t* block_index)
+{
+    uint32_t count;
+    if (_ext2_allocate_blocks(dentry->dev, dentry->fsdata, _ext2_get_goal_block(dentry), 1, block_index, &count) < 0) {
+        return -ENOSPC;
+    }
+
+    uint8_t zero_buf[MAX_BLOCK_LEN];
+    memset(zero_buf, 0, BLOCK_LEN(dentry->fsdata.sb));
+    _ext2_write_to_dev(dentry->dev, zero_buf, _ext2_get_block_offset(dentry->fsdata.sb, *block_index), BLOCK_LEN(dentry->fsdata.sb));
+    dentry->inode->blocks += BLOCK_LEN(dentry->fsdata.sb) / 512;
+    dentry_set_flag(dentry, DENTRY_DIRTY);
+    return 0;
+}
+
+/**
+ * Allocates indirect blocks which are needed to store @inode_block_index.
+ */
+static int _ext2_prepare_indirect_blocks(dentry_t* dentry, uint32_t inode_block_index)
+{
+    const uint32_t per_block = BLOCK_LEN(dentry->fsdata.sb) / 4;
+    if (inode_block_index < 12) {
+        return 0;
+    }
+
+    if (inode_block_index < 12 + per_block) {
+        if (dentry->inode->block[12]) {
+            return 0;
+        }
+        return _ext2_allocate_meta_block(dentry, &dentry->inode->block[12]);
+    }
+
+    if (inode_block_index < 12 + per_block + per_block * per_block) {
+        if (!dentry->inode->block[13]) {
+            if (_ext2_allocate_meta_block(dentry, &dentry->inode->block[13]) < 0) {
+                return -ENOSPC;
             }
         }
+
+        uint32_t offset = (inode_block_index - 12 - per_block) / per_block;
+        if (_ext2_get_block_of_inode_lev0(dentry, dentry->inode->block[13], offset)) {
+            return 0;
+        }
+
+        uint32_t lev1_block_index;
+        if (_ext2_allocate_meta_block(dentry, &lev1_block_index) < 0) {
+            return -ENOSPC;
+        }
+        return _ext2_set_block_of_inode_lev0(dentry, dentry->inode->block[13], offset, lev1_block_index);
     }
-    return -ENOSPC;
+
+    return -EFBIG;
 }
 
-static int _ext2_free_block_index(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index)
+/**
+ * Returns how many blocks starting with @inode_block_index are addressed
+ * by the same indirect block (or by the inode itself).
+ */
+static inline uint32_t _ext2_blocks_till_indirect_end(superblock_t* sb, uint32_t inode_block_index)
 {
-    block_index--;
-    uint32_t block_len = BLOCK_LEN(fsdata.sb);
-    uint32_t group_index = block_index / block_len;
-    uint32_t off = block_index % block_len;
+    const uint32_t per_block = BLOCK_LEN(sb) / 4;
+    if (inode_block_index < 12) {
+        return 12 - inode_block_index;
+    }
+    if (inode_block_index < 12 + per_block) {
+        return 12 + per_block - inode_block_index;
+    }
+    return per_block - ((inode_block_index - 12 - per_block) % per_block);
+}
+
+/**
+ * Appends @count blocks to the inode. Blocks are allocated in runs, each one
+ * starts right after the last block of the file, so files stay contiguous.
+ */
+static int _ext2_allocate_blocks_for_inode(dentry_t* dentry, uint32_t count)
+{
+    const uint32_t block_len = BLOCK_LEN(dentry->fsdata.sb);
+
+    while (count) {
+        uint32_t blocks_per_inode = _ext2_get_data_blocks_cnt(dentry);
+        if (_ext2_prepare_indirect_blocks(dentry, blocks_per_inode) < 0) {
+            return -ENOSPC;
+        }
 
-    uint8_t block_bitmap[MAX_BLOCK_LEN];
-    _ext2_read_from_dev(dev, block_bitmap, _ext2_get_block_offset(fsdata.sb, fsdata.gt->table[group_index].block_bitmap), block_len);
+        uint32_t want = min(count, _ext2_blocks_till_indirect_end(dentry->fsdata.sb, blocks_per_inode));
+        uint32_t block_index, allocated;
+        if (_ext2_allocate_blocks(dentry->dev, dentry->fsdata, _ext2_get_goal_block(dentry), want, &block_index, &allocated) < 0) {
+            return -ENOSPC;
+        }
 
-    _ext2_bitmap_unset_bit(block_bitmap, off);
-    _ext2_write_to_dev(dev, block_bitmap, _ext2_get_block_offset(fsdata.sb, fsdata.gt->table[group_index].block_bitmap), block_len);
+        for (uint32_t i = 0; i < allocated; i++) {
+            _ext2_set_block_of_inode(dentry, blocks_per_inode + i, block_index + i);
+        }
+        dentry->inode->blocks += allocated * (block_len / 512);
+        dentry_set_flag(dentry, DENTRY_DIRTY);
+        count -= allocated;
+    }
     return 0;
 }
 
 /**
  * Returns allocated block in @block_index
  */
-static int _ext2_allocate_block_for_inode(dentry_t* dentry, uint32_t pref_group, uint32_t* block_index)
+static int _ext2_allocate_block_for_inode(dentry_t* dentry, uint32_t* block_index)
 {
-    if (_ext2_allocate_block_index(dentry->dev, dentry->fsdata, block_index, pref_group) == 0) {
-        uint32_t blocks_per_inode = TO_EXT_BLOCKS_CNT(dentry->fsdata.sb, dentry->inode->blocks);
-        if (_ext2_set_block_of_inode(dentry, blocks_per_inode, *block_index) == 0) {
-            dentry->inode->blocks += BLOCK_LEN(dentry->fsdata.sb) / 512;
-            dentry_set_flag(dentry, DENTRY_DIRTY);
-            return 0;
+    if (_ext2_allocate_blocks_for_inode(dentry, 1) < 0) {
+        return -ENOSPC;
+    }
+    *block_index = _ext2_get_block_of_inode(dentry, _ext2_get_data_blocks_cnt(dentry) - 1);
+    return 0;
+}
+
+/**
+ * _ext2_release_blocks_of_inode frees all data blocks starting with @from
+ * and indirect blocks which are not needed anymore. Contiguous blocks are
+ * freed with one bitmap update.
+ */
+static void _ext2_release_blocks_of_inode(dentry_t* dentry, uint32_t from)
+{
+    const uint32_t block_len = BLOCK_LEN(dentry->fsdata.sb);
+    const uint32_t per_block = block_len / 4;
+    const uint32_t blocks_per_group = dentry->fsdata.sb->blocks_per_group;
+    uint32_t blocks_cnt = _ext2_get_data_blocks_cnt(dentry);
+    uint32_t run_start = 0;
+    uint32_t run_len = 0;
+
+    for (uint32_t i = from; i < blocks_cnt; i++) {
+        uint32_t block_index = _ext2_get_block_of_inode(dentry, i);
+
+        /* Pointers inside indirect blocks which are freed below are not cleared. */
+        bool holder_stays = (i < 12);
+        holder_stays |= (i >= 12 && i < 12 + per_block && from > 12);
+        holder_stays |= (i >= 12 + per_block && from > 12 + per_block + ((i - 12 - per_block) / per_block) * per_block);
+        if (holder_stays) {
+            _ext2_set_block_of_inode(dentry, i, 0);
+        }
+
+        if (!block_index) {
+            continue;
         }
+        bool same_group = run_len && ((run_start - 1) / blocks_per_group == (block_index - 1) / blocks_per_group);
+        if (same_group && run_start + run_len == block_index) {
+            run_len++;
+            continue;
+        }
+        if (run_len) {
+            _ext2_free_blocks(dentry->dev, dentry->fsdata, run_start, run_len);
+        }
+        run_start = block_index;
+        run_len = 1;
     }
-    return -ENOSPC;
+    if (run_len) {
+        _ext2_free_blocks(dentry->dev, dentry->fsdata, run_start, run_len);
+    }
+    if (blocks_cnt > from) {
+        dentry->inode->blocks -= (blocks_cnt - from) * (block_len / 512);
+    }
+
+    if (dentry->inode->block[13]) {
+        uint32_t lev1_used = (from > 12 + per_block) ? (from - 12 - per_block + per_block - 1) / per_block : 0;
+        for (uint32_t i = lev1_used; i < per_block; i++) {
+            uint32_t lev1_block_index = _ext2_get_block_of_inode_lev0(dentry, dentry->inode->block[13], i);
+            if (lev1_block_index) {
+                _ext2_free_blocks(dentry->dev, dentry->fsdata, lev1_block_index, 1);
+                dentry->inode->blocks -= block_len / 512;
+                if (lev1_used) {
+                    _ext2_set_block_of_inode_lev0(dentry, dentry->inode->block[13], i, 0);
+                }
+            }
+        }
+        if (!lev1_used) {
+            _ext2_free_blocks(dentry->dev, dentry->fsdata, dentry->inode->block[13], 1);
+            dentry->inode->blocks -= block_len / 512;
+            dentry->inode->block[13] = 0;
+        }
+    }
+
+    if (dentry->inode->block[12] && from <= 12) {
+        _ext2_free_blocks(dentry->dev, dentry->fsdata, dentry->inode->block[12], 1);
+        dentry->inode->blocks -= block_len / 512;
+        dentry->inode->block[12] = 0;
+    }
+    dentry_set_flag(dentry, DENTRY_DIRTY);
 }
 
 /**
  * INODE FUNCTIONS
  */
 
-int ext2_read_inode(dentry_t* dentry)
+static uint32_t _ext2_get_inode_offset(dentry_t* dentry)
 {
     uint32_t inodes_per_group = dentry->fsdata.sb->inodes_per_group;
     uint32_t holder_group = (dentry->inode_indx - 1) / inodes_per_group;
     uint32_t pos_inside_group = (dentry->inode_indx - 1) % inodes_per_group;
-    uint32_t inode_start = _ext2_get_block_offset(dentry->fsdata.sb, dentry->fsdata.gt->table[holder_group].inode_table) + (pos_inside_group * INODE_LEN);
-    _ext2_read_from_dev(dentry->dev, (uint8_t*)dentry->inode, inode_start, INODE_LEN);
+    return _ext2_get_block_offset(dentry->fsdata.sb, dentry->fsdata.gt->table[holder_group].inode_table) + (pos_inside_group * INODE_LEN);
+}
+
+int ext2_read_inode(dentry_t* dentry)
+{
+    _ext2_read_from_dev(dentry->dev, (uint8_t*)dentry->inode, _ext2_get_inode_offset(dentry), INODE_LEN);
     return 0;
 }
 
 int ext2_write_inode(dentry_t* dentry)
 {
-    uint32_t inodes_per_group = dentry->fsdata.sb->inodes_per_group;
-    uint32_t holder_group = (dentry->inode_indx - 1) / inodes_per_group;
-    uint32_t pos_inside_group = (dentry->inode_indx - 1) % inodes_per_group;
-    uint32_t inode_start = _ext2_get_block_offset(dentry->fsdata.sb, dentry->fsdata.gt->table[holder_group].inode_table) + (pos_inside_group * INODE_LEN);
-    _ext2_write_to_dev(dentry->dev, (uint8_t*)dentry->inode, inode_start, INODE_LEN);
+    _ext2_write_to_dev(dentry->dev, (uint8_t*)dentry->inode, _ext2_get_inode_offset(dentry), INODE_LEN);
+    return 0;
+}
+
+/**
+ * ext2_write_inodes writes inodes of one device, sorted by index. Inodes
+ * sharing a block of the inode table are written with one block write.
+ * Each block is updated with interrupts disabled, so an inode written by a
+ * syscall meanwhile is not overwritten with the old block.
+ */
+int ext2_write_inodes(dentry_t** dentries, uint32_t count)
+{
+    uint8_t block_buf[MAX_BLOCK_LEN];
+
+    for (uint32_t i = 0; i < count;) {
+        const uint32_t block_len = BLOCK_LEN(dentries[i]->fsdata.sb);
+        uint32_t inode_start = _ext2_get_inode_offset(dentries[i]);
+        uint32_t block_start = inode_start - (inode_start % block_len);
+
+        uint32_t end = i + 1;
+        while (end < count && _ext2_get_inode_offset(dentries[end]) - block_start < block_len) {
+            end++;
+        }
+        if (end == i + 1) {
+            ext2_write_inode(dentries[i++]);
+            continue;
+        }
+
+        system_disable_interrupts();
+        _ext2_read_from_dev(dentries[i]->dev, block_buf, block_start, block_len);
+        for (; i < end; i++) {
+            memcpy(block_buf + (_ext2_get_inode_offset(dentries[i]) - block_start), (uint8_t*)dentries[i]->inode, INODE_LEN);
+        }
+        _ext2_write_to_dev(dentries[end - 1]->dev, block_buf, block_start, block_len);
+        system_enable_interrupts();
+    }
     return 0;
 }
 
@@ -424,13 +802,7 @@ static int _ext2_free_inode_index(vfs_device_t* dev, fsdata_t fsdata, uint32_t i
 int ext2_free_inode(dentry_t* dentry)
 {
     ASSERT(dentry->d_count == 0 && dentry->inode->links_count == 0);
-    uint32_t block_per_dir = TO_EXT_BLOCKS_CNT(dentry->fsdata.sb, dentry->inode->blocks);
-
-    /* freeing all data blocks */
-    for (int block_index = 0; block_index < block_per_dir; block_index++) {
-        uint32_t data_block_index = _ext2_get_block_of_inode(dentry, block_index);
-        _ext2_free_block_index(dentry->dev, dentry->fsdata, data_block_index);
-    }
+    _ext2_release_blocks_of_inode(dentry, 0);
 
     _ext2_free_inode_index(dentry->dev, dentry->fsdata, dentry->inode_indx);
     return 0;
@@ -445,7 +817,75 @@ static int _ext2_decriment_links_count(dentry_t* dentry)
  * DIR FUNCTIONS
  */
 
-// NOTE: currently only link version is supported.
+static uint32_t _ext2_get_dir_block(dentry_t* dir, uint32_t block_index)
+{
+    if (block_index >= _ext2_get_data_blocks_cnt(dir)) {
+        return 0;
+    }
+    return _ext2_get_block_of_inode(dir, block_index);
+}
+
+static int _ext2_dir_read_block(dentry_t* dir, uint32_t block_index, uint8_t* buf)
+{
+    uint32_t data_block_index = _ext2_get_dir_block(dir, block_index);
+    if (!data_block_index) {
+        return -EINVAL;
+    }
+    _ext2_read_from_dev(dir->dev, buf, _ext2_get_block_offset(dir->fsdata.sb, data_block_index), BLOCK_LEN(dir->fsdata.sb));
+    return 0;
+}
+
+static int _ext2_dir_write_block(dentry_t* dir, uint32_t block_index, uint8_t* buf)
+{
+    uint32_t data_block_index = _ext2_get_dir_block(dir, block_index);
+    if (!data_block_index) {
+        return -EINVAL;
+    }
+    _ext2_write_to_dev(dir->dev, buf, _ext2_get_block_offset(dir->fsdata.sb, data_block_index), BLOCK_LEN(dir->fsdata.sb));
+    return 0;
+}
+
+/**
+ * Appends a new block to @dir. Returns the index of the block inside the dir
+ * in @block_index and its index on the disk in @data_block_index.
+ */
+static int _ext2_dir_append_block(dentry_t* dir, uint32_t* block_index, uint32_t* data_block_index)
+{
+    *block_index = _ext2_get_data_blocks_cnt(dir);
+    if (_ext2_allocate_block_for_inode(dir, data_block_index) < 0) {
+        return -ENOSPC;
+    }
+    dir->inode->size = (*block_index + 1) * BLOCK_LEN(dir->fsdata.sb);
+    dentry_set_flag(dir, DENTRY_DIRTY);
+    return 0;
+}
+
+static uint8_t _ext2_dir_entry_file_type(fsdata_t fsdata, dentry_t* child_dentry)
+{
+    if (fsdata.sb->rev_level < 1 || !(fsdata.sb->feature_incompat & EXT2_FEATURE_INCOMPAT_FILETYPE)) {
+        return EXT2_FT_UNKNOWN;
+    }
+
+    switch (child_dentry->inode->mode & 0xF000) {
+    case S_IFREG:
+        return EXT2_FT_REG_FILE;
+    case S_IFDIR:
+        return EXT2_FT_DIR;
+    case S_IFCHR:
+        return EXT2_FT_CHRDEV;
+    case S_IFBLK:
+        return EXT2_FT_BLKDEV;
+    case S_IFIFO:
+        return EXT2_FT_FIFO;
+    case S_IFSOCK:
+        return EXT2_FT_SOCK;
+    case S_IFLNK:
+        return EXT2_FT_SYMLINK;
+    default:
+        return EXT2_FT_UNKNOWN;
+    }
+}
+
 // TODO: add cache.
 static int _ext2_lookup_block(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index, const char* name, uint32_t len, uint32_t* found_inode_index)
 {
@@ -453,32 +893,27 @@ static int _ext2_lookup_block(vfs_device_t* dev, fsdata_t fsdata, uint32_t block
         return -EINVAL;
     }
 
+    const uint32_t block_len = BLOCK_LEN(fsdata.sb);
     uint8_t tmp_buf[MAX_BLOCK_LEN];
-    _ext2_read_from_dev(dev, tmp_buf, _ext2_get_block_offset(fsdata.sb, block_index), BLOCK_LEN(fsdata.sb));
-    dir_entry_t* start_of_entry = (dir_entry_t*)tmp_buf;
-    for (;;) {
-        if (start_of_entry->inode == 0) {
+    _ext2_read_from_dev(dev, tmp_buf, _ext2_get_block_offset(fsdata.sb, block_index), block_len);
+
+    for (uint32_t internal_offset = 0; internal_offset < block_len;) {
+        dir_entry_t* start_of_entry = (dir_entry_t*)((uint32_t)tmp_buf + internal_offset);
+        if (start_of_entry->rec_len == 0) {
             return -EFAULT;
         }
 
-        if (start_of_entry->name_len == len) {
-            bool is_name_same = true;
-            for (int i = 0; i < start_of_entry->name_len; i++) {
-                is_name_same &= (name[i] == *((char*)start_of_entry + 8 + i));
-            }
-
-            if (is_name_same) {
+        /* Entries with inode 0 are deleted ones, they could be met anywhere in the block. */
+        if (start_of_entry->inode != 0 && start_of_entry->name_len == len) {
+            if (memcmp((char*)start_of_entry + 8, name, len) == 0) {
                 *found_inode_index = start_of_entry->inode;
                 return 0;
             }
         }
 
-        start_of_entry = (dir_entry_t*)((uint32_t)start_of_entry + start_of_entry->rec_len);
-        if ((uint32_t)start_of_entry >= (uint32_t)tmp_buf + BLOCK_LEN(fsdata.sb)) {
-            return -EFAULT;
-        }
+        internal_offset += start_of_entry->rec_len;
     }
-    return -EFAULT;
+    return -ENOENT;
 }
 
 static int _ext2_getdirent_block(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index, uint32_t* offset, dirent_t* dirent)
@@ -542,7 +977,7 @@ static int _ext2_get_dir_entries_count_in_block(vfs_device_t* dev, fsdata_t fsda
 static bool _ext2_is_dir_empty(dentry_t* dir)
 {
     const uint32_t block_len = BLOCK_LEN(dir->fsdata.sb);
-    uint32_t end_block_index = TO_EXT_BLOCKS_CNT(dir->fsdata.sb, dir->inode->blocks);
+    uint32_t end_block_index = _ext2_get_data_blocks_cnt(dir);
     int result = 0;
 
     for (uint32_t block_index = 0; block_index < end_block_index; block_index++) {
@@ -617,20 +1052,15 @@ static int _ext2_add_first_entry_to_dir_block(vfs_device_t* dev, fsdata_t fsdata
         return -EINVAL;
     }
 
-    uint32_t record_name_len = NORM_FILENAME(len);
-    uint32_t min_rec_len = 8 + record_name_len;
-    dir_entry_t new_entry;
-
-    uint8_t tmp_buf[DIR_ENTRY_LEN];
-    _ext2_read_from_dev(dev, tmp_buf, _ext2_get_block_offset(fsdata.sb, block_index), DIR_ENTRY_LEN);
+    uint8_t tmp_buf[MAX_BLOCK_LEN];
+    memset(tmp_buf, 0, BLOCK_LEN(fsdata.sb));
     dir_entry_t* start_of_entry = (dir_entry_t*)tmp_buf;
-    new_entry.inode = child_dentry->inode_indx;
-    new_entry.rec_len = BLOCK_LEN(fsdata.sb);
-    new_entry.name_len = len;
-    memcpy((void*)start_of_entry, (void*)&new_entry, 8);
+    start_of_entry->inode = child_dentry->inode_indx;
+    start_of_entry->rec_len = BLOCK_LEN(fsdata.sb);
+    start_of_entry->name_len = len;
+    start_of_entry->file_type = _ext2_dir_entry_file_type(fsdata, child_dentry);
     memcpy((void*)((uint32_t)start_of_entry + 8), (void*)filename, len);
-    memset((void*)((uint32_t)start_of_entry + 8 + len), 0, record_name_len - len);
-    _ext2_write_to_dev(dev, tmp_buf, _ext2_get_block_offset(fsdata.sb, block_index), DIR_ENTRY_LEN);
+    _ext2_write_to_dev(dev, tmp_buf, _ext2_get_block_offset(fsdata.sb, block_index), BLOCK_LEN(fsdata.sb));
     return 0;
 }
 
@@ -649,19 +1079,21 @@ static int _ext2_add_to_dir_block(vfs_device_t* dev, fsdata_t fsdata, uint32_t b
     dir_entry_t* start_of_entry = (dir_entry_t*)tmp_buf;
     dir_entry_t* start_of_new_entry;
 
-    if (start_of_entry->inode == 0) {
-        kpanic("Ext2: can't add as first entry with help of that function.");
-    }
-
     for (;;) {
+        if (start_of_entry->rec_len == 0) {
+            return -EFAULT;
+        }
+
+        /* A deleted entry (it could be only the first one in a block) takes no place. */
         uint32_t cur_filename_len = NORM_FILENAME(start_of_entry->name_len);
-        uint32_t cur_rec_len = 8 + cur_filename_len;
+        uint32_t cur_rec_len = start_of_entry->inode ? 8 + cur_filename_len : 0;
 
         // We have enough place to put both records
         if (start_of_entry->rec_len >= cur_rec_len + min_rec_len) {
             new_entry.inode = child_dentry->inode_indx;
             new_entry.rec_len = start_of_entry->rec_len - cur_rec_len;
             new_entry.name_len = len;
+            new_entry.file_type = _ext2_dir_entry_file_type(fsdata, child_dentry);
             start_of_new_entry = (dir_entry_t*)((uint32_t)start_of_entry + cur_rec_len);
             start_of_entry->rec_len = cur_rec_len;
             goto update_res;
@@ -669,7 +1101,7 @@ static int _ext2_add_to_dir_block(vfs_device_t* dev, fsdata_t fsdata, uint32_t b
 
         start_of_entry = (dir_entry_t*)((uint32_t)start_of_entry + start_of_entry->rec_len);
         if ((uint32_t)start_of_entry >= (uint32_t)tmp_buf + BLOCK_LEN(fsdata.sb)) {
-            return -EFAULT;
+            return -ENOSPC;
         }
     }
 
@@ -693,16 +1125,16 @@ static int _ext2_rm_from_dir_block(vfs_device_t* dev, fsdata_t fsdata, uint32_t
     dir_entry_t* prev_entry = (dir_entry_t*)0;
 
     for (;;) {
+        if (start_of_entry->rec_len == 0) {
+            return -EFAULT;
+        }
 
         if (start_of_entry->inode == child_dentry->inode_indx) {
-            /* FIXME: just fix that */
-            if (!prev_entry) {
-                kpanic("Ext2: can't delete first entry.");
-            }
-
-            /* deleting entry */
+            /* deleting entry, the first one in a block just stays empty */
             start_of_entry->inode = 0;
-            prev_entry->rec_len += start_of_entry->rec_len;
+            if (prev_entry) {
+                prev_entry->rec_len += start_of_entry->rec_len;
+            }
 
             _ext2_write_to_dev(dev, tmp_buf, _ext2_get_block_offset(fsdata.sb, block_index), BLOCK_LEN(fsdata.sb));
 
@@ -720,8 +1152,24 @@ static int _ext2_rm_from_dir_block(vfs_device_t* dev, fsdata_t fsdata, uint32_t
 static int _ext2_add_child(dentry_t* dir, dentry_t* child_dentry, const char* name, int len)
 {
     uint32_t block_index;
-    uint32_t blocks_per_dir = TO_EXT_BLOCKS_CNT(dir->fsdata.sb, dir->inode->blocks);
+    uint32_t blocks_per_dir;
+
+    if (_ext2_is_dir_indexed(dir)) {
+        int err = _ext2_dx_add_child(dir, child_dentry, name, len);
+        if (err == 0) {
+            goto updated_inode;
+        }
+        if (err != -EINVAL) {
+            return err;
+        }
+
+        /* The index is unusable, so from now the dir is treated as a linear one. */
+        log_warn("[Ext2] Dropping broken dir index of inode %d", dir->inode_indx);
+        dir->inode->flags &= ~EXT2_INDEX_FL;
+        dentry_set_flag(dir, DENTRY_DIRTY);
+    }
 
+    blocks_per_dir = _ext2_get_data_blocks_cnt(dir);
     for (int i = 0; i < blocks_per_dir; i++) {
         if ((block_index = _ext2_get_block_of_inode(dir, i))) {
             if (_ext2_add_to_dir_block(dir->dev, dir->fsdata, block_index, child_dentry, name, len) == 0) {
@@ -730,10 +1178,21 @@ static int _ext2_add_child(dentry_t* dir, dentry_t* child_dentry, const char* na
         }
     }
 
+    /* The only block is full, it's time to build an index instead of growing linearly. */
+    if (blocks_per_dir == 1 && _ext2_has_dir_index(dir->fsdata.sb)) {
+        if (_ext2_dx_make_indexed(dir) == 0) {
+            if (_ext2_dx_add_child(dir, child_dentry, name, len) == 0) {
+                goto updated_inode;
+            }
+            return -EFAULT;
+        }
+    }
+
     // FIXME: group
     uint32_t new_block_index;
-    if (_ext2_allocate_block_for_inode(dir, 0, &new_block_index) == 0) {
-        if (_ext2_add_first_entry_to_dir_block(dir->dev, dir->fsdata, new_block_index, child_dentry, name, len) == 0) {
+    uint32_t new_data_block_index;
+    if (_ext2_dir_append_block(dir, &new_block_index, &new_data_block_index) == 0) {
+        if (_ext2_add_first_entry_to_dir_block(dir->dev, dir->fsdata, new_data_block_index, child_dentry, name, len) == 0) {
             goto updated_inode;
         }
     }
@@ -749,7 +1208,7 @@ updated_inode:
 static int _ext2_rm_child(dentry_t* dir, dentry_t* child_dentry)
 {
     uint32_t block_index;
-    uint32_t blocks_per_dir = TO_EXT_BLOCKS_CNT(dir->fsdata.sb, dir->inode->blocks);
+    uint32_t blocks_per_dir = _ext2_get_data_blocks_cnt(dir);
 
     for (int i = 0; i < blocks_per_dir; i++) {
         if ((block_index = _ext2_get_block_of_inode(dir, i))) {
@@ -770,6 +1229,9 @@ static int _ext2_setup_dir(dentry_t* dir, dentry_t* parent_dir, mode_t mode)
     dir->inode->uid = 0; // FIXME: uid of real user
     dir->inode->links_count = 0;
     dir->inode->blocks = 0;
+    dir->inode->size = 0;
+    dir->inode->flags = 0;
+    memset((uint8_t*)dir->inode->block, 0, sizeof(dir->inode->block));
     dentry_set_flag(dir, DENTRY_DIRTY);
     if (_ext2_add_child(dir, dir, ".", 1) < 0) {
         return -EFAULT;
@@ -781,30 +1243,729 @@ static int _ext2_setup_dir(dentry_t* dir, dentry_t* parent_dir, mode_t mode)
 }
 
 /**
- * FILE FUNCTIONS
+ * HTREE FUNCTIONS
  */
 
-static int _ext2_setup_file(dentry_t* file, mode_t mode)
-{
-    file->inode->mode = mode;
-    file->inode->uid = 0; // FIXME: uid of real user
-    file->inode->links_count = 0;
-    file->inode->blocks = 0;
-    file->inode->size = 0;
-    dentry_set_flag(file, DENTRY_DIRTY);
-    return 0;
-}
+#define EXT2_DX_BLOCK_MASK 0x00ffffff
+#define EXT2_DX_ROOT_INFO_OFFSET 24 /* "." and ".." entries */
+#define EXT2_DX_NODE_ENTRIES_OFFSET 8 /* An empty dir entry */
 
-/**
- * API FUNTIONS
- */
+struct dx_map_entry {
+    uint32_t hash;
+    uint16_t offset;
+    uint16_t size;
+};
+typedef struct dx_map_entry dx_map_entry_t;
 
-bool ext2_can_read(dentry_t* dentry, uint32_t start)
+static inline bool _ext2_has_dir_index(superblock_t* sb)
 {
-    return true;
+    return sb->rev_level >= 1 && (sb->feature_compat & EXT2_FEATURE_COMPAT_DIR_INDEX);
 }
 
-bool ext2_can_write(dentry_t* dentry, uint32_t start)
+static inline bool _ext2_is_dir_indexed(dentry_t* dir)
+{
+    return _ext2_has_dir_index(dir->fsdata.sb) && (dir->inode->flags & EXT2_INDEX_FL);
+}
+
+static inline dx_countlimit_t* _ext2_dx_countlimit(dx_entry_t* entries)
+{
+    return (dx_countlimit_t*)entries;
+}
+
+static inline uint32_t _ext2_dx_get_block(dx_entry_t* entry)
+{
+    return entry->block & EXT2_DX_BLOCK_MASK;
+}
+
+static inline dx_root_info_t* _ext2_dx_root_info(uint8_t* buf)
+{
+    return (dx_root_info_t*)(buf + EXT2_DX_ROOT_INFO_OFFSET);
+}
+
+static inline uint32_t _ext2_dx_root_limit(superblock_t* sb)
+{
+    return (BLOCK_LEN(sb) - EXT2_DX_ROOT_INFO_OFFSET - sizeof(dx_root_info_t)) / sizeof(dx_entry_t);
+}
+
+static inline uint32_t _ext2_dx_node_limit(superblock_t* sb)
+{
+    return (BLOCK_LEN(sb) - EXT2_DX_NODE_ENTRIES_OFFSET) / sizeof(dx_entry_t);
+}
+
+static void _ext2_dx_init_node(superblock_t* sb, uint8_t* buf)
+{
+    memset(buf, 0, BLOCK_LEN(sb));
+    dir_entry_t* fake_entry = (dir_entry_t*)buf;
+    fake_entry->rec_len = BLOCK_LEN(sb);
+    dx_countlimit_t* countlimit = (dx_countlimit_t*)(buf + EXT2_DX_NODE_ENTRIES_OFFSET);
+    countlimit->limit = _ext2_dx_node_limit(sb);
+    countlimit->count = 0;
+}
+
+static inline bool _ext2_is_dot_or_dotdot(const char* name, uint32_t len)
+{
+    return (len == 1 && name[0] == '.') || (len == 2 && name[0] == '.' && name[1] == '.');
+}
+
+/**
+ * The hash functions have to be bit-exact with the ones of e2fsprogs,
+ * since indexes are built by mkfs and fsck too.
+ */
+
+static uint32_t _ext2_dx_hack_hash(const char* name, uint32_t len, bool unsigned_chars)
+{
+    uint32_t hash;
+    uint32_t hash0 = 0x12a3fe2d;
+    uint32_t hash1 = 0x37abe8f9;
+
+    for (uint32_t i = 0; i < len; i++) {
+        int c = unsigned_chars ? (int)(uint8_t)name[i] : (int)(int8_t)name[i];
+        hash = hash1 + (hash0 ^ (uint32_t)(c * 7152373));
+        if (hash & 0x80000000) {
+            hash -= 0x7fffffff;
+        }
+        hash1 = hash0;
+        hash0 = hash;
+    }
+    return hash0 << 1;
+}
+
+static void _ext2_dx_str2hashbuf(const char* msg, uint32_t len, uint32_t* buf, int num, bool unsigned_chars)
+{
+    uint32_t pad = len | (len << 8);
+    pad |= pad << 16;
+
+    uint32_t val = pad;
+    if (len > num * 4) {
+        len = num * 4;
+    }
+
+    for (uint32_t i = 0; i < len; i++) {
+        int c = unsigned_chars ? (int)(uint8_t)msg[i] : (int)(int8_t)msg[i];
+        val = c + (val << 8);
+        if ((i % 4) == 3) {
+            *buf++ = val;
+            val = pad;
+            num--;
+        }
+    }
+
+    if (--num >= 0) {
+        *buf++ = val;
+    }
+    while (--num >= 0) {
+        *buf++ = pad;
+    }
+}
+
+static void _ext2_dx_tea_transform(uint32_t* buf, uint32_t* in)
+{
+    uint32_t sum = 0;
+    uint32_t b0 = buf[0], b1 = buf[1];
+    uint32_t a = in[0], b = in[1], c = in[2], d = in[3];
+
+    for (int n = 0; n < 16; n++) {
+        sum += 0x9E3779B9;
+        b0 += ((b1 << 4) + a) ^ (b1 + sum) ^ ((b1 >> 5) + b);
+        b1 += ((b0 << 4) + c) ^ (b0 + sum) ^ ((b0 >> 5) + d);
+    }
+
+    buf[0] += b0;
+    buf[1] += b1;
+}
+
+#define HALF_MD4_F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define HALF_MD4_G(x, y, z) (((x) & (y)) + (((x) ^ (y)) & (z)))
+#define HALF_MD4_H(x, y, z) ((x) ^ (y) ^ (z))
+#define HALF_MD4_ROUND(f, a, b, c, d, x, s) \
+    (a += f(b, c, d) + x, a = (a << s) | (a >> (32 - s)))
+#define HALF_MD4_K1 0
+#define HALF_MD4_K2 0x5A827999
+#define HALF_MD4_K3 0x6ED9EBA1
+
+static void _ext2_dx_half_md4_transform(uint32_t* buf, uint32_t* in)
+{
+    uint32_t a = buf[0], b = buf[1], c = buf[2], d = buf[3];
+
+    HALF_MD4_ROUND(HALF_MD4_F, a, b, c, d, in[0] + HALF_MD4_K1, 3);
+    HALF_MD4_ROUND(HALF_MD4_F, d, a, b, c, in[1] + HALF_MD4_K1, 7);
+    HALF_MD4_ROUND(HALF_MD4_F, c, d, a, b, in[2] + HALF_MD4_K1, 11);
+    HALF_MD4_ROUND(HALF_MD4_F, b, c, d, a, in[3] + HALF_MD4_K1, 19);
+    HALF_MD4_ROUND(HALF_MD4_F, a, b, c, d, in[4] + HALF_MD4_K1, 3);
+    HALF_MD4_ROUND(HALF_MD4_F, d, a, b, c, in[5] + HALF_MD4_K1, 7);
+    HALF_MD4_ROUND(HALF_MD4_F, c, d, a, b, in[6] + HALF_MD4_K1, 11);
+    HALF_MD4_ROUND(HALF_MD4_F, b, c, d, a, in[7] + HALF_MD4_K1, 19);
+
+    HALF_MD4_ROUND(HALF_MD4_G, a, b, c, d, in[1] + HALF_MD4_K2, 3);
+    HALF_MD4_ROUND(HALF_MD4_G, d, a, b, c, in[3] + HALF_MD4_K2, 5);
+    HALF_MD4_ROUND(HALF_MD4_G, c, d, a, b, in[5] + HALF_MD4_K2, 9);
+    HALF_MD4_ROUND(HALF_MD4_G, b, c, d, a, in[7] + HALF_MD4_K2, 13);
+    HALF_MD4_ROUND(HALF_MD4_G, a, b, c, d, in[0] + HALF_MD4_K2, 3);
+    HALF_MD4_ROUND(HALF_MD4_G, d, a, b, c, in[2] + HALF_MD4_K2, 5);
+    HALF_MD4_ROUND(HALF_MD4_G, c, d, a, b, in[4] + HALF_MD4_K2, 9);
+    HALF_MD4_ROUND(HALF_MD4_G, b, c, d, a, in[6] + HALF_MD4_K2, 13);
+
+    HALF_MD4_ROUND(HALF_MD4_H, a, b, c, d, in[3] + HALF_MD4_K3, 3);
+    HALF_MD4_ROUND(HALF_MD4_H, d, a, b, c, in[7] + HALF_MD4_K3, 9);
+    HALF_MD4_ROUND(HALF_MD4_H, c, d, a, b, in[2] + HALF_MD4_K3, 11);
+    HALF_MD4_ROUND(HALF_MD4_H, b, c, d, a, in[6] + HALF_MD4_K3, 15);
+    HALF_MD4_ROUND(HALF_MD4_H, a, b, c, d, in[1] + HALF_MD4_K3, 3);
+    HALF_MD4_ROUND(HALF_MD4_H, d, a, b, c, in[5] + HALF_MD4_K3, 9);
+    HALF_MD4_ROUND(HALF_MD4_H, c, d, a, b, in[0] + HALF_MD4_K3, 11);
+    HALF_MD4_ROUND(HALF_MD4_H, b, c, d, a, in[4] + HALF_MD4_K3, 15);
+
+    buf[0] += a;
+    buf[1] += b;
+    buf[2] += c;
+    buf[3] += d;
+}
+
+static uint32_t _ext2_dx_hash(superblock_t* sb, uint32_t hash_version, const char* name, uint32_t len)
+{
+    uint32_t buf[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+    uint32_t in[8];
+    uint32_t hash = 0;
+
+    for (int i = 0; i < 4; i++) {
+        if (sb->hash_seed[i]) {
+            memcpy(buf, sb->hash_seed, sizeof(buf));
+            break;
+        }
+    }
+
+    bool unsigned_chars = hash_version >= EXT2_HTREE_LEGACY_UNSIGNED;
+    switch (hash_version) {
+    case EXT2_HTREE_LEGACY:
+    case EXT2_HTREE_LEGACY_UNSIGNED:
+        hash = _ext2_dx_hack_hash(name, len, unsigned_chars);
+        break;
+
+    case EXT2_HTREE_HALF_MD4:
+    case EXT2_HTREE_HALF_MD4_UNSIGNED:
+        for (int rem = len; rem > 0; rem -= 32, name += 32) {
+            _ext2_dx_str2hashbuf(name, rem, in, 8, unsigned_chars);
+            _ext2_dx_half_md4_transform(buf, in);
+        }
+        hash = buf[1];
+        break;
+
+    case EXT2_HTREE_TEA:
+    case EXT2_HTREE_TEA_UNSIGNED:
+        for (int rem = len; rem > 0; rem -= 16, name += 16) {
+            _ext2_dx_str2hashbuf(name, rem, in, 4, unsigned_chars);
+            _ext2_dx_tea_transform(buf, in);
+        }
+        hash = buf[0];
+        break;
+    }
+
+    /* The lowest bit is reserved to mark hash collisions in dx entries. */
+    hash &= ~1;
+    if (hash == (EXT2_HTREE_EOF << 1)) {
+        hash = (EXT2_HTREE_EOF - 1) << 1;
+    }
+    return hash;
+}
+
+/**
+ * _ext2_dx_probe walks the index of @dir down to the leaf where @name should
+ * be. Each frame of @path must have a buffer of block len.
+ * return: 0 on success, -EINVAL if the index is broken or unsupported, so the
+ *         dir has to be treated as a linear one.
+ */
+static int _ext2_dx_probe(dentry_t* dir, const char* name, uint32_t len, dx_path_t* path)
+{
+    superblock_t* sb = dir->fsdata.sb;
+    dx_frame_t* frames = path->frames;
+    if (_ext2_dir_read_block(dir, 0, frames[0].buf) < 0) {
+        return -EINVAL;
+    }
+
+    dx_root_info_t* info = _ext2_dx_root_info(frames[0].buf);
+    if (info->reserved_zero != 0 || info->hash_version > EXT2_HTREE_TEA || info->info_length != sizeof(dx_root_info_t)) {
+        return -EINVAL;
+    }
+    if (info->indirect_levels >= EXT2_DX_MAX_LEVELS) {
+        log_warn("[Ext2] Dir index with %d levels is unsupported", info->indirect_levels + 1);
+        return -EINVAL;
+    }
+
+    path->hash_version = info->hash_version;
+    if (sb->flags & EXT2_FLAGS_UNSIGNED_HASH) {
+        path->hash_version += EXT2_HTREE_LEGACY_UNSIGNED;
+    }
+
+    uint32_t hash = _ext2_dx_hash(sb, path->hash_version, name, len);
+    path->hash = hash;
+    path->levels = info->indirect_levels + 1;
+    frames[0].block_index = 0;
+    frames[0].entries = (dx_entry_t*)((uint8_t*)info + info->info_length);
+    uint32_t limit = _ext2_dx_root_limit(sb);
+
+    for (uint32_t level = 0;; level++) {
+        dx_frame_t* frame = &frames[level];
+        dx_countlimit_t* countlimit = _ext2_dx_countlimit(frame->entries);
+        if (countlimit->limit != limit || countlimit->count == 0 || countlimit->count > limit) {
+            return -EINVAL;
+        }
+
+        dx_entry_t* l = frame->entries + 1;
+        dx_entry_t* r = frame->entries + countlimit->count - 1;
+        while (l <= r) {
+            dx_entry_t* m = l + (r - l) / 2;
+            if (m->hash > hash) {
+                r = m - 1;
+            } else {
+                l = m + 1;
+            }
+        }
+        frame->at = l - 1;
+
+        if (level + 1 == path->levels) {
+            return 0;
+        }
+
+        dx_frame_t* next = &frames[level + 1];
+        next->block_index = _ext2_dx_get_block(frame->at);
+        if (_ext2_dir_read_block(dir, next->block_index, next->buf) < 0) {
+            return -EINVAL;
+        }
+        next->entries = (dx_entry_t*)(next->buf + EXT2_DX_NODE_ENTRIES_OFFSET);
+        limit = _ext2_dx_node_limit(sb);
+    }
+}
+
+/**
+ * _ext2_dx_next_leaf moves @path to the next leaf, if the hash collision
+ * continues there.
+ */
+static bool _ext2_dx_next_leaf(dentry_t* dir, dx_path_t* path)
+{
+    dx_frame_t* frames = path->frames;
+    int level = path->levels - 1;
+    for (;;) {
+        dx_frame_t* frame = &frames[level];
+        frame->at++;
+        if (frame->at < frame->entries + _ext2_dx_countlimit(frame->entries)->count) {
+            break;
+        }
+        if (level == 0) {
+            return false;
+        }
+        level--;
+    }
+
+    if ((frames[level].at->hash & ~1) != path->hash) {
+        return false;
+    }
+
+    for (; level + 1 < path->levels; level++) {
+        dx_frame_t* next = &frames[level + 1];
+        next->block_index = _ext2_dx_get_block(frames[level].at);
+        if (_ext2_dir_read_block(dir, next->block_index, next->buf) < 0) {
+            return false;
+        }
+        next->entries = (dx_entry_t*)(next->buf + EXT2_DX_NODE_ENTRIES_OFFSET);
+        next->at = next->entries;
+    }
+    return true;
+}
+
+/**
+ * Allocates @extra_bufs block buffers after the frame ones.
+ */
+static uint8_t* _ext2_dx_alloc_path(dentry_t* dir, dx_path_t* path, uint32_t extra_bufs)
+{
+    const uint32_t block_len = BLOCK_LEN(dir->fsdata.sb);
+    uint8_t* mem = kmalloc((EXT2_DX_MAX_LEVELS + extra_bufs) * block_len);
+    if (!mem) {
+        return NULL;
+    }
+    for (int i = 0; i < EXT2_DX_MAX_LEVELS; i++) {
+        path->frames[i].buf = mem + i * block_len;
+    }
+    return mem;
+}
+
+/**
+ * _ext2_dx_lookup looks for @name in the indexed @dir.
+ * return: 0 and the inode in @found_inode_index if found, -ENOENT if there is
+ *         no such name, -EINVAL if the index can't be used.
+ */
+static int _ext2_dx_lookup(dentry_t* dir, const char* name, uint32_t len, uint32_t* found_inode_index)
+{
+    dx_path_t path;
+    uint8_t* mem = _ext2_dx_alloc_path(dir, &path, 0);
+    if (!mem) {
+        return -EINVAL;
+    }
+
+    int err = _ext2_dx_probe(dir, name, len, &path);
+    if (err < 0) {
+        goto end;
+    }
+
+    err = -ENOENT;
+    do {
+        uint32_t data_block_index = _ext2_get_dir_block(dir, _ext2_dx_get_block(path.frames[path.levels - 1].at));
+        if (!data_block_index) {
+            err = -EINVAL;
+            break;
+        }
+        if (_ext2_lookup_block(dir->dev, dir->fsdata, data_block_index, name, len, found_inode_index) == 0) {
+            err = 0;
+            break;
+        }
+    } while (_ext2_dx_next_leaf(dir, &path));
+
+end:
+    kfree(mem);
+    return err;
+}
+
+static void _ext2_dx_insert_entry(dx_frame_t* frame, uint32_t hash, uint32_t block_index)
+{
+    dx_countlimit_t* countlimit = _ext2_dx_countlimit(frame->entries);
+    dx_entry_t* new_entry = frame->at + 1;
+    uint32_t tail = (frame->entries + countlimit->count) - new_entry;
+    memmove(new_entry + 1, new_entry, tail * sizeof(dx_entry_t));
+    new_entry->hash = hash;
+    new_entry->block = block_index;
+    countlimit->count++;
+}
+
+/**
+ * Packs entries of the block in @buf one after another, all free space goes
+ * to the last entry. Returns the count of live entries.
+ */
+static int _ext2_dir_pack_block(superblock_t* sb, uint8_t* buf)
+{
+    const uint32_t block_len = BLOCK_LEN(sb);
+    dir_entry_t* last_entry = NULL;
+    uint32_t dest = 0;
+    int count = 0;
+
+    for (uint32_t offset = 0; offset < block_len;) {
+        dir_entry_t* entry = (dir_entry_t*)(buf + offset);
+        uint32_t rec_len = entry->rec_len;
+        if (rec_len == 0) {
+            break;
+        }
+
+        if (entry->inode) {
+            uint32_t real_rec_len = 8 + NORM_FILENAME(entry->name_len);
+            memmove(buf + dest, entry, real_rec_len);
+            last_entry = (dir_entry_t*)(buf + dest);
+            last_entry->rec_len = real_rec_len;
+            dest += real_rec_len;
+            count++;
+        }
+        offset += rec_len;
+    }
+
+    if (!last_entry) {
+        memset(buf, 0, block_len);
+        ((dir_entry_t*)buf)->rec_len = block_len;
+        return 0;
+    }
+
+    last_entry->rec_len += block_len - dest;
+    memset(buf + dest, 0, block_len - dest);
+    return count;
+}
+
+/**
+ * _ext2_dx_split_leaf moves the upper (by hash) half of entries of the leaf,
+ * which @path points to, into a new block and adds the block to the index.
+ * The block where the new entry should be put is returned in @target_block_index.
+ */
+static int _ext2_dx_split_leaf(dentry_t* dir, dx_path_t* path, uint32_t data_block_index, uint8_t* buf, uint8_t* new_buf, uint32_t* target_block_index)
+{
+    superblock_t* sb = dir->fsdata.sb;
+    const uint32_t block_len = BLOCK_LEN(sb);
+    dx_frame_t* frame = &path->frames[path->levels - 1];
+    _ext2_read_from_dev(dir->dev, buf, _ext2_get_block_offset(sb, data_block_index), block_len);
+
+    /* The smallest entry is 12 bytes long. */
+    uint32_t max_entries = block_len / 12;
+    dx_map_entry_t* map = kmalloc(max_entries * sizeof(dx_map_entry_t));
+    if (!map) {
+        return -ENOMEM;
+    }
+
+    uint32_t count = 0;
+    for (uint32_t offset = 0; offset < block_len && count < max_entries;) {
+        dir_entry_t* entry = (dir_entry_t*)(buf + offset);
+        if (entry->rec_len == 0) {
+            break;
+        }
+        if (entry->inode) {
+            map[count].hash = _ext2_dx_hash(sb, path->hash_version, (char*)entry + 8, entry->name_len);
+            map[count].offset = offset;
+            map[count].size = 8 + NORM_FILENAME(entry->name_len);
+            count++;
+        }
+        offset += entry->rec_len;
+    }
+
+    if (count < 2) {
+        kfree(map);
+        return -ENOSPC;
+    }
+
+    /* Insertion sort is fine here, a leaf holds less than a hundred entries. */
+    for (uint32_t i = 1; i < count; i++) {
+        dx_map_entry_t cur = map[i];
+        int j = i - 1;
+        while (j >= 0 && map[j].hash > cur.hash) {
+            map[j + 1] = map[j];
+            j--;
+        }
+        map[j + 1] = cur;
+    }
+
+    uint32_t split = count / 2;
+    uint32_t split_hash = map[split].hash;
+    bool continued = (split_hash == map[split - 1].hash);
+
+    uint32_t new_block_index, new_data_block_index;
+    if (_ext2_dir_append_block(dir, &new_block_index, &new_data_block_index) < 0) {
+        kfree(map);
+        return -ENOSPC;
+    }
+
+    memset(new_buf, 0, block_len);
+    uint32_t dest = 0;
+    dir_entry_t* last_entry = NULL;
+    for (uint32_t i = split; i < count; i++) {
+        dir_entry_t* entry = (dir_entry_t*)(buf + map[i].offset);
+        memcpy(new_buf + dest, entry, map[i].size);
+        last_entry = (dir_entry_t*)(new_buf + dest);
+        last_entry->rec_len = map[i].size;
+        dest += map[i].size;
+        entry->inode = 0;
+    }
+    last_entry->rec_len += block_len - dest;
+    kfree(map);
+
+    _ext2_dir_pack_block(sb, buf);
+    _ext2_write_to_dev(dir->dev, new_buf, _ext2_get_block_offset(sb, new_data_block_index), block_len);
+    _ext2_write_to_dev(dir->dev, buf, _ext2_get_block_offset(sb, data_block_index), block_len);
+
+    _ext2_dx_insert_entry(frame, split_hash | continued, new_block_index);
+    _ext2_dir_write_block(dir, frame->block_index, frame->buf);
+
+    *target_block_index = (path->hash >= split_hash) ? new_data_block_index : data_block_index;
+    return 0;
+}
+
+/**
+ * _ext2_dx_grow_index makes place for a new entry in the lowest index node
+ * of @path. A full node is split in halves; when the root is the only node,
+ * its entries are moved into a new node and the index gets one more level.
+ */
+static int _ext2_dx_grow_index(dentry_t* dir, dx_path_t* path, uint8_t* buf)
+{
+    superblock_t* sb = dir->fsdata.sb;
+    dx_frame_t* root = &path->frames[0];
+    dx_frame_t* frame = &path->frames[path->levels - 1];
+    uint32_t count = _ext2_dx_countlimit(frame->entries)->count;
+
+    if (path->levels == EXT2_DX_MAX_LEVELS && _ext2_dx_countlimit(root->entries)->count == _ext2_dx_countlimit(root->entries)->limit) {
+        log_warn("[Ext2] Dir index of inode %d is full", dir->inode_indx);
+        return -ENOSPC;
+    }
+
+    uint32_t new_block_index, new_data_block_index;
+    if (_ext2_dir_append_block(dir, &new_block_index, &new_data_block_index) < 0) {
+        return -ENOSPC;
+    }
+
+    _ext2_dx_init_node(sb, buf);
+    dx_entry_t* new_entries = (dx_entry_t*)(buf + EXT2_DX_NODE_ENTRIES_OFFSET);
+
+    if (path->levels == 1) {
+        memcpy(new_entries, root->entries, count * sizeof(dx_entry_t));
+        _ext2_dx_countlimit(new_entries)->limit = _ext2_dx_node_limit(sb);
+        _ext2_dx_countlimit(new_entries)->count = count;
+        _ext2_write_to_dev(dir->dev, buf, _ext2_get_block_offset(sb, new_data_block_index), BLOCK_LEN(sb));
+
+        _ext2_dx_countlimit(root->entries)->count = 1;
+        root->entries[0].block = new_block_index;
+        _ext2_dx_root_info(root->buf)->indirect_levels = 1;
+        return _ext2_dir_write_block(dir, 0, root->buf);
+    }
+
+    uint32_t moved = count / 2;
+    uint32_t stay = count - moved;
+    memcpy(new_entries, frame->entries + stay, moved * sizeof(dx_entry_t));
+    uint32_t split_hash = new_entries[0].hash;
+    _ext2_dx_countlimit(new_entries)->limit = _ext2_dx_node_limit(sb);
+    _ext2_dx_countlimit(new_entries)->count = moved;
+    _ext2_write_to_dev(dir->dev, buf, _ext2_get_block_offset(sb, new_data_block_index), BLOCK_LEN(sb));
+
+    _ext2_dx_countlimit(frame->entries)->count = stay;
+    _ext2_dir_write_block(dir, frame->block_index, frame->buf);
+
+    _ext2_dx_insert_entry(root, split_hash, new_block_index);
+    return _ext2_dir_write_block(dir, 0, root->buf);
+}
+
+/**
+ * _ext2_dx_add_child puts a new entry into the leaf of the indexed @dir,
+ * splitting the leaf when it's full.
+ * return: -EINVAL if the index can't be used, the caller falls back to linear mode.
+ */
+static int _ext2_dx_add_child(dentry_t* dir, dentry_t* child_dentry, const char* name, uint32_t len)
+{
+    const uint32_t block_len = BLOCK_LEN(dir->fsdata.sb);
+    dx_path_t path;
+    uint8_t* mem = _ext2_dx_alloc_path(dir, &path, 2);
+    if (!mem) {
+        return -ENOMEM;
+    }
+    uint8_t* buf = mem + EXT2_DX_MAX_LEVELS * block_len;
+    uint8_t* new_buf = buf + block_len;
+
+    int err;
+    uint32_t target_block_index;
+    for (;;) {
+        err = _ext2_dx_probe(dir, name, len, &path);
+        if (err < 0) {
+            goto end;
+        }
+
+        dx_frame_t* frame = &path.frames[path.levels - 1];
+        uint32_t data_block_index = _ext2_get_dir_block(dir, _ext2_dx_get_block(frame->at));
+        if (!data_block_index) {
+            err = -EINVAL;
+            goto end;
+        }
+
+        if (_ext2_add_to_dir_block(dir->dev, dir->fsdata, data_block_index, child_dentry, name, len) == 0) {
+            err = 0;
+            goto end;
+        }
+
+        dx_countlimit_t* countlimit = _ext2_dx_countlimit(frame->entries);
+        if (countlimit->count < countlimit->limit) {
+            err = _ext2_dx_split_leaf(dir, &path, data_block_index, buf, new_buf, &target_block_index);
+            break;
+        }
+
+        /* There is no place for one more leaf, growing the index and probing again. */
+        err = _ext2_dx_grow_index(dir, &path, buf);
+        if (err < 0) {
+            goto end;
+        }
+    }
+
+    if (err == 0) {
+        err = _ext2_add_to_dir_block(dir->dev, dir->fsdata, target_block_index, child_dentry, name, len);
+    }
+
+end:
+    kfree(mem);
+    return err;
+}
+
+/**
+ * _ext2_dx_make_indexed converts the one-block linear @dir into an indexed
+ * one: all entries except "." and ".." are moved into a new leaf, and the
+ * first block becomes the dx root.
+ */
+static int _ext2_dx_make_indexed(dentry_t* dir)
+{
+    superblock_t* sb = dir->fsdata.sb;
+    const uint32_t block_len = BLOCK_LEN(sb);
+    if (_ext2_get_data_blocks_cnt(dir) != 1) {
+        return -EINVAL;
+    }
+
+    uint8_t* buf = kmalloc(2 * block_len);
+    if (!buf) {
+        return -ENOMEM;
+    }
+    uint8_t* new_buf = buf + block_len;
+
+    int err = -EINVAL;
+    _ext2_dir_read_block(dir, 0, buf);
+    dir_entry_t* dot = (dir_entry_t*)buf;
+    if (dot->inode == 0 || dot->name_len != 1 || dot->rec_len != 12) {
+        goto end;
+    }
+    dir_entry_t* dotdot = (dir_entry_t*)(buf + 12);
+    if (dotdot->inode == 0 || dotdot->name_len != 2 || dotdot->rec_len < 12) {
+        goto end;
+    }
+
+    /* Moving the rest entries into the new leaf. */
+    uint32_t entries_start = 12 + dotdot->rec_len;
+    if (entries_start >= block_len) {
+        goto end;
+    }
+    memset(new_buf, 0, block_len);
+    memcpy(new_buf, buf + entries_start, block_len - entries_start);
+    if (_ext2_dir_pack_block(sb, new_buf) == 0) {
+        goto end;
+    }
+
+    uint32_t leaf_block_index, leaf_data_block_index;
+    if (_ext2_dir_append_block(dir, &leaf_block_index, &leaf_data_block_index) < 0) {
+        err = -ENOSPC;
+        goto end;
+    }
+    _ext2_write_to_dev(dir->dev, new_buf, _ext2_get_block_offset(sb, leaf_data_block_index), block_len);
+
+    dotdot->rec_len = block_len - 12;
+    memset(buf + EXT2_DX_ROOT_INFO_OFFSET, 0, block_len - EXT2_DX_ROOT_INFO_OFFSET);
+    dx_root_info_t* info = _ext2_dx_root_info(buf);
+    info->hash_version = (sb->def_hash_version <= EXT2_HTREE_TEA) ? sb->def_hash_version : EXT2_HTREE_HALF_MD4;
+    info->info_length = sizeof(dx_root_info_t);
+    info->indirect_levels = 0;
+
+    dx_entry_t* entries = (dx_entry_t*)(buf + EXT2_DX_ROOT_INFO_OFFSET + sizeof(dx_root_info_t));
+    _ext2_dx_countlimit(entries)->limit = _ext2_dx_root_limit(sb);
+    _ext2_dx_countlimit(entries)->count = 1;
+    entries[0].block = leaf_block_index;
+    _ext2_dir_write_block(dir, 0, buf);
+
+    dir->inode->flags |= EXT2_INDEX_FL;
+    dentry_set_flag(dir, DENTRY_DIRTY);
+    err = 0;
+
+end:
+    kfree(buf);
+    return err;
+}
+
+/**
+ * FILE FUNCTIONS
+ */
+
+static int _ext2_setup_file(dentry_t* file, mode_t mode)
+{
+    file->inode->mode = mode;
+    file->inode->uid = 0; // FIXME: uid of real user
+    file->inode->links_count = 0;
+    file->inode->blocks = 0;
+    file->inode->size = 0;
+    file->inode->flags = 0;
+    memset((uint8_t*)file->inode->block, 0, sizeof(file->inode->block));
+    dentry_set_flag(file, DENTRY_DIRTY);
+    return 0;
+}
+
+/**
+ * API FUNTIONS
+ */
+
+bool ext2_can_read(dentry_t* dentry, uint32_t start)
+{
+    return true;
+}
+
+bool ext2_can_write(dentry_t* dentry, uint32_t start)
 {
     return true;
 }
@@ -812,7 +1973,7 @@ bool ext2_can_write(dentry_t* dentry, uint32_t start)
 int ext2_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
 {
     const uint32_t block_len = BLOCK_LEN(dentry->fsdata.sb);
-    uint32_t blocks_allocated = TO_EXT_BLOCKS_CNT(dentry->fsdata.sb, dentry->inode->blocks);
+    uint32_t blocks_allocated = _ext2_get_data_blocks_cnt(dentry);
     uint32_t start_block_index = start / block_len;
     uint32_t end_block_index = min((start + len - 1) / block_len, blocks_allocated - 1);
 
@@ -838,31 +1999,60 @@ int ext2_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
 
 int ext2_write(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
 {
+    if (!len) {
+        return 0;
+    }
+
     const uint32_t block_len = BLOCK_LEN(dentry->fsdata.sb);
     uint32_t start_block_index = start / block_len;
-    uint32_t end_block_index = (start + len) / block_len;
+    uint32_t end_block_index = (start + len - 1) / block_len;
     uint32_t write_offset = start % block_len;
-    uint32_t to_write = len;
-    uint32_t already_written = 0;
-    uint32_t blocks_allocated = TO_EXT_BLOCKS_CNT(dentry->fsdata.sb, dentry->inode->blocks);
+    uint32_t blocks_allocated = _ext2_get_data_blocks_cnt(dentry);
+
+    /* All missing blocks are allocated at once, so they are laid out contiguously. */
+    if (blocks_allocated <= end_block_index) {
+        _ext2_allocate_blocks_for_inode(dentry, end_block_index + 1 - blocks_allocated);
+        uint32_t new_blocks_allocated = _ext2_get_data_blocks_cnt(dentry);
+        if (new_blocks_allocated <= start_block_index) {
+            return -ENOSPC;
+        }
+        if (new_blocks_allocated <= end_block_index) {
+            end_block_index = new_blocks_allocated - 1;
+            len = new_blocks_allocated * block_len - start;
+        }
 
-    for (uint32_t data_block_index, virt_block_index = start_block_index; virt_block_index <= end_block_index; virt_block_index++) {
-        uint32_t write_to_block = min(to_write, block_len - write_offset);
+        /* New blocks of a hole and partially written ones are cleaned up. */
+        uint8_t zero_buf[MAX_BLOCK_LEN];
+        memset(zero_buf, 0, block_len);
+        for (uint32_t i = blocks_allocated; i <= end_block_index; i++) {
+            bool partial = (i == start_block_index && write_offset) || (i == end_block_index && (start + len) % block_len);
+            if (i < start_block_index || partial) {
+                _ext2_write_to_dev(dentry->dev, zero_buf, _ext2_get_block_offset(dentry->fsdata.sb, _ext2_get_block_of_inode(dentry, i)), block_len);
+            }
+        }
+    }
 
-        if (blocks_allocated <= virt_block_index) {
-            _ext2_allocate_block_for_inode(dentry, 0, &data_block_index);
-        } else {
-            data_block_index = _ext2_get_block_of_inode(dentry, virt_block_index);
+    uint32_t to_write = len;
+    uint32_t already_written = 0;
+    uint32_t virt_block_index = start_block_index;
+    while (virt_block_index <= end_block_index) {
+        /* Physically contiguous blocks are written with one call. */
+        uint32_t data_block_index = _ext2_get_block_of_inode(dentry, virt_block_index);
+        uint32_t run = 1;
+        while (virt_block_index + run <= end_block_index && _ext2_get_block_of_inode(dentry, virt_block_index + run) == data_block_index + run) {
+            run++;
         }
 
-        _ext2_write_to_dev(dentry->dev, buf + already_written, _ext2_get_block_offset(dentry->fsdata.sb, data_block_index) + write_offset, write_to_block);
-        to_write -= write_to_block;
-        already_written += write_to_block;
+        uint32_t write_to_run = min(to_write, run * block_len - write_offset);
+        _ext2_write_to_dev(dentry->dev, buf + already_written, _ext2_get_block_offset(dentry->fsdata.sb, data_block_index) + write_offset, write_to_run);
+        to_write -= write_to_run;
+        already_written += write_to_run;
         write_offset = 0;
+        virt_block_index += run;
     }
 
-    if (dentry->inode->size < start + len) {
-        dentry->inode->size = start + len;
+    if (dentry->inode->size < start + already_written) {
+        dentry->inode->size = start + already_written;
     }
     dentry->inode->mtime = (uint32_t)timeman_now();
     dentry_set_flag(dentry, DENTRY_DIRTY);
@@ -877,14 +2067,15 @@ int ext2_truncate(dentry_t* dentry, uint32_t len)
     }
 
     const uint32_t block_len = BLOCK_LEN(dentry->fsdata.sb);
-    const uint32_t last_written_byte = len - 1;
-    uint32_t last_written_block_index = last_written_byte / block_len;
-    uint32_t start_block_index = last_written_block_index + 1;
-    uint32_t blocks_allocated = TO_EXT_BLOCKS_CNT(dentry->fsdata.sb, dentry->inode->blocks);
-
-    for (uint32_t block_index, virt_block_index = start_block_index; virt_block_index < blocks_allocated; virt_block_index++) {
-        block_index = _ext2_get_block_of_inode(dentry, virt_block_index);
-        _ext2_free_block_index(dentry->dev, dentry->fsdata, block_index);
+    uint32_t blocks_needed = (len + block_len - 1) / block_len;
+    _ext2_release_blocks_of_inode(dentry, blocks_needed);
+
+    /* The tail of the last block is cleaned up, so it reads as zeroes once the file grows. */
+    if (len % block_len) {
+        uint8_t zero_buf[MAX_BLOCK_LEN];
+        memset(zero_buf, 0, block_len);
+        uint32_t last_block_index = _ext2_get_block_of_inode(dentry, blocks_needed - 1);
+        _ext2_write_to_dev(dentry->dev, zero_buf, _ext2_get_block_offset(dentry->fsdata.sb, last_block_index) + len % block_len, block_len - len % block_len);
     }
 
     dentry->inode->size = len;
@@ -895,16 +2086,36 @@ int ext2_truncate(dentry_t* dentry, uint32_t len)
 
 int ext2_lookup(dentry_t* dir, const char* name, uint32_t len, dentry_t** result)
 {
-    uint32_t block_per_dir = TO_EXT_BLOCKS_CNT(dir->fsdata.sb, dir->inode->blocks);
+    uint32_t res_inode_indx = 0;
+
+    /* "." and ".." are always in the first block, so no need to use the index. */
+    if (_ext2_is_dir_indexed(dir) && !_ext2_is_dot_or_dotdot(name, len)) {
+        int err = _ext2_dx_lookup(dir, name, len, &res_inode_indx);
+        if (err == 0) {
+            goto found;
+        }
+        if (err == -ENOENT) {
+            goto not_found;
+        }
+        /* The index is broken, falling back to the linear scan. */
+    }
+
+    uint32_t block_per_dir = _ext2_get_data_blocks_cnt(dir);
     for (int block_index = 0; block_index < block_per_dir; block_index++) {
         uint32_t data_block_index = _ext2_get_block_of_inode(dir, block_index);
-        uint32_t res_inode_indx = 0;
         if (_ext2_lookup_block(dir->dev, dir->fsdata, data_block_index, name, len, &res_inode_indx) == 0) {
-            *result = dentry_get(dir->dev_indx, res_inode_indx);
-            return 0;
+            goto found;
         }
     }
+
+not_found:
+    name_cache_add(dir, name, len, 0);
     return -ENOENT;
+
+found:
+    name_cache_add(dir, name, len, res_inode_indx);
+    *result = dentry_get(dir->dev_indx, res_inode_indx);
+    return 0;
 }
 
 int ext2_mkdir(dentry_t* dir, const char* name, uint32_t len, mode_t mode)
@@ -952,7 +2163,7 @@ int ext2_rmdir(dentry_t* dir)
 int ext2_getdirent(dentry_t* dir, uint32_t* offset, dirent_t* res)
 {
     const uint32_t block_len = BLOCK_LEN(dir->fsdata.sb);
-    uint32_t blocks_per_dir = TO_EXT_BLOCKS_CNT(dir->fsdata.sb, dir->inode->blocks);
+    uint32_t blocks_per_dir = _ext2_get_data_blocks_cnt(dir);
     if (*offset >= blocks_per_dir * block_len) {
         return -1;
     }
@@ -971,7 +2182,7 @@ int ext2_getdents(dentry_t* dentry, uint8_t* buf, uint32_t* offset, uint32_t len
 {
     const uint32_t block_len = BLOCK_LEN(dentry->fsdata.sb);
     uint32_t start_block_index = *offset / block_len;
-    uint32_t end_block_index = TO_EXT_BLOCKS_CNT(dentry->fsdata.sb, dentry->inode->blocks);
+    uint32_t end_block_index = _ext2_get_data_blocks_cnt(dentry);
     uint32_t read_offset = *offset % block_len;
     uint32_t already_read = 0;
 
@@ -1039,11 +2250,24 @@ int ext2_recognize_drive(vfs_device_t* dev)
         kfree(superblock);
         return -EINVAL;
     }
-    if (superblock->rev_level != 0) {
+    if (superblock->rev_level > 1) {
         kfree(superblock);
         return -EINVAL;
     }
 
+    /* Dynamic revision is supported as long as the fs could be used as a rev 0 one. */
+    if (superblock->rev_level == 1) {
+        bool supported = true;
+        supported &= (superblock->inode_size == INODE_LEN);
+        supported &= !(superblock->feature_incompat & ~EXT2_FEATURE_INCOMPAT_SUPP);
+        supported &= !(superblock->feature_ro_compat & ~EXT2_FEATURE_RO_COMPAT_SUPP);
+        if (!supported) {
+            log_warn("[Ext2] Unsupported features: incompat %x, ro_compat %x, inode size %d", superblock->feature_incompat, superblock->feature_ro_compat, superblock->inode_size);
+            kfree(superblock);
+            return -EINVAL;
+        }
+    }
+
     kfree(superblock);
 
     return 0;
@@ -1063,24 +2287,41 @@ int ext2_prepare_fs(vfs_device_t* dev)
     _ext2_group_table_info[dev->dev->id].count = groups_cnt;
     _ext2_group_table_info[dev->dev->id].table = group_table;
 
+    uint32_t* free_hints = (uint32_t*)kmalloc(groups_cnt * sizeof(uint32_t));
+    memset((uint8_t*)free_hints, 0, groups_cnt * sizeof(uint32_t));
+    _ext2_group_free_hints[dev->dev->id] = free_hints;
+
     return 0;
 }
 
-int ext2_save_state(vfs_device_t* dev)
+/**
+ * ext2_sync writes the superblock and the group table, which are kept in memory.
+ */
+int ext2_sync(vfs_device_t* dev)
 {
     if (!_ext2_superblocks[dev->dev->id]) {
         return -1;
     }
 
     superblock_t* superblock = _ext2_superblocks[dev->dev->id];
-
     uint32_t group_table_len = _ext2_group_table_info[dev->dev->id].count * GROUP_LEN;
     group_desc_t* group_table = _ext2_group_table_info[dev->dev->id].table;
     _ext2_write_to_dev(dev, (uint8_t*)group_table, _ext2_get_block_offset(superblock, 2), group_table_len);
-    kfree(group_table);
-
     _ext2_write_to_dev(dev, (uint8_t*)superblock, SUPERBLOCK_START, SUPERBLOCK_LEN);
-    kfree(superblock);
+    return 0;
+}
+
+int ext2_save_state(vfs_device_t* dev)
+{
+    if (ext2_sync(dev) < 0) {
+        return -1;
+    }
+
+    kfree(_ext2_group_table_info[dev->dev->id].table);
+    kfree(_ext2_group_free_hints[dev->dev->id]);
+    _ext2_group_free_hints[dev->dev->id] = NULL;
+    kfree(_ext2_superblocks[dev->dev->id]);
+    _ext2_superblocks[dev->dev->id] = NULL;
     return 0;
 }
 
@@ -1116,9 +2357,11 @@ driver_desc_t _ext2_driver_info()
     fs_desc.functions[DRIVER_FILE_SYSTEM_MKDIR] = ext2_mkdir;
     fs_desc.functions[DRIVER_FILE_SYSTEM_RMDIR] = ext2_rmdir;
     fs_desc.functions[DRIVER_FILE_SYSTEM_EJECT_DEVICE] = ext2_save_state;
+    fs_desc.functions[DRIVER_FILE_SYSTEM_SYNC] = ext2_sync;
 
     fs_desc.functions[DRIVER_FILE_SYSTEM_READ_INODE] = ext2_read_inode;
     fs_desc.functions[DRIVER_FILE_SYSTEM_WRITE_INODE] = ext2_write_inode;
+    fs_desc.functions[DRIVER_FILE_SYSTEM_WRITE_INODES] = ext2_write_inodes;
     fs_desc.functions[DRIVER_FILE_SYSTEM_FREE_INODE] = ext2_free_inode;
     fs_desc.functions[DRIVER_FILE_SYSTEM_GET_FSDATA] = get_fsdata;
     fs_desc.functions[DRIVER_FILE_SYSTEM_LOOKUP] = ext2_lookup;
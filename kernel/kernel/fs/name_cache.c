@@ -0,0 +1,302 @@
+/*
+ * Copyright (C) 2020-2021 Nikita Melekhin. All rights reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <fs/vfs.h>
+#include <libkern/bits/errno.h>
+#include <libkern/libkern.h>
+#include <libkern/lock.h>
+#include <libkern/log.h>
+#include <mem/kmalloc.h>
+
+/**
+ * The name cache maps (dev, dir inode, name) to an inode index, so repeated
+ * path lookups don't need to scan directory blocks. Entries are added by
+ * filesystems (it's an opt-in for fs with stable names), and looked up by vfs.
+ * Negative entries (inode index is 0) remember names which don't exist, they
+ * are dropped when a file with such name is created.
+ */
+
+// #define NAME_CACHE_DEBUG
+
+#define NAME_CACHE_MAX_NAME 32
+#define NAME_CACHE_ENTRIES_COUNT 512
+#define NAME_CACHE_HASH_SIZE 256 /* Must be a power of 2. */
+
+struct name_cache_entry {
+    struct name_cache_entry* hash_next;
+    struct name_cache_entry* lru_prev;
+    struct name_cache_entry* lru_next;
+    uint32_t dev_indx;
+    uint32_t dir_inode_indx;
+    uint32_t inode_indx;
+    uint32_t name_len;
+    char name[NAME_CACHE_MAX_NAME];
+};
+typedef struct name_cache_entry name_cache_entry_t;
+
+static lock_t name_cache_lock;
+static name_cache_entry_t* name_cache_pool;
+static uint32_t name_cache_pool_used = 0;
+static name_cache_entry_t* name_cache_hashtable[NAME_CACHE_HASH_SIZE];
+static name_cache_entry_t* name_cache_lru_head; /* The most recently used entry. */
+static name_cache_entry_t* name_cache_lru_tail;
+
+static uint32_t stat_hits = 0;
+static uint32_t stat_negative_hits = 0;
+static uint32_t stat_misses = 0;
+
+static inline uint32_t name_cache_hash(uint32_t dev_indx, uint32_t dir_inode_indx, const char* name, uint32_t len)
+{
+    uint32_t hash = 2166136261u ^ dir_inode_indx ^ (dev_indx << 24);
+    for (uint32_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)name[i];
+        hash *= 16777619u;
+    }
+    return hash & (NAME_CACHE_HASH_SIZE - 1);
+}
+
+static inline void name_cache_lru_remove_locked(name_cache_entry_t* entry)
+{
+    if (entry->lru_prev) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        name_cache_lru_head = entry->lru_next;
+    }
+
+    if (entry->lru_next) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        name_cache_lru_tail = entry->lru_prev;
+    }
+    entry->lru_prev = NULL;
+    entry->lru_next = NULL;
+}
+
+static inline void name_cache_lru_push_locked(name_cache_entry_t* entry)
+{
+    entry->lru_prev = NULL;
+    entry->lru_next = name_cache_lru_head;
+    if (name_cache_lru_head) {
+        name_cache_lru_head->lru_prev = entry;
+    } else {
+        name_cache_lru_tail = entry;
+    }
+    name_cache_lru_head = entry;
+}
+
+static inline void name_cache_hash_remove_locked(name_cache_entry_t* entry)
+{
+    name_cache_entry_t** link = &name_cache_hashtable[name_cache_hash(entry->dev_indx, entry->dir_inode_indx, entry->name, entry->name_len)];
+    while (*link) {
+        if (*link == entry) {
+            *link = entry->hash_next;
+            entry->hash_next = NULL;
+            return;
+        }
+        link = &(*link)->hash_next;
+    }
+}
+
+static name_cache_entry_t* name_cache_find_locked(uint32_t dev_indx, uint32_t dir_inode_indx, const char* name, uint32_t len)
+{
+    name_cache_entry_t* entry = name_cache_hashtable[name_cache_hash(dev_indx, dir_inode_indx, name, len)];
+    while (entry) {
+        if (entry->dev_indx == dev_indx && entry->dir_inode_indx == dir_inode_indx && entry->name_len == len && memcmp(entry->name, name, len) == 0) {
+            return entry;
+        }
+        entry = entry->hash_next;
+    }
+    return NULL;
+}
+
+/**
+ * Returns an unused entry. When the pool is full, the least recently used
+ * entry is replaced.
+ */
+static name_cache_entry_t* name_cache_alloc_entry_locked()
+{
+    if (!name_cache_pool) {
+        name_cache_pool = (name_cache_entry_t*)kmalloc(NAME_CACHE_ENTRIES_COUNT * sizeof(name_cache_entry_t));
+        memset((uint8_t*)name_cache_pool, 0, NAME_CACHE_ENTRIES_COUNT * sizeof(name_cache_entry_t));
+    }
+
+    if (name_cache_pool_used < NAME_CACHE_ENTRIES_COUNT) {
+        return &name_cache_pool[name_cache_pool_used++];
+    }
+
+    name_cache_entry_t* victim = name_cache_lru_tail;
+    name_cache_lru_remove_locked(victim);
+    name_cache_hash_remove_locked(victim);
+    return victim;
+}
+
+static void name_cache_free_entry_locked(name_cache_entry_t* entry)
+{
+    name_cache_lru_remove_locked(entry);
+    name_cache_hash_remove_locked(entry);
+
+    /* Moving the entry to the end of lru, to be reused first. */
+    entry->lru_prev = name_cache_lru_tail;
+    entry->lru_next = NULL;
+    if (name_cache_lru_tail) {
+        name_cache_lru_tail->lru_next = entry;
+    } else {
+        name_cache_lru_head = entry;
+    }
+    name_cache_lru_tail = entry;
+    entry->dev_indx = 0;
+    entry->dir_inode_indx = 0;
+    entry->name_len = 0;
+}
+
+/**
+ * name_cache_lookup looks for @name inside @dir.
+ * return: 0 and the inode index in @inode_indx on hit, -ENOENT on miss.
+ *         For a negative entry @inode_indx is set to 0.
+ */
+int name_cache_lookup(dentry_t* dir, const char* name, uint32_t len, uint32_t* inode_indx)
+{
+    if (len > NAME_CACHE_MAX_NAME) {
+        stat_misses++;
+        return -ENOENT;
+    }
+
+    lock_acquire(&name_cache_lock);
+    name_cache_entry_t* entry = name_cache_find_locked(dir->dev_indx, dir->inode_indx, name, len);
+    if (!entry) {
+        stat_misses++;
+        lock_release(&name_cache_lock);
+        return -ENOENT;
+    }
+
+    name_cache_lru_remove_locked(entry);
+    name_cache_lru_push_locked(entry);
+    *inode_indx = entry->inode_indx;
+    if (entry->inode_indx) {
+        stat_hits++;
+    } else {
+        stat_negative_hits++;
+    }
+    lock_release(&name_cache_lock);
+    return 0;
+}
+
+/**
+ * name_cache_add remembers that @name inside @dir points to @inode_indx.
+ * Pass 0 as @inode_indx to add a negative entry.
+ */
+void name_cache_add(dentry_t* dir, const char* name, uint32_t len, uint32_t inode_indx)
+{
+    if (len > NAME_CACHE_MAX_NAME) {
+        return;
+    }
+
+    lock_acquire(&name_cache_lock);
+    name_cache_entry_t* entry = name_cache_find_locked(dir->dev_indx, dir->inode_indx, name, len);
+    if (entry) {
+        name_cache_lru_remove_locked(entry);
+    } else {
+        entry = name_cache_alloc_entry_locked();
+        entry->dev_indx = dir->dev_indx;
+        entry->dir_inode_indx = dir->inode_indx;
+        entry->name_len = len;
+        memcpy(entry->name, name, len);
+
+        uint32_t bucket = name_cache_hash(entry->dev_indx, entry->dir_inode_indx, entry->name, entry->name_len);
+        entry->hash_next = name_cache_hashtable[bucket];
+        name_cache_hashtable[bucket] = entry;
+    }
+
+    entry->inode_indx = inode_indx;
+    name_cache_lru_push_locked(entry);
+    lock_release(&name_cache_lock);
+}
+
+/**
+ * name_cache_invalidate_name drops an entry of @name inside @dir. Should be
+ * called when a name appears (create, mkdir) or changes (rename).
+ */
+void name_cache_invalidate_name(dentry_t* dir, const char* name, uint32_t len)
+{
+    if (len > NAME_CACHE_MAX_NAME) {
+        return;
+    }
+
+    lock_acquire(&name_cache_lock);
+    name_cache_entry_t* entry = name_cache_find_locked(dir->dev_indx, dir->inode_indx, name, len);
+    if (entry) {
+        name_cache_free_entry_locked(entry);
+    }
+    lock_release(&name_cache_lock);
+}
+
+/**
+ * name_cache_invalidate_inode drops all names, which point to the @dentry.
+ * Since vfs doesn't know the names of a deleted file, all used entries
+ * are scanned. It's done only when an inode is unlinked.
+ */
+void name_cache_invalidate_inode(dentry_t* dentry)
+{
+    lock_acquire(&name_cache_lock);
+    for (uint32_t i = 0; i < name_cache_pool_used; i++) {
+        name_cache_entry_t* entry = &name_cache_pool[i];
+        if (entry->name_len == 0) {
+            continue;
+        }
+
+        /* Names inside the removed dir are also no longer valid. */
+        bool points_to = (entry->inode_indx == dentry->inode_indx) && entry->inode_indx;
+        bool inside = (entry->dir_inode_indx == dentry->inode_indx);
+        if (entry->dev_indx == dentry->dev_indx && (points_to || inside)) {
+#ifdef NAME_CACHE_DEBUG
+            log("[NameCache] Invalidate %d in dir %d", entry->inode_indx, entry->dir_inode_indx);
+#endif
+            name_cache_free_entry_locked(entry);
+        }
+    }
+    lock_release(&name_cache_lock);
+}
+
+void name_cache_invalidate_dev(uint32_t dev_indx)
+{
+    lock_acquire(&name_cache_lock);
+    for (uint32_t i = 0; i < name_cache_pool_used; i++) {
+        name_cache_entry_t* entry = &name_cache_pool[i];
+        if (entry->name_len != 0 && entry->dev_indx == dev_indx) {
+            name_cache_free_entry_locked(entry);
+        }
+    }
+    lock_release(&name_cache_lock);
+}
+
+uint32_t name_cache_stat_hits()
+{
+    return stat_hits;
+}
+
+uint32_t name_cache_stat_negative_hits()
+{
+    return stat_negative_hits;
+}
+
+uint32_t name_cache_stat_misses()
+{
+    return stat_misses;
+}
+
+uint32_t name_cache_stat_entries()
+{
+    uint32_t entries = 0;
+    lock_acquire(&name_cache_lock);
+    for (uint32_t i = 0; i < name_cache_pool_used; i++) {
+        if (name_cache_pool[i].name_len != 0) {
+            entries++;
+        }
+    }
+    lock_release(&name_cache_lock);
+    return entries;
+}
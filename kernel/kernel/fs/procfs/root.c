@@ -30,6 +30,8 @@ static bool procfs_root_uptime_can_read(dentry_t* dentry, uint32_t start);
 static int procfs_root_uptime_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len);
 static bool procfs_root_stat_can_read(dentry_t* dentry, uint32_t start);
 static int procfs_root_stat_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len);
+static bool procfs_root_namecache_can_read(dentry_t* dentry, uint32_t start);
+static int procfs_root_namecache_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len);
 
 /**
  * DATA
@@ -50,9 +52,15 @@ const file_ops_t procfs_root_stat_ops = {
     .read = procfs_root_stat_read,
 };
 
+const file_ops_t procfs_root_namecache_ops = {
+    .can_read = procfs_root_namecache_can_read,
+    .read = procfs_root_namecache_read,
+};
+
 static const procfs_files_t static_procfs_files[] = {
     { .name = "stat", .mode = 0, .ops = &procfs_root_stat_ops },
     { .name = "uptime", .mode = 0, .ops = &procfs_root_uptime_ops },
+    { .name = "namecache", .mode = 0, .ops = &procfs_root_namecache_ops },
 };
 #define PROCFS_STATIC_FILES_COUNT_AT_LEVEL (sizeof(static_procfs_files) / sizeof(procfs_files_t))
 
@@ -234,4 +242,28 @@ static int procfs_root_stat_read(dentry_t* dentry, uint8_t* buf, uint32_t start,
 
     memcpy(buf, res, size);
     return size;
-}
\ No newline at end of file
+}
+
+static bool procfs_root_namecache_can_read(dentry_t* dentry, uint32_t start)
+{
+    return true;
+}
+
+static int procfs_root_namecache_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
+{
+    char res[96];
+    snprintf(res, 96, "hits %u\nnegative_hits %u\nmisses %u\nentries %u\n",
+        name_cache_stat_hits(), name_cache_stat_negative_hits(), name_cache_stat_misses(), name_cache_stat_entries());
+    size_t size = strlen(res);
+
+    if (start == size) {
+        return 0;
+    }
+
+    if (len < size) {
+        return -EFAULT;
+    }
+
+    memcpy(buf, res, size);
+    return size;
+}
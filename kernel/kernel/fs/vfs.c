@@ -7,6 +7,8 @@
 
 #include <algo/dynamic_array.h>
 #include <fs/vfs.h>
+#include <io/epoll/epoll.h>
+#include <io/pipe/pipe.h>
 #include <io/sockets/socket.h>
 #include <libkern/bits/errno.h>
 #include <libkern/libkern.h>
@@ -131,11 +133,15 @@ void vfs_eject_device(device_t* dev)
 #endif
     int fs_id = _vfs_devices[dev->id].fs;
     fs_desc_t* fs = dynamic_array_get(&_vfs_fses, (int)fs_id);
+
+    /* Inodes are written while fs data of the device is still valid. */
+    dentry_writeback();
     if (fs->ops->eject_device) {
         int (*eject)(vfs_device_t * nd) = fs->ops->eject_device;
         eject(&_vfs_devices[dev->id]);
     }
     dentry_put_all_dentries_of_dev(dev->id);
+    name_cache_invalidate_dev(dev->id);
 }
 
 void vfs_add_fs(driver_t* new_driver)
@@ -149,6 +155,7 @@ void vfs_add_fs(driver_t* new_driver)
     new_ops->recognize = new_driver->desc.functions[DRIVER_FILE_SYSTEM_RECOGNIZE];
     new_ops->prepare_fs = new_driver->desc.functions[DRIVER_FILE_SYSTEM_PREPARE_FS];
     new_ops->eject_device = new_driver->desc.functions[DRIVER_FILE_SYSTEM_EJECT_DEVICE];
+    new_ops->sync = new_driver->desc.functions[DRIVER_FILE_SYSTEM_SYNC];
 
     new_ops->file.mkdir = new_driver->desc.functions[DRIVER_FILE_SYSTEM_MKDIR];
     new_ops->file.rmdir = new_driver->desc.functions[DRIVER_FILE_SYSTEM_RMDIR];
@@ -165,8 +172,12 @@ void vfs_add_fs(driver_t* new_driver)
     new_ops->file.fstat = new_driver->desc.functions[DRIVER_FILE_SYSTEM_FSTAT];
     new_ops->file.ioctl = new_driver->desc.functions[DRIVER_FILE_SYSTEM_IOCTL];
     new_ops->file.mmap = new_driver->desc.functions[DRIVER_FILE_SYSTEM_MMAP];
+    new_ops->file.readv = new_driver->desc.functions[DRIVER_FILE_SYSTEM_READV];
+    new_ops->file.writev = new_driver->desc.functions[DRIVER_FILE_SYSTEM_WRITEV];
+    new_ops->file.wait_queue = new_driver->desc.functions[DRIVER_FILE_SYSTEM_WAIT_QUEUE];
 
     new_ops->dentry.write_inode = new_driver->desc.functions[DRIVER_FILE_SYSTEM_WRITE_INODE];
+    new_ops->dentry.write_inodes = new_driver->desc.functions[DRIVER_FILE_SYSTEM_WRITE_INODES];
     new_ops->dentry.read_inode = new_driver->desc.functions[DRIVER_FILE_SYSTEM_READ_INODE];
     new_ops->dentry.free_inode = new_driver->desc.functions[DRIVER_FILE_SYSTEM_FREE_INODE];
     new_ops->dentry.get_fsdata = new_driver->desc.functions[DRIVER_FILE_SYSTEM_GET_FSDATA];
@@ -216,8 +227,12 @@ static int _int_vfs_do_close(file_descriptor_t* fd)
 {
     if (fd->type == FD_TYPE_FILE) {
         dentry_put(fd->dentry);
-    } else {
+    } else if (fd->type == FD_TYPE_SOCKET) {
         socket_put(fd->sock_entry);
+    } else if (fd->type == FD_TYPE_PIPE) {
+        pipe_put(fd);
+    } else {
+        epoll_put(fd->epoll_entry);
     }
     fd->dentry = NULL;
     fd->ops = NULL;
@@ -233,6 +248,25 @@ int vfs_close(file_descriptor_t* fd)
     return _int_vfs_do_close(fd);
 }
 
+/**
+ * vfs_dup makes @to refer to the same object as @from. There are no shared
+ * open file descriptions, so a duplicated file gets its own offset.
+ */
+int vfs_dup(file_descriptor_t* from, file_descriptor_t* to)
+{
+    *to = *from;
+    if (to->type == FD_TYPE_FILE) {
+        dentry_duplicate(to->dentry);
+    } else if (to->type == FD_TYPE_SOCKET) {
+        socket_duplicate(to->sock_entry);
+    } else if (to->type == FD_TYPE_PIPE) {
+        pipe_duplicate(to);
+    } else {
+        epoll_duplicate(to->epoll_entry);
+    }
+    return 0;
+}
+
 int vfs_create(dentry_t* dir, const char* name, uint32_t len, mode_t mode)
 {
     /* Check if there is a file with the same name */
@@ -242,7 +276,11 @@ int vfs_create(dentry_t* dir, const char* name, uint32_t len, mode_t mode)
         return -EEXIST;
     }
 
-    return dir->ops->file.create(dir, name, len, mode);
+    int err = dir->ops->file.create(dir, name, len, mode);
+    if (!err) {
+        name_cache_invalidate_name(dir, name, len);
+    }
+    return err;
 }
 
 int vfs_unlink(dentry_t* file)
@@ -259,7 +297,11 @@ int vfs_unlink(dentry_t* file)
 #endif
     }
 
-    return file->ops->file.unlink(file);
+    int err = file->ops->file.unlink(file);
+    if (!err) {
+        name_cache_invalidate_inode(file);
+    }
+    return err;
 }
 
 int vfs_lookup(dentry_t* dir, const char* name, uint32_t len, dentry_t** result)
@@ -288,6 +330,17 @@ int vfs_lookup(dentry_t* dir, const char* name, uint32_t len, dentry_t** result)
         }
     }
 
+    uint32_t cached_inode_indx;
+    if (name_cache_lookup(dir, name, len, &cached_inode_indx) == 0) {
+        if (!cached_inode_indx) {
+            return -ENOENT;
+        }
+        *result = dentry_get(dir->dev_indx, cached_inode_indx);
+        if (*result) {
+            return 0;
+        }
+    }
+
     if (!dir->ops->file.lookup) {
         return -ENOEXEC;
     }
@@ -341,12 +394,86 @@ int vfs_write(file_descriptor_t* fd, void* buf, uint32_t len)
     return written;
 }
 
+/**
+ * Transfers iovecs one by one with read/write, for files without vectored ops.
+ * Stops on the first short transfer, so the result is the same as of a single
+ * call with one contiguous buffer.
+ */
+static int _vfs_rw_iovecs(file_descriptor_t* fd, const iovec_t* iov, int iovcnt, uint32_t offset, bool write)
+{
+    int done = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        if (!iov[i].iov_len) {
+            continue;
+        }
+        int res;
+        if (write) {
+            res = fd->ops->write(fd->dentry, (uint8_t*)iov[i].iov_base, offset + done, iov[i].iov_len);
+        } else {
+            res = fd->ops->read(fd->dentry, (uint8_t*)iov[i].iov_base, offset + done, iov[i].iov_len);
+        }
+        if (res < 0) {
+            return done ? done : res;
+        }
+        done += res;
+        if (res < iov[i].iov_len) {
+            break;
+        }
+    }
+    return done;
+}
+
+int vfs_preadv(file_descriptor_t* fd, const iovec_t* iov, int iovcnt, uint32_t offset)
+{
+    if (fd->ops->readv) {
+        return fd->ops->readv(fd->dentry, iov, iovcnt, offset);
+    }
+    return _vfs_rw_iovecs(fd, iov, iovcnt, offset, false);
+}
+
+int vfs_pwritev(file_descriptor_t* fd, const iovec_t* iov, int iovcnt, uint32_t offset)
+{
+    if (fd->ops->writev) {
+        return fd->ops->writev(fd->dentry, iov, iovcnt, offset);
+    }
+    return _vfs_rw_iovecs(fd, iov, iovcnt, offset, true);
+}
+
+int vfs_readv(file_descriptor_t* fd, const iovec_t* iov, int iovcnt)
+{
+    int read = vfs_preadv(fd, iov, iovcnt, fd->offset);
+    if (read > 0) {
+        fd->offset += read;
+    }
+    return read;
+}
+
+int vfs_writev(file_descriptor_t* fd, const iovec_t* iov, int iovcnt)
+{
+    int written = vfs_pwritev(fd, iov, iovcnt, fd->offset);
+    if (written > 0) {
+        fd->offset += written;
+    }
+
+    if (fd->flags & O_TRUNC) {
+        if (fd->ops->truncate) {
+            fd->ops->truncate(fd->dentry, fd->offset);
+        }
+    }
+
+    return written;
+}
+
 int vfs_mkdir(dentry_t* dir, const char* name, size_t len, mode_t mode)
 {
     if (!dentry_inode_test_flag(dir, S_IFDIR)) {
         return -ENOTDIR;
     }
-    return dir->ops->file.mkdir(dir, name, len, mode | S_IFDIR);
+    int err = dir->ops->file.mkdir(dir, name, len, mode | S_IFDIR);
+    if (!err) {
+        name_cache_invalidate_name(dir, name, len);
+    }
+    return err;
 }
 
 int vfs_rmdir(dentry_t* dir)
@@ -362,6 +489,7 @@ int vfs_rmdir(dentry_t* dir)
     if (!err) {
         log("Rmdir: will be deleted %d", dir->inode_indx);
         dentry_set_flag(dir, DENTRY_INODE_TO_BE_DELETED);
+        name_cache_invalidate_inode(dir);
     }
     return err;
 }
@@ -392,6 +520,40 @@ int vfs_fstat(file_descriptor_t* fd, fstat_t* stat)
     return 0;
 }
 
+/**
+ * vfs_fsync makes the file durable. Data is written to the drive by write()
+ * itself, so only the inode and, unless @data_only, fs metadata are flushed.
+ */
+int vfs_fsync(file_descriptor_t* fd, bool data_only)
+{
+    if (fd->type != FD_TYPE_FILE) {
+        return -EINVAL;
+    }
+
+    dentry_t* dentry = fd->dentry;
+    dentry_fsync(dentry);
+    if (!data_only && dentry->ops->sync) {
+        return dentry->ops->sync(dentry->dev);
+    }
+    return 0;
+}
+
+int vfs_sync()
+{
+    dentry_writeback();
+    for (int i = 0; i < MAX_DEVICES_COUNT; i++) {
+        if (!_vfs_devices[i].dev || _vfs_devices[i].dev->is_virtual) {
+            continue;
+        }
+
+        fs_desc_t* fs = dynamic_array_get(&_vfs_fses, _vfs_devices[i].fs);
+        if (fs->ops->sync) {
+            fs->ops->sync(&_vfs_devices[i]);
+        }
+    }
+    return 0;
+}
+
 int vfs_resolve_path_start_from(dentry_t* dentry, const char* path, dentry_t** result)
 {
     if (!path) {
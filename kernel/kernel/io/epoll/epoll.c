@@ -0,0 +1,375 @@
+/*
+ * Copyright (C) 2020-2021 Nikita Melekhin. All rights reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <io/epoll/epoll.h>
+#include <libkern/bits/errno.h>
+#include <libkern/kassert.h>
+#include <libkern/libkern.h>
+#include <mem/kmalloc.h>
+
+#define EPOLL_IO_EVENTS (EPOLLIN | EPOLLOUT)
+
+static bool _epoll_can_read(dentry_t* dentry, uint32_t start);
+static int _epoll_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len);
+static int _epoll_write(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len);
+
+static file_ops_t epoll_ops = {
+    .can_read = _epoll_can_read,
+    .can_write = 0,
+    .read = _epoll_read,
+    .write = _epoll_write,
+};
+
+/**
+ * Ready list
+ */
+
+static void _epoll_ready_list_add(epoll_t* ep, epoll_item_t* item)
+{
+    if (item->on_ready_list) {
+        return;
+    }
+
+    item->on_ready_list = true;
+    item->ready_next = NULL;
+    if (ep->ready_tail) {
+        ep->ready_tail->ready_next = item;
+    } else {
+        ep->ready_head = item;
+    }
+    ep->ready_tail = item;
+    ep->ready_count++;
+}
+
+static epoll_item_t* _epoll_ready_list_pop(epoll_t* ep)
+{
+    epoll_item_t* item = ep->ready_head;
+    if (!item) {
+        return NULL;
+    }
+
+    ep->ready_head = item->ready_next;
+    if (!ep->ready_head) {
+        ep->ready_tail = NULL;
+    }
+    ep->ready_count--;
+    item->ready_next = NULL;
+    item->on_ready_list = false;
+    return item;
+}
+
+static void _epoll_ready_list_remove(epoll_t* ep, epoll_item_t* item)
+{
+    if (!item->on_ready_list) {
+        return;
+    }
+
+    epoll_item_t* prev = NULL;
+    for (epoll_item_t* it = ep->ready_head; it; prev = it, it = it->ready_next) {
+        if (it != item) {
+            continue;
+        }
+        if (prev) {
+            prev->ready_next = item->ready_next;
+        } else {
+            ep->ready_head = item->ready_next;
+        }
+        if (ep->ready_tail == item) {
+            ep->ready_tail = prev;
+        }
+        break;
+    }
+    ep->ready_count--;
+    item->ready_next = NULL;
+    item->on_ready_list = false;
+}
+
+/**
+ * Items
+ */
+
+static uint32_t _epoll_item_poll(epoll_item_t* item)
+{
+    file_descriptor_t* file = &item->file;
+    uint32_t revents = 0;
+    if ((item->events & EPOLLIN) && file->ops->can_read && file->ops->can_read(file->dentry, file->offset)) {
+        revents |= EPOLLIN;
+    }
+    if ((item->events & EPOLLOUT) && file->ops->can_write && file->ops->can_write(file->dentry, file->offset)) {
+        revents |= EPOLLOUT;
+    }
+    return revents;
+}
+
+static epoll_item_t* _epoll_find_item(epoll_t* ep, int fd_num)
+{
+    for (epoll_item_t* item = ep->items; item; item = item->next) {
+        if (item->fd == fd_num) {
+            return item;
+        }
+    }
+    return NULL;
+}
+
+/* Called by the file, when something has happened to it. It's the only place the ready list is filled at. */
+static void _epoll_item_wake(wait_queue_entry_t* entry, uint32_t events)
+{
+    epoll_item_t* item = (epoll_item_t*)entry;
+    if (events & item->events & EPOLL_IO_EVENTS) {
+        _epoll_ready_list_add(item->ep, item);
+    }
+}
+
+static void _epoll_unlink_item(epoll_t* ep, epoll_item_t* item)
+{
+    _epoll_ready_list_remove(ep, item);
+
+    epoll_item_t** link = &ep->items;
+    while (*link != item) {
+        link = &(*link)->next;
+    }
+    *link = item->next;
+
+    if (!item->wait_queue) {
+        link = &ep->polled;
+        while (*link != item) {
+            link = &(*link)->polled_next;
+        }
+        *link = item->polled_next;
+    }
+}
+
+static void _epoll_free_item(epoll_item_t* item)
+{
+    if (item->file.type == FD_TYPE_FILE) {
+        dentry_put(item->file.dentry);
+    }
+    kfree(item);
+}
+
+/* Called by the file, when it's freed. The file has already removed the item from its wait queue. */
+static void _epoll_item_release(wait_queue_entry_t* entry, uint32_t events)
+{
+    epoll_item_t* item = (epoll_item_t*)entry;
+    _epoll_unlink_item(item->ep, item);
+    _epoll_free_item(item);
+}
+
+static void _epoll_remove_item(epoll_t* ep, epoll_item_t* item)
+{
+    _epoll_unlink_item(ep, item);
+    if (item->wait_queue) {
+        wait_queue_remove(item->wait_queue, &item->wait);
+    }
+    _epoll_free_item(item);
+}
+
+static int _epoll_add_item(epoll_t* ep, int fd_num, file_descriptor_t* fd, epoll_event_t* event)
+{
+    epoll_item_t* item = (epoll_item_t*)kmalloc(sizeof(epoll_item_t));
+    if (!item) {
+        return -ENOMEM;
+    }
+    memset((uint8_t*)item, 0, sizeof(epoll_item_t));
+
+    item->ep = ep;
+    item->fd = fd_num;
+    item->file = *fd;
+    item->events = event->events;
+    item->data = event->data;
+    item->wait.wake = _epoll_item_wake;
+    item->wait.release = _epoll_item_release;
+
+    /* Sockets drop their items themselves, when freed. Files are kept alive by the item. */
+    if (fd->type == FD_TYPE_FILE) {
+        dentry_duplicate(fd->dentry);
+    }
+
+    if (fd->ops->wait_queue) {
+        item->wait_queue = fd->ops->wait_queue(fd->dentry);
+    }
+    if (item->wait_queue) {
+        wait_queue_add(item->wait_queue, &item->wait);
+    } else {
+        item->polled_next = ep->polled;
+        ep->polled = item;
+    }
+
+    item->next = ep->items;
+    ep->items = item;
+
+    /* The current state is reported as an event as well, so nothing is missed between open and add. */
+    if (_epoll_item_poll(item)) {
+        _epoll_ready_list_add(ep, item);
+    }
+    return 0;
+}
+
+/**
+ * Epoll
+ */
+
+int epoll_create(file_descriptor_t* fd)
+{
+    epoll_t* ep = (epoll_t*)kmalloc(sizeof(epoll_t));
+    if (!ep) {
+        return -ENOMEM;
+    }
+    memset((uint8_t*)ep, 0, sizeof(epoll_t));
+    ep->d_count = 1;
+
+    fd->type = FD_TYPE_EPOLL;
+    fd->epoll_entry = ep;
+    fd->ops = &epoll_ops;
+    fd->offset = 0;
+    fd->flags = 0;
+    return 0;
+}
+
+epoll_t* epoll_duplicate(epoll_t* ep)
+{
+    ep->d_count++;
+    return ep;
+}
+
+int epoll_put(epoll_t* ep)
+{
+    ASSERT(ep->d_count > 0);
+    ep->d_count--;
+    if (ep->d_count == 0) {
+        while (ep->items) {
+            _epoll_remove_item(ep, ep->items);
+        }
+        kfree(ep);
+    }
+    return 0;
+}
+
+int epoll_ctl(epoll_t* ep, int op, int fd_num, file_descriptor_t* fd, epoll_event_t* event)
+{
+    /* Nested instances are not supported, that keeps wakes from looping. */
+    if (fd->type == FD_TYPE_EPOLL) {
+        return -EINVAL;
+    }
+
+    epoll_item_t* item = _epoll_find_item(ep, fd_num);
+    switch (op) {
+    case EPOLL_CTL_ADD:
+        if (item) {
+            return -EEXIST;
+        }
+        return _epoll_add_item(ep, fd_num, fd, event);
+
+    case EPOLL_CTL_MOD:
+        if (!item) {
+            return -ENOENT;
+        }
+        item->events = event->events;
+        item->data = event->data;
+        _epoll_ready_list_remove(ep, item);
+        if (_epoll_item_poll(item)) {
+            _epoll_ready_list_add(ep, item);
+        }
+        return 0;
+
+    case EPOLL_CTL_DEL:
+        if (!item) {
+            return -ENOENT;
+        }
+        _epoll_remove_item(ep, item);
+        return 0;
+
+    default:
+        return -EINVAL;
+    }
+}
+
+/**
+ * epoll_forget_fd drops the item of a closed fd. Items are keyed by the fd
+ * number, so a kept one would hold the file and match a reused number.
+ */
+void epoll_forget_fd(epoll_t* ep, int fd_num)
+{
+    epoll_item_t* item = _epoll_find_item(ep, fd_num);
+    if (item) {
+        _epoll_remove_item(ep, item);
+    }
+}
+
+/**
+ * epoll_has_ready is polled by the blocker of a waiting thread. Items, which
+ * were woken but have been drained since, are dropped from the ready list
+ * here, so a wait never returns with no events before its timeout.
+ */
+bool epoll_has_ready(epoll_t* ep)
+{
+    while (ep->ready_head) {
+        if (_epoll_item_poll(ep->ready_head)) {
+            return true;
+        }
+        _epoll_ready_list_pop(ep);
+    }
+
+    for (epoll_item_t* item = ep->polled; item; item = item->polled_next) {
+        if (_epoll_item_poll(item)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * epoll_collect reports up to @maxevents ready items. A level-triggered item
+ * stays on the ready list and is checked again by the next wait, an
+ * edge-triggered one is reported once per wake of its file, and a one-shot
+ * one is disabled till EPOLL_CTL_MOD. Files without a wait queue can't tell
+ * about edges, so they are level-triggered only.
+ */
+int epoll_collect(epoll_t* ep, epoll_event_t* events, int maxevents)
+{
+    for (epoll_item_t* item = ep->polled; item; item = item->polled_next) {
+        if (!item->on_ready_list && _epoll_item_poll(item)) {
+            _epoll_ready_list_add(ep, item);
+        }
+    }
+
+    int count = 0;
+    uint32_t pending = ep->ready_count;
+    while (pending-- && count < maxevents) {
+        epoll_item_t* item = _epoll_ready_list_pop(ep);
+        uint32_t revents = _epoll_item_poll(item);
+        if (!revents) {
+            continue;
+        }
+
+        events[count].events = revents;
+        events[count].data = item->data;
+        count++;
+
+        if (item->events & EPOLLONESHOT) {
+            item->events &= ~EPOLL_IO_EVENTS;
+        } else if (!(item->events & EPOLLET) || !item->wait_queue) {
+            _epoll_ready_list_add(ep, item);
+        }
+    }
+    return count;
+}
+
+static bool _epoll_can_read(dentry_t* dentry, uint32_t start)
+{
+    return epoll_has_ready((epoll_t*)dentry);
+}
+
+static int _epoll_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
+{
+    return -EINVAL;
+}
+
+static int _epoll_write(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
+{
+    return -EINVAL;
+}
@@ -0,0 +1,432 @@
+/*
+ * Copyright (C) 2020-2021 Nikita Melekhin. All rights reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <io/pipe/pipe.h>
+#include <libkern/bits/errno.h>
+#include <libkern/kassert.h>
+#include <libkern/libkern.h>
+#include <mem/kmalloc.h>
+#include <mem/pmm.h>
+#include <mem/uaccess.h>
+#include <mem/vmm/vmm.h>
+
+static bool _pipe_can_read(dentry_t* dentry, uint32_t start);
+static bool _pipe_can_write(dentry_t* dentry, uint32_t start);
+static int _pipe_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len);
+static int _pipe_write(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len);
+static int _pipe_bad_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len);
+static int _pipe_bad_write(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len);
+static int _pipe_fstat(dentry_t* dentry, fstat_t* stat);
+static wait_queue_t* _pipe_wait_queue(dentry_t* dentry);
+
+static file_ops_t pipe_read_ops = {
+    .can_read = _pipe_can_read,
+    .can_write = 0,
+    .read = _pipe_read,
+    .write = _pipe_bad_write,
+    .fstat = _pipe_fstat,
+    .wait_queue = _pipe_wait_queue,
+};
+
+static file_ops_t pipe_write_ops = {
+    .can_read = 0,
+    .can_write = _pipe_can_write,
+    .read = _pipe_bad_read,
+    .write = _pipe_write,
+    .fstat = _pipe_fstat,
+    .wait_queue = _pipe_wait_queue,
+};
+
+/**
+ * Pages
+ */
+
+static inline uint8_t* _pipe_page(pipe_t* pipe, uint32_t index)
+{
+    return pipe->zone.ptr + index * VMM_PAGE_SIZE;
+}
+
+static inline uint32_t _pipe_tail(pipe_t* pipe)
+{
+    return (pipe->head + pipe->used - 1) % PIPE_PAGES;
+}
+
+static int _pipe_back_page(pipe_t* pipe, uint32_t index)
+{
+    pipe_buffer_t* buf = &pipe->bufs[index];
+    if (buf->frame) {
+        return 0;
+    }
+
+    uint32_t frame = (uint32_t)pmm_alloc_aligned(VMM_PAGE_SIZE, VMM_PAGE_SIZE);
+    if (!frame) {
+        return -ENOMEM;
+    }
+    vmm_map_page((uint32_t)_pipe_page(pipe, index), frame, PAGE_READABLE | PAGE_WRITABLE);
+    buf->frame = frame;
+    return 0;
+}
+
+/* Returns the free space after the data of the last page, taking a new page, if the last one is full. */
+static uint8_t* _pipe_write_chunk(pipe_t* pipe, uint32_t* len)
+{
+    if (pipe->used) {
+        uint32_t tail = _pipe_tail(pipe);
+        pipe_buffer_t* buf = &pipe->bufs[tail];
+        uint32_t end = buf->offset + buf->len;
+        if (end < VMM_PAGE_SIZE) {
+            *len = VMM_PAGE_SIZE - end;
+            return _pipe_page(pipe, tail) + end;
+        }
+    }
+
+    if (pipe->used == PIPE_PAGES) {
+        return NULL;
+    }
+
+    uint32_t index = (pipe->head + pipe->used) % PIPE_PAGES;
+    if (_pipe_back_page(pipe, index) < 0) {
+        return NULL;
+    }
+    pipe->bufs[index].offset = 0;
+    pipe->bufs[index].len = 0;
+    pipe->used++;
+    *len = VMM_PAGE_SIZE;
+    return _pipe_page(pipe, index);
+}
+
+static void _pipe_commit_write(pipe_t* pipe, uint32_t len)
+{
+    pipe->bufs[_pipe_tail(pipe)].len += len;
+    pipe->size += len;
+}
+
+/* Returns the data of the first page. */
+static uint8_t* _pipe_read_chunk(pipe_t* pipe, uint32_t* len)
+{
+    if (!pipe->size) {
+        return NULL;
+    }
+    pipe_buffer_t* buf = &pipe->bufs[pipe->head];
+    *len = buf->len;
+    return _pipe_page(pipe, pipe->head) + buf->offset;
+}
+
+static void _pipe_consume(pipe_t* pipe, uint32_t len)
+{
+    pipe_buffer_t* buf = &pipe->bufs[pipe->head];
+    buf->offset += len;
+    buf->len -= len;
+    pipe->size -= len;
+
+    /* A drained page is given back to the ring, keeping its frame. The last
+       one stays, the writer continues to fill it from the start. */
+    if (!buf->len) {
+        buf->offset = 0;
+        if (pipe->used > 1) {
+            pipe->head = (pipe->head + 1) % PIPE_PAGES;
+            pipe->used--;
+        }
+    }
+}
+
+static inline uint32_t _pipe_space(pipe_t* pipe)
+{
+    uint32_t space = (PIPE_PAGES - pipe->used) * VMM_PAGE_SIZE;
+    if (pipe->used) {
+        pipe_buffer_t* buf = &pipe->bufs[_pipe_tail(pipe)];
+        space += VMM_PAGE_SIZE - (buf->offset + buf->len);
+    }
+    return space;
+}
+
+/**
+ * Pipe
+ */
+
+int pipe_create(file_descriptor_t* read_fd, file_descriptor_t* write_fd)
+{
+    pipe_t* pipe = (pipe_t*)kmalloc(sizeof(pipe_t));
+    if (!pipe) {
+        return -ENOMEM;
+    }
+    memset((uint8_t*)pipe, 0, sizeof(pipe_t));
+
+    pipe->zone = zoner_new_zone(PIPE_PAGES * VMM_PAGE_SIZE);
+    if (!pipe->zone.start) {
+        kfree(pipe);
+        return -ENOMEM;
+    }
+    pipe->readers = 1;
+    pipe->writers = 1;
+
+    read_fd->type = FD_TYPE_PIPE;
+    read_fd->pipe_entry = pipe;
+    read_fd->ops = &pipe_read_ops;
+    read_fd->offset = 0;
+    read_fd->flags = O_RDONLY;
+
+    write_fd->type = FD_TYPE_PIPE;
+    write_fd->pipe_entry = pipe;
+    write_fd->ops = &pipe_write_ops;
+    write_fd->offset = 0;
+    write_fd->flags = O_WRONLY;
+    return 0;
+}
+
+void pipe_duplicate(file_descriptor_t* fd)
+{
+    if (fd->ops == &pipe_write_ops) {
+        fd->pipe_entry->writers++;
+    } else {
+        fd->pipe_entry->readers++;
+    }
+}
+
+static void _pipe_free(pipe_t* pipe)
+{
+    /* Epoll instances still watching the pipe drop it. */
+    wait_queue_release(&pipe->wait_queue);
+
+    for (uint32_t i = 0; i < PIPE_PAGES; i++) {
+        if (pipe->bufs[i].frame) {
+            vmm_unmap_page((uint32_t)_pipe_page(pipe, i));
+            pmm_free((void*)pipe->bufs[i].frame, VMM_PAGE_SIZE);
+        }
+    }
+    zoner_free_zone(pipe->zone);
+    kfree(pipe);
+}
+
+/* The last writer gone makes readers see EOF, the last reader gone makes writes fail with EPIPE. */
+int pipe_put(file_descriptor_t* fd)
+{
+    pipe_t* pipe = fd->pipe_entry;
+    if (fd->ops == &pipe_write_ops) {
+        ASSERT(pipe->writers > 0);
+        pipe->writers--;
+    } else {
+        ASSERT(pipe->readers > 0);
+        pipe->readers--;
+    }
+
+    if (!pipe->readers && !pipe->writers) {
+        _pipe_free(pipe);
+    } else if (!pipe->readers || !pipe->writers) {
+        wait_queue_wake(&pipe->wait_queue, EPOLLIN | EPOLLOUT);
+    }
+    return 0;
+}
+
+/**
+ * Ops
+ */
+
+static bool _pipe_can_read(dentry_t* dentry, uint32_t start)
+{
+    pipe_t* pipe = (pipe_t*)dentry;
+    return pipe->size || !pipe->writers;
+}
+
+static bool _pipe_can_write(dentry_t* dentry, uint32_t start)
+{
+    pipe_t* pipe = (pipe_t*)dentry;
+    return _pipe_space(pipe) || !pipe->readers;
+}
+
+static int _pipe_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
+{
+    pipe_t* pipe = (pipe_t*)dentry;
+    if (!pipe->size && len) {
+        return pipe->writers ? -EAGAIN : 0;
+    }
+
+    uint32_t done = 0;
+    uint32_t avail;
+    uint8_t* chunk;
+    while (done < len && (chunk = _pipe_read_chunk(pipe, &avail))) {
+        uint32_t n = min(avail, len - done);
+        if (copy_to_user(buf + done, chunk, n)) {
+            break;
+        }
+        _pipe_consume(pipe, n);
+        done += n;
+    }
+
+    if (!done && len) {
+        return -EFAULT;
+    }
+    if (done) {
+        wait_queue_wake(&pipe->wait_queue, EPOLLOUT);
+    }
+    return done;
+}
+
+static int _pipe_write(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
+{
+    pipe_t* pipe = (pipe_t*)dentry;
+    if (!pipe->readers) {
+        return -EPIPE;
+    }
+
+    uint32_t done = 0;
+    uint32_t space;
+    uint8_t* chunk;
+    while (done < len && (chunk = _pipe_write_chunk(pipe, &space))) {
+        uint32_t n = min(space, len - done);
+        if (copy_from_user(chunk, buf + done, n)) {
+            if (!done) {
+                return -EFAULT;
+            }
+            break;
+        }
+        _pipe_commit_write(pipe, n);
+        done += n;
+    }
+
+    if (!done && len) {
+        return -EAGAIN;
+    }
+    if (done) {
+        wait_queue_wake(&pipe->wait_queue, EPOLLIN);
+    }
+    return done;
+}
+
+static int _pipe_bad_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
+{
+    return -EBADF;
+}
+
+static int _pipe_bad_write(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
+{
+    return -EBADF;
+}
+
+static int _pipe_fstat(dentry_t* dentry, fstat_t* stat)
+{
+    pipe_t* pipe = (pipe_t*)dentry;
+    memset((uint8_t*)stat, 0, sizeof(fstat_t));
+    stat->mode = S_IFIFO;
+    stat->size = pipe->size;
+    return 0;
+}
+
+static wait_queue_t* _pipe_wait_queue(dentry_t* dentry)
+{
+    pipe_t* pipe = (pipe_t*)dentry;
+    return &pipe->wait_queue;
+}
+
+/**
+ * Splice
+ *
+ * Data is moved between pipe pages and a file by the file's own read and
+ * write, which get the page as their buffer, so it never passes through
+ * user memory. Files, which copy their data with uaccess (sockets), can't
+ * take kernel buffers and are refused by the callers.
+ */
+
+int pipe_splice_from_file(pipe_t* pipe, file_descriptor_t* in, uint32_t* offset, uint32_t len)
+{
+    if (!pipe->readers) {
+        return -EPIPE;
+    }
+
+    uint32_t done = 0;
+    uint32_t space;
+    uint8_t* chunk;
+    while (done < len && (chunk = _pipe_write_chunk(pipe, &space))) {
+        uint32_t n = min(space, len - done);
+        int res = in->ops->read(in->dentry, chunk, *offset, n);
+        if (res <= 0) {
+            if (!done) {
+                return res;
+            }
+            break;
+        }
+        _pipe_commit_write(pipe, res);
+        *offset += res;
+        done += res;
+        if (res < n) {
+            break;
+        }
+    }
+
+    if (!done && len) {
+        return -EAGAIN;
+    }
+    if (done) {
+        wait_queue_wake(&pipe->wait_queue, EPOLLIN);
+    }
+    return done;
+}
+
+int pipe_splice_to_file(pipe_t* pipe, file_descriptor_t* out, uint32_t* offset, uint32_t len)
+{
+    if (!pipe->size && len) {
+        return pipe->writers ? -EAGAIN : 0;
+    }
+
+    uint32_t done = 0;
+    uint32_t avail;
+    uint8_t* chunk;
+    while (done < len && (chunk = _pipe_read_chunk(pipe, &avail))) {
+        uint32_t n = min(avail, len - done);
+        int res = out->ops->write(out->dentry, chunk, *offset, n);
+        if (res <= 0) {
+            if (!done) {
+                return res;
+            }
+            break;
+        }
+        _pipe_consume(pipe, res);
+        *offset += res;
+        done += res;
+        if (res < n) {
+            break;
+        }
+    }
+
+    if (done) {
+        wait_queue_wake(&pipe->wait_queue, EPOLLOUT);
+    }
+    return done;
+}
+
+int pipe_splice_to_pipe(pipe_t* pipe, pipe_t* out, uint32_t len)
+{
+    if (pipe == out) {
+        return -EINVAL;
+    }
+    if (!out->readers) {
+        return -EPIPE;
+    }
+    if (!pipe->size && len) {
+        return pipe->writers ? -EAGAIN : 0;
+    }
+
+    uint32_t done = 0;
+    uint32_t avail, space;
+    uint8_t *from, *to;
+    while (done < len && (from = _pipe_read_chunk(pipe, &avail)) && (to = _pipe_write_chunk(out, &space))) {
+        uint32_t n = min(min(avail, space), len - done);
+        memcpy(to, from, n);
+        _pipe_commit_write(out, n);
+        _pipe_consume(pipe, n);
+        done += n;
+    }
+
+    if (!done && len) {
+        return -EAGAIN;
+    }
+    if (done) {
+        wait_queue_wake(&pipe->wait_queue, EPOLLOUT);
+        wait_queue_wake(&out->wait_queue, EPOLLIN);
+    }
+    return done;
+}
@@ -5,127 +5,552 @@
  * found in the LICENSE file.
  */
 
-#include <algo/bitmap.h>
 #include <io/shared_buffer/shared_buffer.h>
 #include <libkern/bits/errno.h>
 #include <libkern/libkern.h>
+#include <libkern/lock.h>
 #include <libkern/log.h>
+#include <mem/kmalloc.h>
 #include <mem/vmm/vmm.h>
 #include <mem/vmm/zoner.h>
+#include <tasking/tasking.h>
+
+/**
+ * Shared buffers are refcounted sets of physical pages. A buffer is mapped
+ * only into processes which create or open it, every mapping holds a
+ * reference and the pages are freed with the last one. The creator of a
+ * buffer is its owner, other processes could open it only after the owner
+ * has granted them access.
+ */
 
 // #define SHARED_BUFFER_DEBUG
 
-#define SHBUF_SPACE_SIZE (128 * MB)
-#define SHBUF_BLOCK_SIZE (4 * KB)
-#define SHBUF_MAX_BUFFERS 128
+#define SHBUF_HASH_SIZE 64 /* Must be a power of 2. */
 
-uint8_t* buffers[SHBUF_MAX_BUFFERS];
+/* A window bitmap could grow up to the screen: 1024x768 of 32-bit pixels. */
+#define SHBUF_MIN_RESERVED_PAGES (1024 * 768 * 4 / VMM_PAGE_SIZE)
 
-struct shared_buffer_header {
-    size_t len;
-};
-typedef struct shared_buffer_header shared_buffer_header_t;
+static lock_t shared_buffer_lock;
+static shared_buffer_t* shared_buffer_hashtable[SHBUF_HASH_SIZE];
+static int shared_buffer_next_id = 0;
 
-static zone_t _shared_buffer_zone;
-static uint32_t _shared_buffer_bitmap_len = 0;
-static uint8_t* _shared_buffer_bitmap;
-static bitmap_t bitmap;
+static inline uint32_t _shared_buffer_pages(size_t size)
+{
+    return (size + VMM_PAGE_SIZE - 1) / VMM_PAGE_SIZE;
+}
 
-static inline uint32_t _shared_buffer_to_vaddr(int start)
+/**
+ * The address range is reserved for twice the size (rounded up to a power
+ * of 2), but not less than the screen, so a buffer could grow in place. It
+ * costs nothing till the range is backed with pages.
+ */
+static inline uint32_t _shared_buffer_reserve_pages(uint32_t pages)
 {
-    return (uint32_t)_shared_buffer_zone.start + start * SHBUF_BLOCK_SIZE;
+    uint32_t reserved = 1;
+    while (reserved < 2 * pages) {
+        reserved <<= 1;
+    }
+    return max(reserved, (uint32_t)SHBUF_MIN_RESERVED_PAGES);
 }
 
-static inline int _shared_buffer_to_index(uint32_t vaddr)
+static shared_buffer_t* _shared_buffer_find_locked(int id)
 {
-    return (vaddr - (uint32_t)_shared_buffer_zone.start) / SHBUF_BLOCK_SIZE;
+    shared_buffer_t* buf = shared_buffer_hashtable[id & (SHBUF_HASH_SIZE - 1)];
+    while (buf) {
+        if (buf->id == id) {
+            return buf;
+        }
+        buf = buf->hash_next;
+    }
+    return NULL;
 }
 
-static inline int _shared_buffer_alloc_id()
+static int _shared_buffer_alloc_id_locked()
 {
-    for (int i = 0; i < SHBUF_MAX_BUFFERS; i++) {
-        if (!buffers[i]) {
-            return i;
+    do {
+        shared_buffer_next_id++;
+        if (shared_buffer_next_id < 0) {
+            shared_buffer_next_id = 0;
         }
+    } while (_shared_buffer_find_locked(shared_buffer_next_id));
+    return shared_buffer_next_id;
+}
+
+static void _shared_buffer_hash_remove_locked(shared_buffer_t* buf)
+{
+    shared_buffer_t** link = &shared_buffer_hashtable[buf->id & (SHBUF_HASH_SIZE - 1)];
+    while (*link) {
+        if (*link == buf) {
+            *link = buf->hash_next;
+            return;
+        }
+        link = &(*link)->hash_next;
+    }
+}
+
+/**
+ * PAGES
+ */
+
+static int _shared_buffer_alloc_frames(shared_buffer_t* buf, uint32_t pages)
+{
+    /* New frames are cleared through a temporary kernel mapping, they
+       could keep data of another process. */
+    zone_t tmp_zone = zoner_new_zone(VMM_PAGE_SIZE);
+
+    for (; buf->pages < pages; buf->pages++) {
+        uint32_t paddr = (uint32_t)pmm_alloc_aligned(VMM_PAGE_SIZE, VMM_PAGE_SIZE);
+        if (!paddr) {
+            zoner_free_zone(tmp_zone);
+            return -ENOMEM;
+        }
+        vmm_map_page(tmp_zone.start, paddr, PAGE_READABLE | PAGE_WRITABLE);
+        memset(tmp_zone.ptr, 0, VMM_PAGE_SIZE);
+        vmm_unmap_page(tmp_zone.start);
+        buf->frames[buf->pages] = paddr;
+    }
+
+    zoner_free_zone(tmp_zone);
+    return 0;
+}
+
+static void _shared_buffer_free_frames(shared_buffer_t* buf, uint32_t pages)
+{
+    for (; buf->pages > pages; buf->pages--) {
+        pmm_free((void*)buf->frames[buf->pages - 1], VMM_PAGE_SIZE);
+    }
+}
+
+/**
+ * MAPPINGS
+ */
+
+static shared_buffer_mapping_t* _shared_buffer_find_mapping(shared_buffer_t* buf, proc_t* p)
+{
+    shared_buffer_mapping_t* mapping = buf->mappings;
+    while (mapping) {
+        if (mapping->proc == p) {
+            return mapping;
+        }
+        mapping = mapping->next;
+    }
+    return NULL;
+}
+
+static void _shared_buffer_remove_mapping(shared_buffer_t* buf, shared_buffer_mapping_t* mapping)
+{
+    shared_buffer_mapping_t** link = &buf->mappings;
+    while (*link) {
+        if (*link == mapping) {
+            *link = mapping->next;
+            kfree(mapping);
+            return;
+        }
+        link = &(*link)->next;
+    }
+}
+
+static void _shared_buffer_destroy_locked(shared_buffer_t* buf)
+{
+#ifdef SHARED_BUFFER_DEBUG
+    log("Buffer destroyed %d", buf->id);
+#endif
+    _shared_buffer_hash_remove_locked(buf);
+    _shared_buffer_free_frames(buf, 0);
+    dynamic_array_free(&buf->granted);
+    kfree(buf->frames);
+    kfree(buf);
+}
+
+static void _shared_buffer_put_locked(shared_buffer_t* buf)
+{
+    ASSERT(buf->refs > 0);
+    buf->refs--;
+    if (!buf->refs) {
+        _shared_buffer_destroy_locked(buf);
     }
-    return -1;
 }
 
-static void _shared_buffer_init_bitmap()
+/**
+ * Maps the buffer into the running process. Pages are mapped right away,
+ * the pages added by later resizes are mapped on the first access.
+ */
+static int _shared_buffer_map_locked(shared_buffer_t* buf, uint32_t* start)
 {
-    _shared_buffer_bitmap = _shared_buffer_zone.ptr;
-    _shared_buffer_bitmap_len = (SHBUF_SPACE_SIZE / SHBUF_BLOCK_SIZE / 8);
+    proc_t* p = RUNNING_THREAD->process;
+    shared_buffer_mapping_t* mapping = _shared_buffer_find_mapping(buf, p);
+    if (mapping) {
+        *start = mapping->start;
+        return 0;
+    }
 
-    bitmap = bitmap_wrap(_shared_buffer_bitmap, _shared_buffer_bitmap_len);
-    memset(_shared_buffer_bitmap, 0, _shared_buffer_bitmap_len);
+    mapping = (shared_buffer_mapping_t*)kmalloc(sizeof(shared_buffer_mapping_t));
+    if (!mapping) {
+        return -ENOMEM;
+    }
 
-    /* Setting bitmap as a busy region. */
-    int blocks_needed = (_shared_buffer_bitmap_len + SHBUF_BLOCK_SIZE - 1) / SHBUF_BLOCK_SIZE;
-    bitmap_set_range(bitmap, _shared_buffer_to_index((uint32_t)_shared_buffer_bitmap), blocks_needed);
+    proc_zone_t* zone = proc_new_random_zone(p, buf->reserved_pages * VMM_PAGE_SIZE);
+    if (!zone) {
+        kfree(mapping);
+        return -ENOMEM;
+    }
+    zone->type = ZONE_TYPE_SHARED_BUFFER;
+    zone->flags |= ZONE_READABLE | ZONE_WRITABLE;
+    zone->shbuf = buf;
+
+    /* A table could be still shared with a forked process, which must not see the buffer. */
+    vmm_prepare_active_pdir_for_copying_at(zone->start, buf->pages * VMM_PAGE_SIZE);
+    for (uint32_t i = 0; i < buf->pages; i++) {
+        vmm_map_page(zone->start + i * VMM_PAGE_SIZE, buf->frames[i], zone->flags);
+    }
+
+    mapping->proc = p;
+    mapping->start = zone->start;
+    mapping->next = buf->mappings;
+    buf->mappings = mapping;
+    buf->refs++;
+
+    *start = zone->start;
+#ifdef SHARED_BUFFER_DEBUG
+    log("Buffer %d mapped at %x for %d", buf->id, zone->start, p->pid);
+#endif
+    return 0;
 }
 
+/**
+ * Unmaps pages starting from @from_page in the process of the @mapping,
+ * which could be not the running one.
+ */
+static void _shared_buffer_unmap_pages_locked(shared_buffer_t* buf, shared_buffer_mapping_t* mapping, uint32_t from_page)
+{
+    if (from_page >= buf->pages) {
+        return;
+    }
+
+    pdirectory_t* prev_pdir = vmm_get_active_pdir();
+    vmm_switch_pdir(mapping->proc->pdir);
+    /* A table could be still shared with a forked process, which keeps its pages. */
+    vmm_prepare_active_pdir_for_copying_at(mapping->start + from_page * VMM_PAGE_SIZE, (buf->pages - from_page) * VMM_PAGE_SIZE);
+    for (uint32_t i = from_page; i < buf->pages; i++) {
+        vmm_unmap_page(mapping->start + i * VMM_PAGE_SIZE);
+    }
+    vmm_switch_pdir(prev_pdir);
+}
+
+static void _shared_buffer_unmap_locked(shared_buffer_t* buf, shared_buffer_mapping_t* mapping)
+{
+    _shared_buffer_unmap_pages_locked(buf, mapping, 0);
+
+    proc_zone_t* zone = proc_find_zone(mapping->proc, mapping->start);
+    if (zone) {
+        proc_delete_zone(mapping->proc, zone);
+    }
+
+#ifdef SHARED_BUFFER_DEBUG
+    log("Buffer %d unmapped from %d", buf->id, mapping->proc->pid);
+#endif
+    _shared_buffer_remove_mapping(buf, mapping);
+    _shared_buffer_put_locked(buf);
+}
+
+static bool _shared_buffer_is_granted(shared_buffer_t* buf, pid_t pid)
+{
+    if (buf->owner == pid) {
+        return true;
+    }
+    for (uint32_t i = 0; i < buf->granted.size; i++) {
+        if (*(pid_t*)dynamic_array_get(&buf->granted, i) == pid) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * API
+ */
+
 int shared_buffer_init()
 {
-    _shared_buffer_zone = zoner_new_zone(SHBUF_SPACE_SIZE);
-    _shared_buffer_init_bitmap();
+    lock_init(&shared_buffer_lock);
     return 0;
 }
 
-int shared_buffer_create(uint8_t** res_buffer, size_t size)
+int shared_buffer_create(uint8_t** buffer, size_t size)
 {
-    int buf_id = _shared_buffer_alloc_id();
-    if (buf_id < 0) {
+    if (!size) {
+        return -EINVAL;
+    }
+
+    uint32_t pages = _shared_buffer_pages(size);
+    shared_buffer_t* buf = (shared_buffer_t*)kmalloc(sizeof(shared_buffer_t));
+    if (!buf) {
+        return -ENOMEM;
+    }
+    memset((uint8_t*)buf, 0, sizeof(shared_buffer_t));
+    buf->owner = RUNNING_THREAD->process->pid;
+    buf->size = size;
+    buf->reserved_pages = _shared_buffer_reserve_pages(pages);
+    buf->frames = (uint32_t*)kmalloc(buf->reserved_pages * sizeof(uint32_t));
+    if (!buf->frames || dynamic_array_init(&buf->granted, sizeof(pid_t)) != 0) {
+        kfree(buf->frames);
+        kfree(buf);
         return -ENOMEM;
     }
 
-    size_t act_size = size + sizeof(shared_buffer_header_t);
+    lock_acquire(&shared_buffer_lock);
+    buf->id = _shared_buffer_alloc_id_locked();
+    buf->hash_next = shared_buffer_hashtable[buf->id & (SHBUF_HASH_SIZE - 1)];
+    shared_buffer_hashtable[buf->id & (SHBUF_HASH_SIZE - 1)] = buf;
 
-    int blocks_needed = (act_size + SHBUF_BLOCK_SIZE - 1) / SHBUF_BLOCK_SIZE;
-    int start = bitmap_find_space(bitmap, blocks_needed);
-    if (start < 0) {
-        return -ENOMEM;
+    /* A failed creation is rolled back by taking and dropping a reference,
+       the buffer is destroyed with the last one. */
+    uint32_t start;
+    int err = _shared_buffer_alloc_frames(buf, pages);
+    if (!err) {
+        err = _shared_buffer_map_locked(buf, &start);
+    }
+    if (err) {
+        buf->refs++;
+        _shared_buffer_put_locked(buf);
+        lock_release(&shared_buffer_lock);
+        return err;
     }
 
-    shared_buffer_header_t* space = (shared_buffer_header_t*)_shared_buffer_to_vaddr(start);
-    space->len = act_size;
-    bitmap_set_range(bitmap, start, blocks_needed);
-    vmm_tune_pages((uint32_t)space, act_size, PAGE_WRITABLE | PAGE_EXECUTABLE | PAGE_READABLE | PAGE_USER);
+    int id = buf->id;
+    lock_release(&shared_buffer_lock);
 
-    *res_buffer = (uint8_t*)&space[1];
-    buffers[buf_id] = (uint8_t*)&space[1];
+    /* User memory is touched without the lock, since it could fault. */
+    *buffer = (uint8_t*)start;
 #ifdef SHARED_BUFFER_DEBUG
-    log("Buffer created at %x %d", buffers[buf_id], buf_id);
+    log("Buffer created at %x %d", start, id);
 #endif
-    return buf_id;
+    return id;
 }
 
-int shared_buffer_get(int id, uint8_t** res_buffer)
+int shared_buffer_get(int id, uint8_t** buffer)
 {
-    if (unlikely(id < 0 || SHBUF_MAX_BUFFERS <= id)) {
+    lock_acquire(&shared_buffer_lock);
+    shared_buffer_t* buf = _shared_buffer_find_locked(id);
+    if (unlikely(!buf)) {
+        lock_release(&shared_buffer_lock);
         return -EINVAL;
     }
-    if (unlikely(buffers[id] == 0)) {
+
+    /* A process, which already has a mapping (e.g. inherited by fork), keeps it. */
+    proc_t* p = RUNNING_THREAD->process;
+    if (!_shared_buffer_find_mapping(buf, p) && !_shared_buffer_is_granted(buf, p->pid)) {
+        lock_release(&shared_buffer_lock);
+        return -EPERM;
+    }
+
+    uint32_t start;
+    int err = _shared_buffer_map_locked(buf, &start);
+    lock_release(&shared_buffer_lock);
+    if (!err) {
+        *buffer = (uint8_t*)start;
+    }
+    return err;
+}
+
+/**
+ * shared_buffer_free drops the mapping of the running process. The buffer
+ * itself lives while other processes have it mapped.
+ */
+int shared_buffer_free(int id)
+{
+    lock_acquire(&shared_buffer_lock);
+    shared_buffer_t* buf = _shared_buffer_find_locked(id);
+    if (unlikely(!buf)) {
+        lock_release(&shared_buffer_lock);
         return -EINVAL;
     }
-#ifdef SHARED_BUFFER_DEBUG
-    log("Buffer opened at %x %d", buffers[id], id);
-#endif
-    *res_buffer = buffers[id];
+
+    shared_buffer_mapping_t* mapping = _shared_buffer_find_mapping(buf, RUNNING_THREAD->process);
+    if (unlikely(!mapping)) {
+        lock_release(&shared_buffer_lock);
+        return -EINVAL;
+    }
+
+    _shared_buffer_unmap_locked(buf, mapping);
+    lock_release(&shared_buffer_lock);
     return 0;
 }
 
-int shared_buffer_free(int id)
+int shared_buffer_grant(int id, pid_t pid)
+{
+    lock_acquire(&shared_buffer_lock);
+    shared_buffer_t* buf = _shared_buffer_find_locked(id);
+    if (unlikely(!buf)) {
+        lock_release(&shared_buffer_lock);
+        return -EINVAL;
+    }
+    if (buf->owner != RUNNING_THREAD->process->pid) {
+        lock_release(&shared_buffer_lock);
+        return -EPERM;
+    }
+
+    int err = 0;
+    if (!_shared_buffer_is_granted(buf, pid)) {
+        err = dynamic_array_push(&buf->granted, &pid) ? -ENOMEM : 0;
+    }
+    lock_release(&shared_buffer_lock);
+    return err;
+}
+
+/**
+ * shared_buffer_revoke takes the access back, the buffer is unmapped from
+ * the process if it has been opened there.
+ */
+int shared_buffer_revoke(int id, pid_t pid)
+{
+    lock_acquire(&shared_buffer_lock);
+    shared_buffer_t* buf = _shared_buffer_find_locked(id);
+    if (unlikely(!buf)) {
+        lock_release(&shared_buffer_lock);
+        return -EINVAL;
+    }
+    if (buf->owner != RUNNING_THREAD->process->pid) {
+        lock_release(&shared_buffer_lock);
+        return -EPERM;
+    }
+    if (pid == buf->owner) {
+        lock_release(&shared_buffer_lock);
+        return -EINVAL;
+    }
+
+    for (uint32_t i = 0; i < buf->granted.size; i++) {
+        pid_t* granted = (pid_t*)dynamic_array_get(&buf->granted, i);
+        if (*granted == pid) {
+            *granted = *(pid_t*)dynamic_array_get(&buf->granted, buf->granted.size - 1);
+            dynamic_array_pop(&buf->granted);
+            break;
+        }
+    }
+
+    /* The buffer could be destroyed by the unmap, so the list isn't walked after it. */
+    shared_buffer_mapping_t* mapping = buf->mappings;
+    while (mapping && mapping->proc->pid != pid) {
+        mapping = mapping->next;
+    }
+    if (mapping) {
+        _shared_buffer_unmap_locked(buf, mapping);
+    }
+    lock_release(&shared_buffer_lock);
+    return 0;
+}
+
+/**
+ * shared_buffer_resize changes the size in place, the buffer keeps its
+ * address in every process. New pages are mapped on the first access,
+ * removed pages are unmapped from all processes.
+ */
+int shared_buffer_resize(int id, size_t size)
 {
-    if (unlikely(id < 0 || SHBUF_MAX_BUFFERS <= id)) {
+    if (!size) {
         return -EINVAL;
     }
-    if (unlikely(buffers[id] == 0)) {
+
+    lock_acquire(&shared_buffer_lock);
+    shared_buffer_t* buf = _shared_buffer_find_locked(id);
+    if (unlikely(!buf)) {
+        lock_release(&shared_buffer_lock);
         return -EINVAL;
     }
+    if (buf->owner != RUNNING_THREAD->process->pid) {
+        lock_release(&shared_buffer_lock);
+        return -EPERM;
+    }
 
-    shared_buffer_header_t* sptr = (shared_buffer_header_t*)buffers[id];
-    size_t blocks_to_delete = (sptr[-1].len + SHBUF_BLOCK_SIZE - 1) / SHBUF_BLOCK_SIZE;
-    bitmap_unset_range(bitmap, _shared_buffer_to_index((uint32_t)&sptr[-1]), blocks_to_delete);
-    buffers[id] = 0;
+    uint32_t pages = _shared_buffer_pages(size);
+    if (pages > buf->reserved_pages) {
+        lock_release(&shared_buffer_lock);
+        return -ENOSPC;
+    }
+
+    if (pages > buf->pages) {
+        int err = _shared_buffer_alloc_frames(buf, pages);
+        if (err) {
+            _shared_buffer_free_frames(buf, _shared_buffer_pages(buf->size));
+            lock_release(&shared_buffer_lock);
+            return err;
+        }
+    } else if (pages < buf->pages) {
+        for (shared_buffer_mapping_t* mapping = buf->mappings; mapping; mapping = mapping->next) {
+            _shared_buffer_unmap_pages_locked(buf, mapping, pages);
+        }
+        _shared_buffer_free_frames(buf, pages);
+    }
+
+    buf->size = size;
+    lock_release(&shared_buffer_lock);
     return 0;
-}
\ No newline at end of file
+}
+
+/**
+ * VMM AND TASKING HOOKS
+ */
+
+/**
+ * Returns the frame behind @vaddr inside a shared buffer @zone. vmm maps it
+ * on a fault, when the page has been added by a resize after the buffer was
+ * mapped into the process.
+ */
+int shared_buffer_frame(proc_zone_t* zone, uint32_t vaddr, uint32_t* paddr)
+{
+    lock_acquire(&shared_buffer_lock);
+    shared_buffer_t* buf = zone->shbuf;
+    uint32_t page = (PAGE_START(vaddr) - zone->start) / VMM_PAGE_SIZE;
+    if (page >= buf->pages) {
+        lock_release(&shared_buffer_lock);
+        return -EFAULT;
+    }
+    *paddr = buf->frames[page];
+    lock_release(&shared_buffer_lock);
+    return 0;
+}
+
+/**
+ * A forked process inherits the zone together with the pages, so it
+ * gets its own mapping reference.
+ */
+int shared_buffer_fork_zone(proc_t* new_proc, proc_zone_t* zone)
+{
+    shared_buffer_mapping_t* mapping = (shared_buffer_mapping_t*)kmalloc(sizeof(shared_buffer_mapping_t));
+    if (!mapping) {
+        return -ENOMEM;
+    }
+
+    lock_acquire(&shared_buffer_lock);
+    shared_buffer_t* buf = zone->shbuf;
+    mapping->proc = new_proc;
+    mapping->start = zone->start;
+    mapping->next = buf->mappings;
+    buf->mappings = mapping;
+    buf->refs++;
+    lock_release(&shared_buffer_lock);
+    return 0;
+}
+
+/**
+ * Drops references of shared buffer @zones of @p. Called after the address
+ * space has been freed (on exit or exec), so nothing is unmapped here.
+ */
+void shared_buffer_release_zones(proc_t* p, dynamic_array_t* zones)
+{
+    lock_acquire(&shared_buffer_lock);
+    for (uint32_t i = 0; i < zones->size; i++) {
+        proc_zone_t* zone = (proc_zone_t*)dynamic_array_get(zones, i);
+        if (!(zone->type & ZONE_TYPE_SHARED_BUFFER)) {
+            continue;
+        }
+
+        shared_buffer_t* buf = zone->shbuf;
+        shared_buffer_mapping_t* mapping = _shared_buffer_find_mapping(buf, p);
+        if (mapping) {
+            _shared_buffer_remove_mapping(buf, mapping);
+            _shared_buffer_put_locked(buf);
+        }
+    }
+    lock_release(&shared_buffer_lock);
+}
@@ -31,6 +31,9 @@ static file_ops_t local_socket_ops = {
     .fstat = 0,
     .ioctl = 0,
     .mmap = 0,
+    .readv = local_socket_readv,
+    .writev = local_socket_writev,
+    .wait_queue = local_socket_wait_queue,
 };
 
 int local_socket_create(int type, int protocol, file_descriptor_t* fd)
@@ -38,32 +41,155 @@ int local_socket_create(int type, int protocol, file_descriptor_t* fd)
     return socket_create(PF_LOCAL, type, protocol, fd, &local_socket_ops);
 }
 
+/**
+ * Local sockets are connection-oriented. Each connected socket owns a bounded
+ * buffer of incoming data, and the peer writes straight into it. When the
+ * buffer is full, writers block (or get EAGAIN), so a slow reader throttles
+ * the writer instead of losing data. Data is copied right between the user
+ * memory and the buffer, a bad user pointer results in EFAULT. Every transfer
+ * wakes the other end: written data makes the reader readable and consumed
+ * data makes the writer writable again.
+ */
+
+wait_queue_t* local_socket_wait_queue(dentry_t* dentry)
+{
+    socket_t* sock_entry = (socket_t*)dentry;
+    return &sock_entry->wait_queue;
+}
+
+static inline void _local_socket_wake_peer(socket_t* sock_entry, uint32_t events)
+{
+    if (sock_entry->peer) {
+        wait_queue_wake(&sock_entry->peer->wait_queue, events);
+    }
+}
+
 bool local_socket_can_read(dentry_t* dentry, uint32_t start)
 {
     socket_t* sock_entry = (socket_t*)dentry;
-    return ringbuffer_space_to_read_with_custom_start(&sock_entry->buffer, start) != 0;
+    switch (sock_entry->state) {
+    case SOCKET_LISTENING:
+        return sock_entry->backlog_count != 0;
+    case SOCKET_CONNECTED:
+        return ringbuffer_space_to_read(&sock_entry->buffer) != 0;
+    default:
+        /* Reads return EOF or an error without blocking. */
+        return true;
+    }
 }
 
 int local_socket_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
 {
     socket_t* sock_entry = (socket_t*)dentry;
-    uint32_t read = ringbuffer_read_with_start(&sock_entry->buffer, start, buf, len);
+    if (sock_entry->state == SOCKET_UNCONNECTED || sock_entry->state == SOCKET_LISTENING) {
+        return -ENOTCONN;
+    }
+
+    int read = ringbuffer_read_user(&sock_entry->buffer, buf, len);
+    if (read == 0 && len && sock_entry->state == SOCKET_CONNECTED) {
+        return -EAGAIN;
+    }
+    if (read > 0) {
+        _local_socket_wake_peer(sock_entry, EPOLLOUT);
+    }
     return read;
 }
 
-/* Each process has it's own start when reading from a local socket.
-   We ignore their offsets and write always, hope all readers could
-   read all needed data. */
 bool local_socket_can_write(dentry_t* dentry, uint32_t start)
 {
-    return true;
+    socket_t* sock_entry = (socket_t*)dentry;
+    if (sock_entry->state != SOCKET_CONNECTED) {
+        /* Writes fail without blocking. */
+        return true;
+    }
+    return ringbuffer_space_to_write(&sock_entry->peer->buffer) != 0;
 }
 
 int local_socket_write(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
 {
     socket_t* sock_entry = (socket_t*)dentry;
-    uint32_t written = ringbuffer_write_ignore_bounds(&sock_entry->buffer, buf, len);
-    return 0;
+    if (sock_entry->state == SOCKET_DISCONNECTED) {
+        return -EPIPE;
+    }
+    if (sock_entry->state != SOCKET_CONNECTED) {
+        return -ENOTCONN;
+    }
+
+    int written = ringbuffer_write_user(&sock_entry->peer->buffer, buf, len);
+    if (written == 0 && len) {
+        return -EAGAIN;
+    }
+    if (written > 0) {
+        _local_socket_wake_peer(sock_entry, EPOLLIN);
+    }
+    return written;
+}
+
+/**
+ * Vectored transfers check the connection once and move all iovecs through
+ * the buffer in one call, so a message and its header reach the peer together.
+ */
+int local_socket_readv(dentry_t* dentry, const iovec_t* iov, int iovcnt, uint32_t start)
+{
+    socket_t* sock_entry = (socket_t*)dentry;
+    if (sock_entry->state == SOCKET_UNCONNECTED || sock_entry->state == SOCKET_LISTENING) {
+        return -ENOTCONN;
+    }
+
+    uint32_t read = 0;
+    uint32_t len = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        int chunk = ringbuffer_read_user(&sock_entry->buffer, (uint8_t*)iov[i].iov_base, iov[i].iov_len);
+        if (chunk < 0) {
+            return read ? read : chunk;
+        }
+        read += chunk;
+        len += iov[i].iov_len;
+        if ((uint32_t)chunk < iov[i].iov_len) {
+            break;
+        }
+    }
+
+    if (read == 0 && len && sock_entry->state == SOCKET_CONNECTED) {
+        return -EAGAIN;
+    }
+    if (read) {
+        _local_socket_wake_peer(sock_entry, EPOLLOUT);
+    }
+    return read;
+}
+
+int local_socket_writev(dentry_t* dentry, const iovec_t* iov, int iovcnt, uint32_t start)
+{
+    socket_t* sock_entry = (socket_t*)dentry;
+    if (sock_entry->state == SOCKET_DISCONNECTED) {
+        return -EPIPE;
+    }
+    if (sock_entry->state != SOCKET_CONNECTED) {
+        return -ENOTCONN;
+    }
+
+    uint32_t written = 0;
+    uint32_t len = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        int chunk = ringbuffer_write_user(&sock_entry->peer->buffer, (const uint8_t*)iov[i].iov_base, iov[i].iov_len);
+        if (chunk < 0) {
+            return written ? written : chunk;
+        }
+        written += chunk;
+        len += iov[i].iov_len;
+        if ((uint32_t)chunk < iov[i].iov_len) {
+            break;
+        }
+    }
+
+    if (written == 0 && len) {
+        return -EAGAIN;
+    }
+    if (written) {
+        _local_socket_wake_peer(sock_entry, EPOLLIN);
+    }
+    return written;
 }
 
 int local_socket_bind(file_descriptor_t* sock, char* path, uint32_t len)
@@ -93,6 +219,7 @@ int local_socket_bind(file_descriptor_t* sock, char* path, uint32_t len)
     dentry_put(location);
 
     res = vfs_open(bind_dentry, &sock->sock_entry->bind_file, O_RDONLY);
+    dentry_put(bind_dentry);
     if (res < 0) {
 #ifdef LOCAL_SOCKET_DEBUG
         log_error("Bind: can't open file [%d] : %d pid\n", -res, p->pid);
@@ -102,14 +229,35 @@ int local_socket_bind(file_descriptor_t* sock, char* path, uint32_t len)
 #ifdef LOCAL_SOCKET_DEBUG
     log("Bind local socket at %x : %d pid", sock->sock_entry, p->pid);
 #endif
-    sock->sock_entry->bind_file.dentry->sock = socket_duplicate(sock->sock_entry);
+    /* The link is dropped, when the socket is freed, so connecting to a path
+       left by a dead server fails instead of waiting forever. */
+    sock->sock_entry->bind_file.dentry->sock = sock->sock_entry;
     vfs_helper_restore_full_path_after_split(path, name);
     return 0;
 }
 
+int local_socket_listen(file_descriptor_t* sock, int backlog)
+{
+    socket_t* sock_entry = sock->sock_entry;
+    if (!sock_entry->bind_file.dentry) {
+        return -EINVAL;
+    }
+    if (sock_entry->state != SOCKET_UNCONNECTED && sock_entry->state != SOCKET_LISTENING) {
+        return -EISCONN;
+    }
+
+    sock_entry->state = SOCKET_LISTENING;
+    sock_entry->backlog_limit = max(1, min(backlog, (int)SOCKET_MAX_BACKLOG));
+    return 0;
+}
+
 int local_socket_connect(file_descriptor_t* sock, char* path, uint32_t len)
 {
     proc_t* p = RUNNING_THREAD->process;
+    socket_t* sock_entry = sock->sock_entry;
+    if (sock_entry->state != SOCKET_UNCONNECTED) {
+        return -EISCONN;
+    }
 
     dentry_t* bind_dentry;
     int res = vfs_resolve_path_start_from(p->cwd, path, &bind_dentry);
@@ -123,16 +271,69 @@ int local_socket_connect(file_descriptor_t* sock, char* path, uint32_t len)
 #ifdef LOCAL_SOCKET_DEBUG
         log_error("Connect: file not a socket : %d pid\n", p->pid);
 #endif
+        dentry_put(bind_dentry);
         return -ENOTSOCK;
     }
 
-    if (!bind_dentry->sock) {
-        return -EBADF;
+    socket_t* listener = bind_dentry->sock;
+    dentry_put(bind_dentry);
+    if (!listener || listener->state != SOCKET_LISTENING) {
+        return -ECONNREFUSED;
+    }
+    if (listener->backlog_count >= listener->backlog_limit) {
+        return -EAGAIN;
+    }
+
+    socket_t* server_entry = socket_alloc(listener->domain, listener->type, listener->protocol);
+    if (!server_entry) {
+        return -ENOMEM;
     }
-    sock->sock_entry = socket_duplicate(bind_dentry->sock);
-    sock->offset = bind_dentry->sock->buffer.end; /* Starting to read from the end */
+
+    res = socket_connect_pair(sock_entry, server_entry);
+    if (res < 0) {
+        socket_put(server_entry);
+        return res;
+    }
+
+    /* The backlog owns the reference to the server end till it's accepted. */
+    if (listener->backlog_tail) {
+        listener->backlog_tail->backlog_next = server_entry;
+    } else {
+        listener->backlog_head = server_entry;
+    }
+    listener->backlog_tail = server_entry;
+    listener->backlog_count++;
+    wait_queue_wake(&listener->wait_queue, EPOLLIN);
+
 #ifdef LOCAL_SOCKET_DEBUG
-    log("Connected to local socket at %x : %d pid", bind_dentry->sock, p->pid);
+    log("Connected to local socket at %x : %d pid", listener, p->pid);
 #endif
     return 0;
-}
\ No newline at end of file
+}
+
+int local_socket_accept(file_descriptor_t* sock, file_descriptor_t* new_fd)
+{
+    socket_t* listener = sock->sock_entry;
+    if (listener->state != SOCKET_LISTENING) {
+        return -EINVAL;
+    }
+
+    socket_t* server_entry = listener->backlog_head;
+    if (!server_entry) {
+        return -EAGAIN;
+    }
+
+    listener->backlog_head = server_entry->backlog_next;
+    if (!listener->backlog_head) {
+        listener->backlog_tail = NULL;
+    }
+    listener->backlog_count--;
+    server_entry->backlog_next = NULL;
+
+    new_fd->type = FD_TYPE_SOCKET;
+    new_fd->sock_entry = server_entry;
+    new_fd->ops = &local_socket_ops;
+    new_fd->offset = 0;
+    new_fd->flags = 0;
+    return 0;
+}
@@ -6,29 +6,64 @@
  */
 
 #include <io/sockets/socket.h>
+#include <libkern/bits/errno.h>
 #include <libkern/kassert.h>
+#include <libkern/libkern.h>
+#include <mem/kmalloc.h>
+#include <mem/vmm/vmm.h>
 
-socket_t socket_list[MAX_SOCKET_COUNT];
-static int next_socket = 0;
-
-static socket_t* _socket_create(int domain, int type, int protocol)
+socket_t* socket_alloc(int domain, int type, int protocol)
 {
-    socket_list[next_socket].domain = domain;
-    socket_list[next_socket].type = type;
-    socket_list[next_socket].protocol = protocol;
-    socket_list[next_socket].buffer = ringbuffer_create_std();
-    socket_list[next_socket].d_count = 1;
-    return &socket_list[next_socket++];
+    socket_t* sock = (socket_t*)kmalloc(sizeof(socket_t));
+    if (!sock) {
+        return NULL;
+    }
+    memset((uint8_t*)sock, 0, sizeof(socket_t));
+    sock->domain = domain;
+    sock->type = type;
+    sock->protocol = protocol;
+    sock->state = SOCKET_UNCONNECTED;
+    sock->d_count = 1;
+    return sock;
 }
 
 int socket_create(int domain, int type, int protocol, file_descriptor_t* fd, file_ops_t* ops)
 {
+    socket_t* sock = socket_alloc(domain, type & SOCK_TYPE_MASK, protocol);
+    if (!sock) {
+        return -ENOMEM;
+    }
+
     fd->type = FD_TYPE_SOCKET;
-    fd->sock_entry = _socket_create(domain, type, protocol);
+    fd->sock_entry = sock;
     fd->ops = ops;
-    if (!fd->sock_entry) {
-        return -1;
+    fd->offset = 0;
+    fd->flags = (type & SOCK_NONBLOCK) ? O_NONBLOCK : 0;
+    return 0;
+}
+
+/**
+ * socket_connect_pair allocates the incoming buffers of both ends and
+ * links them to each other.
+ */
+int socket_connect_pair(socket_t* sock, socket_t* peer)
+{
+    sock->buffer = ringbuffer_create(SOCKET_BUFFER_SIZE);
+    if (!sock->buffer.zone.start) {
+        return -ENOMEM;
     }
+
+    peer->buffer = ringbuffer_create(SOCKET_BUFFER_SIZE);
+    if (!peer->buffer.zone.start) {
+        ringbuffer_free(&sock->buffer);
+        sock->buffer.zone.start = 0;
+        return -ENOMEM;
+    }
+
+    sock->peer = peer;
+    sock->state = SOCKET_CONNECTED;
+    peer->peer = sock;
+    peer->state = SOCKET_CONNECTED;
     return 0;
 }
 
@@ -38,12 +73,44 @@ socket_t* socket_duplicate(socket_t* sock)
     return sock;
 }
 
+static void _socket_free(socket_t* sock)
+{
+    /* The peer keeps the data it has already got, and reads EOF after it. */
+    if (sock->peer) {
+        sock->peer->peer = NULL;
+        sock->peer->state = SOCKET_DISCONNECTED;
+        wait_queue_wake(&sock->peer->wait_queue, EPOLLIN | EPOLLOUT);
+        sock->peer = NULL;
+    }
+
+    /* Epoll instances still watching the socket drop it. */
+    wait_queue_release(&sock->wait_queue);
+
+    while (sock->backlog_head) {
+        socket_t* pending = sock->backlog_head;
+        sock->backlog_head = pending->backlog_next;
+        socket_put(pending);
+    }
+
+    if (sock->buffer.zone.start) {
+        ringbuffer_free(&sock->buffer);
+    }
+
+    if (sock->bind_file.dentry) {
+        if (sock->bind_file.dentry->sock == sock) {
+            sock->bind_file.dentry->sock = NULL;
+        }
+        vfs_close(&sock->bind_file);
+    }
+    kfree(sock);
+}
+
 int socket_put(socket_t* sock)
 {
-    sock->d_count--;
     ASSERT(sock->d_count > 0);
+    sock->d_count--;
     if (sock->d_count == 0) {
-        ringbuffer_free(&sock->buffer);
+        _socket_free(sock);
     }
     return 0;
-}
\ No newline at end of file
+}
@@ -11,6 +11,7 @@
 #include <libkern/bits/errno.h>
 #include <libkern/libkern.h>
 #include <libkern/log.h>
+#include <time/time_manager.h>
 
 #define INODE2PTSNO(x) (x - 1)
 #define PTSNO2INODE(x) (x + 1)
@@ -28,6 +29,7 @@ bool pty_master_can_write(dentry_t* dentry, uint32_t start);
 int pty_master_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len);
 int pty_master_write(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len);
 int pty_master_fstat(dentry_t* dentry, fstat_t* stat);
+int pty_master_ioctl(dentry_t* dentry, uint32_t cmd, uint32_t arg);
 
 static fs_ops_t pty_master_ops = {
     .recognize = 0,
@@ -53,7 +55,7 @@ static fs_ops_t pty_master_ops = {
         .mkdir = 0,
         .rmdir = 0,
         .fstat = pty_master_fstat,
-        .ioctl = 0,
+        .ioctl = pty_master_ioctl,
         .mmap = 0,
     }
 };
@@ -72,42 +74,131 @@ int _pty_master_free_dentry_data(dentry_t* dentry)
 {
     pty_master_entry_t* ptm = _ptm_get(dentry);
     ASSERT(ptm);
+    ringbuffer_free(&ptm->buffer);
     ptm->dentry.inode_indx = 0;
     return 0;
 }
 
+/**
+ * The master is usually read by a terminal, which redraws after every read.
+ * Waking it up for each byte the program writes costs a redraw per byte, so
+ * the data is held till read_min bytes come or the oldest of them waits for
+ * read_time ticks. A full buffer is always readable, otherwise a program
+ * writing less than read_min bytes would wait for the terminal forever.
+ */
 bool pty_master_can_read(dentry_t* dentry, uint32_t start)
 {
     pty_master_entry_t* ptm = _ptm_get(dentry);
     ASSERT(ptm);
-    return ringbuffer_space_to_read(&ptm->buffer) >= 1;
+    uint32_t avail = ringbuffer_space_to_read(&ptm->buffer);
+    if (!avail) {
+        return false;
+    }
+    if (avail >= ptm->read_min || !ringbuffer_space_to_write(&ptm->buffer)) {
+        return true;
+    }
+    return timeman_ticks_since_boot() - ptm->pending_since >= ptm->read_time;
 }
 
 bool pty_master_can_write(dentry_t* dentry, uint32_t start)
 {
     pty_master_entry_t* ptm = _ptm_get(dentry);
     ASSERT(ptm);
-    return ringbuffer_space_to_write(&ptm->pts->buffer) >= 0;
+    return ringbuffer_space_to_write(&ptm->pts->buffer) > 0;
 }
 
 int pty_master_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
 {
     pty_master_entry_t* ptm = _ptm_get(dentry);
     ASSERT(ptm);
-    uint32_t leno = ringbuffer_space_to_read(&ptm->buffer);
-    if (leno > len) {
-        leno = len;
-    }
-    int res = ringbuffer_read(&ptm->buffer, buf, leno);
-    return leno;
+    return ringbuffer_read(&ptm->buffer, buf, len);
 }
 
 int pty_master_write(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
 {
     pty_master_entry_t* ptm = _ptm_get(dentry);
     ASSERT(ptm);
-    ringbuffer_write(&ptm->pts->buffer, buf, len);
-    return len;
+    uint32_t written = ringbuffer_write(&ptm->pts->buffer, buf, len);
+    if (!written && len) {
+        return -EAGAIN;
+    }
+    return written;
+}
+
+/**
+ * Called by the slave to pass the output of a program to the master. Takes
+ * only what fits, the caller waits for the rest.
+ */
+int pty_master_push(pty_master_entry_t* ptm, const uint8_t* buf, uint32_t len)
+{
+    if (!ringbuffer_space_to_read(&ptm->buffer)) {
+        ptm->pending_since = timeman_ticks_since_boot();
+    }
+    return ringbuffer_write(&ptm->buffer, buf, len);
+}
+
+static void _pty_move_ring(ringbuffer_t* buf, ringbuffer_t* new_buf)
+{
+    new_buf->end = ringbuffer_read(buf, new_buf->zone.ptr, ringbuffer_space_to_read(buf));
+    ringbuffer_free(buf);
+    *buf = *new_buf;
+}
+
+/**
+ * Moves the data of the master and the slave rings to new rings of @size
+ * bytes. Both new rings are allocated before any is swapped, so on failure
+ * the rings keep their old sizes.
+ */
+int pty_resize_rings(pty_master_entry_t* ptm, uint32_t size)
+{
+    if (size < PTY_BUFFER_MIN_SIZE || size > PTY_BUFFER_MAX_SIZE) {
+        return -EINVAL;
+    }
+
+    ringbuffer_t* master_buf = &ptm->buffer;
+    ringbuffer_t* slave_buf = &ptm->pts->buffer;
+    if (ringbuffer_space_to_read(master_buf) >= size || ringbuffer_space_to_read(slave_buf) >= size) {
+        return -EBUSY;
+    }
+
+    ringbuffer_t new_master_buf = ringbuffer_create(size);
+    if (!new_master_buf.zone.start) {
+        return -ENOMEM;
+    }
+    ringbuffer_t new_slave_buf = ringbuffer_create(size);
+    if (!new_slave_buf.zone.start) {
+        ringbuffer_free(&new_master_buf);
+        return -ENOMEM;
+    }
+
+    _pty_move_ring(master_buf, &new_master_buf);
+    _pty_move_ring(slave_buf, &new_slave_buf);
+    return 0;
+}
+
+static time_t _pty_ms_to_ticks(uint32_t ms)
+{
+    time_t tps = timeman_ticks_per_second();
+    return (ms / 1000) * tps + ((ms % 1000) * tps + 999) / 1000;
+}
+
+int pty_master_ioctl(dentry_t* dentry, uint32_t cmd, uint32_t arg)
+{
+    pty_master_entry_t* ptm = _ptm_get(dentry);
+    ASSERT(ptm);
+
+    switch (cmd) {
+    case TIOCSPTYBUF:
+        return pty_resize_rings(ptm, arg);
+    case TIOCSPTYMIN:
+        ptm->read_min = max(arg, 1u);
+        return 0;
+    case TIOCSPTYTIME:
+        ptm->read_time = _pty_ms_to_ticks(arg);
+        return 0;
+    }
+
+    return -EINVAL;
 }
 
 int pty_master_fstat(dentry_t* dentry, fstat_t* stat)
@@ -151,8 +242,15 @@ int pty_master_alloc(file_descriptor_t* fd)
     fd->offset = 0;
     fd->type = FD_TYPE_FILE;
 
+    ptm->buffer = ringbuffer_create(PTY_BUFFER_STD_SIZE);
+    if (!ptm->buffer.zone.start) {
+        ptm->dentry.inode_indx = 0;
+        return -ENOMEM;
+    }
+    ptm->read_min = 1;
+    ptm->read_time = 0;
+    ptm->pending_since = 0;
     pty_slave_create(INODE2PTSNO(ptm->dentry.inode_indx), ptm);
-    ptm->buffer = ringbuffer_create_std();
 
     return 0;
 }
\ No newline at end of file
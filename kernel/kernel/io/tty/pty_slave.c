@@ -8,6 +8,7 @@
 #include <fs/devfs/devfs.h>
 #include <io/tty/pty_master.h>
 #include <io/tty/pty_slave.h>
+#include <libkern/bits/errno.h>
 #include <libkern/libkern.h>
 #include <libkern/log.h>
 
@@ -30,31 +31,38 @@ bool pty_slave_can_read(dentry_t* dentry, uint32_t start)
     return ringbuffer_space_to_read(&pts->buffer) >= 1;
 }
 
+/* Once the master is closed, nobody drains its buffer, so writes fail at once. */
+static inline bool _pts_master_closed(pty_slave_entry_t* pts)
+{
+    return !pts->ptm->dentry.inode_indx;
+}
+
 bool pty_slave_can_write(dentry_t* dentry, uint32_t start)
 {
     pty_slave_entry_t* pts = _pts_get(dentry);
     ASSERT(pts);
-    return ringbuffer_space_to_write(&pts->ptm->buffer) >= 0;
+    return _pts_master_closed(pts) || ringbuffer_space_to_write(&pts->ptm->buffer) > 0;
 }
 
 int pty_slave_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
 {
     pty_slave_entry_t* pts = _pts_get(dentry);
     ASSERT(pts);
-    uint32_t leno = ringbuffer_space_to_read(&pts->buffer);
-    if (leno > len) {
-        leno = len;
-    }
-    int res = ringbuffer_read(&pts->buffer, buf, leno);
-    return leno;
+    return ringbuffer_read(&pts->buffer, buf, len);
 }
 
 int pty_slave_write(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
 {
     pty_slave_entry_t* pts = _pts_get(dentry);
     ASSERT(pts);
-    ringbuffer_write(&pts->ptm->buffer, buf, len);
-    return len;
+    if (_pts_master_closed(pts)) {
+        return -EIO;
+    }
+    int written = pty_master_push(pts->ptm, buf, len);
+    if (!written && len) {
+        return -EAGAIN;
+    }
+    return written;
 }
 
 int pty_slave_ioctl(dentry_t* dentry, uint32_t cmd, uint32_t arg)
@@ -84,11 +92,16 @@ int pty_slave_create(int id, pty_master_entry_t* ptm)
         devfs_inode_t* res = devfs_register(mp, MKDEV(136, id), name, 4, 0, &fops);
         pty_slaves[id].inode_indx = res->index;
         pty_slaves[id].ptm = ptm;
-        pty_slaves[id].buffer = ringbuffer_create_std();
+        pty_slaves[id].buffer = ringbuffer_create(PTY_BUFFER_STD_SIZE);
         ASSERT(pty_slaves[id].buffer.zone.start);
         ptm->pts = &pty_slaves[id];
+    } else if (pty_slaves[id].buffer.zone.len != PTY_BUFFER_STD_SIZE) {
+        /* The previous master resized the ring. */
+        ringbuffer_free(&pty_slaves[id].buffer);
+        pty_slaves[id].buffer = ringbuffer_create(PTY_BUFFER_STD_SIZE);
+        ASSERT(pty_slaves[id].buffer.zone.start);
     } else {
-        pty_slaves[id].buffer.start = pty_slaves[id].buffer.end = 0;
+        ringbuffer_clear(&pty_slaves[id].buffer);
     }
 
     dentry_put(mp);
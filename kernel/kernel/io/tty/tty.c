@@ -72,31 +72,38 @@ int tty_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
     return leno;
 }
 
-int _tty_process_esc_seq(uint8_t* buf)
+/**
+ * Returns the length of the escape sequence at @buf, if it's handled here,
+ * or 0 to pass it to the console as is. Never looks past @len.
+ */
+static uint32_t _tty_process_esc_seq(uint8_t* buf, uint32_t len)
 {
-    if (buf[0] != '\x1b') {
-        return 0;
-    }
     int argv[4] = { 0, 0, 0, 0 };
-    int id = 1;
+    uint32_t id = 1;
     int argc = 0;
 
-    if (buf[id] == '[') {
+    if (id < len && buf[id] == '[') {
         id++;
         for (;;) {
-            int len = 0;
-            while ('0' <= buf[id + len] && buf[id + len] <= '9') {
-                len++;
+            uint32_t num = 0;
+            while (id + num < len && '0' <= buf[id + num] && buf[id + num] <= '9') {
+                num++;
+            }
+            if (argc < 4) {
+                argv[argc++] = stoi(&buf[id], num);
             }
-            argv[argc++] = stoi(&buf[id], len);
-            id += len;
-            if (buf[id] != ';') {
+            id += num;
+            if (id >= len || buf[id] != ';') {
                 break;
             }
             id++;
         }
     }
 
+    if (id >= len) {
+        return 0;
+    }
+
     char cmd = buf[id];
     id++;
     switch (cmd) {
@@ -129,14 +136,22 @@ int tty_write(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
     time_t ticks = timeman_get_ticks_from_last_second();
     log_not_formatted("[%d:%d:%d.%d] ", hrs, mins, secs, ticks);
 #endif
-    for (int i = 0; i < len; i++) {
+    /* Text between handled escape sequences goes to the console in one run. */
+    uint32_t run = 0;
+    for (uint32_t i = 0; i < len;) {
+        uint32_t seq = 0;
         if (buf[i] == '\x1b') {
-            i += _tty_process_esc_seq(&buf[i]);
-        } else {
-            log_not_formatted("%c", buf[i]);
-            // print_char(buf[i], WHITE_ON_BLACK, -1, -1);
+            seq = _tty_process_esc_seq(&buf[i], len - i);
+        }
+        if (!seq) {
+            i++;
+            continue;
         }
+        log_write((char*)&buf[run], i - run);
+        i += seq;
+        run = i;
     }
+    log_write((char*)&buf[run], len - run);
 
     return len;
 }
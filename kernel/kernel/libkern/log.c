@@ -367,6 +367,15 @@ int log_not_formatted(const char* format, ...)
     return ret;
 }
 
+/* Passes @buf as is, without going through the formatter for every char. */
+int log_write(const char* buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        uart_write(COM1, buf[i]);
+    }
+    return len;
+}
+
 void logger_setup()
 {
     uart_setup(COM1);
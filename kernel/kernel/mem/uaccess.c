@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2020-2021 Nikita Melekhin. All rights reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <libkern/bits/errno.h>
+#include <libkern/libkern.h>
+#include <mem/uaccess.h>
+#include <mem/vmm/vmm.h>
+#include <tasking/tasking.h>
+
+extern uaccess_ex_entry_t uaccess_ex_table[];
+extern uaccess_ex_entry_t uaccess_ex_table_end[];
+
+static inline bool _uaccess_range_ok(uint32_t addr, uint32_t len)
+{
+    return addr + len >= addr && addr + len <= KERNEL_BASE;
+}
+
+/**
+ * Checks that the range is covered by zones of the running process,
+ * writable ones for @access UACCESS_WRITE.
+ */
+static bool _uaccess_zones_ok(uint32_t addr, uint32_t len, int access)
+{
+    proc_t* p = RUNNING_THREAD->process;
+    uint32_t end = addr + len;
+    while (addr < end) {
+        proc_zone_t* zone = proc_find_zone(p, addr);
+        if (!zone) {
+            return false;
+        }
+        if ((access & UACCESS_WRITE) && !(zone->flags & ZONE_WRITABLE)) {
+            return false;
+        }
+        addr = zone->start + zone->len;
+    }
+    return true;
+}
+
+int copy_from_user(void* dest, const void* src, uint32_t len)
+{
+    if (!_uaccess_range_ok((uint32_t)src, len)) {
+        return -EFAULT;
+    }
+    if (uaccess_copy(dest, src, len)) {
+        return -EFAULT;
+    }
+    return 0;
+}
+
+/**
+ * Kernel writes don't fault on read-only user pages and don't trigger
+ * copy-on-write faults, so the destination is checked to be writable and
+ * its COW pages are resolved before copying.
+ */
+int copy_to_user(void* dest, const void* src, uint32_t len)
+{
+    if (!_uaccess_range_ok((uint32_t)dest, len) || !_uaccess_zones_ok((uint32_t)dest, len, UACCESS_WRITE)) {
+        return -EFAULT;
+    }
+    vmm_prepare_active_pdir_for_copying_at((uint32_t)dest, len);
+    if (uaccess_copy(dest, src, len)) {
+        return -EFAULT;
+    }
+    return 0;
+}
+
+/**
+ * Buffers of read and write-like calls are passed to drivers as is, to not
+ * be copied twice. Drivers can't recover from faults, so such buffers have
+ * to be covered by zones of the process, writable ones for @access
+ * UACCESS_WRITE, before they are used.
+ */
+int uaccess_check(const void* ptr, uint32_t len, int access)
+{
+    uint32_t addr = (uint32_t)ptr;
+    if (!_uaccess_range_ok(addr, len) || !_uaccess_zones_ok(addr, len, access)) {
+        return -EFAULT;
+    }
+
+    if (access & UACCESS_WRITE) {
+        vmm_prepare_active_pdir_for_copying_at((uint32_t)ptr, len);
+    }
+    return 0;
+}
+
+/**
+ * Called by page fault handlers for faults, which can't be resolved.
+ * Returns true, if the fault happened in uaccess_copy, which will return
+ * an error then instead of crashing.
+ */
+bool uaccess_fixup(trapframe_t* tf)
+{
+    uint32_t ip = get_instruction_pointer(tf);
+    for (uaccess_ex_entry_t* entry = uaccess_ex_table; entry < uaccess_ex_table_end; entry++) {
+        if (entry->insn == ip) {
+            set_instruction_pointer(tf, entry->fixup);
+            return true;
+        }
+    }
+    return false;
+}
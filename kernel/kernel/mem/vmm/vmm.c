@@ -5,11 +5,13 @@
  * found in the LICENSE file.
  */
 
+#include <io/shared_buffer/shared_buffer.h>
 #include <libkern/bits/errno.h>
 #include <libkern/libkern.h>
 #include <libkern/lock.h>
 #include <libkern/log.h>
 #include <mem/kmalloc.h>
+#include <mem/uaccess.h>
 #include <mem/vmm/vmm.h>
 #include <mem/vmm/zoner.h>
 #include <platform/generic/cpu.h>
@@ -872,6 +874,17 @@ static int _vmm_load_page_with_perm(uint32_t vaddr)
             return SHOULD_CRASH;
         }
 
+        /* Pages of shared buffers are owned by them, they are not allocated here. */
+        if (zone->type & ZONE_TYPE_SHARED_BUFFER) {
+            uint32_t paddr;
+            if (shared_buffer_frame(zone, vaddr, &paddr) < 0) {
+                return SHOULD_CRASH;
+            }
+            _vmm_ensure_cow_for_page(vaddr);
+            vmm_map_page_lockless(PAGE_START(vaddr), paddr, zone->flags);
+            return OK;
+        }
+
 #ifdef VMM_DEBUG
         log("Mmap[ensure_write_to] page %x for %d pid: %x", vaddr, RUNNING_THREAD->process->pid, zone->flags);
 #endif
@@ -919,7 +932,7 @@ static int _vmm_copy_page_to_resolve_cow(proc_t* p, uint32_t vaddr, ptable_t* sr
         return SHOULD_CRASH;
     }
 
-    if ((zone->type & ZONE_TYPE_MAPPED_FILE_SHAREDLY)) {
+    if ((zone->type & ZONE_TYPE_MAPPED_FILE_SHAREDLY) || (zone->type & ZONE_TYPE_SHARED_BUFFER)) {
         uint32_t old_page_paddr = page_desc_get_frame(*old_page_desc);
         return vmm_map_page_lockless(vaddr, old_page_paddr, zone->flags);
     }
@@ -1109,7 +1122,7 @@ void vmm_prepare_active_pdir_for_copying_at(uint32_t dest_vaddr, uint32_t length
 static ALWAYS_INLINE void vmm_copy_to_user_lockless(void* dest, void* src, uint32_t length)
 {
     _vmm_ensure_cow_for_range((uint32_t)dest, length);
-    memcpy(dest, src, length);
+    uaccess_copy(dest, src, length);
 }
 
 void vmm_copy_to_user(void* dest, void* src, uint32_t length)
@@ -1117,7 +1130,7 @@ void vmm_copy_to_user(void* dest, void* src, uint32_t length)
     lock_acquire(&_vmm_lock);
     _vmm_ensure_cow_for_range((uint32_t)dest, length);
     lock_release(&_vmm_lock);
-    memcpy(dest, src, length);
+    uaccess_copy(dest, src, length);
 }
 
 static ALWAYS_INLINE void vmm_copy_to_pdir_lockless(pdirectory_t* pdir, void* src, uint32_t dest_vaddr, uint32_t length)
@@ -1323,7 +1336,7 @@ static ALWAYS_INLINE int vmm_free_page_lockless(uint32_t vaddr, page_desc_t* pag
 
     proc_zone_t* zone = proc_find_zone_no_proc(zones, vaddr);
     if (zone) {
-        if (zone->type & ZONE_TYPE_DEVICE) {
+        if ((zone->type & ZONE_TYPE_DEVICE) || (zone->type & ZONE_TYPE_SHARED_BUFFER)) {
             return 0;
         }
     }
@@ -8,6 +8,7 @@
 #include <drivers/aarch32/gicv2.h>
 #include <libkern/libkern.h>
 #include <libkern/log.h>
+#include <mem/uaccess.h>
 #include <mem/vmm/vmm.h>
 #include <platform/aarch32/interrupts.h>
 #include <platform/aarch32/system.h>
@@ -99,7 +100,10 @@ void data_abort_handler(trapframe_t* tf)
     uint32_t info = read_dfsr();
     uint32_t is_pl0 = read_spsr() & 0xf; // See CPSR M field values
     info |= ((is_pl0 != 0) << 31); // Set the 31bit as type
-    vmm_page_fault_handler(info, fault_addr);
+    int res = vmm_page_fault_handler(info, fault_addr);
+    if (res == SHOULD_CRASH) {
+        uaccess_fixup(tf);
+    }
     cpu_leave_kernel_space();
     system_enable_interrupts_only_counter();
 }
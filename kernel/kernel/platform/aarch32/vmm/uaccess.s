@@ -0,0 +1,55 @@
+.global uaccess_copy
+.global uaccess_ex_table
+.global uaccess_ex_table_end
+
+// uint32_t uaccess_copy(void* dest, const void* src, uint32_t len)
+// Copies 32-byte blocks with ldm/stm when both pointers are word aligned,
+// then words and the tail bytes. Aborted loads and stores leave the base
+// register as it was, so r2 holds the number of not copied bytes.
+uaccess_copy:
+    stmfd   sp!, {r4-r10}
+    orr     r3, r0, r1
+    tst     r3, #3
+    bne     uaccess_copy_bytes
+uaccess_copy_blocks:
+    cmp     r2, #32
+    blo     uaccess_copy_words
+uaccess_copy_block_ld:
+    ldmia   r1!, {r3-r10}
+uaccess_copy_block_st:
+    stmia   r0!, {r3-r10}
+    sub     r2, r2, #32
+    b       uaccess_copy_blocks
+uaccess_copy_words:
+    cmp     r2, #4
+    blo     uaccess_copy_bytes
+uaccess_copy_word_ld:
+    ldr     r3, [r1], #4
+uaccess_copy_word_st:
+    str     r3, [r0], #4
+    sub     r2, r2, #4
+    b       uaccess_copy_words
+uaccess_copy_bytes:
+    cmp     r2, #0
+    beq     uaccess_copy_done
+uaccess_copy_byte_ld:
+    ldrb    r3, [r1], #1
+uaccess_copy_byte_st:
+    strb    r3, [r0], #1
+    sub     r2, r2, #1
+    b       uaccess_copy_bytes
+uaccess_copy_done:
+    mov     r0, r2
+    ldmfd   sp!, {r4-r10}
+    bx      lr
+
+.section .rodata
+// Pairs of a faulting instruction and the code to continue from.
+uaccess_ex_table:
+    .word   uaccess_copy_block_ld, uaccess_copy_done
+    .word   uaccess_copy_block_st, uaccess_copy_done
+    .word   uaccess_copy_word_ld, uaccess_copy_done
+    .word   uaccess_copy_word_st, uaccess_copy_done
+    .word   uaccess_copy_byte_ld, uaccess_copy_done
+    .word   uaccess_copy_byte_st, uaccess_copy_done
+uaccess_ex_table_end:
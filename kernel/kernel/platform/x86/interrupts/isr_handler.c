@@ -8,6 +8,7 @@
 #include <drivers/x86/fpu.h>
 #include <libkern/kassert.h>
 #include <libkern/log.h>
+#include <mem/uaccess.h>
 #include <mem/vmm/vmm.h>
 #include <platform/generic/registers.h>
 #include <platform/generic/system.h>
@@ -122,7 +123,7 @@ void isr_handler(trapframe_t* tf)
         system_stop();
     } else if (tf->int_no == 14) {
         int res = vmm_page_fault_handler(tf->err, read_cr2());
-        if (res == SHOULD_CRASH) {
+        if (res == SHOULD_CRASH && !uaccess_fixup(tf)) {
             if (!p) {
                 snprintf(err_buf, ERR_BUF_SIZE, "Kernel trap at %x, type %d=%s", tf->eip, tf->int_no, &exception_messages[tf->int_no]);
                 kpanic_tf(err_buf, tf);
@@ -0,0 +1,44 @@
+global uaccess_copy
+global uaccess_ex_table
+global uaccess_ex_table_end
+
+; uint32_t uaccess_copy(void* dest, const void* src, uint32_t len)
+; Copies dwords and then the tail bytes. A fault inside a rep movs leaves
+; ecx with what is left, so the fixups return the number of not copied bytes.
+uaccess_copy:
+    push edi
+    push esi
+    mov edi, [esp+12] ; dest
+    mov esi, [esp+16] ; src
+    mov ecx, [esp+20] ; len
+    mov edx, ecx
+    and edx, 3
+    shr ecx, 2
+.copy_dwords:
+    rep movsd
+    mov ecx, edx
+.copy_bytes:
+    rep movsb
+    xor eax, eax
+    pop esi
+    pop edi
+    ret
+
+.fixup_dwords:
+    lea eax, [edx+ecx*4]
+    pop esi
+    pop edi
+    ret
+
+.fixup_bytes:
+    mov eax, ecx
+    pop esi
+    pop edi
+    ret
+
+section .rodata
+; Pairs of a faulting instruction and the code to continue from.
+uaccess_ex_table:
+    dd uaccess_copy.copy_dwords, uaccess_copy.fixup_dwords
+    dd uaccess_copy.copy_bytes, uaccess_copy.fixup_bytes
+uaccess_ex_table_end:
@@ -5,36 +5,40 @@
  * found in the LICENSE file.
  */
 
+#include <io/epoll/epoll.h>
+#include <io/pipe/pipe.h>
 #include <libkern/bits/errno.h>
 #include <libkern/libkern.h>
 #include <libkern/log.h>
 #include <mem/kmalloc.h>
+#include <mem/uaccess.h>
+#include <mem/vmm/vmm.h>
 #include <platform/generic/syscalls/params.h>
 #include <syscalls/handlers.h>
 #include <tasking/tasking.h>
 
-void sys_open(trapframe_t* tf)
+static int _sys_open(const char* path, uint32_t flags, mode_t mode)
 {
     proc_t* p = RUNNING_THREAD->process;
     file_descriptor_t* fd = proc_get_free_fd(p);
-    const char* path = (char*)param1;
     char* kpath = 0;
+    if (!fd) {
+        return -EMFILE;
+    }
     if (!str_validate_len(path, 128)) {
-        return_with_val(-EINVAL);
+        return -EINVAL;
     }
 
-    uint32_t flags = param2;
     size_t path_len = strlen(path);
     kpath = kmem_bring_to_kernel(path, path_len + 1);
 
-    mode_t mode = param3;
     dentry_t* file;
 
     if (flags & O_CREAT) {
         char* kname = vfs_helper_split_path_with_name(kpath, path_len);
         if (!kname) {
             kfree(kpath);
-            return_with_val(-EINVAL);
+            return -EINVAL;
         }
         size_t name_len = strlen(kname);
 
@@ -42,7 +46,7 @@ void sys_open(trapframe_t* tf)
         if (vfs_resolve_path_start_from(p->cwd, kpath, &dir) < 0) {
             kfree(kname);
             kfree(kpath);
-            return_with_val(-ENOENT);
+            return -ENOENT;
         }
 
         int err = vfs_create(dir, kname, name_len, mode);
@@ -50,7 +54,7 @@ void sys_open(trapframe_t* tf)
             dentry_put(dir);
             kfree(kname);
             kfree(kpath);
-            return_with_val(err);
+            return err;
         }
 
         vfs_helper_restore_full_path_after_split(kpath, kname);
@@ -58,15 +62,22 @@ void sys_open(trapframe_t* tf)
         kfree(kname);
     }
 
-    if (vfs_resolve_path_start_from(p->cwd, kpath, &file) < 0) {
-        return_with_val(-ENOENT);
+    int res = vfs_resolve_path_start_from(p->cwd, kpath, &file);
+    kfree(kpath);
+    if (res < 0) {
+        return -ENOENT;
     }
-    int res = vfs_open(file, fd, flags);
+    res = vfs_open(file, fd, flags);
     dentry_put(file);
     if (!res) {
-        return_with_val(proc_get_fd_id(p, fd));
+        return proc_get_fd_id(p, fd);
     }
-    return_with_val(res);
+    return res;
+}
+
+void sys_open(trapframe_t* tf)
+{
+    return_with_val(_sys_open((char*)param1, (uint32_t)param2, (mode_t)param3));
 }
 
 void sys_close(trapframe_t* tf)
@@ -75,10 +86,9 @@ void sys_close(trapframe_t* tf)
     if (!fd) {
         return_with_val(-EBADF);
     }
-    return_with_val(vfs_close(fd));
+    return_with_val(proc_close_fd(RUNNING_THREAD->process, fd));
 }
 
-/* TODO: copying to/from user! */
 void sys_read(trapframe_t* tf)
 {
     file_descriptor_t* fd = proc_get_fd(RUNNING_THREAD->process, (int)param1);
@@ -86,13 +96,50 @@ void sys_read(trapframe_t* tf)
         return_with_val(-EBADF);
     }
 
-    init_read_blocker(RUNNING_THREAD, fd);
+    /* The buffer is checked after waiting, when it's going to be written. */
+    if (!(fd->flags & O_NONBLOCK)) {
+        init_read_blocker(RUNNING_THREAD, fd);
+    }
+
+    uint8_t* buf = (uint8_t*)param2;
+    uint32_t len = (uint32_t)param3;
+    int err = uaccess_check(buf, len, UACCESS_WRITE);
+    if (err) {
+        return_with_val(err);
+    }
 
-    int res = vfs_read(fd, (uint8_t*)param2, (uint32_t)param3);
+    int res = vfs_read(fd, buf, len);
     return_with_val(res);
 }
 
-/* TODO: copying to/from user! */
+/**
+ * Sockets, pipes and ptys take only what fits into their buffers, a blocking
+ * write waits for the reader to drain them and passes the rest. Other files
+ * take all or fail, so the loop ends at once for them.
+ */
+static int _sys_write_rest(file_descriptor_t* fd, const iovec_t* iov, int iovcnt, int done)
+{
+    uint32_t skip = done;
+    for (;;) {
+        while (iovcnt && skip >= iov->iov_len) {
+            skip -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (!iovcnt) {
+            return done;
+        }
+
+        init_write_blocker(RUNNING_THREAD, fd);
+        int written = vfs_write(fd, (uint8_t*)iov->iov_base + skip, iov->iov_len - skip);
+        if (written <= 0) {
+            return done;
+        }
+        done += written;
+        skip += written;
+    }
+}
+
 void sys_write(trapframe_t* tf)
 {
     file_descriptor_t* fd = proc_get_fd(RUNNING_THREAD->process, (int)param1);
@@ -100,12 +147,228 @@ void sys_write(trapframe_t* tf)
         return_with_val(-EBADF);
     }
 
+    iovec_t iov = { .iov_base = (void*)param2, .iov_len = (size_t)param3 };
+    int err = uaccess_check(iov.iov_base, iov.iov_len, UACCESS_READ);
+    if (err) {
+        return_with_val(err);
+    }
+
+    if (fd->flags & O_NONBLOCK) {
+        return_with_val(vfs_write(fd, iov.iov_base, iov.iov_len));
+    }
+
     init_write_blocker(RUNNING_THREAD, fd);
+    int res = vfs_write(fd, iov.iov_base, iov.iov_len);
+    if (res > 0) {
+        res = _sys_write_rest(fd, &iov, 1, res);
+    }
+    return_with_val(res);
+}
+
+#define SYS_FAST_IOV 8
+
+/**
+ * Brings the iovec array into the kernel and checks the buffers it points
+ * to. Small arrays are put into @fast_iov, larger ones are allocated and
+ * should be released with _sys_put_iovecs. The whole transfer has to be
+ * representable by the returned int, as with read and write.
+ */
+static int _sys_get_iovecs(const iovec_t* uiov, int iovcnt, int access, iovec_t* fast_iov, iovec_t** res_iov)
+{
+    if (iovcnt < 0 || iovcnt > IOV_MAX) {
+        return -EINVAL;
+    }
+
+    iovec_t* iov = fast_iov;
+    if (iovcnt > SYS_FAST_IOV) {
+        iov = kmalloc(iovcnt * sizeof(iovec_t));
+        if (!iov) {
+            return -ENOMEM;
+        }
+    }
+
+    int err = copy_from_user(iov, uiov, iovcnt * sizeof(iovec_t));
+    uint32_t total = 0;
+    for (int i = 0; !err && i < iovcnt; i++) {
+        if (iov[i].iov_len > 0x7fffffff - total) {
+            err = -EINVAL;
+            break;
+        }
+        total += iov[i].iov_len;
+        err = uaccess_check(iov[i].iov_base, iov[i].iov_len, access);
+    }
+
+    if (err) {
+        if (iov != fast_iov) {
+            kfree(iov);
+        }
+        return err;
+    }
+    *res_iov = iov;
+    return 0;
+}
+
+static inline void _sys_put_iovecs(iovec_t* fast_iov, iovec_t* iov)
+{
+    if (iov != fast_iov) {
+        kfree(iov);
+    }
+}
+
+void sys_readv(trapframe_t* tf)
+{
+    file_descriptor_t* fd = proc_get_fd(RUNNING_THREAD->process, (int)param1);
+    if (!fd) {
+        return_with_val(-EBADF);
+    }
+
+    if (!(fd->flags & O_NONBLOCK)) {
+        init_read_blocker(RUNNING_THREAD, fd);
+    }
+
+    iovec_t fast_iov[SYS_FAST_IOV];
+    iovec_t* iov;
+    int iovcnt = (int)param3;
+    int err = _sys_get_iovecs((const iovec_t*)param2, iovcnt, UACCESS_WRITE, fast_iov, &iov);
+    if (err) {
+        return_with_val(err);
+    }
+
+    int res = vfs_readv(fd, iov, iovcnt);
+    _sys_put_iovecs(fast_iov, iov);
+    return_with_val(res);
+}
+
+void sys_writev(trapframe_t* tf)
+{
+    file_descriptor_t* fd = proc_get_fd(RUNNING_THREAD->process, (int)param1);
+    if (!fd) {
+        return_with_val(-EBADF);
+    }
+
+    iovec_t fast_iov[SYS_FAST_IOV];
+    iovec_t* iov;
+    int iovcnt = (int)param3;
+    int err = _sys_get_iovecs((const iovec_t*)param2, iovcnt, UACCESS_READ, fast_iov, &iov);
+    if (err) {
+        return_with_val(err);
+    }
 
-    int res = vfs_write(fd, (uint8_t*)param2, (uint32_t)param3);
+    int res;
+    if (fd->flags & O_NONBLOCK) {
+        res = vfs_writev(fd, iov, iovcnt);
+    } else {
+        init_write_blocker(RUNNING_THREAD, fd);
+        res = vfs_writev(fd, iov, iovcnt);
+        if (res > 0) {
+            res = _sys_write_rest(fd, iov, iovcnt, res);
+        }
+    }
+    _sys_put_iovecs(fast_iov, iov);
     return_with_val(res);
 }
 
+/* Positional transfers leave the file offset as is, so they are allowed only for files which have one. */
+void sys_preadv(trapframe_t* tf)
+{
+    file_descriptor_t* fd = proc_get_fd(RUNNING_THREAD->process, (int)param1);
+    if (!fd) {
+        return_with_val(-EBADF);
+    }
+    if (fd->type != FD_TYPE_FILE) {
+        return_with_val(-ESPIPE);
+    }
+
+    if (!(fd->flags & O_NONBLOCK)) {
+        init_read_blocker(RUNNING_THREAD, fd);
+    }
+
+    iovec_t fast_iov[SYS_FAST_IOV];
+    iovec_t* iov;
+    int iovcnt = (int)param3;
+    int err = _sys_get_iovecs((const iovec_t*)param2, iovcnt, UACCESS_WRITE, fast_iov, &iov);
+    if (err) {
+        return_with_val(err);
+    }
+
+    int res = vfs_preadv(fd, iov, iovcnt, (uint32_t)param4);
+    _sys_put_iovecs(fast_iov, iov);
+    return_with_val(res);
+}
+
+void sys_pwritev(trapframe_t* tf)
+{
+    file_descriptor_t* fd = proc_get_fd(RUNNING_THREAD->process, (int)param1);
+    if (!fd) {
+        return_with_val(-EBADF);
+    }
+    if (fd->type != FD_TYPE_FILE) {
+        return_with_val(-ESPIPE);
+    }
+
+    iovec_t fast_iov[SYS_FAST_IOV];
+    iovec_t* iov;
+    int iovcnt = (int)param3;
+    int err = _sys_get_iovecs((const iovec_t*)param2, iovcnt, UACCESS_READ, fast_iov, &iov);
+    if (err) {
+        return_with_val(err);
+    }
+
+    if (!(fd->flags & O_NONBLOCK)) {
+        init_write_blocker(RUNNING_THREAD, fd);
+    }
+
+    int res = vfs_pwritev(fd, iov, iovcnt, (uint32_t)param4);
+    _sys_put_iovecs(fast_iov, iov);
+    return_with_val(res);
+}
+
+void sys_pread(trapframe_t* tf)
+{
+    file_descriptor_t* fd = proc_get_fd(RUNNING_THREAD->process, (int)param1);
+    if (!fd) {
+        return_with_val(-EBADF);
+    }
+    if (fd->type != FD_TYPE_FILE) {
+        return_with_val(-ESPIPE);
+    }
+
+    if (!(fd->flags & O_NONBLOCK)) {
+        init_read_blocker(RUNNING_THREAD, fd);
+    }
+
+    iovec_t iov = { .iov_base = (void*)param2, .iov_len = (size_t)param3 };
+    int err = uaccess_check(iov.iov_base, iov.iov_len, UACCESS_WRITE);
+    if (err) {
+        return_with_val(err);
+    }
+
+    return_with_val(vfs_preadv(fd, &iov, 1, (uint32_t)param4));
+}
+
+void sys_pwrite(trapframe_t* tf)
+{
+    file_descriptor_t* fd = proc_get_fd(RUNNING_THREAD->process, (int)param1);
+    if (!fd) {
+        return_with_val(-EBADF);
+    }
+    if (fd->type != FD_TYPE_FILE) {
+        return_with_val(-ESPIPE);
+    }
+
+    iovec_t iov = { .iov_base = (void*)param2, .iov_len = (size_t)param3 };
+    int err = uaccess_check(iov.iov_base, iov.iov_len, UACCESS_READ);
+    if (err) {
+        return_with_val(err);
+    }
+
+    if (!(fd->flags & O_NONBLOCK)) {
+        init_write_blocker(RUNNING_THREAD, fd);
+    }
+
+    return_with_val(vfs_pwritev(fd, &iov, 1, (uint32_t)param4));
+}
+
 void sys_lseek(trapframe_t* tf)
 {
     file_descriptor_t* fd = proc_get_fd(RUNNING_THREAD->process, (int)param1);
@@ -113,6 +376,10 @@ void sys_lseek(trapframe_t* tf)
         return_with_val(-EBADF);
     }
 
+    if (fd->type != FD_TYPE_FILE) {
+        return_with_val(-ESPIPE);
+    }
+
     int whence = param3;
 
     switch (whence) {
@@ -182,10 +449,38 @@ void sys_fstat(trapframe_t* tf)
     if (!stat) {
         return_with_val(-EINVAL);
     }
-    int res = vfs_fstat(fd, stat);
+
+    fstat_t kstat = { 0 };
+    int res = vfs_fstat(fd, &kstat);
+    if (!res) {
+        res = copy_to_user(stat, &kstat, sizeof(kstat));
+    }
     return_with_val(res);
 }
 
+void sys_fsync(trapframe_t* tf)
+{
+    file_descriptor_t* fd = proc_get_fd(RUNNING_THREAD->process, (int)param1);
+    if (!fd) {
+        return_with_val(-EBADF);
+    }
+    return_with_val(vfs_fsync(fd, false));
+}
+
+void sys_fdatasync(trapframe_t* tf)
+{
+    file_descriptor_t* fd = proc_get_fd(RUNNING_THREAD->process, (int)param1);
+    if (!fd) {
+        return_with_val(-EBADF);
+    }
+    return_with_val(vfs_fsync(fd, true));
+}
+
+void sys_sync(trapframe_t* tf)
+{
+    return_with_val(vfs_sync());
+}
+
 void sys_mkdir(trapframe_t* tf)
 {
     proc_t* p = RUNNING_THREAD->process;
@@ -250,6 +545,14 @@ void sys_getdents(trapframe_t* tf)
 {
     proc_t* p = RUNNING_THREAD->process;
     file_descriptor_t* fd = (file_descriptor_t*)proc_get_fd(p, (uint32_t)param1);
+    if (!fd) {
+        return_with_val(-EBADF);
+    }
+
+    int err = uaccess_check((void*)param2, param3, UACCESS_WRITE);
+    if (err) {
+        return_with_val(err);
+    }
     int read = vfs_getdents(fd, (uint8_t*)param2, param3);
     return_with_val(read);
 }
@@ -260,16 +563,30 @@ void sys_select(trapframe_t* tf)
     file_descriptor_t* fd;
 
     int nfds = param1;
-    fd_set_t* readfds = (fd_set_t*)param2;
-    fd_set_t* writefds = (fd_set_t*)param3;
-    fd_set_t* exceptfds = (fd_set_t*)param4;
-    timeval_t* timeout = (timeval_t*)param5;
+    fd_set_t* u_readfds = (fd_set_t*)param2;
+    fd_set_t* u_writefds = (fd_set_t*)param3;
+    fd_set_t* u_exceptfds = (fd_set_t*)param4;
+    timeval_t* u_timeout = (timeval_t*)param5;
     if (nfds < 0 || nfds > FD_SETSIZE) {
         return_with_val(-EINVAL);
     }
 
+    /* The sets are worked on in the kernel and copied back when ready. */
+    fd_set_t kreadfds, kwritefds, kexceptfds;
+    timeval_t ktimeout;
+    fd_set_t* readfds = u_readfds ? &kreadfds : NULL;
+    fd_set_t* writefds = u_writefds ? &kwritefds : NULL;
+    fd_set_t* exceptfds = u_exceptfds ? &kexceptfds : NULL;
+    timeval_t* timeout = u_timeout ? &ktimeout : NULL;
+    if ((readfds && copy_from_user(readfds, u_readfds, sizeof(fd_set_t)))
+        || (writefds && copy_from_user(writefds, u_writefds, sizeof(fd_set_t)))
+        || (exceptfds && copy_from_user(exceptfds, u_exceptfds, sizeof(fd_set_t)))
+        || (timeout && copy_from_user(timeout, u_timeout, sizeof(timeval_t)))) {
+        return_with_val(-EFAULT);
+    }
+
     for (int i = 0; i < nfds; i++) {
-        if (FD_ISSET(i, readfds) || FD_ISSET(i, writefds) || FD_ISSET(i, exceptfds)) {
+        if ((readfds && FD_ISSET(i, readfds)) || (writefds && FD_ISSET(i, writefds)) || (exceptfds && FD_ISSET(i, exceptfds))) {
             if (!proc_get_fd(p, i)) {
                 return_with_val(-EBADF);
             }
@@ -302,13 +619,458 @@ void sys_select(trapframe_t* tf)
         }
     }
 
+    if ((readfds && copy_to_user(u_readfds, readfds, sizeof(fd_set_t)))
+        || (writefds && copy_to_user(u_writefds, writefds, sizeof(fd_set_t)))
+        || (exceptfds && copy_to_user(u_exceptfds, exceptfds, sizeof(fd_set_t)))) {
+        return_with_val(-EFAULT);
+    }
     return_with_val(0);
 }
 
+void sys_epoll_create(trapframe_t* tf)
+{
+    proc_t* p = RUNNING_THREAD->process;
+    int size = (int)param1;
+    if (size <= 0) {
+        return_with_val(-EINVAL);
+    }
+
+    file_descriptor_t* fd = proc_get_free_fd(p);
+    if (!fd) {
+        return_with_val(-EMFILE);
+    }
+
+    int res = epoll_create(fd);
+    if (res) {
+        return_with_val(res);
+    }
+    return_with_val(proc_get_fd_id(p, fd));
+}
+
+void sys_epoll_ctl(trapframe_t* tf)
+{
+    proc_t* p = RUNNING_THREAD->process;
+    file_descriptor_t* epfd = proc_get_fd(p, (int)param1);
+    int op = (int)param2;
+    int fd_num = (int)param3;
+    file_descriptor_t* fd = proc_get_fd(p, fd_num);
+    if (!epfd || !fd) {
+        return_with_val(-EBADF);
+    }
+    if (epfd->type != FD_TYPE_EPOLL || epfd == fd) {
+        return_with_val(-EINVAL);
+    }
+
+    epoll_event_t event = { 0 };
+    if (op != EPOLL_CTL_DEL && copy_from_user(&event, (epoll_event_t*)param4, sizeof(epoll_event_t))) {
+        return_with_val(-EFAULT);
+    }
+    return_with_val(epoll_ctl(epfd->epoll_entry, op, fd_num, fd, &event));
+}
+
+void sys_epoll_wait(trapframe_t* tf)
+{
+    file_descriptor_t* epfd = proc_get_fd(RUNNING_THREAD->process, (int)param1);
+    epoll_event_t* u_events = (epoll_event_t*)param2;
+    int maxevents = (int)param3;
+    int timeout = (int)param4;
+    if (!epfd) {
+        return_with_val(-EBADF);
+    }
+    if (epfd->type != FD_TYPE_EPOLL || maxevents <= 0) {
+        return_with_val(-EINVAL);
+    }
+
+    /* An instance has an item per fd at most, so a wait can't report more. */
+    epoll_event_t events[MAX_OPENED_FILES];
+    if (maxevents > MAX_OPENED_FILES) {
+        maxevents = MAX_OPENED_FILES;
+    }
+    int err = uaccess_check(u_events, maxevents * sizeof(epoll_event_t), UACCESS_WRITE);
+    if (err) {
+        return_with_val(err);
+    }
+
+    /* The fd could be closed by another thread, while this one sleeps. */
+    epoll_t* ep = epoll_duplicate(epfd->epoll_entry);
+    if (timeout != 0) {
+        init_epoll_blocker(RUNNING_THREAD, ep, timeout);
+    }
+    int count = epoll_collect(ep, events, maxevents);
+    epoll_put(ep);
+
+    if (count && copy_to_user(u_events, events, count * sizeof(epoll_event_t))) {
+        return_with_val(-EFAULT);
+    }
+    return_with_val(count);
+}
+
+void sys_pipe(trapframe_t* tf)
+{
+    proc_t* p = RUNNING_THREAD->process;
+    int* u_fds = (int*)param1;
+    int err = uaccess_check(u_fds, 2 * sizeof(int), UACCESS_WRITE);
+    if (err) {
+        return_with_val(err);
+    }
+
+    file_descriptor_t* read_fd = proc_get_free_fd(p);
+    if (!read_fd) {
+        return_with_val(-EMFILE);
+    }
+
+    /* The read end takes its slot first, so the next free one is found for the write end. */
+    file_descriptor_t write_end;
+    err = pipe_create(read_fd, &write_end);
+    if (err) {
+        return_with_val(err);
+    }
+    file_descriptor_t* write_fd = proc_get_free_fd(p);
+    if (!write_fd) {
+        vfs_close(&write_end);
+        vfs_close(read_fd);
+        return_with_val(-EMFILE);
+    }
+    *write_fd = write_end;
+
+    int fds[2] = { proc_get_fd_id(p, read_fd), proc_get_fd_id(p, write_fd) };
+    if (copy_to_user(u_fds, fds, sizeof(fds))) {
+        vfs_close(write_fd);
+        vfs_close(read_fd);
+        return_with_val(-EFAULT);
+    }
+    return_with_val(0);
+}
+
+void sys_dup2(trapframe_t* tf)
+{
+    proc_t* p = RUNNING_THREAD->process;
+    file_descriptor_t* from = proc_get_fd(p, (int)param1);
+    int new_fd = (int)param2;
+    if (!from || new_fd < 0 || new_fd >= MAX_OPENED_FILES) {
+        return_with_val(-EBADF);
+    }
+
+    file_descriptor_t* to = &p->fds[new_fd];
+    if (to == from) {
+        return_with_val(new_fd);
+    }
+    if (to->dentry) {
+        proc_close_fd(p, to);
+    }
+    vfs_dup(from, to);
+    return_with_val(new_fd);
+}
+
+/* Only files, which take kernel buffers in their read and write, could be spliced. */
+static inline bool _sys_can_splice(file_descriptor_t* fd)
+{
+    return fd->type == FD_TYPE_FILE || fd->type == FD_TYPE_PIPE;
+}
+
+static int _sys_get_offset(file_descriptor_t* fd, off_t* u_offset, uint32_t* offset)
+{
+    off_t koffset;
+    if (!u_offset) {
+        *offset = fd->offset;
+        return 0;
+    }
+    if (copy_from_user(&koffset, u_offset, sizeof(off_t))) {
+        return -EFAULT;
+    }
+    *offset = koffset;
+    return 0;
+}
+
+static int _sys_put_offset(file_descriptor_t* fd, off_t* u_offset, uint32_t offset)
+{
+    off_t koffset = offset;
+    if (!u_offset) {
+        fd->offset = offset;
+        return 0;
+    }
+    return copy_to_user(u_offset, &koffset, sizeof(off_t));
+}
+
+/**
+ * splice moves data between a pipe and another fd inside the kernel: a file
+ * reads right into the pipe pages and is written right from them. Pipe ends
+ * have no offsets, a file uses the given one, or its own, if none is given.
+ */
+void sys_splice(trapframe_t* tf)
+{
+    proc_t* p = RUNNING_THREAD->process;
+    splice_params_t params;
+    if (copy_from_user(&params, (splice_params_t*)param1, sizeof(splice_params_t))) {
+        return_with_val(-EFAULT);
+    }
+
+    file_descriptor_t* in = proc_get_fd(p, params.fd_in);
+    file_descriptor_t* out = proc_get_fd(p, params.fd_out);
+    if (!in || !out) {
+        return_with_val(-EBADF);
+    }
+    if (!_sys_can_splice(in) || !_sys_can_splice(out) || (in->type != FD_TYPE_PIPE && out->type != FD_TYPE_PIPE)) {
+        return_with_val(-EINVAL);
+    }
+    if ((in->type == FD_TYPE_PIPE && params.off_in) || (out->type == FD_TYPE_PIPE && params.off_out)) {
+        return_with_val(-ESPIPE);
+    }
+    if ((in->type == FD_TYPE_PIPE && !(in->flags & O_RDONLY)) || (out->type == FD_TYPE_PIPE && !(out->flags & O_WRONLY))) {
+        return_with_val(-EBADF);
+    }
+    if (params.len > 0x7fffffff) {
+        params.len = 0x7fffffff;
+    }
+
+    uint32_t in_offset, out_offset;
+    int err = _sys_get_offset(in, params.off_in, &in_offset);
+    if (!err) {
+        err = _sys_get_offset(out, params.off_out, &out_offset);
+    }
+    if (err) {
+        return_with_val(err);
+    }
+
+    if (!(params.flags & SPLICE_F_NONBLOCK)) {
+        if (!(in->flags & O_NONBLOCK)) {
+            init_read_blocker(RUNNING_THREAD, in);
+        }
+        if (!(out->flags & O_NONBLOCK)) {
+            init_write_blocker(RUNNING_THREAD, out);
+        }
+    }
+
+    int res;
+    if (in->type == FD_TYPE_PIPE && out->type == FD_TYPE_PIPE) {
+        res = pipe_splice_to_pipe(in->pipe_entry, out->pipe_entry, params.len);
+    } else if (in->type == FD_TYPE_PIPE) {
+        res = pipe_splice_to_file(in->pipe_entry, out, &out_offset, params.len);
+    } else {
+        res = pipe_splice_from_file(out->pipe_entry, in, &in_offset, params.len);
+    }
+
+    if (res > 0) {
+        if (in->type == FD_TYPE_FILE && _sys_put_offset(in, params.off_in, in_offset)) {
+            return_with_val(-EFAULT);
+        }
+        if (out->type == FD_TYPE_FILE && _sys_put_offset(out, params.off_out, out_offset)) {
+            return_with_val(-EFAULT);
+        }
+    }
+    return_with_val(res);
+}
+
+/* Moves data between two files through a kernel page, a page at a time. */
+static int _sys_sendfile_through_page(file_descriptor_t* in, file_descriptor_t* out, uint32_t* offset, uint32_t count)
+{
+    uint8_t* page = kmalloc(VMM_PAGE_SIZE);
+    if (!page) {
+        return -ENOMEM;
+    }
+
+    uint32_t done = 0;
+    int res = 0;
+    while (done < count) {
+        uint32_t n = min(count - done, VMM_PAGE_SIZE);
+        res = in->ops->read(in->dentry, page, *offset, n);
+        if (res <= 0) {
+            break;
+        }
+
+        res = vfs_write(out, page, res);
+        if (res <= 0) {
+            break;
+        }
+        *offset += res;
+        done += res;
+        if (res < n) {
+            break;
+        }
+    }
+
+    kfree(page);
+    return done ? done : res;
+}
+
+/**
+ * sendfile copies a file to another fd without passing the data through user
+ * memory. A pipe gets it into its pages right away, other files get it
+ * through a kernel page.
+ */
+void sys_sendfile(trapframe_t* tf)
+{
+    proc_t* p = RUNNING_THREAD->process;
+    file_descriptor_t* out = proc_get_fd(p, (int)param1);
+    file_descriptor_t* in = proc_get_fd(p, (int)param2);
+    off_t* u_offset = (off_t*)param3;
+    uint32_t count = (uint32_t)param4;
+    if (!in || !out) {
+        return_with_val(-EBADF);
+    }
+    if (in->type != FD_TYPE_FILE || !_sys_can_splice(out)) {
+        return_with_val(-EINVAL);
+    }
+    if (out->type == FD_TYPE_PIPE && !(out->flags & O_WRONLY)) {
+        return_with_val(-EBADF);
+    }
+    if (count > 0x7fffffff) {
+        count = 0x7fffffff;
+    }
+
+    uint32_t offset;
+    int err = _sys_get_offset(in, u_offset, &offset);
+    if (err) {
+        return_with_val(err);
+    }
+
+    if (!(in->flags & O_NONBLOCK)) {
+        init_read_blocker(RUNNING_THREAD, in);
+    }
+    if (!(out->flags & O_NONBLOCK)) {
+        init_write_blocker(RUNNING_THREAD, out);
+    }
+
+    int res;
+    if (out->type == FD_TYPE_PIPE) {
+        res = pipe_splice_from_file(out->pipe_entry, in, &offset, count);
+    } else {
+        res = _sys_sendfile_through_page(in, out, &offset, count);
+    }
+
+    if (res > 0 && _sys_put_offset(in, u_offset, offset)) {
+        return_with_val(-EFAULT);
+    }
+    return_with_val(res);
+}
+
+/**
+ * Ring
+ *
+ * Calls of a ring never block: a read or write, which would wait, completes
+ * with EAGAIN, so one slow fd doesn't hold the whole batch. Apps wait for
+ * readiness with epoll and submit the calls after.
+ */
+
+static int _sys_ring_rw(ring_sqe_t* sqe, bool write)
+{
+    file_descriptor_t* fd = proc_get_fd(RUNNING_THREAD->process, sqe->fd);
+    if (!fd) {
+        return -EBADF;
+    }
+    if (write ? !vfs_can_write(fd) : !vfs_can_read(fd)) {
+        return -EAGAIN;
+    }
+
+    int err = uaccess_check(sqe->addr, sqe->len, write ? UACCESS_READ : UACCESS_WRITE);
+    if (err) {
+        return err;
+    }
+
+    if (sqe->offset == RING_OFFSET_CURRENT) {
+        return write ? vfs_write(fd, sqe->addr, sqe->len) : vfs_read(fd, sqe->addr, sqe->len);
+    }
+    if (fd->type != FD_TYPE_FILE) {
+        return -ESPIPE;
+    }
+    iovec_t iov = { .iov_base = sqe->addr, .iov_len = sqe->len };
+    return write ? vfs_pwritev(fd, &iov, 1, sqe->offset) : vfs_preadv(fd, &iov, 1, sqe->offset);
+}
+
+static int _sys_ring_fstat(ring_sqe_t* sqe)
+{
+    file_descriptor_t* fd = proc_get_fd(RUNNING_THREAD->process, sqe->fd);
+    if (!fd) {
+        return -EBADF;
+    }
+
+    fstat_t kstat = { 0 };
+    int res = vfs_fstat(fd, &kstat);
+    if (!res) {
+        res = copy_to_user(sqe->addr, &kstat, sizeof(kstat));
+    }
+    return res;
+}
+
+static int _sys_ring_do(ring_sqe_t* sqe)
+{
+    file_descriptor_t* fd;
+    switch (sqe->op) {
+    case RING_OP_NOP:
+        return 0;
+    case RING_OP_READ:
+        return _sys_ring_rw(sqe, false);
+    case RING_OP_WRITE:
+        return _sys_ring_rw(sqe, true);
+    case RING_OP_FSTAT:
+        return _sys_ring_fstat(sqe);
+    case RING_OP_OPEN:
+        return _sys_open((const char*)sqe->addr, sqe->flags, (mode_t)sqe->len);
+    case RING_OP_CLOSE:
+        fd = proc_get_fd(RUNNING_THREAD->process, sqe->fd);
+        return fd ? proc_close_fd(RUNNING_THREAD->process, fd) : -EBADF;
+    default:
+        return -EINVAL;
+    }
+}
+
+/**
+ * sys_ring_enter runs up to @to_submit queued calls in one trap. It stops
+ * early, when the completion queue is full, and returns the number of
+ * taken entries. The queue indexes are read once and written back once,
+ * entries are copied one by one.
+ */
+void sys_ring_enter(trapframe_t* tf)
+{
+    ring_t* u_ring = (ring_t*)param1;
+    uint32_t to_submit = (uint32_t)param2;
+
+    ring_t ring;
+    if (copy_from_user(&ring, u_ring, sizeof(ring_t))) {
+        return_with_val(-EFAULT);
+    }
+    uint32_t mask = ring.entries - 1;
+    if (!ring.entries || ring.entries > RING_MAX_ENTRIES || (ring.entries & mask)) {
+        return_with_val(-EINVAL);
+    }
+    if (ring.sq_tail - ring.sq_head > ring.entries || ring.cq_tail - ring.cq_head > ring.entries) {
+        return_with_val(-EINVAL);
+    }
+
+    uint32_t submitted = 0;
+    int err = 0;
+    while (submitted < to_submit && ring.sq_head != ring.sq_tail && ring.cq_tail - ring.cq_head < ring.entries) {
+        ring_sqe_t sqe;
+        if (copy_from_user(&sqe, &ring.sqes[ring.sq_head & mask], sizeof(ring_sqe_t))) {
+            err = -EFAULT;
+            break;
+        }
+
+        ring_cqe_t cqe = { .user_data = sqe.user_data, .res = _sys_ring_do(&sqe) };
+        if (copy_to_user(&ring.cqes[ring.cq_tail & mask], &cqe, sizeof(ring_cqe_t))) {
+            err = -EFAULT;
+            break;
+        }
+        ring.sq_head++;
+        ring.cq_tail++;
+        submitted++;
+    }
+
+    /* The app owns sq_tail and cq_head, only the kernel's indexes are written back. */
+    if (copy_to_user(&u_ring->sq_head, &ring.sq_head, sizeof(uint32_t)) || copy_to_user(&u_ring->cq_tail, &ring.cq_tail, sizeof(uint32_t))) {
+        return_with_val(-EFAULT);
+    }
+    return_with_val(submitted ? submitted : err);
+}
+
 void sys_mmap(trapframe_t* tf)
 {
     proc_t* p = RUNNING_THREAD->process;
-    mmap_params_t* params = (mmap_params_t*)param1;
+    mmap_params_t kparams;
+    mmap_params_t* params = &kparams;
+    if (copy_from_user(params, (mmap_params_t*)param1, sizeof(mmap_params_t))) {
+        return_with_val(-EFAULT);
+    }
 
     bool map_shared = ((params->flags & MAP_SHARED) > 0);
     bool map_anonymous = ((params->flags & MAP_ANONYMOUS) > 0);
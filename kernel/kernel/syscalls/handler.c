@@ -63,6 +63,29 @@ static const void* syscalls[] = {
     [SYS_SHBUF_CREATE] = sys_shbuf_create,
     [SYS_SHBUF_GET] = sys_shbuf_get,
     [SYS_SHBUF_FREE] = sys_shbuf_free,
+    [SYS_FSYNC] = sys_fsync,
+    [SYS_FDATASYNC] = sys_fdatasync,
+    [SYS_SYNC] = sys_sync,
+    [SYS_LISTEN] = sys_listen,
+    [SYS_ACCEPT] = sys_accept,
+    [SYS_FUTEX] = sys_futex,
+    [SYS_SHBUF_GRANT] = sys_shbuf_grant,
+    [SYS_SHBUF_REVOKE] = sys_shbuf_revoke,
+    [SYS_SHBUF_RESIZE] = sys_shbuf_resize,
+    [SYS_READV] = sys_readv,
+    [SYS_WRITEV] = sys_writev,
+    [SYS_PREADV] = sys_preadv,
+    [SYS_PWRITEV] = sys_pwritev,
+    [SYS_PREAD] = sys_pread,
+    [SYS_PWRITE] = sys_pwrite,
+    [SYS_EPOLL_CREATE] = sys_epoll_create,
+    [SYS_EPOLL_CTL] = sys_epoll_ctl,
+    [SYS_EPOLL_WAIT] = sys_epoll_wait,
+    [SYS_PIPE] = sys_pipe,
+    [SYS_DUP2] = sys_dup2,
+    [SYS_SPLICE] = sys_splice,
+    [SYS_SENDFILE] = sys_sendfile,
+    [SYS_RING_ENTER] = sys_ring_enter,
 };
 
 #ifdef __i386__
@@ -10,6 +10,7 @@
 #include <libkern/bits/errno.h>
 #include <libkern/libkern.h>
 #include <libkern/log.h>
+#include <mem/uaccess.h>
 #include <platform/generic/syscalls/params.h>
 #include <syscalls/handlers.h>
 #include <tasking/tasking.h>
@@ -55,6 +56,24 @@ void sys_bind(trapframe_t* tf)
     return_with_val(0);
 }
 
+void sys_listen(trapframe_t* tf)
+{
+    proc_t* p = RUNNING_THREAD->process;
+    int sockfd = param1;
+    int backlog = param2;
+
+    file_descriptor_t* sfd = proc_get_fd(p, sockfd);
+    if (!sfd || sfd->type != FD_TYPE_SOCKET || !sfd->sock_entry) {
+        return_with_val(-EBADF);
+    }
+
+    if (sfd->sock_entry->domain == PF_LOCAL) {
+        return_with_val(local_socket_listen(sfd, backlog));
+    }
+
+    return_with_val(-EOPNOTSUPP);
+}
+
 void sys_connect(trapframe_t* tf)
 {
     proc_t* p = RUNNING_THREAD->process;
@@ -74,6 +93,36 @@ void sys_connect(trapframe_t* tf)
     return_with_val(-EFAULT);
 }
 
+void sys_accept(trapframe_t* tf)
+{
+    proc_t* p = RUNNING_THREAD->process;
+    int sockfd = param1;
+
+    file_descriptor_t* sfd = proc_get_fd(p, sockfd);
+    if (!sfd || sfd->type != FD_TYPE_SOCKET || !sfd->sock_entry) {
+        return_with_val(-EBADF);
+    }
+
+    if (sfd->sock_entry->domain != PF_LOCAL) {
+        return_with_val(-EOPNOTSUPP);
+    }
+
+    if (!(sfd->flags & O_NONBLOCK)) {
+        init_read_blocker(RUNNING_THREAD, sfd);
+    }
+
+    file_descriptor_t* fd = proc_get_free_fd(p);
+    if (!fd) {
+        return_with_val(-EMFILE);
+    }
+
+    int res = local_socket_accept(sfd, fd);
+    if (res < 0) {
+        return_with_val(res);
+    }
+    return_with_val(proc_get_fd_id(p, fd));
+}
+
 void sys_ioctl(trapframe_t* tf)
 {
     proc_t* p = RUNNING_THREAD->process;
@@ -93,18 +142,49 @@ void sys_shbuf_create(trapframe_t* tf)
 {
     uint8_t** buffer = (uint8_t**)param1;
     size_t size = param2;
-    return_with_val(shared_buffer_create(buffer, size));
+    uint8_t* kbuffer;
+    int id = shared_buffer_create(&kbuffer, size);
+    if (id >= 0 && copy_to_user(buffer, &kbuffer, sizeof(kbuffer))) {
+        return_with_val(-EFAULT);
+    }
+    return_with_val(id);
 }
 
 void sys_shbuf_get(trapframe_t* tf)
 {
     int id = param1;
     uint8_t** buffer = (uint8_t**)param2;
-    return_with_val(shared_buffer_get(id, buffer));
+    uint8_t* kbuffer;
+    int err = shared_buffer_get(id, &kbuffer);
+    if (!err && copy_to_user(buffer, &kbuffer, sizeof(kbuffer))) {
+        return_with_val(-EFAULT);
+    }
+    return_with_val(err);
 }
 
 void sys_shbuf_free(trapframe_t* tf)
 {
     int id = param1;
     return_with_val(shared_buffer_free(id));
-}
\ No newline at end of file
+}
+
+void sys_shbuf_grant(trapframe_t* tf)
+{
+    int id = param1;
+    pid_t pid = param2;
+    return_with_val(shared_buffer_grant(id, pid));
+}
+
+void sys_shbuf_revoke(trapframe_t* tf)
+{
+    int id = param1;
+    pid_t pid = param2;
+    return_with_val(shared_buffer_revoke(id, pid));
+}
+
+void sys_shbuf_resize(trapframe_t* tf)
+{
+    int id = param1;
+    size_t size = param2;
+    return_with_val(shared_buffer_resize(id, size));
+}
@@ -9,16 +9,18 @@
 #include <libkern/libkern.h>
 #include <libkern/log.h>
 #include <libkern/version.h>
-#include <mem/vmm/vmm.h>
+#include <mem/uaccess.h>
 #include <platform/generic/syscalls/params.h>
 #include <syscalls/handlers.h>
 
 void sys_uname(trapframe_t* tf)
 {
     utsname_t* buf = (utsname_t*)param1;
-    vmm_copy_to_user(buf->sysname, OSTYPE, sizeof(OSTYPE));
-    vmm_copy_to_user(buf->release, OSRELEASE, sizeof(OSRELEASE));
-    vmm_copy_to_user(buf->version, VERSION_VARIANT, sizeof(VERSION_VARIANT));
-    vmm_copy_to_user(buf->machine, MACHINE, sizeof(MACHINE));
+    if (copy_to_user(buf->sysname, OSTYPE, sizeof(OSTYPE))
+        || copy_to_user(buf->release, OSRELEASE, sizeof(OSRELEASE))
+        || copy_to_user(buf->version, VERSION_VARIANT, sizeof(VERSION_VARIANT))
+        || copy_to_user(buf->machine, MACHINE, sizeof(MACHINE))) {
+        return_with_val(-EFAULT);
+    }
     return_with_val(0);
 }
\ No newline at end of file
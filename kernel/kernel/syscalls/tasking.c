@@ -5,9 +5,11 @@
  * found in the LICENSE file.
  */
 
+#include <io/shared_buffer/shared_buffer.h>
 #include <libkern/bits/errno.h>
 #include <libkern/libkern.h>
 #include <libkern/log.h>
+#include <mem/uaccess.h>
 #include <platform/generic/syscalls/params.h>
 #include <syscalls/handlers.h>
 #include <tasking/sched.h>
@@ -100,12 +102,17 @@ void sys_getpgid(trapframe_t* tf)
 void sys_create_thread(trapframe_t* tf)
 {
     proc_t* p = RUNNING_THREAD->process;
+    thread_create_params_t kparams;
+    thread_create_params_t* params = &kparams;
+    if (copy_from_user(params, (thread_create_params_t*)param1, sizeof(thread_create_params_t))) {
+        return_with_val(-EFAULT);
+    }
+
     thread_t* thread = proc_create_thread(p);
     if (!thread) {
         return_with_val(-EFAULT);
     }
 
-    thread_create_params_t* params = (thread_create_params_t*)param1;
     set_instruction_pointer(thread->tf, params->entry_point);
     uint32_t esp = params->stack_start + params->stack_size;
     set_stack_pointer(thread->tf, esp);
@@ -129,6 +136,55 @@ void sys_sched_yield(trapframe_t* tf)
     resched();
 }
 
+/**
+ * Futexes are keyed by the process and the user address. Shared buffers are
+ * mapped at different addresses in processes, so their futexes are keyed by
+ * the physical address to let both sides of a shared ring meet.
+ */
+static void futex_key(proc_t* p, uint32_t* addr, futex_key_t* key)
+{
+    uint32_t paddr;
+    proc_zone_t* zone = proc_find_zone(p, (uint32_t)addr);
+    if (zone && (zone->type & ZONE_TYPE_SHARED_BUFFER) && shared_buffer_frame(zone, (uint32_t)addr, &paddr) == 0) {
+        key->type = FUTEX_KEY_SHARED;
+        key->owner = NULL;
+        key->addr = paddr | ((uint32_t)addr & (VMM_PAGE_SIZE - 1));
+        return;
+    }
+    key->type = FUTEX_KEY_PRIVATE;
+    key->owner = p;
+    key->addr = (uint32_t)addr;
+}
+
+void sys_futex(trapframe_t* tf)
+{
+    uint32_t* addr = (uint32_t*)param1;
+    int op = param2;
+    uint32_t val = param3;
+    futex_key_t key;
+    uint32_t cur;
+
+    switch (op) {
+    case FUTEX_WAIT:
+        /* Syscalls run with interrupts disabled, so the value can't change
+           between the check and going to sleep. */
+        if (copy_from_user(&cur, addr, sizeof(cur))) {
+            return_with_val(-EFAULT);
+        }
+        if (cur != val) {
+            return_with_val(-EAGAIN);
+        }
+        futex_key(RUNNING_THREAD->process, addr, &key);
+        init_futex_blocker(RUNNING_THREAD, &key);
+        return_with_val(RUNNING_THREAD->futex_woken ? 0 : -EINTR);
+    case FUTEX_WAKE:
+        futex_key(RUNNING_THREAD->process, addr, &key);
+        return_with_val(futex_wake_blocked(&key, val));
+    default:
+        return_with_val(-EINVAL);
+    }
+}
+
 void sys_nice(trapframe_t* tf)
 {
     int inc = param1;
@@ -8,6 +8,7 @@
 #include <libkern/bits/errno.h>
 #include <libkern/libkern.h>
 #include <libkern/log.h>
+#include <mem/uaccess.h>
 #include <platform/generic/syscalls/params.h>
 #include <platform/generic/tasking/trapframe.h>
 #include <syscalls/handlers.h>
@@ -17,20 +18,21 @@ void sys_clock_gettime(trapframe_t* tf)
 {
     clockid_t clk_id = param1;
     timespec_t* u_ts = (timespec_t*)param2;
+    timespec_t ts;
 
     switch (clk_id) {
     case CLOCK_MONOTONIC:
-        u_ts->tv_sec = timeman_seconds_since_boot();
-        u_ts->tv_nsec = timeman_get_ticks_from_last_second() * (1000000000 / timeman_ticks_per_second());
+        ts.tv_sec = timeman_seconds_since_boot();
+        ts.tv_nsec = timeman_get_ticks_from_last_second() * (1000000000 / timeman_ticks_per_second());
         break;
     case CLOCK_REALTIME:
-        u_ts->tv_sec = timeman_now();
-        u_ts->tv_nsec = timeman_get_ticks_from_last_second() * (1000000000 / timeman_ticks_per_second());
+        ts.tv_sec = timeman_now();
+        ts.tv_nsec = timeman_get_ticks_from_last_second() * (1000000000 / timeman_ticks_per_second());
         break;
     default:
         return_with_val(-EINVAL);
     }
-    return_with_val(0);
+    return_with_val(copy_to_user(u_ts, &ts, sizeof(ts)));
 }
 
 void sys_gettimeofday(trapframe_t* tf)
@@ -42,11 +44,16 @@ void sys_gettimeofday(trapframe_t* tf)
         return_with_val(-EINVAL);
     }
 
-    tv->tv_sec = timeman_now();
-    tv->tv_usec = timeman_get_ticks_from_last_second() * (1000000 / timeman_ticks_per_second());
+    timeval_t ktv;
+    ktv.tv_sec = timeman_now();
+    ktv.tv_usec = timeman_get_ticks_from_last_second() * (1000000 / timeman_ticks_per_second());
 
-    tz->tz_dsttime = DST_NONE;
-    tz->tz_minuteswest = 0;
+    timezone_t ktz;
+    ktz.tz_dsttime = DST_NONE;
+    ktz.tz_minuteswest = 0;
 
+    if (copy_to_user(tv, &ktv, sizeof(ktv)) || copy_to_user(tz, &ktz, sizeof(ktz))) {
+        return_with_val(-EFAULT);
+    }
     return_with_val(0);
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
  * found in the LICENSE file.
  */
 
+#include <io/epoll/epoll.h>
 #include <libkern/libkern.h>
 #include <libkern/log.h>
 #include <libkern/syscall_structs.h>
@@ -36,9 +37,10 @@ int init_join_blocker(thread_t* thread)
     return 0;
 }
 
+/* Files without can_read or can_write never block, e.g. the write end of a pipe for reads. */
 int should_unblock_read_block(thread_t* thread)
 {
-    return thread->blocker_fd->ops->can_read(thread->blocker_fd->dentry, thread->blocker_fd->offset);
+    return vfs_can_read(thread->blocker_fd);
 }
 
 int init_read_blocker(thread_t* thread, file_descriptor_t* bfd)
@@ -60,7 +62,7 @@ int init_read_blocker(thread_t* thread, file_descriptor_t* bfd)
 
 int should_unblock_write_block(thread_t* thread)
 {
-    return thread->blocker_fd->ops->can_write(thread->blocker_fd->dentry, thread->blocker_fd->offset);
+    return vfs_can_write(thread->blocker_fd);
 }
 
 int init_write_blocker(thread_t* thread, file_descriptor_t* bfd)
@@ -162,3 +164,79 @@ int init_select_blocker(thread_t* thread, int nfds, fd_set_t* readfds, fd_set_t*
     resched();
     return 0;
 }
+
+int should_unblock_futex_block(thread_t* thread)
+{
+    return thread->futex_woken;
+}
+
+/**
+ * Futexes are keyed by sys_futex, see futex_key_t.
+ */
+int init_futex_blocker(thread_t* thread, const futex_key_t* key)
+{
+    thread->futex_key = *key;
+    thread->futex_woken = false;
+
+    thread->status = THREAD_BLOCKED;
+    thread->blocker.reason = BLOCKER_FUTEX;
+    thread->blocker.should_unblock = should_unblock_futex_block;
+    thread->blocker.should_unblock_for_signal = true;
+    sched_dequeue(thread);
+    resched();
+    return 0;
+}
+
+extern thread_list_t thread_list;
+int futex_wake_blocked(const futex_key_t* key, int count)
+{
+    int woken = 0;
+    thread_list_node_t* node = thread_list.head;
+    while (node && woken < count) {
+        for (int i = 0; i < THREADS_PER_NODE && woken < count; i++) {
+            thread_t* thread = &node->thread_storage[i];
+            if (thread->status == THREAD_BLOCKED && thread->blocker.reason == BLOCKER_FUTEX && !thread->futex_woken && futex_key_equal(&thread->futex_key, key)) {
+                thread->futex_woken = true;
+                woken++;
+            }
+        }
+        node = node->next;
+    }
+    return woken;
+}
+
+int should_unblock_epoll_block(thread_t* thread)
+{
+    if (thread->unblock_time != 0 && thread->unblock_time <= timeman_ticks_since_boot()) {
+        return true;
+    }
+    return epoll_has_ready(thread->blocker_epoll);
+}
+
+/**
+ * Unlike select, the epoll blocker doesn't poll every watched fd: files
+ * with a wait queue put their items onto the ready list, so the check is
+ * cheap while nothing happens. A negative @timeout_ms waits forever.
+ */
+int init_epoll_blocker(thread_t* thread, struct epoll* ep, int timeout_ms)
+{
+    thread->blocker_epoll = ep;
+    thread->unblock_time = 0;
+    if (timeout_ms >= 0) {
+        time_t tps = timeman_ticks_per_second();
+        time_t ticks = (timeout_ms / 1000) * tps + ((timeout_ms % 1000) * tps + 999) / 1000;
+        thread->unblock_time = timeman_ticks_since_boot() + ticks;
+    }
+
+    if (should_unblock_epoll_block(thread)) {
+        return 0;
+    }
+
+    thread->status = THREAD_BLOCKED;
+    thread->blocker.reason = BLOCKER_EPOLL;
+    thread->blocker.should_unblock = should_unblock_epoll_block;
+    thread->blocker.should_unblock_for_signal = true;
+    sched_dequeue(thread);
+    resched();
+    return 0;
+}
@@ -6,6 +6,10 @@
  */
 
 #include <fs/vfs.h>
+#include <io/shared_buffer/shared_buffer.h>
+#include <io/epoll/epoll.h>
+#include <io/pipe/pipe.h>
+#include <io/sockets/socket.h>
 #include <io/tty/tty.h>
 #include <libkern/bits/errno.h>
 #include <libkern/libkern.h>
@@ -245,6 +249,15 @@ int proc_copy_of(proc_t* new_proc, thread_t* from_thread)
                 file_descriptor_t* fd = &new_proc->fds[i];
                 if (from_proc->fds[i].type == FD_TYPE_FILE) {
                     vfs_open(from_proc->fds[i].dentry, fd, from_proc->fds[i].flags);
+                } else if (from_proc->fds[i].type == FD_TYPE_SOCKET) {
+                    *fd = from_proc->fds[i];
+                    socket_duplicate(fd->sock_entry);
+                } else if (from_proc->fds[i].type == FD_TYPE_EPOLL) {
+                    *fd = from_proc->fds[i];
+                    epoll_duplicate(fd->epoll_entry);
+                } else if (from_proc->fds[i].type == FD_TYPE_PIPE) {
+                    *fd = from_proc->fds[i];
+                    pipe_duplicate(fd);
                 }
             }
         }
@@ -255,6 +268,9 @@ int proc_copy_of(proc_t* new_proc, thread_t* from_thread)
         if (zone_to_copy->file) {
             dentry_duplicate(zone_to_copy->file); // For the copied zone.
         }
+        if (zone_to_copy->type & ZONE_TYPE_SHARED_BUFFER) {
+            shared_buffer_fork_zone(new_proc, zone_to_copy);
+        }
         dynamic_array_push(&new_proc->zones, zone_to_copy);
     }
 
@@ -344,6 +360,7 @@ success:
     fpu_init_state(p->main_thread->fpu_state);
 #endif
     vmm_free_pdir(old_pdir, &old_zones);
+    shared_buffer_release_zones(p, &old_zones);
     dynamic_array_clear(&old_zones);
 
     // Setting up proc
@@ -409,6 +426,7 @@ int proc_free(proc_t* p)
 
     if (!p->is_kthread) {
         vmm_free_pdir(p->pdir, &p->zones);
+        shared_buffer_release_zones(p, &p->zones);
         p->pdir = NULL;
     }
 
@@ -584,3 +602,22 @@ file_descriptor_t* proc_get_fd(proc_t* p, uint32_t index)
     lock_release(&p->lock);
     return res;
 }
+
+/**
+ * proc_close_fd closes an fd and drops its items from the epoll instances of
+ * the process. An instance shared with a forked process loses the item too,
+ * there are no open file descriptions to tell if the file is still opened.
+ * Exiting processes close their fds with vfs_close() and don't touch items.
+ */
+int proc_close_fd(proc_t* p, file_descriptor_t* fd)
+{
+    lock_acquire(&p->lock);
+    int fd_num = fd - p->fds;
+    for (int i = 0; i < MAX_OPENED_FILES; i++) {
+        if (p->fds[i].dentry && p->fds[i].type == FD_TYPE_EPOLL) {
+            epoll_forget_fd(p->fds[i].epoll_entry, fd_num);
+        }
+    }
+    lock_release(&p->lock);
+    return vfs_close(fd);
+}
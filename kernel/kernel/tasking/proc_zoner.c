@@ -70,6 +70,7 @@ static inline void _proc_swap_zones(proc_zone_t* one, proc_zone_t* two)
     one->offset = two->offset;
     one->start = two->start;
     one->type = two->type;
+    one->shbuf = two->shbuf;
 
     two->file = tmp.file;
     two->flags = tmp.flags;
@@ -77,6 +78,7 @@ static inline void _proc_swap_zones(proc_zone_t* one, proc_zone_t* two)
     two->offset = tmp.offset;
     two->start = tmp.start;
     two->type = tmp.type;
+    two->shbuf = tmp.shbuf;
 }
 
 /**
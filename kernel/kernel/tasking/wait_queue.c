@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2020-2021 Nikita Melekhin. All rights reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <tasking/wait_queue.h>
+
+void wait_queue_add(wait_queue_t* wq, wait_queue_entry_t* entry)
+{
+    entry->prev = NULL;
+    entry->next = wq->head;
+    if (wq->head) {
+        wq->head->prev = entry;
+    }
+    wq->head = entry;
+}
+
+void wait_queue_remove(wait_queue_t* wq, wait_queue_entry_t* entry)
+{
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        wq->head = entry->next;
+    }
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    }
+    entry->prev = NULL;
+    entry->next = NULL;
+}
+
+void wait_queue_wake(wait_queue_t* wq, uint32_t events)
+{
+    /* A wake callback doesn't touch the queue, so the walk is safe. */
+    for (wait_queue_entry_t* entry = wq->head; entry; entry = entry->next) {
+        entry->wake(entry, events);
+    }
+}
+
+void wait_queue_release(wait_queue_t* wq)
+{
+    while (wq->head) {
+        wait_queue_entry_t* entry = wq->head;
+        wait_queue_remove(wq, entry);
+        entry->release(entry, 0);
+    }
+}
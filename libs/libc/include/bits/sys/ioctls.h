@@ -9,9 +9,15 @@
 #define TCSETSW 0x0105
 #define TCSETSF 0x0106
 
+/* PTY master */
+#define TIOCSPTYBUF 0x0107 /* Resizes both rings of the pty, arg is the size in bytes. */
+#define TIOCSPTYMIN 0x0108 /* A blocking read waits for arg bytes... */
+#define TIOCSPTYTIME 0x0109 /* ...or for arg ms since the first of them came. */
+
 /* BGA */
 #define BGA_SWAP_BUFFERS 0x0101
 #define BGA_GET_HEIGHT 0x0102
 #define BGA_GET_WIDTH 0x0103
+#define BGA_REQUEST_VBLANK 0x0104 /* The display becomes readable at the next vblank. */
 
 #endif // _LIBC_BITS_SYS_IOCTLS_H
\ No newline at end of file
@@ -23,4 +23,11 @@ enum SOCK_TYPES {
     SOCK_PACKET,
 };
 
+/* Flags which could be or'ed with a socket type. */
+#define SOCK_TYPE_MASK 0xff
+#define SOCK_NONBLOCK 0x100
+
+/* The longest queue of connections waiting to be accepted. */
+#define SOMAXCONN 16
+
 #endif // _LIBC_BITS_SYS_SOCKET_H
\ No newline at end of file
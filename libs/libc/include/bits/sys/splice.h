@@ -0,0 +1,22 @@
+#ifndef _LIBC_BITS_SYS_SPLICE_H
+#define _LIBC_BITS_SYS_SPLICE_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#define SPLICE_F_MOVE 0x1
+#define SPLICE_F_NONBLOCK 0x2
+#define SPLICE_F_MORE 0x4
+
+/* splice takes more arguments, than a syscall could pass in registers. */
+struct splice_params {
+    int fd_in;
+    off_t* off_in;
+    int fd_out;
+    off_t* off_out;
+    size_t len;
+    unsigned int flags;
+};
+typedef struct splice_params splice_params_t;
+
+#endif // _LIBC_BITS_SYS_SPLICE_H
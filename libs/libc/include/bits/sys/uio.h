@@ -0,0 +1,15 @@
+#ifndef _LIBC_BITS_SYS_UIO_H
+#define _LIBC_BITS_SYS_UIO_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#define IOV_MAX 1024
+
+struct iovec {
+    void* iov_base;
+    size_t iov_len;
+};
+typedef struct iovec iovec_t;
+
+#endif // _LIBC_BITS_SYS_UIO_H
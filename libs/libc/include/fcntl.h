@@ -2,6 +2,7 @@
 #define _LIBC_FCNTL_H
 
 #include <bits/fcntl.h>
+#include <bits/sys/splice.h>
 #include <sys/cdefs.h>
 #include <sys/types.h>
 
@@ -9,6 +10,7 @@ __BEGIN_DECLS
 
 int open(const char* pathname, int flags);
 int creat(const char* path, mode_t mode);
+ssize_t splice(int fd_in, off_t* off_in, int fd_out, off_t* off_out, size_t len, unsigned int flags);
 
 __END_DECLS
 
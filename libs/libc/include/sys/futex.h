@@ -0,0 +1,15 @@
+#ifndef _LIBC_SYS_FUTEX_H
+#define _LIBC_SYS_FUTEX_H
+
+#include <bits/sys/futex.h>
+#include <stddef.h>
+#include <sys/cdefs.h>
+#include <sys/types.h>
+
+__BEGIN_DECLS
+
+int futex(uint32_t* addr, int op, uint32_t val);
+
+__END_DECLS
+
+#endif // _LIBC_SYS_FUTEX_H
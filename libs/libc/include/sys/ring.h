@@ -0,0 +1,46 @@
+#ifndef _LIBC_SYS_RING_H
+#define _LIBC_SYS_RING_H
+
+#include <bits/sys/ring.h>
+#include <stddef.h>
+#include <sys/cdefs.h>
+#include <sys/types.h>
+
+__BEGIN_DECLS
+
+int ring_init(ring_t* ring, unsigned int entries);
+void ring_free(ring_t* ring);
+int ring_enter(ring_t* ring, unsigned int to_submit);
+
+/* Returns a free submission entry, it's passed to the kernel by the next ring_submit. */
+static inline ring_sqe_t* ring_get_sqe(ring_t* ring)
+{
+    if (ring->sq_tail - ring->sq_head == ring->entries) {
+        return NULL;
+    }
+    ring_sqe_t* sqe = &ring->sqes[ring->sq_tail & (ring->entries - 1)];
+    ring->sq_tail++;
+    return sqe;
+}
+
+static inline int ring_submit(ring_t* ring)
+{
+    return ring_enter(ring, ring->sq_tail - ring->sq_head);
+}
+
+static inline ring_cqe_t* ring_peek_cqe(ring_t* ring)
+{
+    if (ring->cq_head == ring->cq_tail) {
+        return NULL;
+    }
+    return &ring->cqes[ring->cq_head & (ring->entries - 1)];
+}
+
+static inline void ring_cqe_seen(ring_t* ring)
+{
+    ring->cq_head++;
+}
+
+__END_DECLS
+
+#endif // _LIBC_SYS_RING_H
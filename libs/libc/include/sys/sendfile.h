@@ -0,0 +1,14 @@
+#ifndef _LIBC_SYS_SENDFILE_H
+#define _LIBC_SYS_SENDFILE_H
+
+#include <stddef.h>
+#include <sys/cdefs.h>
+#include <sys/types.h>
+
+__BEGIN_DECLS
+
+ssize_t sendfile(int out_fd, int in_fd, off_t* offset, size_t count);
+
+__END_DECLS
+
+#endif // _LIBC_SYS_SENDFILE_H
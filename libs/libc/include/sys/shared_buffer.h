@@ -12,6 +12,9 @@ __BEGIN_DECLS
 int shared_buffer_create(uint8_t** buffer, size_t size);
 int shared_buffer_get(int id, uint8_t** buffer);
 int shared_buffer_free(int id);
+int shared_buffer_grant(int id, pid_t pid);
+int shared_buffer_revoke(int id, pid_t pid);
+int shared_buffer_resize(int id, size_t size);
 
 __END_DECLS
 
@@ -10,7 +10,9 @@ __BEGIN_DECLS
 
 int socket(int domain, int type, int protocol);
 int bind(int sockfd, const char* name, int len);
+int listen(int sockfd, int backlog);
 int connect(int sockfd, const char* name, int len);
+int accept(int sockfd);
 
 __END_DECLS
 
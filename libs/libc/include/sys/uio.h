@@ -0,0 +1,18 @@
+#ifndef _LIBC_SYS_UIO_H
+#define _LIBC_SYS_UIO_H
+
+#include <bits/sys/uio.h>
+#include <stddef.h>
+#include <sys/cdefs.h>
+#include <sys/types.h>
+
+__BEGIN_DECLS
+
+ssize_t readv(int fd, const struct iovec* iov, int iovcnt);
+ssize_t writev(int fd, const struct iovec* iov, int iovcnt);
+ssize_t preadv(int fd, const struct iovec* iov, int iovcnt, off_t offset);
+ssize_t pwritev(int fd, const struct iovec* iov, int iovcnt, off_t offset);
+
+__END_DECLS
+
+#endif // _LIBC_SYS_UIO_H
@@ -18,12 +18,19 @@ pid_t getpgid(pid_t arg);
 
 /* fs */
 int close(int fd);
+int pipe(int fds[2]);
+int dup2(int oldfd, int newfd);
 ssize_t read(int fd, char* buf, size_t count);
 ssize_t write(int fd, const void* buf, size_t count);
+ssize_t pread(int fd, void* buf, size_t count, off_t offset);
+ssize_t pwrite(int fd, const void* buf, size_t count, off_t offset);
 int rmdir(const char* path);
 int chdir(const char* path);
 int unlink(const char* path);
 off_t lseek(int fd, off_t off, int whence);
+int fsync(int fd);
+int fdatasync(int fd);
+void sync();
 
 /* identity */
 uid_t getuid();
@@ -1,5 +1,6 @@
 #include "malloc.h"
 #include <string.h>
+#include <sys/futex.h>
 #include <sys/mman.h>
 
 #define BLOCK_ALLOCATED (0)
@@ -8,8 +9,33 @@
 static malloc_header_t* memory[MALLOC_MAX_ALLOCATED_BLOCKS];
 static size_t allocated_blocks = 0;
 
+/* 0 is unlocked, 1 is locked, 2 is locked and someone waits for it. */
+static uint32_t malloc_lock = 0;
+
 static int _alloc_new_block(size_t sz);
 
+/**
+ * The heap is shared by all threads of a process. Threads sleep on a futex
+ * while the lock is taken, so an unlock without waiters costs no syscall.
+ */
+static inline void _malloc_lock()
+{
+    uint32_t state = 0;
+    if (__atomic_compare_exchange_n(&malloc_lock, &state, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return;
+    }
+    while (__atomic_exchange_n(&malloc_lock, 2, __ATOMIC_ACQUIRE) != 0) {
+        futex(&malloc_lock, FUTEX_WAIT, 2);
+    }
+}
+
+static inline void _malloc_unlock()
+{
+    if (__atomic_exchange_n(&malloc_lock, 0, __ATOMIC_RELEASE) == 2) {
+        futex(&malloc_lock, FUTEX_WAKE, 1);
+    }
+}
+
 static int _alloc_new_block(size_t sz)
 {
     sz += sizeof(malloc_header_t);
@@ -49,6 +75,8 @@ void* malloc(size_t sz)
     }
     sz += 3;
     sz &= ~(uint32_t)0x3;
+
+    _malloc_lock();
     /* iterating over allocated by mmap blocks
        and finding a first fit memory chunk */
     malloc_header_t* first_fit = 0;
@@ -67,6 +95,7 @@ void* malloc(size_t sz)
         int err = _alloc_new_block(sz);
         if (err) {
             /* TODO: Write to log this */
+            _malloc_unlock();
             return NULL;
         }
         first_fit = memory[allocated_blocks - 1];
@@ -91,6 +120,7 @@ void* malloc(size_t sz)
         }
     }
 
+    _malloc_unlock();
     return (void*)((uint32_t)first_fit + sizeof(malloc_header_t));
 }
 
@@ -102,6 +132,7 @@ void free(void* mem)
 
     malloc_header_t* mem_header = (malloc_header_t*)((uint32_t)mem - sizeof(malloc_header_t));
 
+    _malloc_lock();
     mem_header->free = BLOCK_FREE;
     if (mem_header->prev && mem_header->prev->free) {
         mem_header = mem_header->prev;
@@ -116,6 +147,7 @@ void free(void* mem)
         }
         mem_header->next = mem_header->next->next;
     }
+    _malloc_unlock();
 }
 
 void* calloc(size_t num, size_t size)
@@ -2,6 +2,7 @@
 #include <sys/mman.h>
 #include <sys/select.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <sysdep.h>
 #include <unistd.h>
 
@@ -23,6 +24,18 @@ int close(int fd)
     RETURN_WITH_ERRNO(res, 0, -1);
 }
 
+int pipe(int fds[2])
+{
+    int res = DO_SYSCALL_1(SYS_PIPE, fds);
+    RETURN_WITH_ERRNO(res, 0, -1);
+}
+
+int dup2(int oldfd, int newfd)
+{
+    int res = DO_SYSCALL_2(SYS_DUP2, oldfd, newfd);
+    RETURN_WITH_ERRNO(res, res, -1);
+}
+
 ssize_t read(int fd, char* buf, size_t count)
 {
     return (ssize_t)DO_SYSCALL_3(SYS_READ, fd, buf, count);
@@ -33,11 +46,64 @@ ssize_t write(int fd, const void* buf, size_t count)
     return (ssize_t)DO_SYSCALL_3(SYS_WRITE, fd, buf, count);
 }
 
+ssize_t pread(int fd, void* buf, size_t count, off_t offset)
+{
+    int res = DO_SYSCALL_4(SYS_PREAD, fd, buf, count, offset);
+    RETURN_WITH_ERRNO(res, res, -1);
+}
+
+ssize_t pwrite(int fd, const void* buf, size_t count, off_t offset)
+{
+    int res = DO_SYSCALL_4(SYS_PWRITE, fd, buf, count, offset);
+    RETURN_WITH_ERRNO(res, res, -1);
+}
+
+ssize_t readv(int fd, const struct iovec* iov, int iovcnt)
+{
+    int res = DO_SYSCALL_3(SYS_READV, fd, iov, iovcnt);
+    RETURN_WITH_ERRNO(res, res, -1);
+}
+
+ssize_t writev(int fd, const struct iovec* iov, int iovcnt)
+{
+    int res = DO_SYSCALL_3(SYS_WRITEV, fd, iov, iovcnt);
+    RETURN_WITH_ERRNO(res, res, -1);
+}
+
+ssize_t preadv(int fd, const struct iovec* iov, int iovcnt, off_t offset)
+{
+    int res = DO_SYSCALL_4(SYS_PREADV, fd, iov, iovcnt, offset);
+    RETURN_WITH_ERRNO(res, res, -1);
+}
+
+ssize_t pwritev(int fd, const struct iovec* iov, int iovcnt, off_t offset)
+{
+    int res = DO_SYSCALL_4(SYS_PWRITEV, fd, iov, iovcnt, offset);
+    RETURN_WITH_ERRNO(res, res, -1);
+}
+
 off_t lseek(int fd, off_t off, int whence)
 {
     return (off_t)DO_SYSCALL_3(SYS_LSEEK, fd, off, whence);
 }
 
+int fsync(int fd)
+{
+    int res = DO_SYSCALL_1(SYS_FSYNC, fd);
+    RETURN_WITH_ERRNO(res, 0, -1);
+}
+
+int fdatasync(int fd)
+{
+    int res = DO_SYSCALL_1(SYS_FDATASYNC, fd);
+    RETURN_WITH_ERRNO(res, 0, -1);
+}
+
+void sync()
+{
+    DO_SYSCALL_0(SYS_SYNC);
+}
+
 int mkdir(const char* path)
 {
     int res = DO_SYSCALL_1(SYS_MKDIR, path);
@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #define _IO_MAGIC 0xFBAD0000 /* Magic number */
@@ -341,28 +342,56 @@ static size_t _do_system_write(const void* ptr, size_t size, FILE* stream)
     return (size_t)write_cnt;
 }
 
+/**
+ * Writes the buffered data followed by ptr with one system call, so data
+ * which doesn't fit into the buffer isn't copied into it in pieces.
+ * The call is repeated while it writes only a part of the buffered data,
+ * on an error the unwritten part is kept in the buffer.
+ * Returns the number of written bytes of ptr.
+ */
+static size_t _flush_wbuf_with(const void* ptr, size_t size, FILE* stream)
+{
+    size_t buffered = stream->_bf.wbuf.size - stream->_w;
+    struct iovec iov[2] = {
+        { .iov_base = stream->_bf.wbuf.base, .iov_len = buffered },
+        { .iov_base = (void*)ptr, .iov_len = size },
+    };
+
+    ssize_t write_cnt = writev(stream->_file, iov, 2);
+    while (write_cnt > 0 && write_cnt < (ssize_t)iov[0].iov_len) {
+        iov[0].iov_base = (uint8_t*)iov[0].iov_base + write_cnt;
+        iov[0].iov_len -= write_cnt;
+        write_cnt = writev(stream->_file, iov, 2);
+    }
+
+    if (write_cnt < (ssize_t)iov[0].iov_len) {
+        memmove(stream->_bf.wbuf.base, iov[0].iov_base, iov[0].iov_len);
+        stream->_bf.wbuf.ptr = stream->_bf.wbuf.base + iov[0].iov_len;
+        stream->_w = stream->_bf.wbuf.size - iov[0].iov_len;
+        return 0;
+    }
+    stream->_w = stream->_bf.wbuf.size;
+    stream->_bf.wbuf.ptr = stream->_bf.wbuf.base;
+    return (size_t)write_cnt - iov[0].iov_len;
+}
+
 static size_t _fwrite_internal(const void* ptr, size_t size, FILE* stream)
 {
     if (!_can_use_buffer(stream)) {
         return _do_system_write(ptr, size, stream);
     }
 
-    size_t total_size = 0;
-
-    while (size > 0) {
-        size_t write_size = min(stream->_w, size);
-        memcpy(stream->_bf.wbuf.ptr, ptr, write_size);
-        ptr += write_size;
-        size -= write_size;
-        stream->_bf.wbuf.ptr += write_size;
-        stream->_w -= write_size;
-        total_size += write_size;
-        if (!stream->_w) {
-            _flush_wbuf(stream);
-        }
+    if (size > stream->_w) {
+        return _flush_wbuf_with(ptr, size, stream);
     }
 
-    return total_size;
+    memcpy(stream->_bf.wbuf.ptr, ptr, size);
+    stream->_bf.wbuf.ptr += size;
+    stream->_w -= size;
+    if (!stream->_w) {
+        _flush_wbuf(stream);
+    }
+    return size;
 }
 
 size_t fwrite(const void* ptr, size_t size, size_t count, FILE* stream)
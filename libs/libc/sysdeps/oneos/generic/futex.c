@@ -0,0 +1,8 @@
+#include <sys/futex.h>
+#include <sysdep.h>
+
+int futex(uint32_t* addr, int op, uint32_t val)
+{
+    int res = DO_SYSCALL_3(SYS_FUTEX, addr, op, val);
+    RETURN_WITH_ERRNO(res, res, -1);
+}
@@ -0,0 +1,39 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ring.h>
+#include <sysdep.h>
+
+int ring_init(ring_t* ring, unsigned int entries)
+{
+    if (!entries || entries > RING_MAX_ENTRIES || (entries & (entries - 1))) {
+        set_errno(EINVAL);
+        return -1;
+    }
+
+    memset(ring, 0, sizeof(ring_t));
+    ring->sqes = malloc(entries * sizeof(ring_sqe_t));
+    ring->cqes = malloc(entries * sizeof(ring_cqe_t));
+    if (!ring->sqes || !ring->cqes) {
+        ring_free(ring);
+        set_errno(ENOMEM);
+        return -1;
+    }
+    ring->entries = entries;
+    return 0;
+}
+
+void ring_free(ring_t* ring)
+{
+    free(ring->sqes);
+    free(ring->cqes);
+    ring->sqes = NULL;
+    ring->cqes = NULL;
+    ring->entries = 0;
+}
+
+int ring_enter(ring_t* ring, unsigned int to_submit)
+{
+    int res = DO_SYSCALL_2(SYS_RING_ENTER, ring, to_submit);
+    RETURN_WITH_ERRNO(res, res, -1);
+}
@@ -18,3 +18,21 @@ int shared_buffer_free(int id)
     int res = DO_SYSCALL_1(SYS_SHBUF_FREE, id);
     RETURN_WITH_ERRNO(res, res, res);
 }
+
+int shared_buffer_grant(int id, pid_t pid)
+{
+    int res = DO_SYSCALL_2(SYS_SHBUF_GRANT, id, pid);
+    RETURN_WITH_ERRNO(res, res, res);
+}
+
+int shared_buffer_revoke(int id, pid_t pid)
+{
+    int res = DO_SYSCALL_2(SYS_SHBUF_REVOKE, id, pid);
+    RETURN_WITH_ERRNO(res, res, res);
+}
+
+int shared_buffer_resize(int id, size_t size)
+{
+    int res = DO_SYSCALL_2(SYS_SHBUF_RESIZE, id, size);
+    RETURN_WITH_ERRNO(res, res, res);
+}
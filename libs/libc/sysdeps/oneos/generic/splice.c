@@ -0,0 +1,22 @@
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sysdep.h>
+
+ssize_t splice(int fd_in, off_t* off_in, int fd_out, off_t* off_out, size_t len, unsigned int flags)
+{
+    splice_params_t params = { 0 };
+    params.fd_in = fd_in;
+    params.off_in = off_in;
+    params.fd_out = fd_out;
+    params.off_out = off_out;
+    params.len = len;
+    params.flags = flags;
+    int res = DO_SYSCALL_1(SYS_SPLICE, &params);
+    RETURN_WITH_ERRNO(res, res, -1);
+}
+
+ssize_t sendfile(int out_fd, int in_fd, off_t* offset, size_t count)
+{
+    int res = DO_SYSCALL_4(SYS_SENDFILE, out_fd, in_fd, offset, count);
+    RETURN_WITH_ERRNO(res, res, -1);
+}
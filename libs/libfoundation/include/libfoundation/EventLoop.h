@@ -10,6 +10,7 @@
 #include <libfoundation/Event.h>
 #include <libfoundation/EventReceiver.h>
 #include <libfoundation/Receivers.h>
+#include <list>
 #include <memory>
 #include <vector>
 
@@ -48,9 +49,19 @@ public:
     static EventLoop& the();
     EventLoop();
 
-    inline void add(int fd, std::function<void(void)> on_read, std::function<void(void)> on_write)
+    static constexpr int MaxEventsPerWait = 32;
+
+    void add(int fd, std::function<void(void)> on_read, std::function<void(void)> on_write);
+    void remove(int fd);
+
+    // Pollers are called on every iteration to check sources, which can't be
+    // waited for with epoll, e.g. rings in shared memory. A poller queues events
+    // itself. Before the loop sleeps, it calls arm, which should make the source
+    // wake one of the loop's fds and return false, if the source has something
+    // already. The loop never sleeps while it has a poller without arm.
+    inline void add_poller(std::function<void(void)> poller, std::function<bool(void)> arm = nullptr)
     {
-        m_waiting_fds.push_back(FDWaiter(fd, on_read, on_write));
+        m_pollers.push_back(Poller { poller, arm });
     }
 
     inline void add(const Timer& timer)
@@ -69,16 +80,31 @@ public:
     }
 
     inline void stop(int exit_code) { m_exit_code = exit_code, m_stop_flag = true; }
-    void check_fds();
+    void check_fds(int timeout);
     void check_timers();
+    void check_pollers();
     void pump();
     int run();
 
 private:
+    struct Poller {
+        std::function<void(void)> poll;
+        std::function<bool(void)> arm;
+    };
+
+    // Milliseconds the loop may sleep in check_fds: till the nearest timer
+    // expires, or forever if there are no timers. 0, if something is pending.
+    int fds_timeout();
+
+    int m_epoll_fd { -1 };
     bool m_stop_flag { false };
     int m_exit_code { 0 };
-    std::vector<FDWaiter> m_waiting_fds;
+    // Note: Queued events keep references to waiters, so a list is used to
+    // keep them valid while new fds are added from callbacks.
+    std::list<FDWaiter> m_waiting_fds;
     std::vector<Timer> m_timers;
+    int m_fired_timers { 0 };
+    std::vector<Poller> m_pollers;
     std::vector<QueuedEvent> m_event_queue;
 };
 } // namespace LFoundation
\ No newline at end of file
@@ -72,13 +72,19 @@ public:
     void receive_event(std::unique_ptr<Event> event) override
     {
         if (event->type() == Event::Type::FdWaiterRead) {
-            m_on_read();
+            if (m_on_read) {
+                m_on_read();
+            }
         } else if (event->type() == Event::Type::FdWaiterWrite) {
-            m_on_write();
+            if (m_on_write) {
+                m_on_write();
+            }
         }
     }
 
     inline int fd() const { return m_fd; }
+    inline bool canceled() const { return m_fd < 0; }
+    inline void cancel() { m_fd = -1, m_on_read = nullptr, m_on_write = nullptr; }
 
 private:
     int m_fd;
@@ -143,11 +149,23 @@ public:
     }
 
     inline bool repeated() const { return m_repeat; }
+    inline bool fired() const { return m_fired; }
     inline bool expired(const std::timespec& now) const
     {
         return now.tv_sec > m_expire_time.tv_sec || (now.tv_sec == m_expire_time.tv_sec && now.tv_nsec >= m_expire_time.tv_nsec);
     }
 
+    // Rounded up, so a loop sleeping for that long finds the timer expired.
+    inline int ms_until_expire(const std::timespec& now) const
+    {
+        if (expired(now)) {
+            return 0;
+        }
+        long long ns = (long long)(m_expire_time.tv_sec - now.tv_sec) * 1000000000 + (m_expire_time.tv_nsec - now.tv_nsec);
+        long long ms = (ns + 999999) / 1000000;
+        return ms < 0x7fffffff ? (int)ms : 0x7fffffff;
+    }
+
     void reload(const std::timespec& now)
     {
         std::time_t secs = now.tv_nsec + (m_time_interval % 1000) * 1000000;
@@ -165,6 +183,7 @@ private:
     std::timespec m_expire_time;
     std::time_t m_time_interval;
     bool m_repeat { false };
+    bool m_fired { false }; // A one-shot timer, which has expired and waits to be erased.
 };
 
 class CallEvent final : public Event {
@@ -47,6 +47,29 @@ public:
         }
     }
 
+    // Only the creator of a buffer could let other processes open it.
+    bool grant(pid_t pid) const
+    {
+        return alive() && shared_buffer_grant(id(), pid) == 0;
+    }
+
+    bool revoke(pid_t pid) const
+    {
+        return alive() && shared_buffer_revoke(id(), pid) == 0;
+    }
+
+    // The buffer is resized in place, so it keeps its id and address in
+    // every process. Fails if the size is out of the space reserved at creation,
+    // which is at least the size of a screen bitmap.
+    bool resize(size_t size)
+    {
+        if (!alive() || shared_buffer_resize(id(), size) != 0) {
+            return false;
+        }
+        m_size = size;
+        return true;
+    }
+
     inline bool alive() const { return m_id >= 0; }
 
     inline const T& at(size_t i) const
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2020-2021 Nikita Melekhin. All rights reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <sys/types.h>
+
+namespace LFoundation {
+
+// Runs batches of independent jobs on a few worker threads and the calling
+// thread. Jobs are handed out by index, so what a job does must not depend on
+// the thread or on the order it runs in. Jobs may allocate, the heap is
+// locked, but anything else they share has to be safe to use from threads.
+//
+// Workers can't be stopped, they sleep on a futex between batches and live as
+// long as the process.
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t threads);
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    inline size_t threads() const { return m_threads; }
+
+    // Calls job(0) ... job(jobs - 1) and returns, when all of them are done.
+    void run(size_t jobs, std::function<void(size_t)> job);
+
+private:
+    static void worker_entry();
+    [[noreturn]] void worker_loop(uint32_t seen);
+    void work();
+
+    size_t m_threads { 0 };
+    std::function<void(size_t)>* m_job { nullptr };
+    size_t m_jobs { 0 };
+    uint32_t m_next_job { 0 };
+    // Every batch bumps the generation. The caller does not return until all
+    // workers are parked again, so no worker touches a batch after it ends.
+    uint32_t m_generation { 0 };
+    uint32_t m_parked { 0 };
+};
+
+} // namespace LFoundation
@@ -12,7 +12,7 @@
 #include <libfoundation/Logger.h>
 #include <memory>
 #include <sched.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
 #include <sys/time.h>
 #include <unistd.h>
 
@@ -28,53 +28,107 @@ EventLoop& EventLoop::the()
 EventLoop::EventLoop()
 {
     s_the = this;
+    m_epoll_fd = epoll_create(MaxEventsPerWait);
+    if (m_epoll_fd < 0) {
+        Logger::debug << "EventLoop: can't create epoll instance" << std::endl;
+    }
 }
 
-void EventLoop::check_fds()
+void EventLoop::add(int fd, std::function<void(void)> on_read, std::function<void(void)> on_write)
 {
-    if (m_waiting_fds.size() == 0) {
-        return;
+    m_waiting_fds.push_back(FDWaiter(fd, on_read, on_write));
+
+    // Waiters are level-triggered, as callbacks might leave data unread.
+    epoll_event event = {};
+    event.events = (on_read ? EPOLLIN : 0) | (on_write ? EPOLLOUT : 0);
+    event.data.ptr = &m_waiting_fds.back();
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        Logger::debug << "EventLoop: can't watch fd " << fd << std::endl;
     }
-    fd_set_t readfds;
-    fd_set_t writefds;
-    FD_ZERO(&readfds);
-    FD_ZERO(&writefds);
-    int nfds = -1;
-    for (int i = 0; i < m_waiting_fds.size(); i++) {
-        if (m_waiting_fds[i].m_on_read) {
-            FD_SET(m_waiting_fds[i].m_fd, &readfds);
-        }
-        if (m_waiting_fds[i].m_on_write) {
-            FD_SET(m_waiting_fds[i].m_fd, &writefds);
+}
+
+void EventLoop::remove(int fd)
+{
+    epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+
+    // Waiters are only canceled here, since their events might be queued,
+    // they are erased on the next check.
+    for (auto& waiter : m_waiting_fds) {
+        if (waiter.fd() == fd) {
+            waiter.cancel();
         }
-        if (nfds < m_waiting_fds[i].m_fd) {
-            nfds = m_waiting_fds[i].m_fd;
+    }
+}
+
+int EventLoop::fds_timeout()
+{
+    if (!m_event_queue.empty()) {
+        return 0;
+    }
+
+    for (auto& poller : m_pollers) {
+        if (!poller.arm || !poller.arm()) {
+            return 0;
         }
     }
 
-    // For now, that means, that we don't wait for fds.
-    timeval_t timeout;
-    timeout.tv_sec = 0;
-    timeout.tv_usec = 0;
+    if (m_timers.empty()) {
+        return -1;
+    }
 
-    int res = select(nfds + 1, &readfds, &writefds, nullptr, &timeout);
+    std::timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    int timeout = -1;
+    for (auto& timer : m_timers) {
+        if (timer.fired()) {
+            continue;
+        }
+        int left = timer.ms_until_expire(tp);
+        if (timeout < 0 || left < timeout) {
+            timeout = left;
+        }
+    }
+    return timeout;
+}
 
-    for (int i = 0; i < m_waiting_fds.size(); i++) {
-        if (m_waiting_fds[i].m_on_read) {
-            if (FD_ISSET(m_waiting_fds[i].m_fd, &readfds)) {
-                m_event_queue.push_back(QueuedEvent(m_waiting_fds[i], new FDWaiterReadEvent()));
-            }
+void EventLoop::check_fds(int timeout)
+{
+    for (auto it = m_waiting_fds.begin(); it != m_waiting_fds.end();) {
+        if ((*it).canceled()) {
+            it = m_waiting_fds.erase(it);
+        } else {
+            ++it;
         }
-        if (m_waiting_fds[i].m_on_write) {
-            if (FD_ISSET(m_waiting_fds[i].m_fd, &writefds)) {
-                m_event_queue.push_back(QueuedEvent(m_waiting_fds[i], new FDWaiterWriteEvent()));
-            }
+    }
+
+    // Only ready fds are returned, so the cost doesn't grow with the number of waiters.
+    epoll_event events[MaxEventsPerWait];
+    int res = epoll_wait(m_epoll_fd, events, MaxEventsPerWait, timeout);
+    for (int i = 0; i < res; i++) {
+        auto& waiter = *(FDWaiter*)events[i].data.ptr;
+        if ((events[i].events & EPOLLIN) && waiter.m_on_read) {
+            m_event_queue.push_back(QueuedEvent(waiter, new FDWaiterReadEvent()));
+        }
+        if ((events[i].events & EPOLLOUT) && waiter.m_on_write) {
+            m_event_queue.push_back(QueuedEvent(waiter, new FDWaiterWriteEvent()));
         }
     }
 }
 
 void EventLoop::check_timers()
 {
+    // Events of fired timers have been dispatched by now, so nothing refers to them.
+    if (m_fired_timers) {
+        std::vector<Timer> alive;
+        for (auto& timer : m_timers) {
+            if (!timer.fired()) {
+                alive.push_back(std::move(timer));
+            }
+        }
+        m_timers = std::move(alive);
+        m_fired_timers = 0;
+    }
+
     if (m_timers.empty()) {
         return;
     }
@@ -91,21 +145,34 @@ void EventLoop::check_timers()
 
         if (timer.repeated()) {
             timer.reload(tp);
+        } else {
+            timer.m_fired = true;
+            m_fired_timers++;
         }
     }
 }
 
+void EventLoop::check_pollers()
+{
+    for (int i = 0; i < m_pollers.size(); i++) {
+        m_pollers[i].poll();
+    }
+}
+
 [[gnu::flatten]] void EventLoop::pump()
 {
-    check_fds();
+    int timeout = fds_timeout();
+    check_fds(timeout);
     check_timers();
+    check_pollers();
     std::vector<QueuedEvent> events_to_dispatch(std::move(m_event_queue));
     m_event_queue.clear();
     for (auto& event : events_to_dispatch) {
         event.receiver.receive_event(std::move(event.event));
     }
 
-    if (!events_to_dispatch.size()) {
+    // Only a poller without arm could leave the loop with nothing to do and no sleep.
+    if (!events_to_dispatch.size() && timeout == 0) {
         sched_yield();
     }
 }
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2020-2021 Nikita Melekhin. All rights reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <libfoundation/Logger.h>
+#include <libfoundation/WorkerPool.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/futex.h>
+
+namespace LFoundation {
+
+// Threads are started without an argument, so a new worker picks its pool up
+// from here. Workers are started one at a time.
+static WorkerPool* s_starting_pool = nullptr;
+
+WorkerPool::WorkerPool(size_t threads)
+{
+    for (size_t i = 0; i < threads; i++) {
+        __atomic_store_n(&s_starting_pool, this, __ATOMIC_SEQ_CST);
+        if (pthread_create((void*)worker_entry) < 0) {
+            Logger::debug << "WorkerPool: can't start a worker" << std::endl;
+            break;
+        }
+        while (__atomic_load_n(&s_starting_pool, __ATOMIC_SEQ_CST)) {
+            sched_yield();
+        }
+        m_threads++;
+    }
+}
+
+// The generation is read before the worker is reported as started: a batch
+// can be run right after the constructor returns, and it must not be taken
+// for the one the worker has already seen.
+void WorkerPool::worker_entry()
+{
+    auto* pool = __atomic_load_n(&s_starting_pool, __ATOMIC_SEQ_CST);
+    uint32_t seen = __atomic_load_n(&pool->m_generation, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&s_starting_pool, nullptr, __ATOMIC_SEQ_CST);
+    pool->worker_loop(seen);
+}
+
+void WorkerPool::worker_loop(uint32_t seen)
+{
+    for (;;) {
+        uint32_t generation = __atomic_load_n(&m_generation, __ATOMIC_SEQ_CST);
+        if (generation == seen) {
+            futex(&m_generation, FUTEX_WAIT, seen);
+            continue;
+        }
+
+        seen = generation;
+        work();
+        if (__atomic_add_fetch(&m_parked, 1, __ATOMIC_SEQ_CST) == m_threads) {
+            futex(&m_parked, FUTEX_WAKE, 1);
+        }
+    }
+}
+
+void WorkerPool::work()
+{
+    for (;;) {
+        size_t index = __atomic_fetch_add(&m_next_job, 1, __ATOMIC_SEQ_CST);
+        if (index >= m_jobs) {
+            return;
+        }
+        (*m_job)(size_t(index));
+    }
+}
+
+void WorkerPool::run(size_t jobs, std::function<void(size_t)> job)
+{
+    if (!m_threads || jobs <= 1) {
+        for (size_t i = 0; i < jobs; i++) {
+            job(size_t(i));
+        }
+        return;
+    }
+
+    m_job = &job;
+    m_jobs = jobs;
+    __atomic_store_n(&m_next_job, 0, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&m_parked, 0, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&m_generation, 1, __ATOMIC_SEQ_CST);
+    futex(&m_generation, FUTEX_WAKE, m_threads);
+
+    work();
+    for (;;) {
+        uint32_t parked = __atomic_load_n(&m_parked, __ATOMIC_SEQ_CST);
+        if (parked == m_threads) {
+            break;
+        }
+        futex(&m_parked, FUTEX_WAIT, parked);
+    }
+}
+
+} // namespace LFoundation
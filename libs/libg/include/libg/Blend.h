@@ -0,0 +1,28 @@
+/*
+ * Copyright (C) 2020-2021 Nikita Melekhin. All rights reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <libg/Color.h>
+#include <sys/types.h>
+
+namespace LG {
+
+// Row blenders used by Context to draw transparent pixels. Every pixel ends
+// up exactly as Color::mix_with() would leave it, but pixels over a solid
+// destination are blended with SSE2 (x86) or NEON (aarch32), when the CPU
+// has them, or with Color::blend_over_solid() otherwise.
+void blend_row(Color* dest, const Color* src, size_t count);
+void blend_row(Color* dest, const Color& color, size_t count);
+
+// The same for premultiplied pixels: @dest and @src are both premultiplied
+// (a solid destination is the same in both formats). Every pixel is blended
+// with a multiply-add, so these have no fallbacks to per pixel mixing.
+void blend_premultiplied_row(Color* dest, const Color* src, size_t count);
+void blend_premultiplied_row(Color* dest, const Color& color, size_t count);
+
+} // namespace LG
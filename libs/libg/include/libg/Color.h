@@ -91,6 +91,11 @@ public:
             return;
         }
 
+        if (alpha() == 255) {
+            *this = Color(blend_over_solid(u32(), clr.u32()));
+            return;
+        }
+
         int alpha_c = 255 * (alpha() + clr.alpha()) - alpha() * clr.alpha();
         int alpha_of_me = alpha() * (255 - clr.alpha());
         int alpha_of_it = 255 * clr.alpha();
@@ -101,6 +106,65 @@ public:
         m_opacity = 255 - (alpha_c / 255);
     }
 
+    // Same as mix_with(), but both colors are premultiplied by their alpha, so
+    // the result is just clr + this * (1 - clr.alpha) for every channel.
+    [[gnu::always_inline]] inline void mix_with_premultiplied(const Color& clr)
+    {
+        uint32_t me = u32();
+        uint32_t op = clr.m_opacity;
+
+        uint32_t rb = (me & 0x00FF00FF) * op;
+        uint32_t og = ((me >> 8) & 0x00FF00FF) * op;
+        rb = ((rb + 0x00800080 + (((rb + 0x00800080) >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+        og = ((og + 0x00800080 + (((og + 0x00800080) >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+
+        // Neither channel can overflow: a premultiplied channel is not bigger
+        // than its alpha, so the sum is up to alpha + opacity = 255.
+        *this = Color((rb | (og << 8)) + (clr.u32() & 0x00FFFFFF));
+    }
+
+    inline Color premultiplied() const
+    {
+        Color res(*this);
+        uint32_t a = alpha();
+        res.m_r = mul_div255(m_r, a);
+        res.m_g = mul_div255(m_g, a);
+        res.m_b = mul_div255(m_b, a);
+        return res;
+    }
+
+    inline Color unpremultiplied() const
+    {
+        uint32_t a = alpha();
+        if (a == 0) {
+            return Color(0, 0, 0, 0);
+        }
+
+        Color res(*this);
+        res.m_r = unpremultiply_channel(m_r, a);
+        res.m_g = unpremultiply_channel(m_g, a);
+        res.m_b = unpremultiply_channel(m_b, a);
+        return res;
+    }
+
+    // Puts @src over @dest, which must have no transparency. The result is the
+    // same as mix_with() gives, but no divisions are used: both red and blue
+    // are computed at once in 16-bit halves of one word, and x / 255 is taken
+    // as (x + 1 + (x >> 8)) >> 8, which is exact for x up to 255 * 255.
+    static inline uint32_t blend_over_solid(uint32_t dest, uint32_t src)
+    {
+        uint32_t src_opacity = src >> 24;
+        uint32_t src_alpha = 255 - src_opacity;
+
+        uint32_t rb = (src & 0x00FF00FF) * src_alpha + (dest & 0x00FF00FF) * src_opacity;
+        rb = ((rb + 0x00010001 + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+
+        uint32_t g = ((src >> 8) & 0xFF) * src_alpha + ((dest >> 8) & 0xFF) * src_opacity;
+        g = (g + 1 + (g >> 8)) >> 8;
+
+        return rb | (g << 8);
+    }
+
     inline LG::Color darken(int percents) const
     {
         double multiplier = 1.0 - (double(percents) / 100.0);
@@ -111,6 +175,19 @@ public:
     }
 
 private:
+    // Rounded x * y / 255.
+    static inline uint8_t mul_div255(uint32_t x, uint32_t y)
+    {
+        uint32_t t = x * y + 128;
+        return (t + (t >> 8)) >> 8;
+    }
+
+    static inline uint8_t unpremultiply_channel(uint32_t channel, uint32_t alpha)
+    {
+        uint32_t res = (channel * 255 + alpha / 2) / alpha;
+        return res > 255 ? 255 : res;
+    }
+
     uint8_t m_b { 0 };
     uint8_t m_g { 0 };
     uint8_t m_r { 0 };
@@ -31,6 +31,7 @@ public:
     void draw(const Point<int>& start, const PixelBitmap& bitmap);
     void draw_with_bounds(const Rect& rect, const PixelBitmap& bitmap);
     void draw(const Point<int>& start, const GlyphBitmap& bitmap);
+    void draw_text(const Point<int>& start, const Font& font, const char* text, size_t length);
     void draw_rounded(const Point<int>& start, const PixelBitmap& bitmap, const CornerMask& mask = { 0, false, false });
     void draw_shading(const Rect& rect, const Shading& shading);
     void draw_box_shading(const Rect& rect, const Shading& shading, const CornerMask& mask = { 0, false, false });
@@ -47,6 +48,20 @@ public:
     inline const Color& fill_color() const { return m_color; }
 
 private:
+    // Colors and RGBA bitmaps come in straight alpha, these put them to the
+    // target bitmap in its own format.
+    inline Color target_color(const Color& color) const { return m_bitmap.is_premultiplied() ? color.premultiplied() : color; }
+    [[gnu::always_inline]] inline void mix_pixel(Color& pixel, const Color& color) const
+    {
+        if (m_bitmap.is_premultiplied()) {
+            pixel.mix_with_premultiplied(color.premultiplied());
+        } else {
+            pixel.mix_with(color);
+        }
+    }
+    void mix_row(Color* dest, const Color& color, size_t count) const;
+    void draw_row(Color* dest, const Color* src, size_t count, const PixelBitmap& bitmap) const;
+
     void fill_rounded_helper(const Point<int>& start, size_t radius);
     void draw_rounded_helper(const Point<int>& start, size_t radius, const PixelBitmap& bitmap);
     void shadow_rounded_helper(const Point<int>& start, size_t radius, const Shading& shading);
@@ -15,6 +15,7 @@
 namespace LG {
 
 class Font;
+class GlyphAtlas;
 class GlyphBitmap {
 public:
     friend class Font;
@@ -50,7 +51,7 @@ public:
     };
 
     Font(uint32_t* raw_data, uint8_t* width_data, uint8_t width, uint8_t height, size_t count, bool dynamic_width, uint8_t glyph_spacing);
-    ~Font() = default;
+    ~Font();
 
     static Font& system_font();
     static Font& system_bold_font();
@@ -60,8 +61,12 @@ public:
     inline size_t glyph_width(size_t ch) const { return m_dynamic_width ? m_width_data[ch] : m_width; }
     inline size_t glyph_height() const { return m_height; }
     inline size_t glyph_spacing() const { return m_spacing; }
+    inline size_t glyph_count() const { return m_count; }
     GlyphBitmap glyph_bitmap(size_t ch) const;
 
+    // Built on first use, see GlyphAtlas.
+    const GlyphAtlas& atlas() const;
+
 private:
     uint32_t* m_raw_data;
     uint8_t* m_width_data;
@@ -70,6 +75,7 @@ private:
     size_t m_spacing;
     size_t m_count;
     bool m_dynamic_width;
+    mutable GlyphAtlas* m_atlas { nullptr };
 };
 
 } // namespace LG
\ No newline at end of file
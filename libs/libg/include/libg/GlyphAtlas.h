@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2020-2021 Nikita Melekhin. All rights reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+#include <vector>
+
+namespace LG {
+
+class Font;
+
+// All glyphs of a font rasterized once into a strip of alpha values, one byte
+// per pixel, glyph after glyph. The atlas keeps only coverage, the color is
+// applied while a run is drawn, so one atlas serves every color of the font.
+class GlyphAtlas {
+public:
+    struct Glyph {
+        uint32_t offset;
+        uint8_t width;
+        // A bit per row of the glyph, set when the row has covered pixels.
+        // Rows from 31 on share the last bit.
+        uint32_t rows_mask;
+
+        inline bool blank() const { return !rows_mask; }
+        inline bool has_row(size_t y) const { return rows_mask & row_bit(y); }
+    };
+
+    static inline uint32_t row_bit(size_t y) { return 1u << (y < 31 ? y : 31); }
+
+    explicit GlyphAtlas(const Font& font);
+    ~GlyphAtlas() = default;
+
+    GlyphAtlas(const GlyphAtlas&) = delete;
+    GlyphAtlas& operator=(const GlyphAtlas&) = delete;
+
+    inline size_t height() const { return m_height; }
+    inline size_t glyph_count() const { return m_glyphs.size(); }
+    inline const Glyph& glyph(size_t ch) const { return m_glyphs[ch]; }
+    inline const uint8_t* alpha_row(const Glyph& glyph, size_t y) const { return &m_alpha[y * m_width + glyph.offset]; }
+
+private:
+    std::vector<Glyph> m_glyphs;
+    std::vector<uint8_t> m_alpha;
+    size_t m_width { 0 };
+    size_t m_height { 0 };
+};
+
+} // namespace LG
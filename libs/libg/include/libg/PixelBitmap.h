@@ -18,6 +18,9 @@ namespace LG {
 enum PixelBitmapFormat {
     RGB,
     RGBA,
+    // RGBA with color channels already multiplied by alpha, which is
+    // cheaper to draw. PNGs are loaded in this format.
+    RGBAPremultiplied,
 };
 
 class PixelBitmap {
@@ -84,7 +87,12 @@ public:
 
     inline void set_format(PixelBitmapFormat format) { m_format = format; }
     inline PixelBitmapFormat format() const { return m_format; }
-    inline bool has_alpha_channel() const { return m_format == RGBA; }
+    inline bool has_alpha_channel() const { return m_format == RGBA || m_format == RGBAPremultiplied; }
+    inline bool is_premultiplied() const { return m_format == RGBAPremultiplied; }
+
+    // Convert straight alpha pixels to RGBAPremultiplied and back.
+    void premultiply();
+    void unpremultiply();
 
 private:
     Color* m_data { nullptr };
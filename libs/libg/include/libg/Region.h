@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2020-2021 Nikita Melekhin. All rights reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <libg/Rect.h>
+#include <sys/types.h>
+#include <vector>
+
+namespace LG {
+
+// A set of pixels kept as a y-x banded list of rects: the rects are split into
+// bands, all rects of a band have the same top and bottom, go left to right and
+// don't touch each other. Neighbour bands with the same rects are merged into
+// one, so every region has the only representation.
+class Region {
+public:
+    Region() = default;
+    Region(const Rect& rect);
+
+    inline bool empty() const { return m_rects.empty(); }
+    inline const std::vector<Rect>& rects() const { return m_rects; }
+    inline const Rect& bounds() const { return m_bounds; }
+    size_t square() const;
+
+    bool intersects(const Rect& rect) const;
+    bool contains(const Rect& rect) const;
+
+    void unite(const Region& other);
+    void intersect(const Region& other);
+    void subtract(const Region& other);
+
+    Region union_of(const Region& other) const;
+    Region intersection(const Region& other) const;
+    Region difference(const Region& other) const;
+
+    void offset_by(int x, int y);
+    void clear();
+
+private:
+    enum class Op {
+        Union,
+        Intersect,
+        Subtract,
+    };
+
+    static Region combine(const Region& a, const Region& b, Op op);
+    void update_bounds();
+
+    std::vector<Rect> m_rects;
+    Rect m_bounds {};
+};
+
+} // namespace LG
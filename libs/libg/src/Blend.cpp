@@ -0,0 +1,400 @@
+/*
+ * Copyright (C) 2020-2021 Nikita Melekhin. All rights reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <libfoundation/Memory.h>
+#include <libg/Blend.h>
+
+#ifdef __i386__
+#include <cpuid.h>
+#include <emmintrin.h>
+#elif defined(__arm__) && defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+namespace LG {
+
+namespace {
+
+    // A fill color with its channels already multiplied by its alpha, so
+    // a pixel of a solid destination costs two multiplications.
+    struct FillColor {
+        FillColor(const Color& clr)
+            : color(clr)
+            , r(clr.red() * clr.alpha())
+            , g(clr.green() * clr.alpha())
+            , b(clr.blue() * clr.alpha())
+            , opacity(255 - clr.alpha())
+        {
+        }
+
+        inline void blend_into(Color& dest) const
+        {
+            if (dest.alpha() != 255) {
+                dest.mix_with(color);
+                return;
+            }
+
+            uint32_t d = dest.u32();
+            uint32_t rb = ((r << 16) | b) + (d & 0x00FF00FF) * opacity;
+            rb = ((rb + 0x00010001 + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+            uint32_t res_g = g + ((d >> 8) & 0xFF) * opacity;
+            res_g = (res_g + 1 + (res_g >> 8)) >> 8;
+            dest = Color(rb | (res_g << 8));
+        }
+
+        Color color;
+        uint32_t r;
+        uint32_t g;
+        uint32_t b;
+        uint32_t opacity;
+    };
+
+#ifdef __i386__
+    bool cpu_has_sse2()
+    {
+        static int has_sse2 = -1;
+        if (has_sse2 < 0) {
+            unsigned int eax, ebx, ecx, edx;
+            has_sse2 = __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (edx & bit_SSE2);
+        }
+        return has_sse2;
+    }
+
+    // Every 16-bit lane is divided by 255, see Color::blend_over_solid().
+    [[gnu::target("sse2")]] inline __m128i div255_sse2(__m128i x)
+    {
+        x = _mm_add_epi16(x, _mm_add_epi16(_mm_srli_epi16(x, 8), _mm_set1_epi16(1)));
+        return _mm_srli_epi16(x, 8);
+    }
+
+    [[gnu::target("sse2")]] inline bool is_solid_sse2(__m128i pixels)
+    {
+        __m128i opacity = _mm_and_si128(pixels, _mm_set1_epi32((int)0xFF000000));
+        return _mm_movemask_epi8(_mm_cmpeq_epi32(opacity, _mm_setzero_si128())) == 0xFFFF;
+    }
+
+    // Blends 4 pixels at a time. Returns the number of pixels done, the rest
+    // (less than 4) is left to the caller.
+    [[gnu::target("sse2")]] size_t blend_row_sse2(Color* dest, const Color* src, size_t count)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i opacity_mask = _mm_set1_epi32((int)0xFF000000);
+        const __m128i full = _mm_set1_epi32(255);
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(s, opacity_mask), opacity_mask)) == 0xFFFF) {
+                continue;
+            }
+            if (is_solid_sse2(s)) {
+                _mm_storeu_si128((__m128i*)(dest + i), s);
+                continue;
+            }
+
+            __m128i d = _mm_loadu_si128((const __m128i*)(dest + i));
+            if (!is_solid_sse2(d)) {
+                for (size_t j = i; j < i + 4; j++) {
+                    dest[j].mix_with(src[j]);
+                }
+                continue;
+            }
+
+            // Alpha and opacity of a pixel are spread to all 4 of its lanes.
+            __m128i op = _mm_srli_epi32(s, 24);
+            __m128i alpha = _mm_sub_epi32(full, op);
+            op = _mm_or_si128(op, _mm_slli_epi32(op, 16));
+            alpha = _mm_or_si128(alpha, _mm_slli_epi32(alpha, 16));
+
+            __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi32(alpha, alpha)),
+                _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi32(op, op)));
+            __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi32(alpha, alpha)),
+                _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi32(op, op)));
+
+            __m128i res = _mm_packus_epi16(div255_sse2(lo), div255_sse2(hi));
+            _mm_storeu_si128((__m128i*)(dest + i), _mm_andnot_si128(opacity_mask, res));
+        }
+        return i;
+    }
+
+    [[gnu::target("sse2")]] size_t blend_row_sse2(Color* dest, const FillColor& color, size_t count)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i opacity_mask = _mm_set1_epi32((int)0xFF000000);
+        const __m128i op = _mm_set1_epi16(color.opacity);
+        const __m128i premultiplied = _mm_set_epi16(0, color.r, color.g, color.b, 0, color.r, color.g, color.b);
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128i d = _mm_loadu_si128((const __m128i*)(dest + i));
+            if (!is_solid_sse2(d)) {
+                for (size_t j = i; j < i + 4; j++) {
+                    color.blend_into(dest[j]);
+                }
+                continue;
+            }
+
+            __m128i lo = _mm_add_epi16(premultiplied, _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), op));
+            __m128i hi = _mm_add_epi16(premultiplied, _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), op));
+            __m128i res = _mm_packus_epi16(div255_sse2(lo), div255_sse2(hi));
+            _mm_storeu_si128((__m128i*)(dest + i), _mm_andnot_si128(opacity_mask, res));
+        }
+        return i;
+    }
+
+    // Rounded x * op / 255 for every byte of @pixels, where op is given per
+    // 16-bit lane for the low and the high half of them.
+    [[gnu::target("sse2")]] inline __m128i mul_div255_sse2(__m128i pixels, __m128i op_lo, __m128i op_hi)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i half = _mm_set1_epi16(128);
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(pixels, zero), op_lo), half);
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(pixels, zero), op_hi), half);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+        return _mm_packus_epi16(lo, hi);
+    }
+
+    [[gnu::target("sse2")]] size_t blend_premultiplied_row_sse2(Color* dest, const Color* src, size_t count)
+    {
+        const __m128i opacity_mask = _mm_set1_epi32((int)0xFF000000);
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(s, opacity_mask)) == 0xFFFF) {
+                continue;
+            }
+            if (is_solid_sse2(s)) {
+                _mm_storeu_si128((__m128i*)(dest + i), s);
+                continue;
+            }
+
+            __m128i op = _mm_srli_epi32(s, 24);
+            op = _mm_or_si128(op, _mm_slli_epi32(op, 16));
+            __m128i d = _mm_loadu_si128((const __m128i*)(dest + i));
+            d = mul_div255_sse2(d, _mm_unpacklo_epi32(op, op), _mm_unpackhi_epi32(op, op));
+            _mm_storeu_si128((__m128i*)(dest + i), _mm_adds_epu8(d, _mm_andnot_si128(opacity_mask, s)));
+        }
+        return i;
+    }
+
+    [[gnu::target("sse2")]] size_t blend_premultiplied_row_sse2(Color* dest, const Color& color, size_t count)
+    {
+        const __m128i op = _mm_set1_epi16(255 - color.alpha());
+        const __m128i channels = _mm_set1_epi32(color.u32() & 0x00FFFFFF);
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128i d = _mm_loadu_si128((const __m128i*)(dest + i));
+            d = mul_div255_sse2(d, op, op);
+            _mm_storeu_si128((__m128i*)(dest + i), _mm_adds_epu8(d, channels));
+        }
+        return i;
+    }
+#elif defined(__arm__) && defined(__ARM_NEON__)
+    // Every lane is divided by 255 and narrowed, see Color::blend_over_solid().
+    inline uint8x8_t div255_neon(uint16x8_t x)
+    {
+        return vshrn_n_u16(vsraq_n_u16(vaddq_u16(x, vdupq_n_u16(1)), x, 8), 8);
+    }
+
+    inline uint64_t lanes_of(uint8x8_t channel)
+    {
+        return vget_lane_u64(vreinterpret_u64_u8(channel), 0);
+    }
+
+    // Blends 8 pixels at a time, split into planes of one channel. Returns the
+    // number of pixels done, the rest (less than 8) is left to the caller.
+    size_t blend_row_neon(Color* dest, const Color* src, size_t count)
+    {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            uint8x8x4_t s = vld4_u8((const uint8_t*)(src + i));
+            uint64_t s_opacity = lanes_of(s.val[3]);
+            if (s_opacity == 0xFFFFFFFFFFFFFFFFULL) {
+                continue;
+            }
+            if (s_opacity == 0) {
+                vst4_u8((uint8_t*)(dest + i), s);
+                continue;
+            }
+
+            uint8x8x4_t d = vld4_u8((const uint8_t*)(dest + i));
+            if (lanes_of(d.val[3]) != 0) {
+                for (size_t j = i; j < i + 8; j++) {
+                    dest[j].mix_with(src[j]);
+                }
+                continue;
+            }
+
+            uint8x8_t op = s.val[3];
+            uint8x8_t alpha = vmvn_u8(op);
+            for (int c = 0; c < 3; c++) {
+                d.val[c] = div255_neon(vmlal_u8(vmull_u8(s.val[c], alpha), d.val[c], op));
+            }
+            vst4_u8((uint8_t*)(dest + i), d);
+        }
+        return i;
+    }
+
+    size_t blend_row_neon(Color* dest, const FillColor& color, size_t count)
+    {
+        const uint16x8_t premultiplied[3] = { vdupq_n_u16(color.b), vdupq_n_u16(color.g), vdupq_n_u16(color.r) };
+        const uint8x8_t op = vdup_n_u8(color.opacity);
+
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            uint8x8x4_t d = vld4_u8((const uint8_t*)(dest + i));
+            if (lanes_of(d.val[3]) != 0) {
+                for (size_t j = i; j < i + 8; j++) {
+                    color.blend_into(dest[j]);
+                }
+                continue;
+            }
+
+            for (int c = 0; c < 3; c++) {
+                d.val[c] = div255_neon(vmlal_u8(premultiplied[c], d.val[c], op));
+            }
+            vst4_u8((uint8_t*)(dest + i), d);
+        }
+        return i;
+    }
+
+    // Rounded x * y / 255 for every lane.
+    inline uint8x8_t mul_div255_neon(uint8x8_t x, uint8x8_t y)
+    {
+        uint16x8_t t = vmlal_u8(vdupq_n_u16(128), x, y);
+        return vshrn_n_u16(vsraq_n_u16(t, t, 8), 8);
+    }
+
+    size_t blend_premultiplied_row_neon(Color* dest, const Color* src, size_t count)
+    {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            uint8x8x4_t s = vld4_u8((const uint8_t*)(src + i));
+            uint64_t s_opacity = lanes_of(s.val[3]);
+            if (s_opacity == 0xFFFFFFFFFFFFFFFFULL && lanes_of(vorr_u8(vorr_u8(s.val[0], s.val[1]), s.val[2])) == 0) {
+                continue;
+            }
+            if (s_opacity == 0) {
+                vst4_u8((uint8_t*)(dest + i), s);
+                continue;
+            }
+
+            uint8x8x4_t d = vld4_u8((const uint8_t*)(dest + i));
+            for (int c = 0; c < 3; c++) {
+                d.val[c] = vqadd_u8(mul_div255_neon(d.val[c], s.val[3]), s.val[c]);
+            }
+            d.val[3] = mul_div255_neon(d.val[3], s.val[3]);
+            vst4_u8((uint8_t*)(dest + i), d);
+        }
+        return i;
+    }
+
+    size_t blend_premultiplied_row_neon(Color* dest, const Color& color, size_t count)
+    {
+        const uint8x8_t channels[3] = { vdup_n_u8(color.blue()), vdup_n_u8(color.green()), vdup_n_u8(color.red()) };
+        const uint8x8_t op = vdup_n_u8(255 - color.alpha());
+
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            uint8x8x4_t d = vld4_u8((const uint8_t*)(dest + i));
+            for (int c = 0; c < 3; c++) {
+                d.val[c] = vqadd_u8(mul_div255_neon(d.val[c], op), channels[c]);
+            }
+            d.val[3] = mul_div255_neon(d.val[3], op);
+            vst4_u8((uint8_t*)(dest + i), d);
+        }
+        return i;
+    }
+#endif
+
+} // namespace
+
+void blend_row(Color* dest, const Color* src, size_t count)
+{
+    size_t done = 0;
+#ifdef __i386__
+    if (cpu_has_sse2()) {
+        done = blend_row_sse2(dest, src, count);
+    }
+#elif defined(__arm__) && defined(__ARM_NEON__)
+    done = blend_row_neon(dest, src, count);
+#endif
+
+    for (size_t i = done; i < count; i++) {
+        dest[i].mix_with(src[i]);
+    }
+}
+
+void blend_row(Color* dest, const Color& color, size_t count)
+{
+    if (color.is_opaque()) {
+        return;
+    }
+    if (color.alpha() == 255) {
+        LFoundation::fast_set((uint32_t*)dest, color.u32(), count);
+        return;
+    }
+
+    FillColor premultiplied(color);
+    size_t done = 0;
+#ifdef __i386__
+    if (cpu_has_sse2()) {
+        done = blend_row_sse2(dest, premultiplied, count);
+    }
+#elif defined(__arm__) && defined(__ARM_NEON__)
+    done = blend_row_neon(dest, premultiplied, count);
+#endif
+
+    for (size_t i = done; i < count; i++) {
+        premultiplied.blend_into(dest[i]);
+    }
+}
+
+void blend_premultiplied_row(Color* dest, const Color* src, size_t count)
+{
+    size_t done = 0;
+#ifdef __i386__
+    if (cpu_has_sse2()) {
+        done = blend_premultiplied_row_sse2(dest, src, count);
+    }
+#elif defined(__arm__) && defined(__ARM_NEON__)
+    done = blend_premultiplied_row_neon(dest, src, count);
+#endif
+
+    for (size_t i = done; i < count; i++) {
+        dest[i].mix_with_premultiplied(src[i]);
+    }
+}
+
+void blend_premultiplied_row(Color* dest, const Color& color, size_t count)
+{
+    if (color.u32() == 0xFF000000) {
+        return;
+    }
+    if (color.alpha() == 255) {
+        LFoundation::fast_set((uint32_t*)dest, color.u32(), count);
+        return;
+    }
+
+    size_t done = 0;
+#ifdef __i386__
+    if (cpu_has_sse2()) {
+        done = blend_premultiplied_row_sse2(dest, color, count);
+    }
+#elif defined(__arm__) && defined(__ARM_NEON__)
+    done = blend_premultiplied_row_neon(dest, color, count);
+#endif
+
+    for (size_t i = done; i < count; i++) {
+        dest[i].mix_with_premultiplied(color);
+    }
+}
+
+} // namespace LG
@@ -8,7 +8,9 @@
 #include <algorithm>
 #include <libfoundation/Math.h>
 #include <libfoundation/Memory.h>
+#include <libg/Blend.h>
 #include <libg/Context.h>
+#include <libg/GlyphAtlas.h>
 
 namespace LG {
 
@@ -96,12 +98,11 @@ void Context::draw(const Point<int>& start, const PixelBitmap& bitmap)
     int max_y = draw_bounds.max_y();
     int offset_x = -start.x() - m_draw_offset.x() + m_bitmap_offset.x();
     int offset_y = -start.y() - m_draw_offset.y() + m_bitmap_offset.y();
+    int bitmap_x = min_x + offset_x;
     int bitmap_y = min_y + offset_y;
+    int len_x = max_x - min_x + 1;
     for (int y = min_y; y <= max_y; y++, bitmap_y++) {
-        int bitmap_x = min_x + offset_x;
-        for (int x = min_x; x <= max_x; x++, bitmap_x++) {
-            m_bitmap[y][x].mix_with(bitmap[bitmap_y][bitmap_x]);
-        }
+        draw_row(&m_bitmap[y][min_x], &bitmap[bitmap_y][bitmap_x], len_x, bitmap);
     }
 }
 
@@ -125,12 +126,44 @@ void Context::draw_with_bounds(const Rect& rect, const PixelBitmap& bitmap)
     int max_y = draw_bounds.max_y();
     int offset_x = -rect.min_x() - m_draw_offset.x() + m_bitmap_offset.x();
     int offset_y = -rect.min_y() - m_draw_offset.y() + m_bitmap_offset.y();
+    int bitmap_x = min_x + offset_x;
     int bitmap_y = min_y + offset_y;
+    int len_x = max_x - min_x + 1;
     for (int y = min_y; y <= max_y; y++, bitmap_y++) {
-        int bitmap_x = min_x + offset_x;
-        for (int x = min_x; x <= max_x; x++, bitmap_x++) {
-            m_bitmap[y][x].mix_with(bitmap[bitmap_y][bitmap_x]);
+        draw_row(&m_bitmap[y][min_x], &bitmap[bitmap_y][bitmap_x], len_x, bitmap);
+    }
+}
+
+void Context::draw_row(Color* dest, const Color* src, size_t count, const PixelBitmap& bitmap) const
+{
+    if (bitmap.is_premultiplied()) {
+        // A solid target is the same in both formats, only straight alpha
+        // targets need the pixels back in straight alpha.
+        if (m_bitmap.format() != RGBA) {
+            blend_premultiplied_row(dest, src, count);
+        } else {
+            for (size_t i = 0; i < count; i++) {
+                dest[i].mix_with(src[i].unpremultiplied());
+            }
         }
+        return;
+    }
+
+    if (m_bitmap.is_premultiplied()) {
+        for (size_t i = 0; i < count; i++) {
+            dest[i].mix_with_premultiplied(src[i].premultiplied());
+        }
+    } else {
+        blend_row(dest, src, count);
+    }
+}
+
+void Context::mix_row(Color* dest, const Color& color, size_t count) const
+{
+    if (m_bitmap.is_premultiplied()) {
+        blend_premultiplied_row(dest, color.premultiplied(), count);
+    } else {
+        blend_row(dest, color, count);
     }
 }
 
@@ -142,7 +175,7 @@ void Context::draw(const Point<int>& start, const GlyphBitmap& bitmap)
         return;
     }
 
-    auto& color = fill_color();
+    auto color = target_color(fill_color());
     int min_x = draw_bounds.min_x();
     int min_y = draw_bounds.min_y();
     int max_x = draw_bounds.max_x();
@@ -160,6 +193,53 @@ void Context::draw(const Point<int>& start, const GlyphBitmap& bitmap)
     }
 }
 
+// Draws a run of glyphs, each one after the previous and the font's spacing,
+// from the font's atlas. The run is clipped once, blank glyphs and empty rows
+// of glyphs are skipped and the rest goes by rows of alpha values.
+void Context::draw_text(const Point<int>& start, const Font& font, const char* text, size_t length)
+{
+    auto& atlas = font.atlas();
+    int run_x = start.x() + m_draw_offset.x();
+    int run_y = start.y() + m_draw_offset.y();
+    int min_y = std::max(run_y, m_clip.min_y());
+    int max_y = std::min(run_y + (int)atlas.height() - 1, m_clip.max_y());
+    if (min_y > max_y) {
+        return;
+    }
+
+    auto color = target_color(fill_color());
+    int spacing = font.glyph_spacing();
+    for (size_t i = 0; i < length && run_x <= m_clip.max_x(); i++) {
+        auto& glyph = atlas.glyph((uint8_t)text[i]);
+        int glyph_x = run_x;
+        run_x += glyph.width + spacing;
+        if (glyph.blank() || glyph_x + glyph.width <= m_clip.min_x()) {
+            continue;
+        }
+
+        int min_x = std::max(glyph_x, m_clip.min_x());
+        int max_x = std::min(glyph_x + (int)glyph.width - 1, m_clip.max_x());
+        for (int y = min_y; y <= max_y; y++) {
+            size_t glyph_y = y - run_y;
+            if (!glyph.has_row(glyph_y)) {
+                continue;
+            }
+
+            const uint8_t* alpha = atlas.alpha_row(glyph, glyph_y) + (min_x - glyph_x);
+            Color* row = m_bitmap[y];
+            for (int x = min_x; x <= max_x; x++, alpha++) {
+                if (*alpha == 255) {
+                    row[x] = color;
+                } else if (*alpha) {
+                    Color covered = fill_color();
+                    covered.set_alpha(covered.alpha() * *alpha / 255);
+                    mix_pixel(row[x], covered);
+                }
+            }
+        }
+    }
+}
+
 [[gnu::flatten]] void Context::draw_rounded(const Point<int>& start, const PixelBitmap& bitmap, const CornerMask& mask)
 {
     Rect rect(start.x(), start.y(), bitmap.width(), bitmap.height());
@@ -253,10 +333,9 @@ void Context::mix(const Rect& rect)
     int max_x = draw_bounds.max_x();
     int max_y = draw_bounds.max_y();
     const auto& color = fill_color();
+    int len_x = max_x - min_x + 1;
     for (int y = min_y; y <= max_y; y++) {
-        for (int x = min_x; x <= max_x; x++) {
-            m_bitmap[y][x].mix_with(color);
-        }
+        mix_row(&m_bitmap[y][min_x], color, len_x);
     }
 }
 
@@ -320,15 +399,18 @@ void Context::draw_rounded_helper(const Point<int>& start, size_t radius, const
             int x2 = (x - center.x()) * (x - center.x());
             int y2 = (y - center.y()) * (y - center.y());
             int dist = x2 + y2;
+            auto color = bitmap[bitmap_y][bitmap_x];
+            if (bitmap.is_premultiplied()) {
+                color = color.unpremultiplied();
+            }
             if (dist <= radius2) {
-                m_bitmap[y][x].mix_with(bitmap[bitmap_y][bitmap_x]);
+                mix_pixel(m_bitmap[y][x], color);
             } else {
-                auto color = bitmap[bitmap_y][bitmap_x];
                 float fdist = 0.5 - (LFoundation::fast_sqrt((float)(dist)) - radius);
                 fdist = std::max(std::min(fdist, 1.0f), 0.0f);
                 int alpha = int(color.alpha() * fdist);
                 color.set_alpha(alpha);
-                m_bitmap[y][x].mix_with(color);
+                mix_pixel(m_bitmap[y][x], color);
             }
         }
     }
@@ -361,13 +443,13 @@ void Context::fill_rounded_helper(const Point<int>& start, size_t radius)
             int y2 = (y - center.y()) * (y - center.y());
             int dist = x2 + y2;
             if (dist <= radius2) {
-                m_bitmap[y][x].mix_with(fill_color());
+                mix_pixel(m_bitmap[y][x], fill_color());
             } else {
                 float fdist = 0.5 - (LFoundation::fast_sqrt((float)(dist)) - radius);
                 fdist = std::max(std::min(fdist, 1.0f), 0.0f);
                 int alpha = int(fill_color().alpha() * fdist);
                 color.set_alpha(alpha);
-                m_bitmap[y][x].mix_with(color);
+                mix_pixel(m_bitmap[y][x], color);
             }
         }
     }
@@ -410,7 +492,7 @@ void Context::shadow_rounded_helper(const Point<int>& start, size_t radius, cons
                     fdist = std::max(fdist, 0.0f);
                     int alpha = std_alpha * fdist;
                     color.set_alpha(alpha);
-                    m_bitmap[y][x].mix_with(color);
+                    mix_pixel(m_bitmap[y][x], color);
                 }
             }
         }
@@ -509,9 +591,7 @@ void Context::draw_shading(const Rect& rect, const Shading& shading)
         color.set_alpha(color.alpha() - skipped_steps * step);
 
         for (int y = min_y; y <= max_y; y++) {
-            for (int x = min_x; x <= max_x; x++) {
-                m_bitmap[y][x].mix_with(color);
-            }
+            mix_row(&m_bitmap[y][min_x], color, max_x - min_x + 1);
             color.set_alpha(color.alpha() - step);
         }
         return;
@@ -522,9 +602,7 @@ void Context::draw_shading(const Rect& rect, const Shading& shading)
         color.set_alpha(color.alpha() - skipped_steps * step);
 
         for (int y = max_y; y >= min_y; y--) {
-            for (int x = min_x; x <= max_x; x++) {
-                m_bitmap[y][x].mix_with(color);
-            }
+            mix_row(&m_bitmap[y][min_x], color, max_x - min_x + 1);
             color.set_alpha(color.alpha() - step);
         }
         return;
@@ -536,7 +614,7 @@ void Context::draw_shading(const Rect& rect, const Shading& shading)
 
         for (int x = min_x; x <= max_x; x++) {
             for (int y = min_y; y <= max_y; y++) {
-                m_bitmap[y][x].mix_with(color);
+                mix_pixel(m_bitmap[y][x], color);
             }
             color.set_alpha(color.alpha() - step);
         }
@@ -549,7 +627,7 @@ void Context::draw_shading(const Rect& rect, const Shading& shading)
 
         for (int x = max_x; x >= min_x; x--) {
             for (int y = min_y; y <= max_y; y++) {
-                m_bitmap[y][x].mix_with(color);
+                mix_pixel(m_bitmap[y][x], color);
             }
             color.set_alpha(color.alpha() - step);
         }
@@ -568,7 +646,7 @@ void Context::draw_shading(const Rect& rect, const Shading& shading)
         for (int y = max_y; y >= min_y; y--) {
             auto cur_color = color;
             for (int x = min_x; x <= end_x; x++) {
-                m_bitmap[y][x].mix_with(cur_color);
+                mix_pixel(m_bitmap[y][x], cur_color);
                 cur_color.set_alpha(cur_color.alpha() - step);
             }
             end_x--;
@@ -593,7 +671,7 @@ void Context::draw_shading(const Rect& rect, const Shading& shading)
         for (int y = min_y; y <= max_y; y++) {
             auto cur_color = color;
             for (int x = min_x; x <= end_x; x++) {
-                m_bitmap[y][x].mix_with(cur_color);
+                mix_pixel(m_bitmap[y][x], cur_color);
                 cur_color.set_alpha(cur_color.alpha() - step);
             }
             end_x--;
@@ -618,7 +696,7 @@ void Context::draw_shading(const Rect& rect, const Shading& shading)
         for (int y = max_y; y >= min_y; y--) {
             auto cur_color = color;
             for (int x = max_x; x >= end_x; x--) {
-                m_bitmap[y][x].mix_with(cur_color);
+                mix_pixel(m_bitmap[y][x], cur_color);
                 cur_color.set_alpha(cur_color.alpha() - step);
             }
             end_x++;
@@ -643,7 +721,7 @@ void Context::draw_shading(const Rect& rect, const Shading& shading)
         for (int y = min_y; y <= max_y; y++) {
             auto cur_color = color;
             for (int x = max_x; x >= end_x; x--) {
-                m_bitmap[y][x].mix_with(cur_color);
+                mix_pixel(m_bitmap[y][x], cur_color);
                 cur_color.set_alpha(cur_color.alpha() - step);
             }
             end_x++;
@@ -737,6 +815,7 @@ void Context::add_ellipse(const Rect& rect)
     int ry = rect.height() / 2;
     int xc = rect.mid_x();
     int yc = rect.mid_y();
+    auto color = target_color(fill_color());
 
     double dx, dy, d1, d2, x, y;
     double tmp_d1, tmp_d2;
@@ -748,10 +827,10 @@ void Context::add_ellipse(const Rect& rect)
     dy = 2 * rx * rx * y;
 
     while (dx < dy) {
-        m_bitmap[y + yc][(int)x + xc] = fill_color();
-        m_bitmap[y + yc][(int)-x + xc] = fill_color();
-        m_bitmap[-y + yc][(int)x + xc] = fill_color();
-        m_bitmap[-y + yc][(int)-x + xc] = fill_color();
+        m_bitmap[y + yc][(int)x + xc] = color;
+        m_bitmap[y + yc][(int)-x + xc] = color;
+        m_bitmap[-y + yc][(int)x + xc] = color;
+        m_bitmap[-y + yc][(int)-x + xc] = color;
 
         x++;
         dx += 2 * ry * ry;
@@ -767,10 +846,10 @@ void Context::add_ellipse(const Rect& rect)
     d2 = ((ry * ry) * ((x + 0.5) * (x + 0.5))) + ((rx * rx) * ((y - 1) * (y - 1))) - (rx * rx * ry * ry);
 
     while (y >= 0) {
-        m_bitmap[y + yc][(int)x + xc] = fill_color();
-        m_bitmap[y + yc][(int)-x + xc] = fill_color();
-        m_bitmap[-y + yc][(int)x + xc] = fill_color();
-        m_bitmap[-y + yc][(int)-x + xc] = fill_color();
+        m_bitmap[y + yc][(int)x + xc] = color;
+        m_bitmap[y + yc][(int)-x + xc] = color;
+        m_bitmap[-y + yc][(int)x + xc] = color;
+        m_bitmap[-y + yc][(int)-x + xc] = color;
 
         y--;
         dy -= 2 * rx * rx;
@@ -8,6 +8,7 @@
 #include <fcntl.h>
 #include <libfoundation/Logger.h>
 #include <libg/Font.h>
+#include <libg/GlyphAtlas.h>
 #include <new>
 #include <string.h>
 #include <sys/mman.h>
@@ -59,6 +60,11 @@ Font::Font(uint32_t* raw_data, uint8_t* width_data, uint8_t width, uint8_t heigh
 {
 }
 
+Font::~Font()
+{
+    delete m_atlas;
+}
+
 Font* Font::load_from_file(const char* path)
 {
     int fd = open(path, O_RDONLY);
@@ -115,4 +121,21 @@ GlyphBitmap Font::glyph_bitmap(size_t ch) const
     return GlyphBitmap(&m_raw_data[ch * m_height], glyph_width(ch), m_height);
 }
 
+// A font could be used by several threads of a process, so the atlas built
+// first is kept and the others are dropped.
+const GlyphAtlas& Font::atlas() const
+{
+    auto* atlas = __atomic_load_n(&m_atlas, __ATOMIC_ACQUIRE);
+    if (atlas) {
+        return *atlas;
+    }
+
+    auto* new_atlas = new GlyphAtlas(*this);
+    if (!__atomic_compare_exchange_n(&m_atlas, &atlas, new_atlas, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        delete new_atlas;
+        return *atlas;
+    }
+    return *new_atlas;
+}
+
 } // namespace LG
\ No newline at end of file
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2020-2021 Nikita Melekhin. All rights reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <libg/Font.h>
+#include <libg/GlyphAtlas.h>
+#include <string.h>
+
+namespace LG {
+
+GlyphAtlas::GlyphAtlas(const Font& font)
+    : m_height(font.glyph_height())
+{
+    size_t count = font.glyph_count();
+    m_glyphs.resize(count);
+    for (size_t ch = 0; ch < count; ch++) {
+        m_glyphs[ch].offset = m_width;
+        m_glyphs[ch].width = font.glyph_width(ch);
+        m_glyphs[ch].rows_mask = 0;
+        m_width += font.glyph_width(ch);
+    }
+
+    m_alpha.resize(m_width * m_height);
+    memset(m_alpha.data(), 0, m_alpha.size());
+    for (size_t ch = 0; ch < count; ch++) {
+        auto& glyph = m_glyphs[ch];
+        auto bitmap = font.glyph_bitmap(ch);
+        for (size_t y = 0; y < m_height; y++) {
+            uint8_t* alpha = &m_alpha[y * m_width + glyph.offset];
+            for (size_t x = 0; x < glyph.width; x++) {
+                if (bitmap.bit_at(x, y)) {
+                    alpha[x] = 255;
+                    glyph.rows_mask |= row_bit(y);
+                }
+            }
+        }
+    }
+}
+
+} // namespace LG
@@ -223,7 +223,7 @@ namespace PNG {
             }
         }
         if (m_ihdr_chunk.color_type == 6) {
-            bitmap.set_format(PixelBitmapFormat::RGBA);
+            bitmap.set_format(PixelBitmapFormat::RGBAPremultiplied);
             for (int i = 0; i < m_ihdr_chunk.height; i++) {
                 auto& scanline = m_scanline_keeper.scanlines()[i];
                 for (int j = 0, bit = 0; j < m_ihdr_chunk.width; j++) {
@@ -231,7 +231,7 @@ namespace PNG {
                     int g = scanline.data()[bit++];
                     int b = scanline.data()[bit++];
                     int alpha = scanline.data()[bit++];
-                    bitmap[i][j] = Color(r, g, b, alpha);
+                    bitmap[i][j] = Color(r, g, b, alpha).premultiplied();
                 }
             }
         }
@@ -62,4 +62,30 @@ void PixelBitmap::resize(size_t width, size_t height)
     m_should_free = true;
 }
 
+void PixelBitmap::premultiply()
+{
+    if (m_format != RGBA) {
+        return;
+    }
+
+    size_t len = width() * height();
+    for (size_t i = 0; i < len; i++) {
+        m_data[i] = m_data[i].premultiplied();
+    }
+    m_format = RGBAPremultiplied;
+}
+
+void PixelBitmap::unpremultiply()
+{
+    if (m_format != RGBAPremultiplied) {
+        return;
+    }
+
+    size_t len = width() * height();
+    for (size_t i = 0; i < len; i++) {
+        m_data[i] = m_data[i].unpremultiplied();
+    }
+    m_format = RGBA;
+}
+
 } // namespace LG
\ No newline at end of file
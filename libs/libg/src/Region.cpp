@@ -0,0 +1,284 @@
+/*
+ * Copyright (C) 2020-2021 Nikita Melekhin. All rights reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <algorithm>
+#include <libg/Region.h>
+
+namespace LG {
+
+namespace {
+
+    // A piece of a band from x1 up to x2, not including x2.
+    struct Span {
+        int x1;
+        int x2;
+    };
+
+    constexpr int no_edge = 0x7fffffff;
+
+    inline int bottom_of(const Rect& rect) { return rect.max_y() + 1; }
+
+    // Skips the bands, which end above @y. Returns the index of the first rect
+    // of the band, which covers @y or lies below it.
+    size_t band_at(const std::vector<Rect>& rects, size_t from, int y)
+    {
+        while (from < rects.size() && bottom_of(rects[from]) <= y) {
+            from++;
+        }
+        return from;
+    }
+
+    void band_spans(const std::vector<Rect>& rects, size_t from, std::vector<Span>& spans)
+    {
+        int top = rects[from].min_y();
+        for (size_t i = from; i < rects.size() && rects[i].min_y() == top; i++) {
+            spans.push_back({ rects[i].min_x(), rects[i].max_x() + 1 });
+        }
+    }
+
+    void spans_union(const std::vector<Span>& a, const std::vector<Span>& b, std::vector<Span>& out)
+    {
+        size_t i = 0;
+        size_t j = 0;
+        while (i < a.size() || j < b.size()) {
+            Span next;
+            if (j >= b.size() || (i < a.size() && a[i].x1 <= b[j].x1)) {
+                next = a[i++];
+            } else {
+                next = b[j++];
+            }
+
+            if (!out.empty() && out.back().x2 >= next.x1) {
+                out.back().x2 = std::max(out.back().x2, next.x2);
+            } else {
+                out.push_back(next);
+            }
+        }
+    }
+
+    void spans_intersect(const std::vector<Span>& a, const std::vector<Span>& b, std::vector<Span>& out)
+    {
+        size_t i = 0;
+        size_t j = 0;
+        while (i < a.size() && j < b.size()) {
+            int x1 = std::max(a[i].x1, b[j].x1);
+            int x2 = std::min(a[i].x2, b[j].x2);
+            if (x1 < x2) {
+                out.push_back({ x1, x2 });
+            }
+            if (a[i].x2 < b[j].x2) {
+                i++;
+            } else {
+                j++;
+            }
+        }
+    }
+
+    void spans_subtract(const std::vector<Span>& a, const std::vector<Span>& b, std::vector<Span>& out)
+    {
+        size_t j = 0;
+        for (size_t i = 0; i < a.size(); i++) {
+            int x1 = a[i].x1;
+            int x2 = a[i].x2;
+            while (j < b.size() && b[j].x2 <= x1) {
+                j++;
+            }
+            for (size_t k = j; k < b.size() && b[k].x1 < x2; k++) {
+                if (b[k].x1 > x1) {
+                    out.push_back({ x1, b[k].x1 });
+                }
+                x1 = std::max(x1, b[k].x2);
+            }
+            if (x1 < x2) {
+                out.push_back({ x1, x2 });
+            }
+        }
+    }
+
+} // namespace
+
+Region::Region(const Rect& rect)
+{
+    if (!rect.empty()) {
+        m_rects.push_back(rect);
+        m_bounds = rect;
+    }
+}
+
+size_t Region::square() const
+{
+    size_t res = 0;
+    for (int i = 0; i < m_rects.size(); i++) {
+        res += m_rects[i].square();
+    }
+    return res;
+}
+
+bool Region::intersects(const Rect& rect) const
+{
+    if (empty() || !m_bounds.intersects(rect)) {
+        return false;
+    }
+    for (int i = 0; i < m_rects.size(); i++) {
+        if (m_rects[i].intersects(rect)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Region::contains(const Rect& rect) const
+{
+    if (rect.empty()) {
+        return true;
+    }
+    if (empty() || !m_bounds.contains(rect)) {
+        return false;
+    }
+    return Region(rect).difference(*this).empty();
+}
+
+void Region::unite(const Region& other) { *this = combine(*this, other, Op::Union); }
+void Region::intersect(const Region& other) { *this = combine(*this, other, Op::Intersect); }
+void Region::subtract(const Region& other) { *this = combine(*this, other, Op::Subtract); }
+
+Region Region::union_of(const Region& other) const { return combine(*this, other, Op::Union); }
+Region Region::intersection(const Region& other) const { return combine(*this, other, Op::Intersect); }
+Region Region::difference(const Region& other) const { return combine(*this, other, Op::Subtract); }
+
+void Region::offset_by(int x, int y)
+{
+    for (int i = 0; i < m_rects.size(); i++) {
+        m_rects[i].offset_by(x, y);
+    }
+    m_bounds.offset_by(x, y);
+}
+
+void Region::clear()
+{
+    m_rects.clear_remain_capacity();
+    m_bounds = Rect();
+}
+
+void Region::update_bounds()
+{
+    if (empty()) {
+        m_bounds = Rect();
+        return;
+    }
+
+    // Bands go top to bottom, so only x has to be looked for.
+    int min_x = m_rects[0].min_x();
+    int max_x = m_rects[0].max_x();
+    for (int i = 1; i < m_rects.size(); i++) {
+        min_x = std::min(min_x, m_rects[i].min_x());
+        max_x = std::max(max_x, m_rects[i].max_x());
+    }
+    int min_y = m_rects[0].min_y();
+    int max_y = m_rects.back().max_y();
+    m_bounds = Rect(min_x, min_y, max_x - min_x + 1, max_y - min_y + 1);
+}
+
+// Walks both regions top to bottom, band by band. Every stripe, where neither
+// of them changes, gets its spans from the spans of both regions.
+Region Region::combine(const Region& a, const Region& b, Op op)
+{
+    if (a.empty() || b.empty() || !a.bounds().intersects(b.bounds())) {
+        switch (op) {
+        case Op::Union:
+            if (a.empty()) {
+                return b;
+            }
+            if (b.empty()) {
+                return a;
+            }
+            break;
+        case Op::Intersect:
+            return Region();
+        case Op::Subtract:
+            return a;
+        }
+    }
+
+    Region res;
+    std::vector<Span> spans_a;
+    std::vector<Span> spans_b;
+    std::vector<Span> spans;
+    size_t ia = 0;
+    size_t ib = 0;
+    size_t last_band = 0;
+    bool has_band = false;
+
+    int y = std::min(a.bounds().min_y(), b.bounds().min_y());
+    for (;;) {
+        spans_a.clear_remain_capacity();
+        spans_b.clear_remain_capacity();
+        spans.clear_remain_capacity();
+
+        int next = no_edge;
+        ia = band_at(a.m_rects, ia, y);
+        if (ia < a.m_rects.size()) {
+            if (a.m_rects[ia].min_y() <= y) {
+                band_spans(a.m_rects, ia, spans_a);
+                next = bottom_of(a.m_rects[ia]);
+            } else {
+                next = a.m_rects[ia].min_y();
+            }
+        }
+        ib = band_at(b.m_rects, ib, y);
+        if (ib < b.m_rects.size()) {
+            if (b.m_rects[ib].min_y() <= y) {
+                band_spans(b.m_rects, ib, spans_b);
+                next = std::min(next, bottom_of(b.m_rects[ib]));
+            } else {
+                next = std::min(next, b.m_rects[ib].min_y());
+            }
+        }
+        if (next == no_edge) {
+            break;
+        }
+
+        switch (op) {
+        case Op::Union:
+            spans_union(spans_a, spans_b, spans);
+            break;
+        case Op::Intersect:
+            spans_intersect(spans_a, spans_b, spans);
+            break;
+        case Op::Subtract:
+            spans_subtract(spans_a, spans_b, spans);
+            break;
+        }
+
+        if (!spans.empty()) {
+            // The stripe continues the last band, if it has the same spans.
+            bool same = has_band && bottom_of(res.m_rects[last_band]) == y && res.m_rects.size() - last_band == spans.size();
+            for (size_t i = 0; same && i < spans.size(); i++) {
+                auto& rect = res.m_rects[last_band + i];
+                same = rect.min_x() == spans[i].x1 && rect.max_x() + 1 == spans[i].x2;
+            }
+
+            if (same) {
+                for (size_t i = last_band; i < res.m_rects.size(); i++) {
+                    res.m_rects[i].set_height(next - res.m_rects[i].min_y());
+                }
+            } else {
+                last_band = res.m_rects.size();
+                has_band = true;
+                for (size_t i = 0; i < spans.size(); i++) {
+                    res.m_rects.push_back(Rect(spans[i].x1, y, spans[i].x2 - spans[i].x1, next - y));
+                }
+            }
+        }
+        y = next;
+    }
+
+    res.update_bounds();
+    return res;
+}
+
+} // namespace LG
@@ -4,8 +4,11 @@
 #include <libfoundation/EventLoop.h>
 #include <libfoundation/EventReceiver.h>
 #include <libfoundation/Logger.h>
+#include <libfoundation/SharedBuffer.h>
 #include <libipc/Message.h>
 #include <libipc/MessageDecoder.h>
+#include <libipc/MessageStream.h>
+#include <libipc/SharedRing.h>
 #include <unistd.h>
 #include <vector>
 
@@ -24,14 +27,53 @@ public:
 
     bool send_message(const Message& msg) const
     {
-        auto encoded_msg = msg.encode();
-        int wrote = write(m_connection_fd, encoded_msg.data(), encoded_msg.size());
-        return wrote == encoded_msg.size();
+        if (m_send_ring.attached()) {
+            auto encoded_msg = msg.encode();
+            m_send_ring.push(encoded_msg.data(), encoded_msg.size());
+            return true;
+        }
+        return MessageStream::send(m_connection_fd, msg);
+    }
+
+    // Moves further messages to a pair of rings in a shared buffer, so they
+    // don't pass through the kernel. The socket stays to setup the rings and
+    // to notice the server's exit. The server process is granted access to
+    // the rings. Returns false, if rings can't be created.
+    bool enable_shared_rings(pid_t server_pid)
+    {
+        m_shared_rings.create(2 * SharedRing::SharedSize);
+        if (!m_shared_rings.alive()) {
+            return false;
+        }
+        if (!m_shared_rings.grant(server_pid)) {
+            m_shared_rings.free();
+            return false;
+        }
+
+        // The first ring goes from the client to the server, the second one back.
+        m_send_ring.attach(m_shared_rings.data(), true, m_connection_fd);
+        m_recv_ring.attach(m_shared_rings.data() + SharedRing::SharedSize, true);
+        if (!MessageStream::send_control(m_connection_fd, MessageStream::AttachSharedRings, m_shared_rings.id())) {
+            m_send_ring = SharedRing();
+            m_recv_ring = SharedRing();
+            return false;
+        }
+
+        LFoundation::EventLoop::the().add_poller(
+            [this] {
+                pump_shared_ring();
+            },
+            [this] {
+                return m_recv_ring.arm_doorbell();
+            });
+        return true;
     }
 
     std::unique_ptr<Message> send_sync(const Message& msg)
     {
-        bool status = send_message(msg);
+        if (!send_message(msg)) {
+            return nullptr;
+        }
         return wait_for_answer(msg);
     }
 
@@ -43,49 +85,40 @@ public:
                     return m_messages[i].release();
                 }
             }
-            pump_messages();
+            if (!m_recv_ring.attached()) {
+                pump_messages();
+            } else if (!pump_shared_ring()) {
+                m_recv_ring.wait_for_data();
+            }
         }
     }
 
     void pump_messages()
     {
-        std::vector<char> buf;
-
-        char tmpbuf[1024];
-
-        int read_cnt;
-        while ((read_cnt = read(m_connection_fd, tmpbuf, sizeof(tmpbuf)))) {
-            if (read_cnt <= 0) {
-                Logger::debug << getpid() << " :: ClientConnection read error" << std::endl;
-                return;
-            }
-            size_t buf_size = buf.size();
-            buf.resize(buf_size + read_cnt);
-            memcpy((uint8_t*)&buf.data()[buf_size], (uint8_t*)tmpbuf, read_cnt);
-            if (read_cnt < sizeof(tmpbuf)) {
-                break;
-            }
+        int read_cnt = m_stream.read_from(m_connection_fd);
+        if (read_cnt <= 0) {
+            // The server has closed the connection, there is nothing to wait for.
+            Logger::debug << getpid() << " :: ClientConnection closed" << std::endl;
+            exit(-1);
         }
 
-        size_t msg_len = 0;
-        size_t buf_size = buf.size();
-        for (size_t i = 0; i < buf_size; i += msg_len) {
-            msg_len = 0;
-            if (auto response = m_client_decoder.decode((buf.data() + i), read_cnt - i, msg_len)) {
-                m_messages.push_back(std::move(response));
-            } else if (auto response = m_server_decoder.decode((buf.data() + i), read_cnt - i, msg_len)) {
-                m_messages.push_back(std::move(response));
-            } else {
-                Logger::debug << getpid() << " :: ClientConnection read error" << std::endl;
-                std::abort();
-            }
-        }
+        m_stream.for_each_message([this](const char* buf, size_t len) {
+            decode_message(buf, len);
+        });
+        post_messages();
+    }
 
-        if (m_messages.size() > 0) {
-            // Note: We send an event to ourselves and use CallEvent to recognize the
-            // event as sign to start processing of messages.
-            LFoundation::EventLoop::the().add(*this, new LFoundation::CallEvent(nullptr));
+    // Returns true, if some messages have been got from the ring.
+    bool pump_shared_ring()
+    {
+        size_t got = m_recv_ring.consume([this](const char* buf, size_t len) {
+            decode_message(buf, len);
+        });
+        if (!got) {
+            return false;
         }
+        post_messages();
+        return true;
     }
 
     void receive_event(std::unique_ptr<LFoundation::Event> event) override
@@ -103,9 +136,42 @@ public:
     }
 
 private:
+    void decode_message(const char* buf, size_t len)
+    {
+        // The only control message a client gets is the doorbell of the ring,
+        // which is pumped by the poller anyway.
+        int command, arg;
+        if (MessageStream::decode_control(buf, len, command, arg)) {
+            return;
+        }
+
+        size_t msg_len = 0;
+        if (auto response = m_client_decoder.decode(buf, len, msg_len)) {
+            m_messages.push_back(std::move(response));
+        } else if (auto response = m_server_decoder.decode(buf, len, msg_len)) {
+            m_messages.push_back(std::move(response));
+        } else {
+            Logger::debug << getpid() << " :: ClientConnection read error" << std::endl;
+            std::abort();
+        }
+    }
+
+    void post_messages()
+    {
+        if (m_messages.size() > 0) {
+            // Note: We send an event to ourselves and use CallEvent to recognize the
+            // event as sign to start processing of messages.
+            LFoundation::EventLoop::the().add(*this, new LFoundation::CallEvent(nullptr));
+        }
+    }
+
     int m_accepted_key { -1 };
     int m_connection_fd;
     std::vector<std::unique_ptr<Message>> m_messages;
+    MessageStream m_stream;
+    LFoundation::SharedBuffer<uint8_t> m_shared_rings;
+    SharedRing m_send_ring;
+    SharedRing m_recv_ring;
     ServerDecoder& m_server_decoder;
     ClientDecoder& m_client_decoder;
 };
\ No newline at end of file
@@ -0,0 +1,98 @@
+#pragma once
+#include <cstring>
+#include <libipc/Message.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <vector>
+
+// Local sockets are byte streams and don't keep message boundaries, so every
+// message is sent with its length ahead. MessageStream collects read bytes
+// till whole messages arrive, a message could come in several reads.
+class MessageStream {
+public:
+    static constexpr size_t ReadChunk = 4096;
+
+    // Control messages are handled by libipc itself, they are marked with
+    // magic 0, which is never used by decoders.
+    static constexpr int ControlMagic = 0;
+    enum Control {
+        AttachSharedRings = 1,
+        Doorbell = 2, // Data has been put into a shared ring, while the peer was sleeping.
+    };
+
+    MessageStream() = default;
+    ~MessageStream() = default;
+
+    static bool send(int fd, const Message& msg)
+    {
+        auto encoded_msg = msg.encode();
+        uint32_t len = encoded_msg.size();
+
+        // The length and the message go in one call, without being copied
+        // into a frame. Blocking writes pass them whole, waiting for the reader if needed.
+        struct iovec iov[2] = {
+            { .iov_base = &len, .iov_len = sizeof(len) },
+            { .iov_base = (void*)encoded_msg.data(), .iov_len = len },
+        };
+        int wrote = writev(fd, iov, 2);
+        return wrote == (int)(sizeof(len) + len);
+    }
+
+    static bool send_control(int fd, int command, int arg)
+    {
+        int frame[] = { (int)(3 * sizeof(int)), ControlMagic, command, arg };
+        int wrote = write(fd, frame, sizeof(frame));
+        return wrote == sizeof(frame);
+    }
+
+    // Returns true and fills command and arg, if the message is a control one.
+    static bool decode_control(const char* buf, size_t len, int& command, int& arg)
+    {
+        int frame[3];
+        if (len != sizeof(frame)) {
+            return false;
+        }
+        memcpy(frame, buf, sizeof(frame));
+        if (frame[0] != ControlMagic) {
+            return false;
+        }
+        command = frame[1];
+        arg = frame[2];
+        return true;
+    }
+
+    // Returns the number of read bytes, 0 when the peer has closed the connection.
+    int read_from(int fd)
+    {
+        size_t size = m_data.size();
+        m_data.resize(size + ReadChunk);
+        int read_cnt = read(fd, m_data.data() + size, ReadChunk);
+        m_data.resize(read_cnt > 0 ? size + read_cnt : size);
+        return read_cnt;
+    }
+
+    // Calls callback(data, len) for each complete message, which is dropped after.
+    template <typename Callback>
+    void for_each_message(Callback callback)
+    {
+        size_t offset = 0;
+        size_t size = m_data.size();
+        while (size - offset >= sizeof(uint32_t)) {
+            uint32_t len;
+            memcpy(&len, m_data.data() + offset, sizeof(len));
+            if (size - offset - sizeof(len) < len) {
+                break;
+            }
+            callback(m_data.data() + offset + sizeof(len), (size_t)len);
+            offset += sizeof(len) + len;
+        }
+
+        if (offset) {
+            memmove(m_data.data(), m_data.data() + offset, size - offset);
+            m_data.resize(size - offset);
+        }
+    }
+
+private:
+    std::vector<char> m_data;
+};
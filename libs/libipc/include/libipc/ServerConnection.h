@@ -1,13 +1,21 @@
 #pragma once
 #include <cstdlib>
+#include <libfoundation/EventLoop.h>
 #include <libfoundation/Logger.h>
+#include <libfoundation/SharedBuffer.h>
 #include <libipc/Message.h>
 #include <libipc/MessageDecoder.h>
+#include <libipc/MessageStream.h>
+#include <libipc/SharedRing.h>
+#include <list>
+#include <sys/socket.h>
+#include <unistd.h>
 #include <vector>
 
 template <typename ServerDecoder, typename ClientDecoder>
 class ServerConnection {
 public:
+    // Note: sock_fd is a listening socket, every client gets its own connection.
     ServerConnection(int sock_fd, ServerDecoder& server_decoder, ClientDecoder& client_decoder)
         : m_connection_fd(sock_fd)
         , m_server_decoder(server_decoder)
@@ -15,51 +23,198 @@ public:
     {
     }
 
+    // Returns fd of the accepted client or -1.
+    int accept_client()
+    {
+        int client_fd = accept(m_connection_fd);
+        if (client_fd < 0) {
+            return -1;
+        }
+        m_clients.push_back(Client(client_fd));
+        return client_fd;
+    }
+
+    void disconnect_client(int client_fd)
+    {
+        for (auto it = m_clients.begin(); it != m_clients.end(); ++it) {
+            if ((*it).fd == client_fd) {
+                m_clients.erase(it);
+                break;
+            }
+        }
+        close(client_fd);
+    }
+
+    // Messages are routed to the client, which has used the message's key.
     bool send_message(const Message& msg) const
     {
-        auto encoded_msg = msg.encode();
-        int wrote = write(m_connection_fd, encoded_msg.data(), encoded_msg.size());
-        return wrote == encoded_msg.size();
+        const Client* client = find_client_by_key(msg.key());
+        if (!client) {
+            return false;
+        }
+        return client->send(msg);
     }
 
-    void pump_messages()
+    // Returns false, when the client has gone and should be disconnected.
+    bool pump_messages(int client_fd)
     {
-        std::vector<char> buf;
+        Client* client = find_client(client_fd);
+        if (!client) {
+            return false;
+        }
 
-        char tmpbuf[1024];
+        int read_cnt = client->stream.read_from(client_fd);
+        if (read_cnt <= 0) {
+            return false;
+        }
 
-        int read_cnt;
-        while ((read_cnt = read(m_connection_fd, tmpbuf, sizeof(tmpbuf)))) {
-            if (read_cnt <= 0) {
-                Logger::debug << getpid() << " :: ServerConnection read error" << std::endl;
+        bool valid = true;
+        client->stream.for_each_message([&](const char* buf, size_t len) {
+            int command, arg;
+            if (!valid) {
                 return;
             }
-            size_t buf_size = buf.size();
-            buf.resize(buf_size + read_cnt);
-            memcpy(&buf.data()[buf_size], tmpbuf, read_cnt);
-            if (read_cnt < sizeof(tmpbuf)) {
-                break;
+            if (MessageStream::decode_control(buf, len, command, arg)) {
+                valid = handle_control(*client, command, arg);
+            } else {
+                valid = handle_message(*client, buf, len);
+            }
+        });
+        return valid;
+    }
+
+    // Returns false, if some client has put messages into its ring already.
+    bool arm_shared_rings()
+    {
+        bool armed = true;
+        for (auto& client : m_clients) {
+            if (client.recv_ring.attached()) {
+                armed &= client.recv_ring.arm_doorbell();
             }
         }
+        return armed;
+    }
 
-        size_t msg_len = 0;
-        size_t buf_size = buf.size();
-        for (int i = 0; i < buf_size; i += msg_len) {
-            msg_len = 0;
-            if (auto response = m_server_decoder.decode((buf.data() + i), read_cnt - i, msg_len)) {
-                if (auto answer = m_server_decoder.handle(*response)) {
-                    send_message(*answer);
+    // Handles messages, which clients have put into their shared rings.
+    void pump_shared_rings()
+    {
+        for (auto& client : m_clients) {
+            if (!client.recv_ring.attached()) {
+                continue;
+            }
+            client.recv_ring.consume([&](const char* buf, size_t len) {
+                handle_message(client, buf, len);
+            });
+        }
+    }
+
+private:
+    struct Client {
+        explicit Client(int client_fd)
+            : fd(client_fd)
+        {
+        }
+
+        void remember_key(message_key_t key)
+        {
+            for (int i = 0; i < keys.size(); i++) {
+                if (keys[i] == key) {
+                    return;
                 }
-            } else if (auto response = m_client_decoder.decode((buf.data() + i), read_cnt - i, msg_len)) {
+            }
+            keys.push_back(key);
+        }
 
-            } else {
-                std::abort();
+        bool send(const Message& msg) const
+        {
+            if (send_ring.attached()) {
+                auto encoded_msg = msg.encode();
+                send_ring.push(encoded_msg.data(), encoded_msg.size());
+                return true;
             }
+            return MessageStream::send(fd, msg);
         }
+
+        int fd;
+        std::vector<message_key_t> keys;
+        MessageStream stream;
+        LFoundation::SharedBuffer<uint8_t> shared_rings;
+        SharedRing send_ring;
+        SharedRing recv_ring;
+    };
+
+    bool handle_message(Client& client, const char* buf, size_t len)
+    {
+        size_t msg_len = 0;
+        if (auto response = m_server_decoder.decode(buf, len, msg_len)) {
+            client.remember_key(response->key());
+            if (auto answer = m_server_decoder.handle(*response)) {
+                client.send(*answer);
+            }
+        } else if (auto response = m_client_decoder.decode(buf, len, msg_len)) {
+
+        } else {
+            Logger::debug << getpid() << " :: ServerConnection got a broken message" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool handle_control(Client& client, int command, int arg)
+    {
+        if (command == MessageStream::Doorbell) {
+            // The ring is pumped by the poller in the same loop iteration.
+            return true;
+        }
+        if (command != MessageStream::AttachSharedRings) {
+            return false;
+        }
+
+        client.shared_rings.open(arg);
+        if (!client.shared_rings.alive()) {
+            return false;
+        }
+        client.recv_ring.attach(client.shared_rings.data(), false);
+        client.send_ring.attach(client.shared_rings.data() + SharedRing::SharedSize, false, client.fd);
+
+        if (!m_polling_rings) {
+            m_polling_rings = true;
+            LFoundation::EventLoop::the().add_poller(
+                [this] {
+                    pump_shared_rings();
+                },
+                [this] {
+                    return arm_shared_rings();
+                });
+        }
+        return true;
+    }
+
+    Client* find_client(int client_fd)
+    {
+        for (auto& client : m_clients) {
+            if (client.fd == client_fd) {
+                return &client;
+            }
+        }
+        return nullptr;
+    }
+
+    const Client* find_client_by_key(message_key_t key) const
+    {
+        for (auto& client : m_clients) {
+            for (int i = 0; i < client.keys.size(); i++) {
+                if (client.keys[i] == key) {
+                    return &client;
+                }
+            }
+        }
+        return nullptr;
     }
 
-private:
     int m_connection_fd;
+    bool m_polling_rings { false };
+    std::list<Client> m_clients;
     ServerDecoder& m_server_decoder;
     ClientDecoder& m_client_decoder;
-};
\ No newline at end of file
+};
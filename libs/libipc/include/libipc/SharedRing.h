@@ -0,0 +1,226 @@
+#pragma once
+#include <cstring>
+#include <libipc/MessageStream.h>
+#include <sys/futex.h>
+#include <sys/types.h>
+#include <vector>
+
+// Lives at the start of the shared memory of a ring. head and tail are free
+// running byte counters, the producer moves head and the consumer moves tail.
+// consumer_waiting is a mask of SharedRing::Waiter bits.
+struct SharedRingHeader {
+    uint32_t head;
+    uint32_t tail;
+    uint32_t consumer_waiting;
+    uint32_t producer_waiting;
+};
+
+// A single producer, single consumer ring of length-prefixed messages in memory
+// shared by two processes. Messages are copied into the ring once and decoded
+// right from it, the kernel is entered only through the doorbells, when one
+// side has to wait for the other. A consumer blocked in the ring itself is
+// woken with a futex, a consumer sleeping in its event loop gets a control
+// message over the socket, which the loop waits on.
+class SharedRing {
+public:
+    static constexpr size_t Capacity = 8192; // Must be a power of 2.
+    static constexpr size_t SharedSize = sizeof(SharedRingHeader) + Capacity;
+
+    enum Waiter : uint32_t {
+        FutexWaiter = 1 << 0,
+        SocketWaiter = 1 << 1,
+    };
+
+    SharedRing() = default;
+    ~SharedRing() = default;
+
+    // doorbell_fd is the socket the producer rings the consumer's event loop through.
+    void attach(uint8_t* shared, bool init, int doorbell_fd = -1)
+    {
+        m_header = (SharedRingHeader*)shared;
+        m_data = shared + sizeof(SharedRingHeader);
+        m_doorbell_fd = doorbell_fd;
+        if (init) {
+            memset(m_header, 0, sizeof(SharedRingHeader));
+        }
+    }
+
+    inline bool attached() const { return m_header; }
+
+    // Producer side. Waits for the consumer, if there is not enough space.
+    void push(const uint8_t* data, size_t len) const
+    {
+        uint32_t frame_len = len;
+        size_t total = sizeof(frame_len) + len;
+        uint32_t head = m_header->head;
+
+        if (total <= Capacity) {
+            wait_for_space(total);
+            copy_in(head, (const uint8_t*)&frame_len, sizeof(frame_len));
+            copy_in(head + sizeof(frame_len), data, len);
+            publish(head + total);
+            return;
+        }
+
+        // A message, which doesn't fit into the ring, is passed in parts.
+        wait_for_space(sizeof(frame_len));
+        copy_in(head, (const uint8_t*)&frame_len, sizeof(frame_len));
+        head += sizeof(frame_len);
+        publish(head);
+
+        size_t done = 0;
+        while (done < len) {
+            size_t chunk = wait_for_space(1);
+            if (chunk > len - done) {
+                chunk = len - done;
+            }
+            copy_in(head, data + done, chunk);
+            head += chunk;
+            done += chunk;
+            publish(head);
+        }
+    }
+
+    // Consumer side. Calls callback(data, len) for each complete message, the
+    // data points into the shared memory unless the message wraps around.
+    template <typename Callback>
+    size_t consume(Callback callback)
+    {
+        size_t consumed = 0;
+        uint32_t head = __atomic_load_n(&m_header->head, __ATOMIC_ACQUIRE);
+        uint32_t tail = m_header->tail;
+
+        for (;;) {
+            if (m_partial_left) {
+                size_t chunk = head - tail;
+                if (!chunk) {
+                    break;
+                }
+                if (chunk > m_partial_left) {
+                    chunk = m_partial_left;
+                }
+                copy_out(tail, (uint8_t*)m_partial.data() + m_partial.size() - m_partial_left, chunk);
+                tail += chunk;
+                m_partial_left -= chunk;
+                release(tail);
+                if (!m_partial_left) {
+                    callback(m_partial.data(), m_partial.size());
+                    consumed++;
+                }
+                continue;
+            }
+
+            uint32_t frame_len;
+            if (head - tail < sizeof(frame_len)) {
+                break;
+            }
+            copy_out(tail, (uint8_t*)&frame_len, sizeof(frame_len));
+
+            size_t total = sizeof(frame_len) + frame_len;
+            if (total > Capacity) {
+                m_partial.resize(frame_len);
+                m_partial_left = frame_len;
+                tail += sizeof(frame_len);
+                release(tail);
+                continue;
+            }
+
+            if (head - tail < total) {
+                break;
+            }
+
+            uint32_t offset = (tail + sizeof(frame_len)) & (Capacity - 1);
+            if (offset + frame_len <= Capacity) {
+                callback((const char*)&m_data[offset], (size_t)frame_len);
+            } else {
+                m_scratch.resize(frame_len);
+                copy_out(tail + sizeof(frame_len), (uint8_t*)m_scratch.data(), frame_len);
+                callback(m_scratch.data(), (size_t)frame_len);
+            }
+
+            // Releasing only after the callback, the producer must not reuse the memory while it's decoded.
+            tail += total;
+            release(tail);
+            consumed++;
+        }
+        return consumed;
+    }
+
+    // Consumer side. Sleeps till the producer puts something into the ring.
+    void wait_for_data() const
+    {
+        uint32_t head = __atomic_load_n(&m_header->head, __ATOMIC_ACQUIRE);
+        if (head != m_header->tail) {
+            return;
+        }
+        __atomic_or_fetch(&m_header->consumer_waiting, FutexWaiter, __ATOMIC_SEQ_CST);
+        futex(&m_header->head, FUTEX_WAIT, head);
+    }
+
+    // Consumer side. Asks the producer to ring the socket doorbell on the next
+    // publish, the event loop is about to sleep. Returns false, if the ring has
+    // data already, then the loop shouldn't sleep.
+    bool arm_doorbell() const
+    {
+        __atomic_or_fetch(&m_header->consumer_waiting, SocketWaiter, __ATOMIC_SEQ_CST);
+        return __atomic_load_n(&m_header->head, __ATOMIC_SEQ_CST) == m_header->tail;
+    }
+
+private:
+    size_t wait_for_space(size_t need) const
+    {
+        for (;;) {
+            uint32_t tail = __atomic_load_n(&m_header->tail, __ATOMIC_ACQUIRE);
+            size_t space = Capacity - (m_header->head - tail);
+            if (space >= need) {
+                return space;
+            }
+            // If the consumer moves tail after the load, the futex returns at once.
+            __atomic_store_n(&m_header->producer_waiting, 1, __ATOMIC_SEQ_CST);
+            futex(&m_header->tail, FUTEX_WAIT, tail);
+        }
+    }
+
+    void publish(uint32_t head) const
+    {
+        __atomic_store_n(&m_header->head, head, __ATOMIC_SEQ_CST);
+        uint32_t waiting = __atomic_exchange_n(&m_header->consumer_waiting, 0, __ATOMIC_SEQ_CST);
+        if (waiting & FutexWaiter) {
+            futex(&m_header->head, FUTEX_WAKE, 1);
+        }
+        if ((waiting & SocketWaiter) && m_doorbell_fd >= 0) {
+            MessageStream::send_control(m_doorbell_fd, MessageStream::Doorbell, 0);
+        }
+    }
+
+    void release(uint32_t tail) const
+    {
+        __atomic_store_n(&m_header->tail, tail, __ATOMIC_SEQ_CST);
+        if (__atomic_exchange_n(&m_header->producer_waiting, 0, __ATOMIC_SEQ_CST)) {
+            futex(&m_header->tail, FUTEX_WAKE, 1);
+        }
+    }
+
+    void copy_in(uint32_t pos, const uint8_t* src, size_t len) const
+    {
+        uint32_t offset = pos & (Capacity - 1);
+        size_t first = (len < Capacity - offset) ? len : Capacity - offset;
+        memcpy(&m_data[offset], src, first);
+        memcpy(m_data, src + first, len - first);
+    }
+
+    void copy_out(uint32_t pos, uint8_t* dest, size_t len) const
+    {
+        uint32_t offset = pos & (Capacity - 1);
+        size_t first = (len < Capacity - offset) ? len : Capacity - offset;
+        memcpy(dest, &m_data[offset], first);
+        memcpy(dest + first, m_data, len - first);
+    }
+
+    SharedRingHeader* m_header { nullptr };
+    uint8_t* m_data { nullptr };
+    int m_doorbell_fd { -1 };
+    std::vector<char> m_partial;
+    size_t m_partial_left { 0 };
+    std::vector<char> m_scratch;
+};
@@ -25,6 +25,7 @@ public:
     virtual std::unique_ptr<Message> handle(const KeyboardMessage& msg) override;
     virtual std::unique_ptr<Message> handle(const DisplayMessage& msg) override;
     virtual std::unique_ptr<Message> handle(const WindowCloseRequestMessage& msg) override;
+    virtual std::unique_ptr<Message> handle(const FrameDoneMessage& msg) override;
 
     // Notifiers
     virtual std::unique_ptr<Message> handle(const NotifyWindowStatusChangedMessage& msg) override;
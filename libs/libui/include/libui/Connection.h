@@ -29,6 +29,7 @@ private:
 
     int m_connection_fd;
     int m_connection_id;
+    pid_t m_server_pid;
     ClientConnection<BaseWindowServerDecoder, ClientDecoder> m_connection_with_server;
     BaseWindowServerDecoder m_server_decoder;
     ClientDecoder m_client_decoder;
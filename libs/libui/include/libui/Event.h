@@ -32,6 +32,7 @@ public:
         DisplayEvent,
         LayoutEvent,
         WindowCloseRequestEvent,
+        FrameDoneEvent,
 
         UIHandlerInvoke,
 
@@ -193,6 +194,16 @@ private:
     uint32_t m_window_id;
 };
 
+class FrameDoneEvent : public Event {
+public:
+    FrameDoneEvent()
+        : Event(Event::Type::FrameDoneEvent)
+    {
+    }
+
+    ~FrameDoneEvent() = default;
+};
+
 // Notifiers
 class NotifyWindowStatusChangedEvent : public Event {
 public:
@@ -8,6 +8,7 @@
 #pragma once
 #include <libfoundation/Object.h>
 #include <libg/Rect.h>
+#include <libg/Region.h>
 #include <libui/Event.h>
 
 namespace UI {
@@ -19,6 +20,7 @@ public:
     bool send_invalidate_message_to_server(const LG::Rect& rect) const;
     void send_display_message_to_self(Window& win, const LG::Rect& display_rect);
     void send_layout_message(Window& win, UI::View* for_view);
+    LG::Region take_display_region();
 
     void receive_event(std::unique_ptr<LFoundation::Event> event) override;
     virtual void receive_mouse_move_event(MouseEvent&) { }
@@ -31,7 +33,7 @@ public:
 
 protected:
     bool m_display_message_sent { false };
-    LG::Rect m_prev_display_message {};
+    LG::Region m_display_region {};
     Responder() = default;
 };
 
@@ -13,6 +13,7 @@
 #include <libfoundation/SharedBuffer.h>
 #include <libg/Color.h>
 #include <libg/PixelBitmap.h>
+#include <libg/Region.h>
 #include <libg/Size.h>
 #include <libg/string.h>
 #include <libui/View.h>
@@ -74,6 +75,7 @@ public:
 
 private:
     void fill_with_opaque(const LG::Rect&);
+    void display_pending_region();
 
     uint32_t m_id;
     BaseViewController* m_root_view_controller { nullptr };
@@ -83,6 +85,11 @@ private:
     LFoundation::SharedBuffer<LG::Color> m_buffer;
     View* m_superview { nullptr };
     View* m_focused_view { nullptr };
+
+    // The window is displayed once per frame of the server: after it has
+    // sent its changes, new ones wait here till the frame is done.
+    bool m_frame_pending { false };
+    LG::Region m_pending_display_region {};
     LG::string m_icon_path { "/res/icons/apps/missing.icon" };
 };
 
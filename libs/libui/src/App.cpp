@@ -20,7 +20,7 @@ App& App::the()
 
 App::App()
     : m_event_loop()
-    , m_server_connection(socket(PF_LOCAL, 0, 0))
+    , m_server_connection(socket(PF_LOCAL, SOCK_STREAM, 0))
 {
     s_the = this;
 }
@@ -38,14 +38,8 @@ void Button::display(const LG::Rect& rect)
         text_start.set_x(bounds().width() - content_width);
     }
 
-    auto& f = font();
-    const size_t letter_spacing = f.glyph_spacing();
-
     ctx.set_fill_color(title_color());
-    for (int i = 0; i < m_title.size(); i++) {
-        ctx.draw(text_start, f.glyph_bitmap(m_title[i]));
-        text_start.offset_by(f.glyph_width(m_title[i]) + letter_spacing, 0);
-    }
+    ctx.draw_text(text_start, font(), m_title.c_str(), m_title.size());
 }
 
 void Button::hover_begin(const LG::Point<int>& location)
@@ -24,7 +24,7 @@ Connection& Connection::the()
 {
     // FIXME: Thread-safe method to be applied
     if (!s_the) {
-        new Connection(socket(PF_LOCAL, 0, 0));
+        new Connection(socket(PF_LOCAL, SOCK_STREAM, 0));
     }
     return *s_the;
 }
@@ -71,7 +71,12 @@ void Connection::greeting()
 {
     auto resp_message = send_sync_message<GreetMessageReply>(GreetMessage(getpid()));
     m_connection_id = resp_message->connection_id();
+    m_server_pid = resp_message->server_pid();
     m_connection_with_server.set_accepted_key(m_connection_id);
+
+    // Small and frequent messages (mouse moves, invalidations) go through
+    // shared rings from now on, the socket is used as a fallback.
+    m_connection_with_server.enable_shared_rings(m_server_pid);
 #ifdef DEBUG_CONNECTION
     Logger::debug << "Got greet with server" << std::endl;
 #endif
@@ -79,6 +84,8 @@ void Connection::greeting()
 
 int Connection::new_window(const Window& window)
 {
+    // The server maps the window's buffer to compose it.
+    window.buffer().grant(m_server_pid);
     auto message = CreateWindowMessage(key(), window.type(), window.bounds().width(), window.bounds().height(), window.buffer().id(), window.icon_path());
     auto resp_message = send_sync_message<CreateWindowMessageReply>(message);
 #ifdef DEBUG_CONNECTION
@@ -49,18 +49,22 @@ void Label::display(const LG::Rect& rect)
     }
 
     ctx.set_fill_color(text_color());
-    for (int i = 0; i < m_text.size(); i++) {
-        size_t glyph_width = f.glyph_width(m_text[i]) + letter_spacing;
-        if (need_to_stop_rendering_text && text_start.x() + glyph_width > width_when_stop_rendering_text) {
-            for (int j = 0; j < 3; j++) {
-                ctx.draw(text_start, f.glyph_bitmap('.'));
-                text_start.offset_by(f.glyph_width('.') + letter_spacing, 0);
-            }
-            return;
+    if (!need_to_stop_rendering_text) {
+        ctx.draw_text(text_start, f, m_text.c_str(), m_text.size());
+        return;
+    }
+
+    size_t visible_length = 0;
+    LG::Point<int> dots_start = text_start;
+    for (; visible_length < m_text.size(); visible_length++) {
+        size_t glyph_width = f.glyph_width((uint8_t)m_text[visible_length]) + letter_spacing;
+        if (dots_start.x() + glyph_width > width_when_stop_rendering_text) {
+            break;
         }
-        ctx.draw(text_start, f.glyph_bitmap(m_text[i]));
-        text_start.offset_by(glyph_width, 0);
+        dots_start.offset_by(glyph_width, 0);
     }
+    ctx.draw_text(text_start, f, m_text.c_str(), visible_length);
+    ctx.draw_text(dots_start, f, "...", 3);
 }
 
 void Label::hover_begin(const LG::Point<int>& location)
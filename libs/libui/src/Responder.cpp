@@ -25,15 +25,25 @@ void Responder::send_layout_message(Window& win, UI::View* for_view)
     m_display_message_sent = false;
 }
 
+// Areas, which are asked to be displayed before the display event comes,
+// are gathered into one region and displayed together.
 void Responder::send_display_message_to_self(Window& win, const LG::Rect& display_rect)
 {
-    if (!m_display_message_sent || m_prev_display_message != display_rect) {
+    m_display_region.unite(display_rect);
+    if (!m_display_message_sent) {
         LFoundation::EventLoop::the().add(win, new DisplayEvent(display_rect));
         m_display_message_sent = true;
-        m_prev_display_message = display_rect;
     }
 }
 
+LG::Region Responder::take_display_region()
+{
+    auto region = m_display_region;
+    m_display_region.clear();
+    m_display_message_sent = false;
+    return region;
+}
+
 void Responder::receive_event(std::unique_ptr<LFoundation::Event> event)
 {
     if (event->type() == Event::Type::MouseEvent) {
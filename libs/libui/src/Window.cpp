@@ -48,7 +48,7 @@ bool Window::set_frame_style(const LG::Color& color)
 
 bool Window::did_format_change()
 {
-    if (bitmap().format() == LG::PixelBitmapFormat::RGBA) {
+    if (bitmap().has_alpha_channel()) {
         // Set full bitmap as opaque, to mix colors correctly.
         fill_with_opaque(bounds());
     }
@@ -98,15 +98,18 @@ void Window::receive_event(std::unique_ptr<LFoundation::Event> event)
     if (event->type() == Event::Type::DisplayEvent) {
         if (m_superview) {
             DisplayEvent& own_event = *(DisplayEvent*)event.get();
-
-            // If the window is in RGBA mode, we have to fill this rect
-            // with opaque color before superview will mix it's color on
-            // top of bitmap.
-            if (bitmap().format() == LG::PixelBitmapFormat::RGBA) {
-                fill_with_opaque(own_event.bounds());
+            m_pending_display_region.unite(m_superview->take_display_region());
+            m_pending_display_region.unite(own_event.bounds());
+            if (!m_frame_pending) {
+                display_pending_region();
             }
+        }
+    }
 
-            m_superview->receive_display_event(own_event);
+    if (event->type() == Event::Type::FrameDoneEvent) {
+        m_frame_pending = false;
+        if (m_superview) {
+            display_pending_region();
         }
     }
 
@@ -118,6 +121,30 @@ void Window::receive_event(std::unique_ptr<LFoundation::Event> event)
     }
 }
 
+void Window::display_pending_region()
+{
+    auto region = m_pending_display_region.intersection(bounds());
+    m_pending_display_region.clear();
+    if (region.empty()) {
+        return;
+    }
+
+    for (int i = 0; i < region.rects().size(); i++) {
+        // If the window is in RGBA mode, we have to fill this rect
+        // with opaque color before superview will mix it's color on
+        // top of bitmap.
+        if (bitmap().has_alpha_channel()) {
+            fill_with_opaque(region.rects()[i]);
+        }
+
+        DisplayEvent rect_event(region.rects()[i]);
+        m_superview->receive_display_event(rect_event);
+    }
+
+    // The superview has sent the changes, the server tells when they are shown.
+    m_frame_pending = true;
+}
+
 void Window::fill_with_opaque(const LG::Rect& rect)
 {
     const auto color = LG::Color(0, 0, 0, 0).u32();
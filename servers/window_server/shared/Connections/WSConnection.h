@@ -34,9 +34,10 @@ private:
 
 class GreetMessageReply : public Message {
 public:
-    GreetMessageReply(message_key_t key, uint32_t connection_id)
+    GreetMessageReply(message_key_t key, uint32_t connection_id, int server_pid)
         : m_key(key)
         , m_connection_id(connection_id)
+        , m_server_pid(server_pid)
     {
     }
     int id() const override { return 2; }
@@ -44,6 +45,7 @@ public:
     int key() const override { return m_key; }
     int decoder_magic() const override { return 320; }
     uint32_t connection_id() const { return m_connection_id; }
+    int server_pid() const { return m_server_pid; }
     EncodedMessage encode() const override
     {
         EncodedMessage buffer;
@@ -51,12 +53,14 @@ public:
         Encoder::append(buffer, id());
         Encoder::append(buffer, key());
         Encoder::append(buffer, m_connection_id);
+        Encoder::append(buffer, m_server_pid);
         return buffer;
     }
 
 private:
     message_key_t m_key;
     uint32_t m_connection_id;
+    int m_server_pid;
 };
 
 class CreateWindowMessage : public Message {
@@ -364,6 +368,7 @@ public:
         Encoder::decode(buf, decoded_msg_len, secret_key);
 
         uint32_t var_connection_id;
+        int var_server_pid;
         int var_type;
         uint32_t var_width;
         uint32_t var_height;
@@ -383,7 +388,8 @@ public:
             return new GreetMessage(secret_key);
         case 2:
             Encoder::decode(buf, decoded_msg_len, var_connection_id);
-            return new GreetMessageReply(secret_key, var_connection_id);
+            Encoder::decode(buf, decoded_msg_len, var_server_pid);
+            return new GreetMessageReply(secret_key, var_connection_id, var_server_pid);
         case 3:
             Encoder::decode(buf, decoded_msg_len, var_type);
             Encoder::decode(buf, decoded_msg_len, var_width);
@@ -757,6 +763,33 @@ private:
     LG::string m_icon_path;
 };
 
+class FrameDoneMessage : public Message {
+public:
+    FrameDoneMessage(message_key_t key, int win_id)
+        : m_key(key)
+        , m_win_id(win_id)
+    {
+    }
+    int id() const override { return 10; }
+    int reply_id() const override { return -1; }
+    int key() const override { return m_key; }
+    int decoder_magic() const override { return 737; }
+    int win_id() const { return m_win_id; }
+    EncodedMessage encode() const override
+    {
+        EncodedMessage buffer;
+        Encoder::append(buffer, decoder_magic());
+        Encoder::append(buffer, id());
+        Encoder::append(buffer, key());
+        Encoder::append(buffer, m_win_id);
+        return buffer;
+    }
+
+private:
+    message_key_t m_key;
+    int m_win_id;
+};
+
 class BaseWindowClientDecoder : public MessageDecoder {
 public:
     BaseWindowClientDecoder() { }
@@ -824,6 +857,9 @@ public:
             Encoder::decode(buf, decoded_msg_len, var_changed_window_id);
             Encoder::decode(buf, decoded_msg_len, var_icon_path);
             return new NotifyWindowIconChangedMessage(secret_key, var_win_id, var_changed_window_id, var_icon_path);
+        case 10:
+            Encoder::decode(buf, decoded_msg_len, var_win_id);
+            return new FrameDoneMessage(secret_key, var_win_id);
         default:
             decoded_msg_len = saved_dml;
             return nullptr;
@@ -855,6 +891,8 @@ public:
             return handle(static_cast<const NotifyWindowStatusChangedMessage&>(msg));
         case 9:
             return handle(static_cast<const NotifyWindowIconChangedMessage&>(msg));
+        case 10:
+            return handle(static_cast<const FrameDoneMessage&>(msg));
         default:
             return nullptr;
         }
@@ -869,4 +907,5 @@ public:
     virtual std::unique_ptr<Message> handle(const DisconnectMessage& msg) { return nullptr; }
     virtual std::unique_ptr<Message> handle(const NotifyWindowStatusChangedMessage& msg) { return nullptr; }
     virtual std::unique_ptr<Message> handle(const NotifyWindowIconChangedMessage& msg) { return nullptr; }
+    virtual std::unique_ptr<Message> handle(const FrameDoneMessage& msg) { return nullptr; }
 };
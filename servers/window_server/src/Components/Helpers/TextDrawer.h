@@ -28,12 +28,7 @@ namespace Helpers {
 
     [[gnu::always_inline]] inline static void draw_text(LG::Context& ctx, LG::Point<int> pt, const std::string& text, const LG::Font& f)
     {
-        const size_t letter_spacing = f.glyph_spacing();
-
-        for (int i = 0; i < text.size(); i++) {
-            ctx.draw(pt, f.glyph_bitmap(text[i]));
-            pt.offset_by(f.glyph_width(text[i]) + letter_spacing, 0);
-        }
+        ctx.draw_text(pt, f, text.c_str(), text.size());
     }
 
 } // namespace Helpers
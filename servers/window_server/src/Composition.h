@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2020-2021 Nikita Melekhin. All rights reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+#include <libfoundation/WorkerPool.h>
+#include <libg/Rect.h>
+#include <libg/Region.h>
+#include <type_traits>
+#include <vector>
+
+// Parts of the compositor, which don't depend on the screen, the window
+// manager or components, so benchmarks drive the same code.
+
+namespace WinServer {
+
+struct Tile {
+    LG::Rect bounds;
+    LG::Region damage;
+#ifdef COMPOSITOR_DEBUG_OVERDRAW
+    size_t drawn_pixels { 0 };
+#endif // COMPOSITOR_DEBUG_OVERDRAW
+};
+
+// The damage is drawn in tiles on a grid. Tiles share no pixels, so they are
+// drawn in any order and the frame comes out the same.
+class TileGrid {
+public:
+    explicit TileGrid(int tile_size)
+        : m_tile_size(tile_size)
+    {
+    }
+
+    inline std::vector<Tile>& tiles() { return m_tiles; }
+    inline const std::vector<Tile>& tiles() const { return m_tiles; }
+
+    // Splits the damage into tiles, which have something to draw.
+    void split(const LG::Region& damage)
+    {
+        m_tiles.clear();
+        if (damage.empty()) {
+            return;
+        }
+
+        auto& bounds = damage.bounds();
+        int first_x = bounds.min_x() - bounds.min_x() % m_tile_size;
+        int first_y = bounds.min_y() - bounds.min_y() % m_tile_size;
+        for (int y = first_y; y <= bounds.max_y(); y += m_tile_size) {
+            for (int x = first_x; x <= bounds.max_x(); x += m_tile_size) {
+                LG::Rect tile_bounds(x, y, m_tile_size, m_tile_size);
+                auto tile_damage = damage.intersection(tile_bounds);
+                if (!tile_damage.empty()) {
+                    m_tiles.push_back(Tile { tile_bounds, std::move(tile_damage) });
+                }
+            }
+        }
+    }
+
+    template <typename DrawTile>
+    void draw(LFoundation::WorkerPool& pool, DrawTile draw_tile)
+    {
+        pool.run(m_tiles.size(), [&](size_t i) {
+            draw_tile(m_tiles[i]);
+        });
+    }
+
+private:
+    int m_tile_size;
+    std::vector<Tile> m_tiles;
+};
+
+// The damage, which every buffer of a flipped pair has missed since it was
+// drawn. A buffer is drawn again where it is stale instead of being copied
+// back from the other one after a flip.
+class BufferDamage {
+public:
+    // The write buffer was displayed in the last frame, so it has missed the
+    // damage drawn then. Returns the region to draw into it.
+    LG::Region take(int write_buffer, const LG::Region& frame_damage)
+    {
+        auto& missing = m_missing_damage[write_buffer];
+        auto region = frame_damage.union_of(missing);
+        missing.clear();
+        return region;
+    }
+
+    // The displayed buffer misses what is drawn into the other one.
+    inline void miss(int display_buffer, const LG::Region& damage) { m_missing_damage[display_buffer].unite(damage); }
+
+    inline void clear()
+    {
+        m_missing_damage[0].clear();
+        m_missing_damage[1].clear();
+    }
+
+private:
+    LG::Region m_missing_damage[2];
+};
+
+// Going top-down, every window gets the damaged parts, which are not hidden
+// by opaque windows above it. What is left uncovered in the end is the only
+// place, where the wallpaper is seen. Then windows are drawn bottom-up over it.
+// A window has visible(), bounds() and opaque_region().
+template <typename Windows, typename DrawWallpaper, typename DrawWindow>
+void compose_windows(const LG::Region& damage, const Windows& windows, DrawWallpaper draw_wallpaper, DrawWindow draw_window)
+{
+    auto exposed = damage;
+    std::vector<std::remove_cv_t<std::remove_reference_t<decltype(*windows.begin())>>> drawn_windows;
+    std::vector<LG::Region> window_fragments;
+    for (auto* window : windows) {
+        if (exposed.empty()) {
+            break;
+        }
+        if (!window->visible()) {
+            continue;
+        }
+
+        auto fragments = exposed.intersection(window->bounds());
+        if (fragments.empty()) {
+            continue;
+        }
+
+        exposed.subtract(window->opaque_region());
+        drawn_windows.push_back(window);
+        window_fragments.push_back(std::move(fragments));
+    }
+
+    for (int i = 0; i < exposed.rects().size(); i++) {
+        draw_wallpaper(exposed.rects()[i]);
+    }
+
+    for (int i = (int)drawn_windows.size() - 1; i >= 0; i--) {
+        auto& fragments = window_fragments[i].rects();
+        auto opaque_region = drawn_windows[i]->opaque_region();
+        for (int j = 0; j < fragments.size(); j++) {
+            draw_window(*drawn_windows[i], fragments[j], opaque_region);
+        }
+    }
+}
+
+} // namespace WinServer
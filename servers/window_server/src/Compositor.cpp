@@ -6,10 +6,12 @@
  */
 
 #include "Compositor.h"
+#include "Connection.h"
 #include "Components/Base/BaseWindow.h"
 #include "Components/ControlBar/ControlBar.h"
 #include "Components/MenuBar/MenuBar.h"
 #include "Components/Popup/Popup.h"
+#include "Components/Helpers/TextDrawer.h"
 #include "CursorManager.h"
 #include "ResourceManager.h"
 #include "Screen.h"
@@ -17,6 +19,7 @@
 #include <libfoundation/EventLoop.h>
 #include <libfoundation/Memory.h>
 #include <libg/Context.h>
+#include <libg/Font.h>
 
 namespace WinServer {
 
@@ -37,62 +40,153 @@ Compositor::Compositor()
 #endif // TARGET_MOBILE
 {
     s_the = this;
+    auto& cursor = m_cursor_manager.current_cursor();
+    m_cursor_save_under.resize(cursor.width(), cursor.height());
+    LFoundation::EventLoop::the().add(
+        Screen::the().fd(), [] {
+            Compositor::the().on_vblank();
+        },
+        nullptr);
     invalidate(Screen::the().bounds());
-    LFoundation::EventLoop::the().add(LFoundation::Timer([] {
-        Compositor::the().refresh();
-    },
-        1000 / 60, LFoundation::Timer::Repeat));
 }
 
-void Compositor::copy_changes_to_second_buffer(const std::vector<LG::Rect>& areas)
+void Compositor::schedule_frame()
 {
-    auto& screen = Screen::the();
+    if (m_frame_scheduled) {
+        return;
+    }
+    m_frame_scheduled = true;
+    Screen::the().request_vblank();
+}
 
-    for (int i = 0; i < areas.size(); i++) {
-        auto bounds = areas[i].intersection(screen.bounds());
-        auto* buf1_ptr = reinterpret_cast<uint32_t*>(&screen.display_bitmap()[bounds.min_y()][bounds.min_x()]);
-        auto* buf2_ptr = reinterpret_cast<uint32_t*>(&screen.write_bitmap()[bounds.min_y()][bounds.min_x()]);
-        for (int j = 0; j < bounds.height(); j++) {
-            LFoundation::fast_copy(buf2_ptr, buf1_ptr, bounds.width());
-            buf1_ptr += screen.width();
-            buf2_ptr += screen.width();
+void Compositor::on_vblank()
+{
+    Screen::the().take_vblank();
+    m_frame_scheduled = false;
+    refresh();
+    send_frame_callbacks();
+}
+
+void Compositor::add_frame_callback(int connection_id, int window_id)
+{
+    for (auto& callback : m_frame_callbacks) {
+        if (callback.connection_id == connection_id && callback.window_id == window_id) {
+            return;
         }
     }
+    m_frame_callbacks.push_back(FrameCallback { connection_id, window_id });
+    schedule_frame();
 }
 
-[[gnu::flatten]] void Compositor::refresh()
+void Compositor::send_frame_callbacks()
 {
-    if (m_invalidated_areas.size() == 0) {
+    auto& connection = Connection::the();
+    for (auto& callback : m_frame_callbacks) {
+        connection.send_async_message(FrameDoneMessage(callback.connection_id, callback.window_id));
+    }
+    m_frame_callbacks.clear();
+}
+
+void Compositor::save_under_cursor(const LG::PixelBitmap& scene, const LG::Rect& bounds, const LG::Rect& part)
+{
+    int x = part.min_x() - bounds.min_x();
+    for (int y = part.min_y(); y <= part.max_y(); y++) {
+        LFoundation::fast_copy((uint32_t*)&m_cursor_save_under[y - bounds.min_y()][x], (uint32_t*)&scene[y][part.min_x()], part.width());
+    }
+}
+
+void Compositor::restore_under_cursor(LG::PixelBitmap& bitmap, const LG::Rect& bounds)
+{
+    for (int y = 0; y < bounds.height(); y++) {
+        LFoundation::fast_copy((uint32_t*)&bitmap[bounds.min_y() + y][bounds.min_x()], (uint32_t*)m_cursor_save_under[y], bounds.width());
+    }
+}
+
+// A pure cursor move does not touch the scene: the pixels under the old place
+// come back from the save-under buffer, and the cursor is blit right into the
+// displayed buffer.
+void Compositor::move_cursor_overlay()
+{
+    m_cursor_invalidated = false;
+
+    auto& screen = Screen::the();
+    auto bounds = m_cursor_manager.draw_bounds().intersection(screen.bounds());
+    if (bounds == m_cursor_bounds) {
         return;
     }
 
+    auto& display = screen.display_bitmap();
+    restore_under_cursor(display, m_cursor_bounds);
+    save_under_cursor(display, bounds, bounds);
+    LG::Context ctx(display);
+    ctx.draw(m_cursor_manager.draw_position(), m_cursor_manager.current_cursor());
+    m_cursor_bounds = bounds;
+}
+
+#ifdef COMPOSITOR_DEBUG_OVERDRAW
+inline LG::Rect Compositor::overdraw_hud_bounds() const
+{
+    auto& screen = Screen::the();
+    return LG::Rect(0, screen.bounds().height() - 20, 140, 20);
+}
+
+// Shows how many pixels were drawn for every damaged pixel in the last frame.
+// The caller clips it.
+void Compositor::draw_overdraw_hud(LG::Context& ctx)
+{
+    size_t permille = m_damaged_pixels ? m_drawn_pixels * 1000 / m_damaged_pixels : 0;
+    char text[32];
+    snprintf(text, sizeof(text), "overdraw %d.%03dx", (int)(permille / 1000), (int)(permille % 1000));
+
+    auto hud = overdraw_hud_bounds();
+    ctx.set_fill_color(LG::Color::Black);
+    ctx.fill(hud);
+    ctx.set_fill_color(LG::Color::White);
+    Helpers::draw_text(ctx, { hud.min_x() + 4, hud.min_y() + 6 }, text, LG::Font::system_font());
+}
+#endif // COMPOSITOR_DEBUG_OVERDRAW
+
+// Draws everything in the damaged part of the tile: the wallpaper, windows,
+// components on top of them and the cursor. Nothing outside of the tile is
+// touched, so tiles can be drawn in any order.
+[[gnu::flatten]] void Compositor::compose_tile(Tile& tile, const LG::Rect& cursor_bounds)
+{
     auto& screen = Screen::the();
     auto& wm = WindowManager::the();
-    auto invalidated_areas = std::move(m_invalidated_areas);
+    auto& invalidated_region = tile.damage;
+#ifdef TARGET_MOBILE
+    auto& invalidated_areas = invalidated_region.rects();
+#endif // TARGET_MOBILE
     LG::Context ctx(screen.write_bitmap());
 
-    auto is_window_area_invalidated = [&](const std::vector<LG::Rect>& areas, const LG::Rect& area) -> bool {
-        for (int i = 0; i < areas.size(); i++) {
-            if (area.intersects(areas[i])) {
-                return true;
-            }
-        }
-        return false;
-    };
-
     auto draw_wallpaper_for_area = [&](const LG::Rect& area) {
         ctx.add_clip(area);
         ctx.draw({ 0, 0 }, m_resource_manager.background());
         ctx.reset_clip();
+#ifdef COMPOSITOR_DEBUG_OVERDRAW
+        tile.drawn_pixels += area.square();
+#endif // COMPOSITOR_DEBUG_OVERDRAW
     };
 
 #ifdef TARGET_DESKTOP
-    auto draw_window = [&](Desktop::Window& window, const LG::Rect& area) {
+    // The frame is not drawn for fragments, which the content covers fully.
+    auto draw_window = [&](Desktop::Window& window, const LG::Rect& area, const LG::Region& opaque_region) {
+        bool covered_by_content = opaque_region.contains(area);
+
         ctx.add_clip(area);
         ctx.add_clip(window.bounds());
-        window.frame().draw(ctx);
+        if (!covered_by_content) {
+            window.frame().draw(ctx);
+        }
         ctx.draw_rounded(window.content_bounds().origin(), window.content_bitmap(), window.corner_mask());
         ctx.reset_clip();
+
+#ifdef COMPOSITOR_DEBUG_OVERDRAW
+        if (!covered_by_content) {
+            tile.drawn_pixels += area.square();
+        }
+        tile.drawn_pixels += area.intersection(window.content_bounds()).square();
+#endif // COMPOSITOR_DEBUG_OVERDRAW
     };
 #elif TARGET_MOBILE
     auto draw_window = [&](Mobile::Window& window, const LG::Rect& area) {
@@ -104,9 +198,7 @@ void Compositor::copy_changes_to_second_buffer(const std::vector<LG::Rect>& area
 #endif // TARGET_DESKTOP
 
 #ifdef TARGET_DESKTOP
-    for (int i = 0; i < invalidated_areas.size(); i++) {
-        draw_wallpaper_for_area(invalidated_areas[i]);
-    }
+    compose_windows(invalidated_region, wm.windows(), draw_wallpaper_for_area, draw_window);
 #elif TARGET_MOBILE
     // Draw wallpaper only in case when WM contains only homescreen app.
     if (wm.windows().size() <= 1) {
@@ -114,44 +206,34 @@ void Compositor::copy_changes_to_second_buffer(const std::vector<LG::Rect>& area
             draw_wallpaper_for_area(invalidated_areas[i]);
         }
     }
-#endif // TARGET_DESKTOP
 
-    auto& windows = wm.windows();
-#ifdef TARGET_DESKTOP
-    for (auto it = windows.rbegin(); it != windows.rend(); it++) {
-        auto& window = *(*it);
-        if (window.visible() && is_window_area_invalidated(invalidated_areas, window.bounds())) {
-            for (int i = 0; i < invalidated_areas.size(); i++) {
-                draw_window(window, invalidated_areas[i]);
-            }
-        }
-    }
-#elif TARGET_MOBILE
     // Draw wallpaper only in case when WM contains homescreen app.
+    auto& windows = wm.windows();
     if (windows.begin() != windows.end()) {
         auto& window = *(*windows.begin());
-        if (is_window_area_invalidated(invalidated_areas, window.bounds())) {
+        if (invalidated_region.intersects(window.bounds())) {
             for (int i = 0; i < invalidated_areas.size(); i++) {
                 draw_window(window, invalidated_areas[i]);
             }
         }
     }
 #endif // TARGET_DESKTOP
-
-    if (m_popup.visible()) {
-        for (int i = 0; i < invalidated_areas.size(); i++) {
-            ctx.add_clip(invalidated_areas[i]);
-            m_popup.draw(ctx);
+    // Components on top of windows are drawn only where they are damaged.
+    auto draw_damaged_part = [&](const LG::Rect& bounds, auto draw) {
+        auto damage = invalidated_region.intersection(bounds);
+        for (int i = 0; i < damage.rects().size(); i++) {
+            ctx.add_clip(damage.rects()[i]);
+            draw();
             ctx.reset_clip();
         }
-    }
+    };
 
-    for (int i = 0; i < invalidated_areas.size(); i++) {
-        ctx.add_clip(invalidated_areas[i]);
-        m_menu_bar.draw(ctx);
-        ctx.reset_clip();
+    if (m_popup.visible()) {
+        draw_damaged_part(m_popup.bounds(), [&] { m_popup.draw(ctx); });
     }
 
+    draw_damaged_part(m_menu_bar.bounds(), [&] { m_menu_bar.draw(ctx); });
+
 #ifdef TARGET_MOBILE
     for (int i = 0; i < invalidated_areas.size(); i++) {
         ctx.add_clip(invalidated_areas[i]);
@@ -160,16 +242,64 @@ void Compositor::copy_changes_to_second_buffer(const std::vector<LG::Rect>& area
     }
 #endif // TARGET_MOBILE
 
-    auto mouse_draw_position = m_cursor_manager.draw_position();
-    auto& current_mouse_bitmap = m_cursor_manager.current_cursor();
-    for (int i = 0; i < invalidated_areas.size(); i++) {
-        ctx.add_clip(invalidated_areas[i]);
-        ctx.draw(mouse_draw_position, current_mouse_bitmap);
+#ifdef COMPOSITOR_DEBUG_OVERDRAW
+    draw_damaged_part(overdraw_hud_bounds(), [&] { draw_overdraw_hud(ctx); });
+#endif // COMPOSITOR_DEBUG_OVERDRAW
+
+    // The scene of the tile is ready, the cursor goes on top of it.
+    auto cursor_part = cursor_bounds.intersection(tile.bounds);
+    if (!cursor_part.empty()) {
+        save_under_cursor(screen.write_bitmap(), cursor_bounds, cursor_part);
+        ctx.add_clip(cursor_part);
+        ctx.draw(m_cursor_manager.draw_position(), m_cursor_manager.current_cursor());
         ctx.reset_clip();
     }
+}
+
+void Compositor::refresh()
+{
+    if (m_invalidated_region.empty()) {
+        if (m_cursor_invalidated) {
+            move_cursor_overlay();
+        }
+        return;
+    }
+#ifdef COMPOSITOR_DEBUG_OVERDRAW
+    // Not invalidate(): the HUD should not schedule frames itself.
+    m_invalidated_region.unite(overdraw_hud_bounds());
+#endif // COMPOSITOR_DEBUG_OVERDRAW
+
+    auto& screen = Screen::the();
+    auto frame_damage = m_invalidated_region.intersection(screen.bounds());
+    m_invalidated_region.clear();
+
+    auto invalidated_region = m_buffer_damage.take(screen.write_buffer_index(), frame_damage);
+
+    // The cursor is drawn by the tiles it lies on, so all of them are drawn.
+    auto cursor_bounds = m_cursor_manager.draw_bounds().intersection(screen.bounds());
+    invalidated_region.unite(cursor_bounds);
+
+    m_tiles.split(invalidated_region);
+    m_tiles.draw(m_tile_pool, [&](Tile& tile) {
+        compose_tile(tile, cursor_bounds);
+    });
+
+#ifdef COMPOSITOR_DEBUG_OVERDRAW
+    m_damaged_pixels = invalidated_region.square();
+    m_drawn_pixels = 0;
+    for (auto& tile : m_tiles.tiles()) {
+        m_drawn_pixels += tile.drawn_pixels;
+    }
+#endif // COMPOSITOR_DEBUG_OVERDRAW
+
+    // The displayed buffer misses this frame and has the cursor, which is
+    // not a part of the scene, at its old place.
+    m_buffer_damage.miss(screen.display_buffer_index(), frame_damage);
+    m_buffer_damage.miss(screen.display_buffer_index(), m_cursor_bounds);
 
     screen.swap_buffers();
-    copy_changes_to_second_buffer(invalidated_areas);
+    m_cursor_bounds = cursor_bounds;
+    m_cursor_invalidated = false;
 }
 
 } // namespace WinServer
\ No newline at end of file
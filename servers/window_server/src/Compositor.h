@@ -6,8 +6,15 @@
  */
 
 #pragma once
+
+// #define COMPOSITOR_DEBUG_OVERDRAW
+
 #include "../shared/Connections/WSConnection.h"
+#include "Composition.h"
 #include "ServerDecoder.h"
+#include <libfoundation/WorkerPool.h>
+#include <libg/Context.h>
+#include <libg/Region.h>
 #include <libipc/ServerConnection.h>
 #include <vector>
 
@@ -28,42 +35,12 @@ public:
 
     void refresh();
 
-    void optimized_invalidate_insert(std::vector<LG::Rect>& data, const LG::Rect& inv_area)
-    {
-        auto area = inv_area;
-        bool intersects = false;
-        int int_index = 0;
-        for (auto& rect : data) {
-            if (rect.contains(area)) {
-                return;
-            }
-        }
-
-        for (auto& rect : data) {
-            if (rect.intersects(area)) {
-                intersects = true;
-                break;
-            }
-            int_index++;
-        }
-
-        if (!intersects) {
-            data.push_back(area);
-            return;
-        }
-
-        data[int_index].unite(area);
-        for (int i = int_index + 1; i < data.size(); i++) {
-            if (data[int_index].intersects(data[i])) {
-                data[int_index].unite(data[i]);
-                std::swap(data[i], data.back());
-                data.pop_back();
-                i--;
-            }
-        }
-    }
+    inline void invalidate(const LG::Rect& area) { m_invalidated_region.unite(area), schedule_frame(); }
+    inline void invalidate_cursor() { m_cursor_invalidated = true, schedule_frame(); }
 
-    inline void invalidate(const LG::Rect& area) { optimized_invalidate_insert(m_invalidated_areas, area); }
+    // The window is told with a FrameDoneMessage, when the next frame is on
+    // the screen, so its app draws no more than once per frame.
+    void add_frame_callback(int connection_id, int window_id);
     inline CursorManager& cursor_manager() { return m_cursor_manager; }
     inline const CursorManager& cursor_manager() const { return m_cursor_manager; }
     inline ResourceManager& resource_manager() { return m_resource_manager; }
@@ -81,9 +58,48 @@ public:
 #endif // TARGET_MOBILE
 
 private:
-    void copy_changes_to_second_buffer(const std::vector<LG::Rect>& areas);
+    // Frames are drawn at vblanks, and only at those, which come after
+    // something has been invalidated. The server sleeps till then.
+    void schedule_frame();
+    void on_vblank();
+    void send_frame_callbacks();
+
+    // The damage is drawn in tiles of TileSize pixels.
+    static constexpr int TileSize = 128;
+    // Threads, which draw tiles besides the event loop. There are none yet:
+    // the kernel runs on one CPU, so workers would only add switches, and the
+    // drawing of components and fonts is not safe to run from threads.
+    static constexpr size_t TileWorkers = 0;
+
+    void compose_tile(Tile& tile, const LG::Rect& cursor_bounds);
+
+    // The cursor is not a part of the scene: it is put right into the displayed
+    // buffer, and the save-under buffer keeps what it hides.
+    void move_cursor_overlay();
+    void save_under_cursor(const LG::PixelBitmap& scene, const LG::Rect& bounds, const LG::Rect& part);
+    void restore_under_cursor(LG::PixelBitmap& bitmap, const LG::Rect& bounds);
+#ifdef COMPOSITOR_DEBUG_OVERDRAW
+    inline LG::Rect overdraw_hud_bounds() const;
+    void draw_overdraw_hud(LG::Context& ctx);
+
+    size_t m_drawn_pixels { 0 };
+    size_t m_damaged_pixels { 0 };
+#endif // COMPOSITOR_DEBUG_OVERDRAW
+
+    struct FrameCallback {
+        int connection_id;
+        int window_id;
+    };
 
-    std::vector<LG::Rect> m_invalidated_areas;
+    bool m_frame_scheduled { false };
+    std::vector<FrameCallback> m_frame_callbacks;
+    LG::Region m_invalidated_region;
+    TileGrid m_tiles { TileSize };
+    LFoundation::WorkerPool m_tile_pool { TileWorkers };
+    BufferDamage m_buffer_damage;
+    LG::PixelBitmap m_cursor_save_under;
+    LG::Rect m_cursor_bounds {};
+    bool m_cursor_invalidated { false };
     MenuBar& m_menu_bar;
     Popup& m_popup;
     CursorManager& m_cursor_manager;
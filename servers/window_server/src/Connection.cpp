@@ -27,15 +27,40 @@ Connection::Connection(int connection_fd)
 {
     s_the = this;
     int err = bind(m_connection_fd, "/tmp/win.sock", 9);
+    if (!err) {
+        err = ::listen(m_connection_fd, SOMAXCONN);
+    }
     if (!err) {
         LFoundation::EventLoop::the().add(
             m_connection_fd, [] {
-                Connection::the().listen();
+                Connection::the().accept_client();
             },
             nullptr);
     }
 }
 
+void Connection::accept_client()
+{
+    int client_fd = m_connection_with_clients.accept_client();
+    if (client_fd < 0) {
+        return;
+    }
+
+    LFoundation::EventLoop::the().add(
+        client_fd, [client_fd] {
+            Connection::the().listen(client_fd);
+        },
+        nullptr);
+}
+
+void Connection::listen(int client_fd)
+{
+    if (!m_connection_with_clients.pump_messages(client_fd)) {
+        LFoundation::EventLoop::the().remove(client_fd);
+        m_connection_with_clients.disconnect_client(client_fd);
+    }
+}
+
 void Connection::receive_event(std::unique_ptr<LFoundation::Event> event)
 {
     if (event->type() == WinServer::Event::Type::SendEvent) {
@@ -18,10 +18,8 @@ public:
     static Connection& the();
     explicit Connection(int connection_fd);
 
-    inline void listen()
-    {
-        m_connection_with_clients.pump_messages();
-    }
+    void accept_client();
+    void listen(int client_fd);
 
     inline bool send_async_message(const Message& msg) const { return m_connection_with_clients.send_message(msg); }
     inline int alloc_connection() { return ++m_connections_number; }
@@ -40,6 +40,8 @@ public:
     inline LG::Point<int> draw_position() { return { m_mouse_x - 6, m_mouse_y - 6 }; }
 #endif
 
+    inline LG::Rect draw_bounds() { return LG::Rect(draw_position().x(), draw_position().y(), current_cursor().width(), current_cursor().height()); }
+
     inline int x() const { return m_mouse_x; }
     inline int y() const { return m_mouse_y; }
 
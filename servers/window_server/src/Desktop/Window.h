@@ -13,6 +13,7 @@
 #include <libfoundation/SharedBuffer.h>
 #include <libg/PixelBitmap.h>
 #include <libg/Rect.h>
+#include <libg/Region.h>
 #include <sys/types.h>
 #include <utility>
 
@@ -49,6 +50,27 @@ public:
 
     inline const LG::CornerMask& corner_mask() const { return m_corner_mask; }
 
+    // The part of the window, which hides everything under it: the content
+    // without its rounded corners, if the content has no alpha channel.
+    LG::Region opaque_region() const
+    {
+        if (!visible() || content_bitmap().has_alpha_channel()) {
+            return LG::Region();
+        }
+
+        auto& content = content_bounds();
+        size_t radius = m_corner_mask.bottom_rounded() ? m_corner_mask.radius() : 0;
+        if (content.width() <= 2 * radius || content.height() <= radius) {
+            return LG::Region();
+        }
+
+        LG::Region region(LG::Rect(content.min_x(), content.min_y(), content.width(), content.height() - radius));
+        if (radius) {
+            region.unite(LG::Rect(content.min_x() + radius, content.max_y() - radius + 1, content.width() - 2 * radius, radius));
+        }
+        return region;
+    }
+
     inline const LG::string& icon_path() const { return m_icon_path; }
 
     inline std::vector<MenuDir>& menubar_content() { return m_menubar_content; }
@@ -11,6 +11,7 @@
 #include <fcntl.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <unistd.h>
 #include <utility>
 
 namespace WinServer {
@@ -51,4 +52,16 @@ void Screen::swap_buffers()
     ioctl(m_screen_fd, BGA_SWAP_BUFFERS, m_active_buffer);
 }
 
+void Screen::request_vblank()
+{
+    ioctl(m_screen_fd, BGA_REQUEST_VBLANK, 0);
+}
+
+uint32_t Screen::take_vblank()
+{
+    uint32_t vblank = 0;
+    read(m_screen_fd, (char*)&vblank, sizeof(vblank));
+    return vblank;
+}
+
 } // namespace WinServer
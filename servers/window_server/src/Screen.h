@@ -19,12 +19,21 @@ public:
 
     void swap_buffers();
 
+    // The display is readable at the first vblank after request_vblank(),
+    // take_vblank() gives the vblank counter and lets it sleep again.
+    inline int fd() const { return m_screen_fd; }
+    void request_vblank();
+    uint32_t take_vblank();
+
     inline size_t width() { return m_bounds.width(); }
     inline size_t height() const { return m_bounds.height(); }
     inline LG::Rect& bounds() { return m_bounds; }
     inline const LG::Rect& bounds() const { return m_bounds; }
     inline uint32_t depth() const { return m_depth; }
 
+    inline int display_buffer_index() const { return m_active_buffer; }
+    inline int write_buffer_index() const { return m_active_buffer ^ 1; }
+
     inline LG::PixelBitmap& write_bitmap() { return *m_write_bitmap_ptr; }
     inline const LG::PixelBitmap& write_bitmap() const { return *m_write_bitmap_ptr; }
     inline LG::PixelBitmap& display_bitmap() { return *m_display_bitmap_ptr; }
@@ -12,12 +12,13 @@
 #include "Mobile/Window.h"
 #endif
 #include "WindowManager.h"
+#include <unistd.h>
 
 namespace WinServer {
 
 std::unique_ptr<Message> WindowServerDecoder::handle(const GreetMessage& msg)
 {
-    return new GreetMessageReply(msg.key(), Connection::the().alloc_connection());
+    return new GreetMessageReply(msg.key(), Connection::the().alloc_connection(), getpid());
 }
 
 #ifdef TARGET_DESKTOP
@@ -76,12 +77,17 @@ std::unique_ptr<Message> WindowServerDecoder::handle(const InvalidateMessage& ms
     auto& wm = WindowManager::the();
     auto* window = wm.window(msg.window_id());
     if (!window) {
+        // The client waits for a frame after every invalidate, so it is
+        // answered even when there is nothing to draw.
+        Connection::the().send_async_message(FrameDoneMessage(msg.key(), msg.window_id()));
         return nullptr;
     }
     auto rect = msg.rect();
     rect.offset_by(window->content_bounds().origin());
     rect.intersect(window->content_bounds());
-    Compositor::the().invalidate(rect);
+    auto& compositor = Compositor::the();
+    compositor.invalidate(rect);
+    compositor.add_frame_callback(window->connection_id(), window->id());
     return nullptr;
 }
 
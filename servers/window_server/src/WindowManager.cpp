@@ -105,14 +105,8 @@ bool WindowManager::continue_window_move()
 
 void WindowManager::update_mouse_position(std::unique_ptr<LFoundation::Event> mouse_event)
 {
-    auto invalidate_bounds = m_cursor_manager.current_cursor().bounds();
-    invalidate_bounds.origin().set(m_cursor_manager.draw_position());
-    m_compositor.invalidate(invalidate_bounds);
-
     m_cursor_manager.update_position((WinServer::MouseEvent*)mouse_event.get());
-
-    invalidate_bounds.origin().set(m_cursor_manager.draw_position());
-    m_compositor.invalidate(invalidate_bounds);
+    m_compositor.invalidate_cursor();
 }
 
 #ifdef TARGET_DESKTOP
@@ -40,7 +40,7 @@ int main()
     start_dock();
     auto* event_loop = new LFoundation::EventLoop();
     new WinServer::Screen();
-    new WinServer::Connection(socket(PF_LOCAL, 0, 0));
+    new WinServer::Connection(socket(PF_LOCAL, SOCK_STREAM, 0));
     new WinServer::CursorManager();
     new WinServer::ResourceManager();
     new WinServer::Popup();
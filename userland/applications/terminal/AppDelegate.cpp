@@ -2,6 +2,7 @@
 #include "TerminalViewController.h"
 #include <csignal>
 #include <libui/AppDelegate.h>
+#include <sys/ioctl.h>
 
 static int shell_pid = 0;
 
@@ -12,6 +13,11 @@ int setup_shell()
         std::abort();
     }
 
+    // Take the output of the shell in large pieces, so the view is not redrawn for every small write.
+    ioctl(ptmx, TIOCSPTYBUF, 64 * 1024);
+    ioctl(ptmx, TIOCSPTYMIN, 4096);
+    ioctl(ptmx, TIOCSPTYTIME, 16);
+
     int f = fork();
     if (f == 0) {
         char* pname = ptsname(ptmx);
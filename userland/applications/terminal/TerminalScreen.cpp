@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2020-2021 Nikita Melekhin. All rights reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "TerminalScreen.h"
+#include <cstring>
+#include <libg/Context.h>
+
+void TerminalScreen::resize(size_t cols, size_t rows)
+{
+    m_cols = cols;
+    m_rows = rows;
+    m_data.resize(m_rows * m_cols);
+    memset((uint8_t*)m_data.data(), 0, m_data.size());
+    m_dirty_lines.resize(m_rows);
+    mark_all_dirty();
+    m_pending_scroll = 0;
+    m_needs_full_redraw = true;
+}
+
+void TerminalScreen::mark_cells_dirty(size_t row, size_t min_col, size_t max_col)
+{
+    auto& cells = m_dirty_lines[row];
+    cells.min_col = std::min(cells.min_col, (int)min_col);
+    cells.max_col = std::max(cells.max_col, (int)max_col);
+}
+
+void TerminalScreen::mark_all_dirty()
+{
+    for (int i = 0; i < m_rows; i++) {
+        m_dirty_lines[i] = { 0, (int)m_cols - 1 };
+    }
+}
+
+LG::Rect TerminalScreen::cells_rect(size_t row, int min_col, int max_col) const
+{
+    return LG::Rect(padding() + min_col * glyph_width(), padding() + row * glyph_height(), (max_col - min_col + 1) * glyph_width(), glyph_height());
+}
+
+void TerminalScreen::scroll_line()
+{
+    memmove((uint8_t*)m_data.data(), (uint8_t*)&m_data[m_cols], (m_rows - 1) * m_cols);
+    memset((uint8_t*)&m_data[(m_rows - 1) * m_cols], 0, m_cols);
+    for (int i = 0; i + 1 < m_rows; i++) {
+        m_dirty_lines[i] = m_dirty_lines[i + 1];
+    }
+    m_dirty_lines[m_rows - 1] = { 0, (int)m_cols - 1 };
+    m_pending_scroll++;
+}
+
+// Moves the drawn lines up in the bitmap, the lines which come up from the
+// bottom are already dirty.
+void TerminalScreen::scroll_pixels(LG::PixelBitmap& bitmap, const LG::Rect& frame, size_t lines)
+{
+    if (lines >= m_rows) {
+        return;
+    }
+
+    int top = frame.min_y() + padding();
+    int shift = lines * glyph_height();
+    int height = (m_rows - lines) * glyph_height();
+    if (frame.min_x() == 0 && frame.width() == bitmap.width()) {
+        memmove(bitmap[top], bitmap[top + shift], height * bitmap.width() * sizeof(LG::Color));
+        return;
+    }
+    for (int y = top; y < top + height; y++) {
+        memmove(&bitmap[y][frame.min_x()], &bitmap[y + shift][frame.min_x()], frame.width() * sizeof(LG::Color));
+    }
+}
+
+void TerminalScreen::display(LG::PixelBitmap& bitmap, const LG::Rect& frame, const LG::Rect& rect, size_t cursor_row, size_t cursor_col)
+{
+    LG::Context ctx(bitmap);
+    ctx.add_clip(frame);
+    ctx.set_draw_offset(frame.origin());
+    ctx.add_clip(rect);
+
+    if (m_pending_scroll) {
+        scroll_pixels(bitmap, frame, m_pending_scroll);
+        m_pending_scroll = 0;
+    }
+
+    if (m_needs_full_redraw || bitmap.has_alpha_channel()) {
+        ctx.set_fill_color(background_color());
+        ctx.fill(rect);
+        mark_all_dirty();
+        m_needs_full_redraw = !rect.contains(LG::Rect(0, 0, frame.width(), frame.height()));
+    }
+
+    for (int i = 0; i < m_rows; i++) {
+        auto& cells = m_dirty_lines[i];
+        if (cells.empty()) {
+            continue;
+        }
+
+        auto cells_bounds = cells_rect(i, cells.min_col, cells.max_col);
+        if (!cells_bounds.intersects(rect)) {
+            continue;
+        }
+
+        ctx.set_fill_color(background_color());
+        ctx.fill(cells_bounds);
+        ctx.set_fill_color(font_color());
+        ctx.draw_text(cells_bounds.origin(), font(), &m_data[i * m_cols + cells.min_col], cells.max_col - cells.min_col + 1);
+        if (rect.contains(cells_bounds)) {
+            cells = { (int)m_cols, -1 };
+        }
+    }
+
+    ctx.set_fill_color(cursor_color());
+    ctx.fill(LG::Rect(cursor_col * glyph_width() + padding(), cursor_row * glyph_height() + padding(), cursor_width(), glyph_height()));
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2020-2021 Nikita Melekhin. All rights reserved.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+#include <algorithm>
+#include <libg/Color.h>
+#include <libg/Font.h>
+#include <libg/PixelBitmap.h>
+#include <libg/Rect.h>
+#include <vector>
+
+// Characters of the terminal and the pixels drawn for them. Lines keep their
+// pixels between displays, only dirty cells are drawn again. Scrolled lines
+// are moved in the bitmap, when displayed.
+class TerminalScreen {
+public:
+    explicit TerminalScreen(const LG::Font& font)
+        : m_font(font)
+    {
+    }
+
+    const LG::Color& font_color() const { return m_font_color; }
+    const LG::Color cursor_color() const { return LG::Color(200, 200, 200, 255); }
+    const LG::Color& background_color() const { return m_background_color; }
+    inline const LG::Font& font() const { return m_font; }
+
+    inline int glyph_width() const { return font().glyph_width('.'); }
+    inline int glyph_height() const { return font().glyph_height(); }
+
+    constexpr int padding() const { return 2; }
+    constexpr int spacing() const { return 2; }
+    constexpr int cursor_width() const { return 5; }
+
+    inline size_t cols() const { return m_cols; }
+    inline size_t rows() const { return m_rows; }
+
+    // FIXME: Keep the characters on resize.
+    void resize(size_t cols, size_t rows);
+
+    inline void set_char(size_t row, size_t col, char c)
+    {
+        m_data[row * m_cols + col] = c;
+        mark_cells_dirty(row, col, col);
+    }
+
+    void mark_cells_dirty(size_t row, size_t min_col, size_t max_col);
+    void mark_all_dirty();
+    LG::Rect cells_rect(size_t row, int min_col, int max_col) const;
+
+    // Cells the cursor covers at the cell (row, col).
+    inline size_t cursor_last_col(size_t col) const { return std::min(m_cols - 1, col + (cursor_width() + spacing() - 1) / glyph_width()); }
+
+    // The lines move up by one, the last line comes up empty.
+    void scroll_line();
+
+    // Draws the part @rect of the screen, which lies at @frame in @bitmap.
+    // Bitmaps with alpha are cleared before every display, so everything in
+    // @rect is drawn again for them.
+    void display(LG::PixelBitmap& bitmap, const LG::Rect& frame, const LG::Rect& rect, size_t cursor_row, size_t cursor_col);
+
+private:
+    // Columns of a line, which have changed since the line was drawn.
+    struct DirtyCells {
+        int min_col;
+        int max_col;
+
+        inline bool empty() const { return min_col > max_col; }
+    };
+
+    void scroll_pixels(LG::PixelBitmap& bitmap, const LG::Rect& frame, size_t lines);
+
+    const LG::Font& m_font;
+    LG::Color m_background_color { 0xE9E9EA };
+    LG::Color m_font_color { LG::Color::LightSystemText };
+
+    size_t m_cols { 0 };
+    size_t m_rows { 0 };
+    std::vector<char> m_data {};
+    std::vector<DirtyCells> m_dirty_lines {};
+    size_t m_pending_scroll { 0 };
+    bool m_needs_full_redraw { true };
+};
@@ -1,9 +1,9 @@
 #include "TerminalView.h"
-#include <algorithm>
 #include <libfoundation/EventLoop.h>
 #include <libfoundation/KeyboardMapping.h>
 #include <libg/Color.h>
-#include <libui/Context.h>
+#include <libui/Window.h>
+#include <unistd.h>
 
 TerminalView::TerminalView(UI::View* superview, const LG::Rect& frame, int ptmx)
     : UI::View(superview, frame)
@@ -23,52 +23,20 @@ void TerminalView::recalc_dimensions(const LG::Rect& frame)
 {
     m_max_rows = (frame.height() - padding() - UI::SafeArea::Bottom) / glyph_height();
     m_max_cols = (frame.width() - 2 * padding()) / glyph_width();
-    // FIXME: Add copy and resize on window resize.
-    m_display_data = (char*)malloc(m_max_rows * m_max_cols);
-    memset((uint8_t*)m_display_data, 0, m_max_rows * m_max_cols);
+    m_screen.resize(m_max_cols, m_max_rows);
 }
 
 void TerminalView::display(const LG::Rect& rect)
 {
-    UI::Context ctx(*this);
-    ctx.add_clip(rect);
-
-    ctx.set_fill_color(background_color());
-    ctx.fill(bounds());
-
-    auto& f = font();
-    ctx.set_fill_color(font_color());
-    LG::Point<int> text_start { padding(), padding() };
-
-    for (int i = 0; i < m_max_rows; i++) {
-        for (int j = 0; j < m_max_cols; j++) {
-            int idx = i * m_max_cols + j;
-            ctx.draw(text_start, f.glyph_bitmap(m_display_data[idx]));
-            text_start.offset_by(glyph_width(), 0);
-        }
-        text_start.set_x(padding());
-        text_start.offset_by(0, glyph_height());
-    }
-
-    ctx.set_fill_color(cursor_color());
-    auto cursor_left_corner = pos_on_screen();
-    ctx.fill(LG::Rect(cursor_left_corner.x(), cursor_left_corner.y(), cursor_width(), glyph_height()));
+    m_screen.display(window()->bitmap(), frame_in_window(), rect, m_row, m_col);
 }
 
 void TerminalView::scroll_line()
 {
-    data_do_new_line();
+    m_screen.scroll_line();
     set_needs_display();
 }
 
-void TerminalView::data_do_new_line()
-{
-    char* data_plus_line = m_display_data + (m_max_cols);
-    char* data_end_minus_line = m_display_data + (m_max_rows - 1) * m_max_cols;
-    memmove((uint8_t*)m_display_data, (uint8_t*)data_plus_line, (m_max_rows - 1) * m_max_cols);
-    memset((uint8_t*)data_end_minus_line, 0, m_max_cols);
-}
-
 WindowStatus TerminalView::cursor_positions_do_new_line()
 {
     m_col = 0;
@@ -103,7 +71,7 @@ void TerminalView::new_line()
     will_move_cursor();
     auto status = cursor_positions_do_new_line();
     if (status == DoNewLine) {
-        data_do_new_line();
+        scroll_line();
     }
     did_move_cursor();
 }
@@ -132,7 +100,7 @@ void TerminalView::put_char(char c)
 {
     auto pt = pos_on_screen();
     set_needs_display(LG::Rect(pt.x(), pt.y(), glyph_width(), glyph_height()));
-    m_display_data[pos_in_data()] = c;
+    data_set_char(c);
 }
 
 void TerminalView::push_back_char(char c)
@@ -151,7 +119,7 @@ void TerminalView::put_text(const std::string& data)
     LG::Point<int> top_left_update_location { current_pos.x(), current_pos.y() };
     LG::Point<int> bottom_right_update_location { current_pos.x(), current_pos.y() };
     auto set_to_redraw_full_screen = [&]() {
-        data_do_new_line();
+        scroll_line();
         top_left_update_location = { bounds().min_x(), bounds().min_y() };
         bottom_right_update_location = { bounds().max_x(), bounds().max_y() };
     };
@@ -1,4 +1,5 @@
 #pragma once
+#include "TerminalScreen.h"
 #include <libg/Font.h>
 #include <libui/View.h>
 #include <string>
@@ -15,13 +16,13 @@ public:
     TerminalView(UI::View* superview, const LG::Rect&, int ptmx);
     TerminalView(UI::View* superview, UI::Window* window, const LG::Rect&, int ptmx);
 
-    const LG::Color& font_color() const { return m_font_color; }
-    const LG::Color cursor_color() const { return LG::Color(200, 200, 200, 255); }
-    const LG::Color& background_color() const { return m_background_color; }
+    const LG::Color& font_color() const { return m_screen.font_color(); }
+    const LG::Color cursor_color() const { return m_screen.cursor_color(); }
+    const LG::Color& background_color() const { return m_screen.background_color(); }
     inline const LG::Font& font() const { return *m_font_ptr; }
 
-    inline int glyph_width() const { return font().glyph_width('.'); }
-    inline int glyph_height() const { return font().glyph_height(); }
+    inline int glyph_width() const { return m_screen.glyph_width(); }
+    inline int glyph_height() const { return m_screen.glyph_height(); }
 
     inline LG::Point<int> pos_on_screen() const { return { (int)m_col * glyph_width() + padding(), (int)m_row * glyph_height() + padding() }; }
     inline int pos_in_data() const { return m_max_cols * m_row + m_col; }
@@ -41,11 +42,7 @@ private:
     WindowStatus cursor_positions_do_new_line();
     WindowStatus cursor_position_move_right();
     WindowStatus cursor_position_move_left();
-    void data_do_new_line();
-    inline void data_set_char(char c)
-    {
-        m_display_data[pos_in_data()] = c;
-    }
+    inline void data_set_char(char c) { m_screen.set_char(m_row, m_col, c); }
 
     void scroll_line();
     void new_line();
@@ -56,25 +53,24 @@ private:
     void push_back_char(char c);
     void send_input();
 
-    inline void will_move_cursor()
+    // The cells under the cursor are drawn again, when it leaves them.
+    inline void invalidate_cursor_cells()
     {
-        auto pt = pos_on_screen();
-        set_needs_display(LG::Rect(pt.x(), pt.y(), cursor_width() + spacing(), glyph_height()));
+        if (m_row >= m_max_rows || m_col >= m_max_cols) {
+            return;
+        }
+        size_t last_col = m_screen.cursor_last_col(m_col);
+        m_screen.mark_cells_dirty(m_row, m_col, last_col);
+        set_needs_display(m_screen.cells_rect(m_row, m_col, last_col));
     }
 
-    inline void did_move_cursor()
-    {
-        auto pt = pos_on_screen();
-        set_needs_display(LG::Rect(pt.x(), pt.y(), cursor_width() + spacing(), glyph_height()));
-    }
+    inline void will_move_cursor() { invalidate_cursor_cells(); }
+    inline void did_move_cursor() { invalidate_cursor_cells(); }
 
-    LG::Color m_background_color { 0xE9E9EA };
-    LG::Color m_font_color { LG::Color::LightSystemText };
     LG::Font* m_font_ptr { LG::Font::load_from_file("/res/fonts/LizaRegular8x10.font") };
+    TerminalScreen m_screen { *m_font_ptr };
 
-    constexpr int padding() const { return 2; }
-    constexpr int spacing() const { return 2; }
-    constexpr int cursor_width() const { return 5; }
+    inline int padding() const { return m_screen.padding(); }
 
     int m_ptmx { -1 };
     std::string m_input {};
@@ -83,5 +79,4 @@ private:
     size_t m_max_rows { 0 };
     size_t m_col { 0 };
     size_t m_row { 0 };
-    char* m_display_data { nullptr };
 };
\ No newline at end of file
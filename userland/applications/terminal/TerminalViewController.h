@@ -24,10 +24,11 @@ public:
     {
         LFoundation::EventLoop::the().add(
             view().ptmx(), [this] {
-                char text[256];
-                int cnt = read(view().ptmx(), text, 255);
-                text[cnt] = '\0';
-                view().put_text(std::string(text, cnt));
+                char text[4096];
+                int cnt = read(view().ptmx(), text, sizeof(text));
+                if (cnt > 0) {
+                    view().put_text(std::string(text, cnt));
+                }
             },
             nullptr);
     }
@@ -8,6 +8,8 @@
 #define true (1)
 #define false (0)
 
+#define MAX_PIPELINE_CMDS 8
+
 char* _cmd_app;
 char* _cmd_buffer;
 char** _cmd_parsed_buffer;
@@ -72,6 +74,83 @@ void _cmd_input()
     _cmd_buffer[_cmd_buffer_position] = '\0';
 }
 
+/* Runs the app with @in_fd and @out_fd as its stdin and stdout. @unused_fd is the
+   read end of the next pipe, the app should not keep it open. */
+int _cmd_launch(char** argv, int in_fd, int out_fd, int unused_fd)
+{
+    uint32_t namelen = strlen(argv[0]);
+    memcpy(_cmd_app + 5, argv[0], namelen + 1);
+
+    int res = fork();
+    if (!res) {
+        if (in_fd != 0) {
+            dup2(in_fd, 0);
+            close(in_fd);
+        }
+        if (out_fd != 1) {
+            dup2(out_fd, 1);
+            close(out_fd);
+        }
+        if (unused_fd >= 0) {
+            close(unused_fd);
+        }
+        execve(_cmd_app, argv, 0);
+        exit(-1);
+    }
+    return res;
+}
+
+/* Apps of "a | b | c" are started at once, each one's stdout is a pipe to the next one's stdin. */
+void _cmd_run_pipeline()
+{
+    char** cmds[MAX_PIPELINE_CMDS];
+    int cmds_count = 0;
+    cmds[cmds_count++] = _cmd_parsed_buffer;
+    for (int i = 0; i < _cmd_parsed_buffer_position; i++) {
+        if (memcmp(_cmd_parsed_buffer[i], "|", 2) == 0) {
+            if (cmds_count == MAX_PIPELINE_CMDS) {
+                return;
+            }
+            _cmd_parsed_buffer[i] = 0;
+            cmds[cmds_count++] = &_cmd_parsed_buffer[i + 1];
+        }
+    }
+    for (int i = 0; i < cmds_count; i++) {
+        if (!cmds[i][0]) {
+            return;
+        }
+    }
+
+    int pids[MAX_PIPELINE_CMDS];
+    int in_fd = 0;
+    for (int i = 0; i < cmds_count; i++) {
+        int fds[2] = { -1, 1 };
+        if (i != cmds_count - 1 && pipe(fds) < 0) {
+            cmds_count = i;
+            break;
+        }
+
+        pids[i] = _cmd_launch(cmds[i], in_fd, fds[1], fds[0]);
+        if (in_fd != 0) {
+            close(in_fd);
+        }
+        if (fds[1] != 1) {
+            close(fds[1]);
+        }
+        in_fd = fds[0];
+    }
+    if (in_fd > 0) {
+        close(in_fd);
+    }
+
+    for (int i = 0; i < cmds_count; i++) {
+        if (pids[i] > 0) {
+            running_job = pids[i];
+            wait(pids[i]);
+        }
+    }
+}
+
 void _cmd_processor()
 {
     _cmd_parsed_buffer_position = 0;
@@ -100,17 +179,7 @@ void _cmd_processor()
     /* We try to launch an app */
     uint32_t cmd = _is_cmd_internal();
     if (cmd == CMD_NONE) {
-        uint32_t namelen = strlen(_cmd_parsed_buffer[0]);
-        memcpy(_cmd_app + 5, _cmd_buffer, namelen + 1);
-
-        int res = fork();
-        if (!res) {
-            execve(_cmd_app, _cmd_parsed_buffer, 0);
-            exit(-1);
-        } else {
-            running_job = res;
-            wait(res);
-        }
+        _cmd_run_pipeline();
     } else {
         _cmd_do_internal(cmd);
     }
@@ -13,7 +13,7 @@ public:
     bool application() override
     {
         auto& window = std::oneos::construct<DockWindow>();
-        window.set_bitmap_format(LG::PixelBitmapFormat::RGBA); // Turning on Alpha channel
+        window.set_bitmap_format(LG::PixelBitmapFormat::RGBAPremultiplied); // Turning on Alpha channel
         auto& dock_view = window.create_superview<DockView, DockViewController>();
 
         window.set_title("Dock");
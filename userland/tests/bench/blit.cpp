@@ -0,0 +1,140 @@
+#include "common.h"
+#include <cstdio>
+#include <cstdlib>
+#include <libg/Context.h>
+#include <libg/PixelBitmap.h>
+
+#define BENCH_BLIT_SIZE 256
+#define BENCH_BLIT_ROUNDS 20
+
+static void fill_layers(LG::PixelBitmap& dest, LG::PixelBitmap& src)
+{
+    for (int y = 0; y < BENCH_BLIT_SIZE; y++) {
+        for (int x = 0; x < BENCH_BLIT_SIZE; x++) {
+            dest[y][x] = LG::Color(x, y, x ^ y);
+            // Like an icon or a shadow: transparent and solid parts with soft edges between.
+            uint8_t alpha = (x < 32) ? 0 : (x >= 224) ? 255 : (uint8_t)(x + y);
+            src[y][x] = LG::Color(y, x, 255 - x, alpha);
+        }
+    }
+}
+
+// Context::draw leaves every pixel as Color::mix_with does.
+static bool test_blit(LG::PixelBitmap& dest, const LG::PixelBitmap& src)
+{
+    LG::PixelBitmap reference(BENCH_BLIT_SIZE, BENCH_BLIT_SIZE);
+    for (int y = 0; y < BENCH_BLIT_SIZE; y++) {
+        for (int x = 0; x < BENCH_BLIT_SIZE; x++) {
+            reference[y][x] = dest[y][x];
+            reference[y][x].mix_with(src[y][x]);
+        }
+    }
+
+    LG::Context ctx(dest);
+    ctx.draw({ 0, 0 }, src);
+    for (int y = 0; y < BENCH_BLIT_SIZE; y++) {
+        for (int x = 0; x < BENCH_BLIT_SIZE; x++) {
+            if (dest[y][x].u32() != reference[y][x].u32()) {
+                printf("[BENCH] Blit: wrong pixel at %d %d\n", x, y);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// A premultiplied copy of the layer is drawn within a rounding error of the straight one.
+static bool test_blit_premultiplied(const LG::PixelBitmap& dest, const LG::PixelBitmap& src, const LG::PixelBitmap& premultiplied_src)
+{
+    LG::PixelBitmap straight(BENCH_BLIT_SIZE, BENCH_BLIT_SIZE);
+    LG::PixelBitmap premultiplied(BENCH_BLIT_SIZE, BENCH_BLIT_SIZE);
+    for (int y = 0; y < BENCH_BLIT_SIZE; y++) {
+        for (int x = 0; x < BENCH_BLIT_SIZE; x++) {
+            straight[y][x] = dest[y][x];
+            premultiplied[y][x] = dest[y][x];
+        }
+    }
+
+    LG::Context(straight).draw({ 0, 0 }, src);
+    LG::Context(premultiplied).draw({ 0, 0 }, premultiplied_src);
+    for (int y = 0; y < BENCH_BLIT_SIZE; y++) {
+        for (int x = 0; x < BENCH_BLIT_SIZE; x++) {
+            auto a = straight[y][x];
+            auto b = premultiplied[y][x];
+            if (abs(a.red() - b.red()) > 1 || abs(a.green() - b.green()) > 1 || abs(a.blue() - b.blue()) > 1 || a.alpha() != b.alpha()) {
+                printf("[BENCH] Blit: wrong premultiplied pixel at %d %d\n", x, y);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void bench_blit_per_pixel(LG::PixelBitmap& dest, const LG::PixelBitmap& src)
+{
+    RUN_BENCH("BLIT MIX_WITH PER PIXEL", 3)
+    {
+        for (int round = 0; round < BENCH_BLIT_ROUNDS; round++) {
+            for (int y = 0; y < BENCH_BLIT_SIZE; y++) {
+                for (int x = 0; x < BENCH_BLIT_SIZE; x++) {
+                    dest[y][x].mix_with(src[y][x]);
+                }
+            }
+        }
+    }
+}
+
+static void bench_blit_context(LG::PixelBitmap& dest, const LG::PixelBitmap& src)
+{
+    LG::Context ctx(dest);
+    RUN_BENCH("BLIT CONTEXT DRAW", 3)
+    {
+        for (int round = 0; round < BENCH_BLIT_ROUNDS; round++) {
+            ctx.draw({ 0, 0 }, src);
+        }
+    }
+}
+
+static void bench_blit_context_premultiplied(LG::PixelBitmap& dest, const LG::PixelBitmap& src)
+{
+    LG::Context ctx(dest);
+    RUN_BENCH("BLIT CONTEXT DRAW PREMULTIPLIED", 3)
+    {
+        for (int round = 0; round < BENCH_BLIT_ROUNDS; round++) {
+            ctx.draw({ 0, 0 }, src);
+        }
+    }
+}
+
+static void bench_blit_mix(LG::PixelBitmap& dest)
+{
+    LG::Context ctx(dest);
+    ctx.set_fill_color(LG::Color(0, 0, 0, 100));
+    RUN_BENCH("BLIT CONTEXT MIX", 3)
+    {
+        for (int round = 0; round < BENCH_BLIT_ROUNDS; round++) {
+            ctx.mix(dest.bounds());
+        }
+    }
+}
+
+void bench_blit()
+{
+    LG::PixelBitmap dest(BENCH_BLIT_SIZE, BENCH_BLIT_SIZE);
+    LG::PixelBitmap src(BENCH_BLIT_SIZE, BENCH_BLIT_SIZE, LG::PixelBitmapFormat::RGBA);
+    fill_layers(dest, src);
+    if (!test_blit(dest, src)) {
+        return;
+    }
+
+    LG::PixelBitmap premultiplied_src(src);
+    premultiplied_src.premultiply();
+    if (!test_blit_premultiplied(dest, src, premultiplied_src)) {
+        return;
+    }
+
+    bench_blit_per_pixel(dest, src);
+    bench_blit_context(dest, src);
+    bench_blit_context_premultiplied(dest, premultiplied_src);
+    bench_blit_mix(dest);
+}
@@ -18,4 +18,16 @@ static inline int to_usec()
     return sec * 1000000 + diff;
 }
 
-void bench_pngloader();
\ No newline at end of file
+void bench_pngloader();
+void bench_fs();
+void bench_sockets();
+void bench_uaccess();
+void bench_epoll();
+void bench_idle_apps();
+void bench_pipe();
+void bench_pty();
+void bench_ring();
+void bench_blit();
+void bench_frames();
+void bench_tiles();
+void bench_text();
\ No newline at end of file
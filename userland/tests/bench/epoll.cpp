@@ -0,0 +1,170 @@
+#include "common.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define BENCH_EPOLL_PATH "/tmp/bench_epoll.sock"
+#define BENCH_EPOLL_PAIRS 12
+#define BENCH_EPOLL_ROUNDS 2000
+
+struct SocketPair {
+    int wfd;
+    int rfd;
+};
+
+static SocketPair pairs[BENCH_EPOLL_PAIRS];
+
+static bool open_pairs(int listen_fd)
+{
+    for (int i = 0; i < BENCH_EPOLL_PAIRS; i++) {
+        pairs[i].wfd = socket(PF_LOCAL, SOCK_STREAM, 0);
+        if (pairs[i].wfd < 0 || connect(pairs[i].wfd, BENCH_EPOLL_PATH, sizeof(BENCH_EPOLL_PATH) - 1) < 0) {
+            return false;
+        }
+        pairs[i].rfd = accept(listen_fd);
+        if (pairs[i].rfd < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void close_pairs()
+{
+    for (int i = 0; i < BENCH_EPOLL_PAIRS; i++) {
+        if (pairs[i].wfd >= 0) {
+            close(pairs[i].wfd);
+        }
+        if (pairs[i].rfd >= 0) {
+            close(pairs[i].rfd);
+        }
+    }
+}
+
+static int wait_events(int epfd, uint32_t events, int rfd)
+{
+    epoll_event ev = {};
+    ev.events = events;
+    ev.data.fd = rfd;
+    epoll_ctl(epfd, EPOLL_CTL_MOD, rfd, &ev);
+
+    // The first wait reports the byte, the second one shows whether it's reported again.
+    epoll_event got[BENCH_EPOLL_PAIRS];
+    int first = epoll_wait(epfd, got, BENCH_EPOLL_PAIRS, 0);
+    int second = epoll_wait(epfd, got, BENCH_EPOLL_PAIRS, 0);
+    return first * 10 + second;
+}
+
+// A level-triggered fd is reported while it has data, an edge-triggered one
+// once per write, and a one-shot one once till it's rearmed.
+static bool test_epoll_modes(int epfd)
+{
+    int wfd = pairs[0].wfd;
+    int rfd = pairs[0].rfd;
+    char c = 'e';
+
+    write(wfd, &c, 1);
+    bool level = (wait_events(epfd, EPOLLIN, rfd) == 11);
+    bool edge = (wait_events(epfd, EPOLLIN | EPOLLET, rfd) == 10);
+    write(wfd, &c, 1);
+    epoll_event got;
+    bool edge_again = (epoll_wait(epfd, &got, 1, 0) == 1 && got.data.fd == rfd);
+    bool oneshot = (wait_events(epfd, EPOLLIN | EPOLLONESHOT, rfd) == 10);
+
+    char drain[2];
+    bool drained = (read(rfd, drain, 2) == 2);
+    bool empty = (wait_events(epfd, EPOLLIN, rfd) == 0);
+
+    if (!level || !edge || !edge_again || !oneshot || !drained || !empty) {
+        printf("[BENCH] Epoll: wrong events, level %d edge %d/%d oneshot %d empty %d\n", level, edge, edge_again, oneshot, empty);
+        return false;
+    }
+    return true;
+}
+
+// Only one of the sockets is active, so select pays for all idle ones on every call.
+static bool bench_select_wait()
+{
+    int nfds = 0;
+    for (int i = 0; i < BENCH_EPOLL_PAIRS; i++) {
+        nfds = (pairs[i].rfd >= nfds) ? pairs[i].rfd + 1 : nfds;
+    }
+
+    char c = 's';
+    SocketPair& active = pairs[BENCH_EPOLL_PAIRS - 1];
+    RUN_BENCH("SELECT 1 OF 12", 3)
+    {
+        for (int round = 0; round < BENCH_EPOLL_ROUNDS; round++) {
+            fd_set_t readfds;
+            FD_ZERO(&readfds);
+            for (int i = 0; i < BENCH_EPOLL_PAIRS; i++) {
+                FD_SET(pairs[i].rfd, &readfds);
+            }
+            write(active.wfd, &c, 1);
+            if (select(nfds, &readfds, nullptr, nullptr, nullptr) < 0 || !FD_ISSET(active.rfd, &readfds) || read(active.rfd, &c, 1) != 1) {
+                printf("[BENCH] Epoll: select missed the active socket\n");
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool bench_epoll_wait(int epfd)
+{
+    char c = 'e';
+    SocketPair& active = pairs[BENCH_EPOLL_PAIRS - 1];
+    RUN_BENCH("EPOLL 1 OF 12", 3)
+    {
+        for (int round = 0; round < BENCH_EPOLL_ROUNDS; round++) {
+            epoll_event got;
+            write(active.wfd, &c, 1);
+            if (epoll_wait(epfd, &got, 1, -1) != 1 || got.data.fd != active.rfd || read(active.rfd, &c, 1) != 1) {
+                printf("[BENCH] Epoll: epoll_wait missed the active socket\n");
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void bench_epoll()
+{
+    int listen_fd = socket(PF_LOCAL, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        return;
+    }
+    if (bind(listen_fd, BENCH_EPOLL_PATH, sizeof(BENCH_EPOLL_PATH) - 1) < 0 || listen(listen_fd, BENCH_EPOLL_PAIRS) < 0) {
+        close(listen_fd);
+        return;
+    }
+
+    for (int i = 0; i < BENCH_EPOLL_PAIRS; i++) {
+        pairs[i].wfd = pairs[i].rfd = -1;
+    }
+
+    int epfd = epoll_create(BENCH_EPOLL_PAIRS);
+    if (epfd >= 0 && open_pairs(listen_fd)) {
+        bool added = true;
+        for (int i = 0; i < BENCH_EPOLL_PAIRS; i++) {
+            epoll_event ev = {};
+            ev.events = EPOLLIN;
+            ev.data.fd = pairs[i].rfd;
+            added &= (epoll_ctl(epfd, EPOLL_CTL_ADD, pairs[i].rfd, &ev) == 0);
+        }
+        if (added && test_epoll_modes(epfd) && bench_select_wait()) {
+            bench_epoll_wait(epfd);
+        }
+    }
+
+    close_pairs();
+    if (epfd >= 0) {
+        close(epfd);
+    }
+    close(listen_fd);
+    unlink(BENCH_EPOLL_PATH);
+}
@@ -0,0 +1,140 @@
+#include "common.h"
+#include "scene.h"
+#include <cstdio>
+#include <libfoundation/Memory.h>
+#include <libfoundation/WorkerPool.h>
+#include <libg/PixelBitmap.h>
+#include <libg/Region.h>
+
+#define BENCH_FRAMES_WIDTH 640
+#define BENCH_FRAMES_HEIGHT 480
+#define BENCH_FRAMES_COUNT 60
+
+// Copying the damage back after a flip is how frames were drawn before the
+// buffer age was tracked, it is kept to compare with.
+enum class FlipMode {
+    CopyBack,
+    BufferAge,
+};
+
+// Two page-flipped buffers, as the screen has them.
+struct FrameBuffers {
+    LG::PixelBitmap bitmaps[2] { { BENCH_FRAMES_WIDTH, BENCH_FRAMES_HEIGHT }, { BENCH_FRAMES_WIDTH, BENCH_FRAMES_HEIGHT } };
+    WinServer::BufferDamage damage;
+    int display { 0 };
+
+    LG::PixelBitmap& write_bitmap() { return bitmaps[display ^ 1]; }
+    LG::PixelBitmap& display_bitmap() { return bitmaps[display]; }
+};
+
+// A wallpaper, a window to drag and an animated translucent badge.
+struct FrameScene {
+    Scene scene { BENCH_FRAMES_WIDTH, BENCH_FRAMES_HEIGHT };
+    SceneWindow& badge { scene.add_badge(480, 320) };
+    SceneWindow& window { scene.add_window(40, 40) };
+};
+
+static LFoundation::WorkerPool& frames_pool()
+{
+    // Workers live as long as the process, so the pool is never freed.
+    static LFoundation::WorkerPool pool(0);
+    return pool;
+}
+
+static void present(FrameScene& frame_scene, FrameBuffers& buffers, const LG::Region& damage, FlipMode mode)
+{
+    if (mode == FlipMode::CopyBack) {
+        frame_scene.scene.compose(buffers.write_bitmap(), damage, frames_pool());
+        buffers.display ^= 1;
+        for (int i = 0; i < damage.rects().size(); i++) {
+            auto& rect = damage.rects()[i];
+            for (int y = rect.min_y(); y <= rect.max_y(); y++) {
+                LFoundation::fast_copy((uint32_t*)&buffers.write_bitmap()[y][rect.min_x()], (uint32_t*)&buffers.display_bitmap()[y][rect.min_x()], rect.width());
+            }
+        }
+        return;
+    }
+
+    // The same steps as Compositor::refresh() takes.
+    auto region = buffers.damage.take(buffers.display ^ 1, damage);
+    frame_scene.scene.compose(buffers.write_bitmap(), region, frames_pool());
+    buffers.damage.miss(buffers.display, damage);
+    buffers.display ^= 1;
+}
+
+static void reset_buffers(FrameScene& frame_scene, FrameBuffers& buffers)
+{
+    frame_scene.window.rect.set_origin({ 40, 40 });
+    for (int i = 0; i < 2; i++) {
+        frame_scene.scene.compose(buffers.bitmaps[i], frame_scene.scene.bounds(), frames_pool());
+    }
+    buffers.damage.clear();
+}
+
+// Every frame the window moves and both its old and new places are damaged.
+static void drag_frame(FrameScene& frame_scene, FrameBuffers& buffers, int frame, FlipMode mode)
+{
+    auto& window = frame_scene.window.rect;
+    LG::Region damage(window);
+    int dx = (frame % 60 < 15 || frame % 60 >= 45) ? 6 : -6;
+    window.offset_by(dx, 4 - (frame % 3) * 4);
+    damage.unite(window);
+    present(frame_scene, buffers, damage, mode);
+}
+
+// Every frame the badge changes, but stays at its place.
+static void animation_frame(FrameScene& frame_scene, FrameBuffers& buffers, int frame, FlipMode mode)
+{
+    frame_scene.scene.paint_badge(frame);
+    present(frame_scene, buffers, LG::Region(frame_scene.badge.rect), mode);
+}
+
+// After a drag the displayed buffer is the same as the scene drawn from scratch.
+static bool test_frames(FrameScene& frame_scene, FrameBuffers& buffers, FlipMode mode)
+{
+    reset_buffers(frame_scene, buffers);
+    for (int frame = 0; frame < 8; frame++) {
+        drag_frame(frame_scene, buffers, frame, mode);
+        animation_frame(frame_scene, buffers, frame, mode);
+    }
+
+    LG::PixelBitmap reference(BENCH_FRAMES_WIDTH, BENCH_FRAMES_HEIGHT);
+    frame_scene.scene.draw_reference(reference);
+    return same_bitmaps(buffers.display_bitmap(), reference, "Frames");
+}
+
+static void bench_drag(FrameScene& frame_scene, FrameBuffers& buffers, FlipMode mode, const char* name)
+{
+    reset_buffers(frame_scene, buffers);
+    RUN_BENCH(name, 3)
+    {
+        for (int frame = 0; frame < BENCH_FRAMES_COUNT; frame++) {
+            drag_frame(frame_scene, buffers, frame, mode);
+        }
+    }
+}
+
+static void bench_animation(FrameScene& frame_scene, FrameBuffers& buffers, FlipMode mode, const char* name)
+{
+    reset_buffers(frame_scene, buffers);
+    RUN_BENCH(name, 3)
+    {
+        for (int frame = 0; frame < BENCH_FRAMES_COUNT; frame++) {
+            animation_frame(frame_scene, buffers, frame, mode);
+        }
+    }
+}
+
+void bench_frames()
+{
+    FrameScene frame_scene;
+    FrameBuffers buffers;
+    if (!test_frames(frame_scene, buffers, FlipMode::CopyBack) || !test_frames(frame_scene, buffers, FlipMode::BufferAge)) {
+        return;
+    }
+
+    bench_drag(frame_scene, buffers, FlipMode::CopyBack, "60 DRAG FRAMES COPY BACK");
+    bench_drag(frame_scene, buffers, FlipMode::BufferAge, "60 DRAG FRAMES BUFFER AGE");
+    bench_animation(frame_scene, buffers, FlipMode::CopyBack, "60 ANIMATION FRAMES COPY BACK");
+    bench_animation(frame_scene, buffers, FlipMode::BufferAge, "60 ANIMATION FRAMES BUFFER AGE");
+}
@@ -0,0 +1,56 @@
+#include "common.h"
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define BENCH_FS_DIR "/bench_fs"
+#define BENCH_FS_FILES 10000
+
+static char path[64];
+
+static inline void bench_fs_path(int i)
+{
+    snprintf(path, sizeof(path), BENCH_FS_DIR "/file_%d", i);
+}
+
+static void bench_fs_cleanup()
+{
+    for (int i = 0; i < BENCH_FS_FILES; i++) {
+        bench_fs_path(i);
+        unlink(path);
+    }
+    rmdir(BENCH_FS_DIR);
+}
+
+void bench_fs()
+{
+    mkdir(BENCH_FS_DIR);
+
+    RUN_BENCH("FS CREATE 10K", 1)
+    {
+        for (int i = 0; i < BENCH_FS_FILES; i++) {
+            bench_fs_path(i);
+            int fd = open(path, O_CREAT | O_RDWR);
+            if (fd < 0) {
+                printf("Bench: can't create %s\n", path);
+                bench_fs_cleanup();
+                return;
+            }
+            close(fd);
+        }
+    }
+
+    RUN_BENCH("FS LOOKUP 10K", 3)
+    {
+        for (int i = 0; i < BENCH_FS_FILES; i++) {
+            bench_fs_path(i);
+            int fd = open(path, O_RDONLY);
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    bench_fs_cleanup();
+}
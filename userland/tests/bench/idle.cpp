@@ -0,0 +1,117 @@
+#include "common.h"
+#include <cstdio>
+#include <cstdlib>
+#include <libfoundation/EventLoop.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define BENCH_IDLE_PATH "/tmp/bench_idle.sock"
+#define BENCH_IDLE_APPS 8
+#define BENCH_IDLE_WORK 5000000
+
+struct IdleApp {
+    int pid;
+    int wfd;
+    int rfd;
+};
+
+static IdleApp apps[BENCH_IDLE_APPS];
+
+// Looks like an idle GUI app: a connection, which nothing comes through, and
+// a repeating timer. The app exits, when a byte comes.
+static void idle_app_process(int fd)
+{
+    LFoundation::EventLoop loop;
+    loop.add(
+        fd, [&loop] {
+            loop.stop(0);
+        },
+        nullptr);
+    loop.add(LFoundation::Timer([] {}, 1000, LFoundation::Timer::Repeat));
+    exit(loop.run());
+}
+
+static bool start_idle_apps(int listen_fd)
+{
+    for (int i = 0; i < BENCH_IDLE_APPS; i++) {
+        apps[i].wfd = socket(PF_LOCAL, SOCK_STREAM, 0);
+        if (apps[i].wfd < 0 || connect(apps[i].wfd, BENCH_IDLE_PATH, sizeof(BENCH_IDLE_PATH) - 1) < 0) {
+            return false;
+        }
+        apps[i].rfd = accept(listen_fd);
+        if (apps[i].rfd < 0) {
+            return false;
+        }
+
+        apps[i].pid = fork();
+        if (apps[i].pid < 0) {
+            return false;
+        }
+        if (apps[i].pid == 0) {
+            idle_app_process(apps[i].rfd);
+        }
+    }
+    return true;
+}
+
+static void stop_idle_apps()
+{
+    char c = 'q';
+    for (int i = 0; i < BENCH_IDLE_APPS; i++) {
+        if (apps[i].pid > 0) {
+            write(apps[i].wfd, &c, 1);
+            wait(apps[i].pid);
+        }
+        if (apps[i].wfd >= 0) {
+            close(apps[i].wfd);
+        }
+        if (apps[i].rfd >= 0) {
+            close(apps[i].rfd);
+        }
+    }
+}
+
+// The same work takes longer, when idle apps take CPU time from it.
+static int run_busy_work(const char* name)
+{
+    int best = 0;
+    RUN_BENCH(name, 3)
+    {
+        for (volatile int i = 0; i < BENCH_IDLE_WORK; i++) { }
+        gettimeofday(&ttv, &tz);
+        int usec = to_usec();
+        if (!best || usec < best) {
+            best = usec;
+        }
+    }
+    return best;
+}
+
+void bench_idle_apps()
+{
+    for (int i = 0; i < BENCH_IDLE_APPS; i++) {
+        apps[i].pid = apps[i].wfd = apps[i].rfd = -1;
+    }
+
+    int listen_fd = socket(PF_LOCAL, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        return;
+    }
+    if (bind(listen_fd, BENCH_IDLE_PATH, sizeof(BENCH_IDLE_PATH) - 1) < 0 || listen(listen_fd, BENCH_IDLE_APPS) < 0) {
+        close(listen_fd);
+        return;
+    }
+
+    int alone = run_busy_work("BUSY WORK ALONE");
+    if (start_idle_apps(listen_fd)) {
+        int shared = run_busy_work("BUSY WORK WITH 8 IDLE APPS");
+        if (shared > 0) {
+            int permille = (int)((long long)alone * 1000 / shared);
+            printf("[BENCH] Idle apps: %d apps leave %d.%d%% of CPU\n", BENCH_IDLE_APPS, permille / 10, permille % 10);
+        }
+    }
+
+    stop_idle_apps();
+    close(listen_fd);
+    unlink(BENCH_IDLE_PATH);
+}
@@ -32,6 +32,18 @@ int main(int argc, char** argv)
 {
     bench_kernel();
     bench_pngloader();
+    bench_fs();
+    bench_sockets();
+    bench_uaccess();
+    bench_epoll();
+    bench_idle_apps();
+    bench_pipe();
+    bench_pty();
+    bench_ring();
+    bench_blit();
+    bench_frames();
+    bench_tiles();
+    bench_text();
     printf("[BENCH END]\n\n");
     fflush(stdout);
     return 0;
@@ -0,0 +1,97 @@
+#include "common.h"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define BENCH_PIPE_FILE "/bench_pipe"
+#define BENCH_PIPE_CHUNK 4096
+#define BENCH_PIPE_FILE_CHUNKS 16
+#define BENCH_PIPE_ROUNDS 2000
+
+static char chunk[BENCH_PIPE_CHUNK];
+static char sink[BENCH_PIPE_CHUNK];
+
+static bool create_file()
+{
+    int fd = open(BENCH_PIPE_FILE, O_CREAT | O_RDWR);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = true;
+    for (int i = 0; i < BENCH_PIPE_FILE_CHUNKS && ok; i++) {
+        memset(chunk, 'a' + i, BENCH_PIPE_CHUNK);
+        ok = (write(fd, chunk, BENCH_PIPE_CHUNK) == BENCH_PIPE_CHUNK);
+    }
+    close(fd);
+    return ok;
+}
+
+// The whole file goes through the pipe in one splice, and is read back as it was written.
+static bool test_splice(int file_fd, int rfd, int wfd)
+{
+    off_t off = 0;
+    int size = BENCH_PIPE_CHUNK * BENCH_PIPE_FILE_CHUNKS;
+    if (splice(file_fd, &off, wfd, nullptr, size, 0) != size || off != size) {
+        printf("[BENCH] Pipe: splice moved a part of the file\n");
+        return false;
+    }
+    for (int i = 0; i < BENCH_PIPE_FILE_CHUNKS; i++) {
+        memset(chunk, 'a' + i, BENCH_PIPE_CHUNK);
+        if (read(rfd, sink, BENCH_PIPE_CHUNK) != BENCH_PIPE_CHUNK || memcmp(chunk, sink, BENCH_PIPE_CHUNK)) {
+            printf("[BENCH] Pipe: wrong data came out of the pipe\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+// The usual way: the data comes to the user buffer and goes back to the kernel.
+static void bench_read_write(int file_fd, int rfd, int wfd)
+{
+    RUN_BENCH("FILE TO PIPE READ+WRITE", 3)
+    {
+        for (int round = 0; round < BENCH_PIPE_ROUNDS; round++) {
+            off_t off = (round % BENCH_PIPE_FILE_CHUNKS) * BENCH_PIPE_CHUNK;
+            pread(file_fd, chunk, BENCH_PIPE_CHUNK, off);
+            write(wfd, chunk, BENCH_PIPE_CHUNK);
+            read(rfd, sink, BENCH_PIPE_CHUNK);
+        }
+    }
+}
+
+static void bench_splice(int file_fd, int rfd, int wfd)
+{
+    RUN_BENCH("FILE TO PIPE SPLICE", 3)
+    {
+        for (int round = 0; round < BENCH_PIPE_ROUNDS; round++) {
+            off_t off = (round % BENCH_PIPE_FILE_CHUNKS) * BENCH_PIPE_CHUNK;
+            splice(file_fd, &off, wfd, nullptr, BENCH_PIPE_CHUNK, 0);
+            read(rfd, sink, BENCH_PIPE_CHUNK);
+        }
+    }
+}
+
+void bench_pipe()
+{
+    if (!create_file()) {
+        unlink(BENCH_PIPE_FILE);
+        return;
+    }
+
+    int file_fd = open(BENCH_PIPE_FILE, O_RDONLY);
+    int fds[2];
+    if (file_fd >= 0 && pipe(fds) == 0) {
+        if (test_splice(file_fd, fds[0], fds[1])) {
+            bench_read_write(file_fd, fds[0], fds[1]);
+            bench_splice(file_fd, fds[0], fds[1]);
+        }
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    if (file_fd >= 0) {
+        close(file_fd);
+    }
+    unlink(BENCH_PIPE_FILE);
+}
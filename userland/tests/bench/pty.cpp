@@ -0,0 +1,111 @@
+#include "common.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#define BENCH_PTY_LINE 128
+#define BENCH_PTY_READ 4096
+#define BENCH_PTY_BYTES (4 * 1024 * 1024)
+
+static char line[BENCH_PTY_LINE];
+static char sink[BENCH_PTY_READ];
+
+// Writes like a program printing a long output, one line per call.
+static void pty_writer_process(const char* pts_name, int bytes)
+{
+    int fd = open(pts_name, O_WRONLY);
+    if (fd < 0) {
+        exit(1);
+    }
+    for (int done = 0; done < bytes; done += BENCH_PTY_LINE) {
+        for (int i = 0; i < BENCH_PTY_LINE; i++) {
+            line[i] = (char)((done + i) % 251);
+        }
+        write(fd, line, BENCH_PTY_LINE);
+    }
+    close(fd);
+    exit(0);
+}
+
+static int start_writer(const char* pts_name, int bytes)
+{
+    int pid = fork();
+    if (pid == 0) {
+        pty_writer_process(pts_name, bytes);
+    }
+    return pid;
+}
+
+// Reads @bytes from the master. Returns the number of reads, or -1 if the data is wrong.
+static int drain(int ptmx, int bytes, bool check)
+{
+    int reads = 0;
+    int got = 0;
+    while (got < bytes) {
+        int cnt = read(ptmx, sink, BENCH_PTY_READ);
+        if (cnt <= 0) {
+            return -1;
+        }
+        if (check) {
+            for (int i = 0; i < cnt; i++) {
+                if (sink[i] != (char)((got + i) % 251)) {
+                    return -1;
+                }
+            }
+        }
+        got += cnt;
+        reads++;
+    }
+    return reads;
+}
+
+// Nothing is lost, when the writer is faster than the reader.
+static bool test_pty(int ptmx, const char* pts_name)
+{
+    int bytes = 64 * 1024;
+    int pid = start_writer(pts_name, bytes);
+    if (pid < 0) {
+        return false;
+    }
+    bool ok = drain(ptmx, bytes, true) >= 0;
+    wait(pid);
+    if (!ok) {
+        printf("[BENCH] Pty: data was lost or damaged\n");
+    }
+    return ok;
+}
+
+static void bench_pty_output(int ptmx, const char* pts_name, const char* name)
+{
+    int reads = 0;
+    RUN_BENCH(name, 3)
+    {
+        int pid = start_writer(pts_name, BENCH_PTY_BYTES);
+        if (pid < 0) {
+            return;
+        }
+        reads = drain(ptmx, BENCH_PTY_BYTES, false);
+        wait(pid);
+    }
+    printf("[BENCH] Pty: %s takes %d reads\n", name, reads);
+}
+
+void bench_pty()
+{
+    int ptmx = posix_openpt(O_RDWR);
+    if (ptmx < 0) {
+        return;
+    }
+    char* pts_name = ptsname(ptmx);
+    if (pts_name && test_pty(ptmx, pts_name)) {
+        bench_pty_output(ptmx, pts_name, "PTY 4MB OUTPUT");
+        ioctl(ptmx, TIOCSPTYBUF, 64 * 1024);
+        ioctl(ptmx, TIOCSPTYMIN, BENCH_PTY_READ);
+        ioctl(ptmx, TIOCSPTYTIME, 16);
+        bench_pty_output(ptmx, pts_name, "PTY 4MB OUTPUT COALESCED");
+    }
+    close(ptmx);
+}
@@ -0,0 +1,118 @@
+#include "common.h"
+#include <cstdio>
+#include <cstring>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/ring.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define BENCH_RING_FILE "/bench_ring"
+#define BENCH_RING_ENTRIES 64
+#define BENCH_RING_ROUNDS 200
+
+static fstat_t stats[BENCH_RING_ENTRIES];
+
+// Calls of one batch come back in order, with the same results the syscalls give.
+static bool test_ring(ring_t* ring, int fd)
+{
+    char data[] = "ring";
+    char back[sizeof(data)] = {};
+
+    ring_sqe_t* sqe = ring_get_sqe(ring);
+    memset(sqe, 0, sizeof(ring_sqe_t));
+    sqe->op = RING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = data;
+    sqe->len = sizeof(data);
+    sqe->offset = 0;
+    sqe->user_data = 1;
+
+    sqe = ring_get_sqe(ring);
+    memset(sqe, 0, sizeof(ring_sqe_t));
+    sqe->op = RING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = back;
+    sqe->len = sizeof(back);
+    sqe->offset = 0;
+    sqe->user_data = 2;
+
+    sqe = ring_get_sqe(ring);
+    memset(sqe, 0, sizeof(ring_sqe_t));
+    sqe->op = RING_OP_CLOSE;
+    sqe->fd = -1;
+    sqe->user_data = 3;
+
+    if (ring_submit(ring) != 3) {
+        printf("[BENCH] Ring: not all calls were taken\n");
+        return false;
+    }
+
+    int expected[] = { (int)sizeof(data), (int)sizeof(back), -EBADF };
+    for (int i = 0; i < 3; i++) {
+        ring_cqe_t* cqe = ring_peek_cqe(ring);
+        if (!cqe || cqe->user_data != (uint32_t)(i + 1) || cqe->res != expected[i]) {
+            printf("[BENCH] Ring: wrong completion %d\n", i + 1);
+            return false;
+        }
+        ring_cqe_seen(ring);
+    }
+
+    if (memcmp(data, back, sizeof(data))) {
+        printf("[BENCH] Ring: read back wrong data\n");
+        return false;
+    }
+    return true;
+}
+
+static void bench_fstat_syscalls(int fd)
+{
+    RUN_BENCH("FSTAT 64 SYSCALLS", 3)
+    {
+        for (int round = 0; round < BENCH_RING_ROUNDS; round++) {
+            for (int i = 0; i < BENCH_RING_ENTRIES; i++) {
+                fstat(fd, &stats[i]);
+            }
+        }
+    }
+}
+
+static void bench_fstat_ring(ring_t* ring, int fd)
+{
+    RUN_BENCH("FSTAT 64 IN RING", 3)
+    {
+        for (int round = 0; round < BENCH_RING_ROUNDS; round++) {
+            for (int i = 0; i < BENCH_RING_ENTRIES; i++) {
+                ring_sqe_t* sqe = ring_get_sqe(ring);
+                sqe->op = RING_OP_FSTAT;
+                sqe->fd = fd;
+                sqe->addr = &stats[i];
+                sqe->user_data = i;
+            }
+            ring_submit(ring);
+            while (ring_peek_cqe(ring)) {
+                ring_cqe_seen(ring);
+            }
+        }
+    }
+}
+
+void bench_ring()
+{
+    int fd = open(BENCH_RING_FILE, O_CREAT | O_RDWR);
+    if (fd < 0) {
+        return;
+    }
+
+    ring_t ring;
+    if (ring_init(&ring, BENCH_RING_ENTRIES) == 0) {
+        if (test_ring(&ring, fd)) {
+            bench_fstat_syscalls(fd);
+            bench_fstat_ring(&ring, fd);
+        }
+        ring_free(&ring);
+    }
+
+    close(fd);
+    unlink(BENCH_RING_FILE);
+}
@@ -0,0 +1,95 @@
+#include "scene.h"
+#include <cstdio>
+#include <libg/Context.h>
+
+Scene::Scene(int width, int height)
+    : m_wallpaper(width, height)
+{
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            m_wallpaper[y][x] = LG::Color(x / 4, y / 3, (x + y) / 7);
+        }
+    }
+    for (int y = 0; y < m_window.height(); y++) {
+        for (int x = 0; x < m_window.width(); x++) {
+            m_window[y][x] = LG::Color(230, 230, 230 - (y % 16));
+        }
+    }
+    paint_badge(0);
+}
+
+Scene::~Scene()
+{
+    for (auto* window : m_windows) {
+        delete window;
+    }
+}
+
+SceneWindow& Scene::add_window(int x, int y)
+{
+    m_windows.push_back(new SceneWindow { &m_window, LG::Rect(x, y, m_window.width(), m_window.height()), true });
+    return *m_windows.back();
+}
+
+SceneWindow& Scene::add_badge(int x, int y)
+{
+    m_windows.push_back(new SceneWindow { &m_badge, LG::Rect(x, y, m_badge.width(), m_badge.height()), false });
+    return *m_windows.back();
+}
+
+// All badges share the bitmap, so a step repaints every one of them.
+void Scene::paint_badge(int step)
+{
+    uint8_t alpha = 64 + (step * 8) % 192;
+    for (int y = 0; y < m_badge.height(); y++) {
+        for (int x = 0; x < m_badge.width(); x++) {
+            m_badge[y][x] = LG::Color(255, x * 2, y * 2, alpha).premultiplied();
+        }
+    }
+}
+
+void Scene::compose_tile(LG::PixelBitmap& bitmap, const WinServer::Tile& tile) const
+{
+    LG::Context ctx(bitmap);
+    auto draw_wallpaper = [&](const LG::Rect& area) {
+        ctx.add_clip(area);
+        ctx.draw({ 0, 0 }, m_wallpaper);
+        ctx.reset_clip();
+    };
+    auto draw_window = [&](const SceneWindow& window, const LG::Rect& area, const LG::Region&) {
+        ctx.add_clip(area);
+        ctx.draw(window.rect.origin(), *window.bitmap);
+        ctx.reset_clip();
+    };
+    WinServer::compose_windows(tile.damage, m_windows, draw_wallpaper, draw_window);
+}
+
+void Scene::compose(LG::PixelBitmap& bitmap, const LG::Region& damage, LFoundation::WorkerPool& pool)
+{
+    m_tiles.split(damage.intersection(bounds()));
+    m_tiles.draw(pool, [&](WinServer::Tile& tile) {
+        compose_tile(bitmap, tile);
+    });
+}
+
+void Scene::draw_reference(LG::PixelBitmap& bitmap) const
+{
+    LG::Context ctx(bitmap);
+    ctx.draw({ 0, 0 }, m_wallpaper);
+    for (int i = (int)m_windows.size() - 1; i >= 0; i--) {
+        ctx.draw(m_windows[i]->rect.origin(), *m_windows[i]->bitmap);
+    }
+}
+
+bool same_bitmaps(const LG::PixelBitmap& a, const LG::PixelBitmap& b, const char* name)
+{
+    for (int y = 0; y < a.height(); y++) {
+        for (int x = 0; x < a.width(); x++) {
+            if (a[y][x].u32() != b[y][x].u32()) {
+                printf("[BENCH] %s: wrong pixel at %d %d\n", name, x, y);
+                return false;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "../../../servers/window_server/src/Composition.h"
+#include <libfoundation/WorkerPool.h>
+#include <libg/PixelBitmap.h>
+#include <libg/Region.h>
+#include <vector>
+
+#define BENCH_SCENE_TILE_SIZE 128
+
+// A window of the scene, the compositor's code takes it as one of its own.
+struct SceneWindow {
+    const LG::PixelBitmap* bitmap;
+    LG::Rect rect;
+    bool opaque;
+
+    inline bool visible() const { return true; }
+    inline const LG::Rect& bounds() const { return rect; }
+    inline LG::Region opaque_region() const { return opaque ? LG::Region(rect) : LG::Region(); }
+};
+
+// A desktop drawn by the compositor's tiles: a wallpaper, opaque windows and
+// translucent badges over them. Windows are added top-down.
+class Scene {
+public:
+    Scene(int width, int height);
+    ~Scene();
+
+    inline LG::Rect bounds() const { return m_wallpaper.bounds(); }
+
+    SceneWindow& add_window(int x, int y);
+    SceneWindow& add_badge(int x, int y);
+    void paint_badge(int step);
+
+    // Draws the damage in tiles, the way the compositor does.
+    void compose(LG::PixelBitmap& bitmap, const LG::Region& damage, LFoundation::WorkerPool& pool);
+    // Draws all windows bottom-up over the whole bitmap with no tiles and no
+    // occlusion, what the compositor has to come out with.
+    void draw_reference(LG::PixelBitmap& bitmap) const;
+
+private:
+    void compose_tile(LG::PixelBitmap& bitmap, const WinServer::Tile& tile) const;
+
+    LG::PixelBitmap m_wallpaper;
+    LG::PixelBitmap m_window { 320, 240 };
+    LG::PixelBitmap m_badge { 96, 96, LG::PixelBitmapFormat::RGBAPremultiplied };
+    std::vector<SceneWindow*> m_windows;
+    WinServer::TileGrid m_tiles { BENCH_SCENE_TILE_SIZE };
+};
+
+bool same_bitmaps(const LG::PixelBitmap& a, const LG::PixelBitmap& b, const char* name);
\ No newline at end of file
@@ -0,0 +1,183 @@
+#include "common.h"
+#include <cstdio>
+#include <cstdlib>
+#include <errno.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define BENCH_SOCKET_PATH "/tmp/bench.sock"
+#define BENCH_SOCKET_TRANSFER (4 * 1024 * 1024)
+#define BENCH_SOCKET_CHUNK 4096
+
+static char buf[BENCH_SOCKET_CHUNK];
+
+// Every byte of the stream depends on its offset, so a lost, duplicated
+// or reordered byte is caught by the reader.
+static inline char stream_byte(size_t offset)
+{
+    return (char)(offset % 251);
+}
+
+static void fill_chunk(size_t offset, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = stream_byte(offset + i);
+    }
+}
+
+static bool check_chunk(size_t offset, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (buf[i] != stream_byte(offset + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int connect_to_bench_socket(int type)
+{
+    int fd = socket(PF_LOCAL, type, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    for (int i = 0; i < 10; i++) {
+        if (connect(fd, BENCH_SOCKET_PATH, sizeof(BENCH_SOCKET_PATH) - 1) == 0) {
+            return fd;
+        }
+        sched_yield();
+    }
+    close(fd);
+    return -1;
+}
+
+static void writer_process()
+{
+    int fd = connect_to_bench_socket(SOCK_STREAM);
+    if (fd < 0) {
+        exit(1);
+    }
+
+    for (size_t offset = 0; offset < BENCH_SOCKET_TRANSFER; offset += BENCH_SOCKET_CHUNK) {
+        fill_chunk(offset, BENCH_SOCKET_CHUNK);
+        if (write(fd, buf, BENCH_SOCKET_CHUNK) != BENCH_SOCKET_CHUNK) {
+            exit(1);
+        }
+    }
+    close(fd);
+    exit(0);
+}
+
+// The writer produces faster than the reader checks the data, so it's throttled
+// by the connection's buffer. All data should come in order, followed by EOF.
+static bool bench_socket_throughput(int listen_fd)
+{
+    int pid = fork();
+    if (pid < 0) {
+        return false;
+    }
+    if (pid == 0) {
+        writer_process();
+    }
+
+    int fd = accept(listen_fd);
+    if (fd < 0) {
+        wait(pid);
+        return false;
+    }
+
+    size_t received = 0;
+    bool valid = true;
+    int read_cnt;
+    while ((read_cnt = read(fd, buf, sizeof(buf))) > 0) {
+        valid &= check_chunk(received, read_cnt);
+        received += read_cnt;
+    }
+    close(fd);
+    wait(pid);
+
+    if (!valid || received != BENCH_SOCKET_TRANSFER) {
+        printf("[BENCH] Local socket: lost data, got %d of %d bytes\n", (int)received, BENCH_SOCKET_TRANSFER);
+        return false;
+    }
+    return true;
+}
+
+// A non-blocking writer gets EAGAIN once the reader's buffer is full, and
+// nothing it was told to be written may be lost.
+static bool test_socket_backpressure(int listen_fd)
+{
+    int wfd = connect_to_bench_socket(SOCK_STREAM | SOCK_NONBLOCK);
+    if (wfd < 0) {
+        return false;
+    }
+    int rfd = accept(listen_fd);
+    if (rfd < 0) {
+        close(wfd);
+        return false;
+    }
+
+    size_t written = 0;
+    int res;
+    for (;;) {
+        fill_chunk(written, BENCH_SOCKET_CHUNK);
+        res = write(wfd, buf, BENCH_SOCKET_CHUNK);
+        if (res <= 0) {
+            break;
+        }
+        written += res;
+    }
+    bool blocked = (res == -EAGAIN);
+
+    size_t received = 0;
+    bool valid = true;
+    while (received < written) {
+        int read_cnt = read(rfd, buf, sizeof(buf));
+        if (read_cnt <= 0) {
+            break;
+        }
+        valid &= check_chunk(received, read_cnt);
+        received += read_cnt;
+    }
+
+    // After draining the writer could go on.
+    fill_chunk(written, 1);
+    bool resumed = (write(wfd, buf, 1) == 1);
+
+    close(wfd);
+    close(rfd);
+
+    if (!blocked || !valid || received != written || !resumed) {
+        printf("[BENCH] Local socket: backpressure failed, wrote %d, read %d\n", (int)written, (int)received);
+        return false;
+    }
+    return true;
+}
+
+void bench_sockets()
+{
+    int listen_fd = socket(PF_LOCAL, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        return;
+    }
+    if (bind(listen_fd, BENCH_SOCKET_PATH, sizeof(BENCH_SOCKET_PATH) - 1) < 0 || listen(listen_fd, 1) < 0) {
+        close(listen_fd);
+        return;
+    }
+
+    if (!test_socket_backpressure(listen_fd)) {
+        close(listen_fd);
+        return;
+    }
+
+    RUN_BENCH("LOCAL SOCKET 4MB", 3)
+    {
+        if (!bench_socket_throughput(listen_fd)) {
+            break;
+        }
+    }
+
+    close(listen_fd);
+    unlink(BENCH_SOCKET_PATH);
+}
@@ -0,0 +1,280 @@
+#include "../../applications/terminal/TerminalScreen.h"
+#include "common.h"
+#include <cstdio>
+#include <libg/Context.h>
+#include <libg/Font.h>
+#include <libg/PixelBitmap.h>
+#include <libg/Region.h>
+
+#define BENCH_TEXT_COLS 80
+#define BENCH_TEXT_ROWS 25
+#define BENCH_TEXT_FRAMES 10
+#define BENCH_TEXT_SCROLLED_LINES 100
+
+static const char* s_line = "drwxr-xr-x  2 root root  4096 Jan  1 00:00 bench text glyph atlas run";
+static const int s_line_length = 69;
+
+static void fill_line(char* line, int number, int length)
+{
+    for (int col = 0; col < BENCH_TEXT_COLS; col++) {
+        line[col] = (col < length) ? s_line[(number + col) % s_line_length] : ' ';
+    }
+}
+
+// A terminal screen: the upper half is filled with text, the lower one is
+// mostly blank, as after a few commands.
+static void fill_screen(char* screen)
+{
+    for (int row = 0; row < BENCH_TEXT_ROWS; row++) {
+        int length = (row < BENCH_TEXT_ROWS / 2) ? BENCH_TEXT_COLS : (row * 7) % 12;
+        fill_line(&screen[row * BENCH_TEXT_COLS], row, length);
+    }
+}
+
+static void fill_background(LG::PixelBitmap& bitmap)
+{
+    LG::Context ctx(bitmap);
+    ctx.set_fill_color(LG::Color(0xE9E9EA));
+    ctx.fill(bitmap.bounds());
+}
+
+static void draw_by_glyph(LG::PixelBitmap& bitmap, const LG::Font& font, const char* screen)
+{
+    LG::Context ctx(bitmap);
+    ctx.set_fill_color(LG::Color(20, 20, 20));
+    for (int row = 0; row < BENCH_TEXT_ROWS; row++) {
+        LG::Point<int> pt { 0, row * (int)font.glyph_height() };
+        for (int col = 0; col < BENCH_TEXT_COLS; col++) {
+            uint8_t ch = screen[row * BENCH_TEXT_COLS + col];
+            ctx.draw(pt, font.glyph_bitmap(ch));
+            pt.offset_by(font.glyph_width(ch) + font.glyph_spacing(), 0);
+        }
+    }
+}
+
+static void draw_by_run(LG::PixelBitmap& bitmap, const LG::Font& font, const char* screen)
+{
+    LG::Context ctx(bitmap);
+    ctx.set_fill_color(LG::Color(20, 20, 20));
+    for (int row = 0; row < BENCH_TEXT_ROWS; row++) {
+        ctx.draw_text({ 0, row * (int)font.glyph_height() }, font, &screen[row * BENCH_TEXT_COLS], BENCH_TEXT_COLS);
+    }
+}
+
+static bool same_pixels(const LG::PixelBitmap& a, const LG::PixelBitmap& b, const char* what)
+{
+    for (int y = 0; y < a.height(); y++) {
+        for (int x = 0; x < a.width(); x++) {
+            if (a[y][x].u32() != b[y][x].u32()) {
+                printf("[BENCH] Text: wrong %s pixel at %d %d\n", what, x, y);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Drives the terminal screen as TerminalView does: every change invalidates
+// a part of the view, and the collected region is displayed rect by rect.
+struct TerminalDriver {
+    TerminalScreen screen;
+    LG::PixelBitmap bitmap;
+    LG::Rect frame;
+    LG::Region pending {};
+    size_t row { 0 };
+    size_t col { 0 };
+
+    TerminalDriver(const LG::Font& font, const LG::Rect& frame, int width, int height)
+        : screen(font)
+        , bitmap(width, height)
+        , frame(frame)
+    {
+        fill_background(bitmap);
+        screen.resize(BENCH_TEXT_COLS, BENCH_TEXT_ROWS);
+        pending.unite(bounds());
+    }
+
+    LG::Rect bounds() const { return LG::Rect(0, 0, frame.width(), frame.height()); }
+
+    void invalidate_cursor()
+    {
+        size_t last_col = screen.cursor_last_col(col);
+        screen.mark_cells_dirty(row, col, last_col);
+        pending.unite(screen.cells_rect(row, col, last_col));
+    }
+
+    void put_char(char c)
+    {
+        invalidate_cursor();
+        screen.set_char(row, col, c);
+        pending.unite(screen.cells_rect(row, col, col));
+        col++;
+        invalidate_cursor();
+    }
+
+    void new_line()
+    {
+        invalidate_cursor();
+        col = 0;
+        if (++row == BENCH_TEXT_ROWS) {
+            row--;
+            screen.scroll_line();
+            pending.unite(bounds());
+        }
+        invalidate_cursor();
+    }
+
+    void display()
+    {
+        auto region = pending.intersection(bounds());
+        pending.clear();
+        for (int i = 0; i < region.rects().size(); i++) {
+            screen.display(bitmap, frame, region.rects()[i], row, col);
+        }
+    }
+};
+
+// Like `cat` in the terminal: a line is printed and the screen goes up.
+static void write_line(TerminalDriver& driver, int number)
+{
+    char line[BENCH_TEXT_COLS];
+    int length = (number * 13) % (BENCH_TEXT_COLS - 1);
+    fill_line(line, number, length);
+    for (int i = 0; i < length; i++) {
+        driver.put_char(line[i]);
+    }
+    driver.new_line();
+}
+
+// With @full_redraw every cell is drawn again for each line, as the terminal
+// did before it kept its pixels.
+static void bench_terminal_scroll(TerminalDriver& driver, bool full_redraw, const char* name)
+{
+    RUN_BENCH(name, 3)
+    {
+        for (int line = 0; line < BENCH_TEXT_SCROLLED_LINES; line++) {
+            write_line(driver, line);
+            if (full_redraw) {
+                driver.screen.mark_all_dirty();
+            }
+            driver.display();
+        }
+    }
+}
+
+// The terminal, which redraws only dirty cells and moves scrolled lines,
+// leaves the same pixels as the final screen drawn at once.
+static bool test_terminal_scroll(const LG::Font& font, const LG::Rect& frame, int width, int height)
+{
+    TerminalDriver driven(font, frame, width, height);
+    TerminalDriver reference(font, frame, width, height);
+    char line[BENCH_TEXT_COLS];
+    for (int number = 0; number < 3 * BENCH_TEXT_ROWS; number++) {
+        int length = (number * 13) % (BENCH_TEXT_COLS - 1);
+        fill_line(line, number, length);
+        for (int i = 0; i < length; i++) {
+            driven.put_char(line[i]);
+            reference.put_char(line[i]);
+            if (i % 17 == 16) {
+                driven.display();
+            }
+        }
+        driven.new_line();
+        reference.new_line();
+        if (number % 3) {
+            driven.display();
+        }
+    }
+
+    driven.display();
+    reference.display();
+    return same_pixels(driven.bitmap, reference.bitmap, "terminal");
+}
+
+// A run from the atlas leaves the same pixels as glyphs drawn one by one,
+// also when the run is cut by a clip.
+static bool test_text(const LG::Font& font, const char* screen, int width, int height)
+{
+    LG::PixelBitmap by_glyph(width, height);
+    LG::PixelBitmap by_run(width, height);
+    LG::PixelBitmap clipped(width, height);
+    fill_background(by_glyph);
+    fill_background(by_run);
+    fill_background(clipped);
+    draw_by_glyph(by_glyph, font, screen);
+    draw_by_run(by_run, font, screen);
+
+    LG::Rect clip(width / 3 + 1, height / 3 + 1, width / 3, height / 3);
+    LG::Context ctx(clipped);
+    ctx.add_clip(clip);
+    ctx.set_fill_color(LG::Color(20, 20, 20));
+    for (int row = 0; row < BENCH_TEXT_ROWS; row++) {
+        ctx.draw_text({ 0, row * (int)font.glyph_height() }, font, &screen[row * BENCH_TEXT_COLS], BENCH_TEXT_COLS);
+    }
+
+    LG::Color background(0xE9E9EA);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            if (by_glyph[y][x].u32() != by_run[y][x].u32()) {
+                printf("[BENCH] Text: wrong pixel at %d %d\n", x, y);
+                return false;
+            }
+            bool inside = clip.contains(x, y);
+            if (clipped[y][x].u32() != (inside ? by_glyph[y][x].u32() : background.u32())) {
+                printf("[BENCH] Text: wrong clipped pixel at %d %d\n", x, y);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void bench_text()
+{
+    LG::Font* font = LG::Font::load_from_file("/res/fonts/LizaRegular8x10.font");
+    if (!font) {
+        return;
+    }
+
+    char screen[BENCH_TEXT_ROWS * BENCH_TEXT_COLS];
+    fill_screen(screen);
+    int width = BENCH_TEXT_COLS * (font->glyph_width('.') + font->glyph_spacing());
+    int height = BENCH_TEXT_ROWS * font->glyph_height();
+    if (!test_text(*font, screen, width, height)) {
+        return;
+    }
+
+    // The terminal takes the whole width of the window, or sits inside it.
+    int terminal_width = width + 4;
+    int terminal_height = height + 4;
+    LG::Rect whole(0, 0, terminal_width, terminal_height);
+    LG::Rect inside(3, 5, terminal_width, terminal_height);
+    if (!test_terminal_scroll(*font, whole, terminal_width, terminal_height)
+        || !test_terminal_scroll(*font, inside, terminal_width + 7, terminal_height + 9)) {
+        return;
+    }
+
+    LG::PixelBitmap bitmap(width, height);
+    fill_background(bitmap);
+    RUN_BENCH("TEXT SCREEN GLYPH BY GLYPH", 3)
+    {
+        for (int frame = 0; frame < BENCH_TEXT_FRAMES; frame++) {
+            draw_by_glyph(bitmap, *font, screen);
+        }
+    }
+    RUN_BENCH("TEXT SCREEN ATLAS RUNS", 3)
+    {
+        for (int frame = 0; frame < BENCH_TEXT_FRAMES; frame++) {
+            draw_by_run(bitmap, *font, screen);
+        }
+    }
+
+    // The screen is full, so every line scrolls it.
+    TerminalDriver driver(*font, whole, terminal_width, terminal_height);
+    for (int line = 0; line < BENCH_TEXT_ROWS; line++) {
+        write_line(driver, line);
+    }
+    driver.display();
+    bench_terminal_scroll(driver, true, "100 SCROLLED LINES FULL REDRAW");
+    bench_terminal_scroll(driver, false, "100 SCROLLED LINES TERMINAL");
+}
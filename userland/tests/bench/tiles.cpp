@@ -0,0 +1,64 @@
+#include "common.h"
+#include "scene.h"
+#include <cstdio>
+#include <libfoundation/WorkerPool.h>
+#include <libg/PixelBitmap.h>
+
+#define BENCH_TILES_WIDTH 1024
+#define BENCH_TILES_HEIGHT 768
+#define BENCH_TILES_FRAMES 10
+
+// A full screen repaint, as the compositor does it after a resolution change
+// or a wallpaper switch: the wallpaper, a few windows and translucent badges.
+static void setup_tile_scene(Scene& scene)
+{
+    for (int i = 0; i < 8; i++) {
+        scene.add_badge(40 + i * 120, 600 - i * 60);
+    }
+    for (int i = 3; i >= 0; i--) {
+        scene.add_window(60 + i * 140, 50 + i * 100);
+    }
+}
+
+// Whatever the number of threads, the screen is the same as drawn in one go.
+static bool test_tiles(Scene& scene, LFoundation::WorkerPool& pool)
+{
+    LG::PixelBitmap reference(BENCH_TILES_WIDTH, BENCH_TILES_HEIGHT);
+    LG::PixelBitmap tiled(BENCH_TILES_WIDTH, BENCH_TILES_HEIGHT);
+    scene.draw_reference(reference);
+    scene.compose(tiled, scene.bounds(), pool);
+    if (!same_bitmaps(tiled, reference, "Tiles")) {
+        printf("[BENCH] Tiles: drawn with %d threads\n", (int)pool.threads() + 1);
+        return false;
+    }
+    return true;
+}
+
+static void bench_tiles_with(Scene& scene, LFoundation::WorkerPool& pool, const char* name)
+{
+    LG::PixelBitmap buffer(BENCH_TILES_WIDTH, BENCH_TILES_HEIGHT);
+    RUN_BENCH(name, 3)
+    {
+        for (int frame = 0; frame < BENCH_TILES_FRAMES; frame++) {
+            scene.compose(buffer, scene.bounds(), pool);
+        }
+    }
+}
+
+void bench_tiles()
+{
+    // Workers live as long as the process, so the pools are never freed.
+    static LFoundation::WorkerPool single_thread(0);
+    static LFoundation::WorkerPool two_threads(1);
+    static LFoundation::WorkerPool four_threads(3);
+
+    Scene scene(BENCH_TILES_WIDTH, BENCH_TILES_HEIGHT);
+    setup_tile_scene(scene);
+    if (!test_tiles(scene, single_thread) || !test_tiles(scene, two_threads) || !test_tiles(scene, four_threads)) {
+        return;
+    }
+
+    bench_tiles_with(scene, single_thread, "10 FULL SCREEN FRAMES 1 THREAD");
+    bench_tiles_with(scene, two_threads, "10 FULL SCREEN FRAMES 2 THREADS");
+    bench_tiles_with(scene, four_threads, "10 FULL SCREEN FRAMES 4 THREADS");
+}
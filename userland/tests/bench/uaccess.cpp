@@ -0,0 +1,96 @@
+#include "common.h"
+#include <cstdio>
+#include <cstdlib>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#define BENCH_UACCESS_PATH "/tmp/bench_uaccess.sock"
+#define BENCH_UACCESS_TRANSFER (4 * 1024 * 1024)
+#define BENCH_UACCESS_MAX_CHUNK 8192
+
+// Not covered by any zone of the process.
+#define BENCH_UACCESS_BAD_PTR ((void*)16)
+
+static char buf[BENCH_UACCESS_MAX_CHUNK];
+
+// Bad pointers passed to the kernel should fail the call, the process goes on.
+static bool test_uaccess_faults(int wfd, int rfd)
+{
+    bool uname_failed = (uname((utsname_t*)BENCH_UACCESS_BAD_PTR) < 0 && errno == EFAULT);
+    bool write_failed = (write(wfd, BENCH_UACCESS_BAD_PTR, 64) == -EFAULT);
+
+    // The reader has something to read, so it doesn't wait, and the data stays after the failed read.
+    bool wrote = (write(wfd, buf, 64) == 64);
+    bool read_failed = (read(rfd, (char*)BENCH_UACCESS_BAD_PTR, 64) == -EFAULT);
+    bool data_kept = (read(rfd, buf, 64) == 64);
+    if (!uname_failed || !write_failed || !wrote || !read_failed || !data_kept) {
+        printf("[BENCH] Uaccess: bad pointers are not rejected\n");
+        return false;
+    }
+    return true;
+}
+
+// Every write copies the chunk from the user memory into the socket buffer
+// and every read copies it back, so both copy directions are measured.
+static bool bench_uaccess_chunk(int wfd, int rfd, size_t chunk)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "UACCESS %dB", (int)chunk);
+
+    RUN_BENCH(name, 3)
+    {
+        for (size_t done = 0; done < BENCH_UACCESS_TRANSFER; done += chunk) {
+            if (write(wfd, buf, chunk) != chunk || read(rfd, buf, chunk) != chunk) {
+                printf("[BENCH] Uaccess: short transfer of %d bytes\n", (int)chunk);
+                return false;
+            }
+        }
+
+        // Bytes per usec are MB/s.
+        gettimeofday(&ttv, &tz);
+        int usec = to_usec();
+        int mbps = usec ? BENCH_UACCESS_TRANSFER / usec : 0;
+        printf("[BENCH] Uaccess %dB: %d.%03d GB/s\n", (int)chunk, mbps / 1000, mbps % 1000);
+    }
+    return true;
+}
+
+void bench_uaccess()
+{
+    int listen_fd = socket(PF_LOCAL, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        return;
+    }
+    if (bind(listen_fd, BENCH_UACCESS_PATH, sizeof(BENCH_UACCESS_PATH) - 1) < 0 || listen(listen_fd, 1) < 0) {
+        close(listen_fd);
+        return;
+    }
+
+    int wfd = socket(PF_LOCAL, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (wfd < 0 || connect(wfd, BENCH_UACCESS_PATH, sizeof(BENCH_UACCESS_PATH) - 1) < 0) {
+        close(listen_fd);
+        return;
+    }
+    int rfd = accept(listen_fd);
+    if (rfd < 0) {
+        close(wfd);
+        close(listen_fd);
+        return;
+    }
+
+    if (test_uaccess_faults(wfd, rfd)) {
+        const size_t chunks[] = { 64, 512, 4096, BENCH_UACCESS_MAX_CHUNK };
+        for (size_t chunk : chunks) {
+            if (!bench_uaccess_chunk(wfd, rfd, chunk)) {
+                break;
+            }
+        }
+    }
+
+    close(wfd);
+    close(rfd);
+    close(listen_fd);
+    unlink(BENCH_UACCESS_PATH);
+}